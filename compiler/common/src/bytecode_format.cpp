@@ -5,6 +5,43 @@ nlohmann::json BytecodeInstruction::toJson() const {
     j["operation"] = operation;
     j["operands"] = operands;
     j["label"] = label;
+    j["dtype"] = dtype;
+    if (!shape.empty()) {
+        j["shape"] = shape;
+    }
+    if (operation == Instruction::GEMM) {
+        j["alpha"] = alpha;
+        j["beta"] = beta;
+        j["post_ops"] = nlohmann::json::array();
+        for (const auto& op : postOps) {
+            nlohmann::json opJson;
+            opJson["op"] = postOpToString(op.kind);
+            if (postOpHasOperand(op.kind)) {
+                opJson["operand"] = op.operand;
+            } else if (op.kind == PostOpKind::CLAMP) {
+                opJson["min"] = op.value;
+                opJson["max"] = op.upper;
+            } else {
+                opJson["value"] = op.value;
+            }
+            j["post_ops"].push_back(opJson);
+        }
+    }
+    if (operation == Instruction::SCALE) {
+        j["alpha"] = alpha;
+    }
+    if (operation == Instruction::MATRIX_POWER) {
+        j["exponent"] = exponent;
+    }
+    if (operation == Instruction::MATRIX_MULTIPLY_MOD) {
+        j["modulus"] = modulus;
+        if (signedRemainder) {
+            j["signed_remainder"] = true;
+        }
+    }
+    if (operation == Instruction::MATRIX_MULTIPLY && semiring != Semiring::PLUS_TIMES) {
+        j["semiring"] = semiringToString(semiring);
+    }
     return j;
 }
 
@@ -13,6 +50,30 @@ BytecodeInstruction BytecodeInstruction::fromJson(const nlohmann::json& j) {
     instr.operation = j["operation"];
     instr.operands = j["operands"].get<std::vector<int>>();
     instr.label = j["label"].get<std::string>();
+    if (j.contains("dtype")) {
+        instr.dtype = j["dtype"];
+    }
+    if (j.contains("shape")) {
+        instr.shape = j["shape"].get<std::vector<std::string>>();
+    }
+    instr.alpha = j.value("alpha", 1.0);
+    instr.beta = j.value("beta", 0.0);
+    if (j.contains("post_ops")) {
+        for (const auto& opJson : j["post_ops"]) {
+            PostOp op;
+            op.kind = stringToPostOp(opJson["op"].get<std::string>());
+            op.operand = opJson.value("operand", -1);
+            op.value = opJson.value(op.kind == PostOpKind::CLAMP ? "min" : "value", 0.0);
+            op.upper = opJson.value("max", 0.0);
+            instr.postOps.push_back(op);
+        }
+    }
+    instr.exponent = j.value("exponent", "");
+    instr.modulus = j.value("modulus", "");
+    instr.signedRemainder = j.value("signed_remainder", false);
+    if (j.contains("semiring")) {
+        instr.semiring = stringToSemiring(j["semiring"].get<std::string>());
+    }
     return instr;
 }
 
@@ -25,9 +86,12 @@ nlohmann::json Program::toJson() const {
     j["matrices"] = nlohmann::json::array();
     for (const auto& mat : matrices) {
         nlohmann::json matJson;
-        matJson["size"] = mat.size;
+        matJson["rows"] = mat.rows;
+        matJson["cols"] = mat.cols;
+        matJson["ld"] = mat.ld;
         matJson["name"] = mat.name;
         matJson["isOutput"] = mat.isOutput;
+        matJson["dtype"] = mat.dtype;
         j["matrices"].push_back(matJson);
     }
     return j;
@@ -40,9 +104,18 @@ Program Program::fromJson(const nlohmann::json& j) {
     }
     for (const auto& matJson : j["matrices"]) {
         Matrix mat;
-        mat.size = matJson["size"];
+        if (matJson.contains("size")) {
+            mat.rows = mat.cols = mat.ld = matJson["size"];
+        } else {
+            mat.rows = matJson["rows"];
+            mat.cols = matJson["cols"];
+            mat.ld = matJson.value("ld", mat.cols);
+        }
         mat.name = matJson["name"];
         mat.isOutput = matJson["isOutput"];
+        if (matJson.contains("dtype")) {
+            mat.dtype = matJson["dtype"];
+        }
         prog.matrices.push_back(mat);
     }
     return prog;
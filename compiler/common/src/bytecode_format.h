@@ -3,19 +3,46 @@
 #include <vector>
 #include <nlohmann/json.hpp>
 #include "instruction_set.h"
+#include "dtype.h"
+#include "epilogue.h"
+#include "semiring.h"
 
 struct BytecodeInstruction {
     Instruction operation;
     std::vector<int> operands;
     std::string label;
+    DType dtype = DType::I32;
+    // Names of the integer variables holding a matrix's rows and columns,
+    // optionally preceded by a batch count; empty means square, sized by "n".
+    // An entry written as a decimal number is a size fixed at compile time.
+    std::vector<std::string> shape;
+    // GEMM only: result = postOps(alpha * A * B + beta * result). SCALE
+    // uses alpha as its factor.
+    double alpha = 1.0;
+    double beta = 0.0;
+    std::vector<PostOp> postOps;
+    // MATRIX_POWER only: integer variable or decimal literal for the power.
+    std::string exponent;
+    // MATRIX_MULTIPLY_MOD only: integer variable or decimal literal for p.
+    std::string modulus;
+    // MATRIX_MULTIPLY_MOD only: the program's remainder is signed (C++ `%` on
+    // int), so negative sums would keep their sign. The runtime then needs
+    // non-negative A and B.
+    bool signedRemainder = false;
+    // MATRIX_MULTIPLY only: how products are summed, the ordinary product
+    // by default.
+    Semiring semiring = Semiring::PLUS_TIMES;
     nlohmann::json toJson() const;
     static BytecodeInstruction fromJson(const nlohmann::json& j);
 };
 
 struct Matrix {
-    int size;
+    int rows;
+    int cols;
+    int ld;
     std::string name;
     bool isOutput;
+    DType dtype = DType::I32;
 };
 
 struct Program {
@@ -31,4 +58,12 @@ inline void to_json(nlohmann::json& j, const Instruction& inst) {
 
 inline void from_json(const nlohmann::json& j, Instruction& inst) {
     inst = stringToInstruction(j.get<std::string>());
+}
+
+inline void to_json(nlohmann::json& j, const DType& dtype) {
+    j = dtypeToString(dtype);
+}
+
+inline void from_json(const nlohmann::json& j, DType& dtype) {
+    dtype = stringToDType(j.get<std::string>());
 }
\ No newline at end of file
@@ -0,0 +1,33 @@
+#include "dtype.h"
+#include <cstdint>
+#include <stdexcept>
+const char* dtypeToString(DType dtype) {
+    switch (dtype) {
+        case DType::I32: return "i32";
+        case DType::F32: return "f32";
+        case DType::F64: return "f64";
+        case DType::I64: return "i64";
+        case DType::I128: return "i128";
+        default: return "unknown";
+    }
+}
+DType stringToDType(const std::string& str) {
+    if (str == "i32") return DType::I32;
+    if (str == "f32") return DType::F32;
+    if (str == "f64") return DType::F64;
+    if (str == "i64") return DType::I64;
+    if (str == "i128") return DType::I128;
+    throw std::runtime_error("Unknown matrix element type: " + str);
+}
+std::size_t dtypeSize(DType dtype) {
+    switch (dtype) {
+        case DType::F32: return sizeof(float);
+        case DType::F64: return sizeof(double);
+        case DType::I64: return sizeof(int64_t);
+        case DType::I128: return sizeof(__int128);
+        default: return sizeof(int);
+    }
+}
+bool isWideInteger(DType dtype) {
+    return dtype == DType::I64 || dtype == DType::I128;
+}
@@ -0,0 +1,15 @@
+#pragma once
+#include <cstddef>
+#include <string>
+enum class DType {
+    I32,
+    F32,
+    F64,
+    // Wide integers, only produced by exact multiplies of I32 matrices.
+    I64,
+    I128
+};
+const char* dtypeToString(DType dtype);
+DType stringToDType(const std::string& str);
+std::size_t dtypeSize(DType dtype);
+bool isWideInteger(DType dtype);
@@ -0,0 +1,23 @@
+#include "epilogue.h"
+#include <stdexcept>
+const char* postOpToString(PostOpKind kind) {
+    switch (kind) {
+        case PostOpKind::BIAS: return "bias";
+        case PostOpKind::ADD: return "add";
+        case PostOpKind::SUB: return "sub";
+        case PostOpKind::SCALE: return "scale";
+        case PostOpKind::CLAMP: return "clamp";
+        default: return "unknown";
+    }
+}
+PostOpKind stringToPostOp(const std::string& str) {
+    if (str == "bias") return PostOpKind::BIAS;
+    if (str == "add") return PostOpKind::ADD;
+    if (str == "sub") return PostOpKind::SUB;
+    if (str == "scale") return PostOpKind::SCALE;
+    if (str == "clamp") return PostOpKind::CLAMP;
+    throw std::runtime_error("Unknown post-op: " + str);
+}
+bool postOpHasOperand(PostOpKind kind) {
+    return kind == PostOpKind::BIAS || kind == PostOpKind::ADD || kind == PostOpKind::SUB;
+}
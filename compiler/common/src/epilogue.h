@@ -0,0 +1,40 @@
+#pragma once
+#include <string>
+#include <vector>
+
+struct MatrixBuffer;
+
+// Elementwise steps applied, in order, to alpha * A * B + beta * C before the
+// result is stored.
+enum class PostOpKind {
+    BIAS,     // adds row vector operand (1 x n) to every row
+    ADD,      // adds matrix operand
+    SUB,      // subtracts matrix operand
+    SCALE,    // multiplies by value
+    CLAMP     // limits to [value, upper]
+};
+const char* postOpToString(PostOpKind kind);
+PostOpKind stringToPostOp(const std::string& str);
+bool postOpHasOperand(PostOpKind kind);
+
+// Bytecode form: operand is a matrix slot, -1 for the scalar ops.
+struct PostOp {
+    PostOpKind kind;
+    int operand = -1;
+    double value = 0.0;
+    double upper = 0.0;
+};
+
+// Runtime form with the operand slots resolved to buffers.
+struct MatrixEpilogue {
+    struct Step {
+        PostOpKind kind;
+        MatrixBuffer* matrix;
+        double value;
+        double upper;
+    };
+    double alpha = 1.0;
+    double beta = 0.0;
+    std::vector<Step> steps;
+    bool trivial() const { return alpha == 1.0 && beta == 0.0 && steps.empty(); }
+};
@@ -6,8 +6,15 @@ const char* instructionToString(Instruction inst) {
         case Instruction::ALLOC_MATRIX: return "ALLOC_MATRIX";
         case Instruction::WRITE_MATRIX: return "WRITE_MATRIX";
         case Instruction::MATRIX_MULTIPLY: return "MATRIX_MULTIPLY";
+        case Instruction::MATRIX_MULTIPLY_BATCHED: return "MATRIX_MULTIPLY_BATCHED";
+        case Instruction::GEMM: return "GEMM";
+        case Instruction::MATRIX_POWER: return "MATRIX_POWER";
+        case Instruction::MATRIX_MULTIPLY_MOD: return "MATRIX_MULTIPLY_MOD";
+        case Instruction::MATRIX_MULTIPLY_EXACT: return "MATRIX_MULTIPLY_EXACT";
         case Instruction::ADD: return "ADD";
         case Instruction::SUB: return "SUB";
+        case Instruction::SCALE: return "SCALE";
+        case Instruction::TRANSPOSE: return "TRANSPOSE";
         case Instruction::JUMP: return "JUMP";
         case Instruction::JUMP_IF_ZERO: return "JUMP_IF_ZERO";
         case Instruction::LOOP_BEGIN: return "LOOP_BEGIN";
@@ -24,8 +31,15 @@ Instruction stringToInstruction(const std::string& str) {
     if (str == "ALLOC_MATRIX") return Instruction::ALLOC_MATRIX;
     if (str == "WRITE_MATRIX") return Instruction::WRITE_MATRIX;
     if (str == "MATRIX_MULTIPLY") return Instruction::MATRIX_MULTIPLY;
+    if (str == "MATRIX_MULTIPLY_BATCHED") return Instruction::MATRIX_MULTIPLY_BATCHED;
+    if (str == "GEMM") return Instruction::GEMM;
+    if (str == "MATRIX_POWER") return Instruction::MATRIX_POWER;
+    if (str == "MATRIX_MULTIPLY_MOD") return Instruction::MATRIX_MULTIPLY_MOD;
+    if (str == "MATRIX_MULTIPLY_EXACT") return Instruction::MATRIX_MULTIPLY_EXACT;
     if (str == "ADD") return Instruction::ADD;
     if (str == "SUB") return Instruction::SUB;
+    if (str == "SCALE") return Instruction::SCALE;
+    if (str == "TRANSPOSE") return Instruction::TRANSPOSE;
     if (str == "JUMP") return Instruction::JUMP;
     if (str == "JUMP_IF_ZERO") return Instruction::JUMP_IF_ZERO;
     if (str == "LOOP_BEGIN") return Instruction::LOOP_BEGIN;
@@ -6,8 +6,15 @@ enum class Instruction {
     ALLOC_MATRIX,       
     WRITE_MATRIX,       
     MATRIX_MULTIPLY,    
+    MATRIX_MULTIPLY_BATCHED,
+    GEMM,
+    MATRIX_POWER,
+    MATRIX_MULTIPLY_MOD,
+    MATRIX_MULTIPLY_EXACT,
     ADD,                
     SUB,                
+    SCALE,
+    TRANSPOSE,
     JUMP,               
     JUMP_IF_ZERO,       
     LOOP_BEGIN,         
@@ -2,22 +2,91 @@
 #include "metal_buffer_wrapper.h"
 #include <Metal/Metal.h>
 #include <algorithm>
+#include <cmath>
 #include <iostream>
 
-MatrixBuffer::MatrixBuffer(int size) 
-    : size(size), 
+const char* layoutToString(MatrixLayout layout) {
+    switch (layout) {
+        case MatrixLayout::TILED: return "tiled";
+        case MatrixLayout::MORTON: return "morton";
+        default: return "row-major";
+    }
+}
+
+bool stringToLayout(const std::string& name, MatrixLayout& layout) {
+    if (name == "row-major" || name == "rowmajor") {
+        layout = MatrixLayout::ROW_MAJOR;
+    } else if (name == "tiled" || name == "tile-major") {
+        layout = MatrixLayout::TILED;
+    } else if (name == "morton" || name == "z-order") {
+        layout = MatrixLayout::MORTON;
+    } else {
+        return false;
+    }
+    return true;
+}
+
+size_t mortonTileIndex(int tileRows, int tileCols, int ti, int tj) {
+    size_t base = 0;
+    while (tileRows > 1 || tileCols > 1) {
+        if (tileRows >= tileCols) {
+            int half = tileRows / 2;
+            if (ti < half) {
+                tileRows = half;
+            } else {
+                base += static_cast<size_t>(half) * tileCols;
+                ti -= half;
+                tileRows -= half;
+            }
+        } else {
+            int half = tileCols / 2;
+            if (tj < half) {
+                tileCols = half;
+            } else {
+                base += static_cast<size_t>(tileRows) * half;
+                tj -= half;
+                tileCols -= half;
+            }
+        }
+    }
+    return base;
+}
+
+MatrixBuffer::MatrixBuffer(int batch, int rows, int cols, DType dtype, MatrixLayout layout,
+                           int tileHeight, int tileWidth) 
+    : batch(batch), 
+      rows(rows), 
+      cols(cols), 
+      ld(cols), 
+      dtype(dtype), 
+      layout(layout),
+      tileHeight(rows),
+      tileWidth(cols),
       unifiedBuffer(nullptr), 
       metalBuffer(nullptr), 
-      aneModel(nullptr) {
+      aneModel(nullptr),
+      nonZeros(-1) {
     state.store(MemoryAccessState::SHARED);
-    size_t bufferSize = size * size * sizeof(int);
+    if (layout != MatrixLayout::ROW_MAJOR && batch != 1) {
+        throw std::invalid_argument("Only row-major buffers can hold a batch of matrices");
+    }
+    if (layout == MatrixLayout::MORTON) {
+        this->tileHeight = this->tileWidth = MORTON_TILE;
+    } else if (layout == MatrixLayout::TILED) {
+        if (tileHeight <= 0 || tileWidth <= 0) {
+            throw std::invalid_argument("Tiled matrix needs a positive tile size");
+        }
+        this->tileHeight = std::min(tileHeight, rows);
+        this->tileWidth = std::min(tileWidth, cols);
+    }
+    size_t bufferSize = static_cast<size_t>(batch) * batchStride() * dtypeSize(dtype);
     metalBuffer = new MTLBufferWrapper();
     unifiedBuffer = metalBuffer->createBuffer(bufferSize, true);
     if (unifiedBuffer) {
         memset(unifiedBuffer, 0, bufferSize);
     } else {
         std::cerr << "ERROR: Failed to allocate unified memory for matrix of size " 
-                  << size << "x" << size << std::endl;
+                  << batch << "x" << rows << "x" << cols << std::endl;
         throw std::runtime_error("Failed to allocate unified memory for matrix");
     }
 }
@@ -128,65 +197,83 @@ void MatrixBuffer::releaseResources() {
     unifiedBuffer = nullptr;
 }
 
+// Row-major rows past the first matrix continue into the next batch entry.
+size_t MatrixBuffer::index(int row, int col) const {
+    if (layout == MatrixLayout::ROW_MAJOR) {
+        return static_cast<size_t>(row) * ld + col;
+    }
+    int ti = row / tileHeight;
+    int tj = col / tileWidth;
+    size_t tile = layout == MatrixLayout::MORTON ? mortonTileIndex(tileRows(), tileCols(), ti, tj)
+                                                 : static_cast<size_t>(ti) * tileCols() + tj;
+    return tile * tileHeight * tileWidth + static_cast<size_t>(row % tileHeight) * tileWidth + col % tileWidth;
+}
+
 int MatrixBuffer::get(int row, int col) const {
-    if (row < 0 || row >= size || col < 0 || col >= size) {
+    if (row < 0 || row >= rows || col < 0 || col >= cols) {
         throw std::out_of_range("Matrix index out of bounds");
     }
-    return static_cast<int*>(unifiedBuffer)[row * size + col];
+    return static_cast<int*>(unifiedBuffer)[index(row, col)];
 }
 
 void MatrixBuffer::set(int row, int col, int value) {
-    if (row < 0 || row >= size || col < 0 || col >= size) {
+    if (row < 0 || row >= rows || col < 0 || col >= cols) {
         throw std::out_of_range("Matrix index out of bounds");
     }
-    static_cast<int*>(unifiedBuffer)[row * size + col] = value;
+    static_cast<int*>(unifiedBuffer)[index(row, col)] = value;
 }
 
-int& MatrixBuffer::operator[](size_t index) {
-    if (index >= static_cast<size_t>(size * size)) {
+// Row-major buffers index storage directly; other layouts take the
+// row-major position (row * cols + col) and map it through index().
+int& MatrixBuffer::operator[](size_t position) {
+    if (layout == MatrixLayout::ROW_MAJOR) {
+        if (position >= batch * batchStride()) {
+            throw std::out_of_range("Matrix index out of bounds");
+        }
+        return static_cast<int*>(unifiedBuffer)[position];
+    }
+    if (position >= static_cast<size_t>(rows) * cols) {
         throw std::out_of_range("Matrix index out of bounds");
     }
-    return static_cast<int*>(unifiedBuffer)[index];
+    return static_cast<int*>(unifiedBuffer)[index(static_cast<int>(position / cols), static_cast<int>(position % cols))];
 }
 
-const int& MatrixBuffer::operator[](size_t index) const {
-    if (index >= static_cast<size_t>(size * size)) {
-        throw std::out_of_range("Matrix index out of bounds");
-    }
-    return static_cast<int*>(unifiedBuffer)[index];
+const int& MatrixBuffer::operator[](size_t position) const {
+    return const_cast<MatrixBuffer&>(*this)[position];
 }
 
 int* MatrixBuffer::getRawData() {
     return static_cast<int*>(unifiedBuffer);
 }
 
-std::vector<WorkChunk> createWorkChunks(int matrixSize, int numChunks) {
+std::vector<WorkChunk> createWorkChunks(int rows, int cols, int blockRows, int blockCols) {
     std::vector<WorkChunk> chunks;
-    if (matrixSize <= 128) {
-        int blockSize = std::min(32, matrixSize / 4);
-        if (matrixSize % blockSize != 0) {
-            while (matrixSize % blockSize != 0 && blockSize > 4) {
-                blockSize -= 4; 
-            }
+    for (int i = 0; i < rows; i += blockRows) {
+        for (int j = 0; j < cols; j += blockCols) {
+            int endRow = std::min(i + blockRows, rows);
+            int endCol = std::min(j + blockCols, cols);
+            chunks.emplace_back(i, endRow, j, endCol);
         }
-        for (int i = 0; i < matrixSize; i += blockSize) {
-            for (int j = 0; j < matrixSize; j += blockSize) {
-                int endRow = std::min(i + blockSize, matrixSize);
-                int endCol = std::min(j + blockSize, matrixSize);
-                chunks.emplace_back(i, endRow, j, endCol);
-            }
-        }
-    } else {
-        int blockSize = std::max(4, matrixSize / (int)sqrt(numChunks));
-        for (int i = 0; i < matrixSize; i += blockSize) {
-            for (int j = 0; j < matrixSize; j += blockSize) {
-                int endRow = std::min(i + blockSize, matrixSize);
-                int endCol = std::min(j + blockSize, matrixSize);
-                chunks.emplace_back(i, endRow, j, endCol);
+    }
+    return chunks;
+}
+
+std::vector<WorkChunk> createWorkChunks(int rows, int cols, int numChunks) {
+    int shortSide = std::min(rows, cols);
+    if (shortSide <= 128) {
+        int blockSize = std::max(1, std::min(32, shortSide / 4));
+        if (shortSide % blockSize != 0) {
+            while (shortSide % blockSize != 0 && blockSize > 4) {
+                blockSize -= 4; 
             }
         }
+        return createWorkChunks(rows, cols, blockSize, blockSize);
     }
-    return chunks;
+    // Square blocks covering rows * cols / numChunks cells each, so a
+    // tall-skinny result splits along its long side only.
+    double cells = static_cast<double>(rows) * cols / std::max(1, numChunks);
+    int blockSize = std::max(4, std::min(shortSide, static_cast<int>(std::sqrt(cells))));
+    return createWorkChunks(rows, cols, blockSize, blockSize);
 }
 
 void partitionChunks(std::vector<WorkChunk>& chunks,
@@ -1,7 +1,13 @@
 #pragma once
 #include <vector>
+#include <algorithm>
 #include <atomic>
 #include <mutex>
+#include <climits>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include "dtype.h"
 
 class MTLBufferWrapper;
 enum class MemoryAccessState {
@@ -14,19 +20,78 @@ enum class MemoryAccessState {
     SHARED            
 };
 
+struct ValueRange {
+    int minValue = INT_MAX;
+    int maxValue = INT_MIN;
+    bool known() const { return minValue <= maxValue; }
+    void include(int value) {
+        if (value < minValue) minValue = value;
+        if (value > maxValue) maxValue = value;
+    }
+    long long maxAbs() const {
+        return std::max(std::llabs(minValue), std::llabs(maxValue));
+    }
+    int bitWidth() const {
+        int width = 1;
+        while (width < 32 && (minValue < -(1LL << (width - 1)) || maxValue > (1LL << (width - 1)) - 1)) {
+            width++;
+        }
+        return width;
+    }
+    bool fitsInt8() const { return known() && minValue >= -128 && maxValue <= 127; }
+    bool fitsUint8() const { return known() && minValue >= 0 && maxValue <= 255; }
+    bool fitsInt16() const { return known() && minValue >= -32768 && maxValue <= 32767; }
+    // Only 0s and 1s, such as an adjacency matrix: multiplies can run bit-packed.
+    bool binary() const { return known() && minValue >= 0 && maxValue <= 1; }
+};
+
+// Storage order of a MatrixBuffer. TILED keeps tileHeight x tileWidth tiles,
+// each row-major, in row-major order of the tile grid; full-width tiles make
+// row panels, full-height ones column panels. MORTON keeps MORTON_TILE
+// square tiles ordered by recursively halving the tile grid along its longer
+// side (rows on a tie). A square power-of-two grid comes out in Z order, and
+// every block the halving reaches is one contiguous range.
+enum class MatrixLayout {
+    ROW_MAJOR,
+    TILED,
+    MORTON
+};
+
+constexpr int MORTON_TILE = 32;
+
+const char* layoutToString(MatrixLayout layout);
+bool stringToLayout(const std::string& name, MatrixLayout& layout);
+
+// Position of tile (ti, tj) in the MORTON order of a tileRows x tileCols grid.
+size_t mortonTileIndex(int tileRows, int tileCols, int ti, int tj);
+
 struct MatrixBuffer {
-    int size;                            
+    int batch;                           // matrices stacked batchStride() elements apart
+    int rows;                            
+    int cols;                            
+    int ld;                              // row stride in elements
+    DType dtype;                         
+    MatrixLayout layout;                 // TILED and MORTON buffers hold a single matrix
+    int tileHeight;                      // the whole matrix for ROW_MAJOR
+    int tileWidth;                       
     std::mutex accessMutex;              
     std::atomic<MemoryAccessState> state;  
     void* unifiedBuffer;                 
     MTLBufferWrapper* metalBuffer;       
     void* aneModel;                      
-    MatrixBuffer(int size);
+    ValueRange valueRange;
+    long long nonZeros;                  // counted at load time, -1 when unknown
+    MatrixBuffer(int batch, int rows, int cols, DType dtype, MatrixLayout layout = MatrixLayout::ROW_MAJOR,
+                 int tileHeight = 0, int tileWidth = 0);
+    MatrixBuffer(int rows, int cols, DType dtype = DType::I32) : MatrixBuffer(1, rows, cols, dtype) {}
+    explicit MatrixBuffer(int size, DType dtype = DType::I32) : MatrixBuffer(size, size, dtype) {}
     ~MatrixBuffer();
     void* getUnifiedBufferPtr();         
     int* getCPUReadPtr();                
     int* getCPUWritePtr();               
     void releaseCPUAccess();             
+    template <typename T> T* getCPUReadPtrAs() { return reinterpret_cast<T*>(getCPUReadPtr()); }
+    template <typename T> T* getCPUWritePtrAs() { return reinterpret_cast<T*>(getCPUWritePtr()); }
     void prepareForGPUAccess(bool readOnly);   
     void releaseGPUAccess();             
     void prepareForANEAccess(bool readOnly);   
@@ -34,13 +99,67 @@ struct MatrixBuffer {
     void syncToDevice() const;
     void syncFromDevice();
     void releaseResources();             
+    // Element offset of (row, col) in this buffer's layout.
+    size_t index(int row, int col) const;
     int get(int row, int col) const;     
     void set(int row, int col, int value);  
-    int& operator[](size_t index);       
-    const int& operator[](size_t index) const;  
+    int& operator[](size_t position);    
+    const int& operator[](size_t position) const;
     int* getRawData();                   
+    bool square() const { return rows == cols; }
+    int tileRows() const { return (rows + tileHeight - 1) / tileHeight; }
+    int tileCols() const { return (cols + tileWidth - 1) / tileWidth; }
+    // Distance between vertically adjacent elements of the same tile.
+    int rowStride() const { return layout == MatrixLayout::ROW_MAJOR ? ld : tileWidth; }
+    // Edge tiles are padded to full size.
+    size_t batchStride() const {
+        if (layout == MatrixLayout::ROW_MAJOR) {
+            return static_cast<size_t>(rows) * ld;
+        }
+        return static_cast<size_t>(tileRows()) * tileCols() * tileHeight * tileWidth;
+    }
+    size_t elements() const { return static_cast<size_t>(batch) * rows * cols; }
+    // Drops the value range and non-zero count taken at load time, once an
+    // instruction has written the buffer and they may no longer hold.
+    void clearValueStats() {
+        valueRange = ValueRange{};
+        nonZeros = -1;
+    }
+    double density() const {
+        return nonZeros < 0 ? 1.0 : static_cast<double>(nonZeros) / static_cast<double>(elements());
+    }
+    // Converts between this buffer's layout and a row-major copy of all
+    // batch * rows rows, ldRowMajor elements apart.
+    template <typename T> void fromRowMajor(const T* src, int ldRowMajor);
+    template <typename T> void toRowMajor(T* dst, int ldRowMajor);
 };
 
+template <typename T>
+void MatrixBuffer::fromRowMajor(const T* src, int ldRowMajor) {
+    T* data = getCPUWritePtrAs<T>();
+    int span = std::min(tileWidth, cols);
+    for (int i = 0; i < batch * rows; i++) {
+        for (int j = 0; j < cols; j += span) {
+            std::memcpy(data + index(i, j), src + static_cast<size_t>(i) * ldRowMajor + j,
+                        sizeof(T) * std::min(span, cols - j));
+        }
+    }
+    releaseCPUAccess();
+}
+
+template <typename T>
+void MatrixBuffer::toRowMajor(T* dst, int ldRowMajor) {
+    const T* data = getCPUReadPtrAs<T>();
+    int span = std::min(tileWidth, cols);
+    for (int i = 0; i < batch * rows; i++) {
+        for (int j = 0; j < cols; j += span) {
+            std::memcpy(dst + static_cast<size_t>(i) * ldRowMajor + j, data + index(i, j),
+                        sizeof(T) * std::min(span, cols - j));
+        }
+    }
+    releaseCPUAccess();
+}
+
 struct WorkChunk {
     int startRow;
     int endRow;
@@ -50,7 +169,10 @@ struct WorkChunk {
         : startRow(sr), endRow(er), startCol(sc), endCol(ec) {}
 };
 
-std::vector<WorkChunk> createWorkChunks(int matrixSize, int numChunks);
+// Tiles a rows x cols result into blocks of at most blockRows x blockCols.
+std::vector<WorkChunk> createWorkChunks(int rows, int cols, int blockRows, int blockCols);
+
+std::vector<WorkChunk> createWorkChunks(int rows, int cols, int numChunks);
 
 void partitionChunks(std::vector<WorkChunk>& chunks,
                     std::vector<WorkChunk>& cpu,
@@ -0,0 +1,18 @@
+#include "semiring.h"
+#include <stdexcept>
+const char* semiringToString(Semiring semiring) {
+    switch (semiring) {
+        case Semiring::PLUS_TIMES: return "plus_times";
+        case Semiring::MIN_PLUS: return "min_plus";
+        case Semiring::MAX_PLUS: return "max_plus";
+        case Semiring::OR_AND: return "or_and";
+        default: return "unknown";
+    }
+}
+Semiring stringToSemiring(const std::string& str) {
+    if (str == "plus_times") return Semiring::PLUS_TIMES;
+    if (str == "min_plus") return Semiring::MIN_PLUS;
+    if (str == "max_plus") return Semiring::MAX_PLUS;
+    if (str == "or_and") return Semiring::OR_AND;
+    throw std::runtime_error("Unknown semiring: " + str);
+}
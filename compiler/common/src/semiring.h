@@ -0,0 +1,13 @@
+#pragma once
+#include <string>
+
+// The (add, multiply) pair a matrix multiply sums products with:
+// C[i][j] = add over p of multiply(A[i][p], B[p][j]).
+enum class Semiring {
+    PLUS_TIMES,   // the ordinary product
+    MIN_PLUS,     // shortest paths: min of a + b
+    MAX_PLUS,     // longest paths: max of a + b
+    OR_AND        // reachability: or of a & b, integers only
+};
+const char* semiringToString(Semiring semiring);
+Semiring stringToSemiring(const std::string& str);
@@ -4,12 +4,26 @@
 #include <llvm/IR/Instruction.h>
 #include <llvm/IR/Instructions.h>
 #include <llvm/IR/Constants.h>
+#include <llvm/IR/IntrinsicInst.h>
+#include <llvm/IR/Operator.h>
 #include <llvm/Support/raw_ostream.h>
+#include <algorithm>
+#include <climits>
+#include <functional>
 #include <iostream>
+#include <map>
 #include <queue>
 #include <set>
 IRGenerator::IRGenerator() {
 }
+static bool isInputCall(const std::string& funcName) {
+    return (funcName.find("istream") != std::string::npos ||
+            funcName.find("cin") != std::string::npos) &&
+           (funcName.find("rs") != std::string::npos ||
+            funcName.find("read") != std::string::npos ||
+            funcName.find("get") != std::string::npos ||
+            funcName.find("extract") != std::string::npos);
+}
 bool IRGenerator::loadIR(const std::string& filename) {
     std::cout << "Loading IR from: " << filename << std::endl;
     if (!parser.parseIR(filename)) {
@@ -37,10 +51,31 @@ bool IRGenerator::analyzeFunction(llvm::Function* func) {
         }
     }
     std::vector<IROperation> operations;
+    semiring = Semiring::PLUS_TIMES;
     for (auto& bb : *func) {
         analyzeBlock(&bb, operations);
     }
     std::cout << "\nAnalyzed " << operations.size() << " operations" << std::endl;
+    detectDimensions(func, operations);
+    detectEpilogue(func, operations);
+    if (!detectModulus(func, operations)) {
+        return false;
+    }
+    // The semiring kernels have no epilogue or remainder, and a PLUS_TIMES
+    // multiply in their place would compute another function.
+    if (semiring != Semiring::PLUS_TIMES && (!foldedOps.empty() || modulus > 0)) {
+        std::cerr << "Unsupported program: the " << semiringToString(semiring) << " product is combined with "
+                  << (foldedOps.empty() ? "a remainder" : "an elementwise " + std::string(postOpToString(foldedOps[0].kind)))
+                  << " of the result" << std::endl;
+        return false;
+    }
+    // No instruction takes both a remainder and a folded update; emitting
+    // either alone would compute something other than the program.
+    if (modulus > 0 && !foldedOps.empty()) {
+        std::cerr << "Unsupported program: the remainder of the multiply's sums is combined with an elementwise "
+                  << postOpToString(foldedOps[0].kind) << " of the result" << std::endl;
+        return false;
+    }
     generateBytecodeFromOperations(operations);
     return true;
 }
@@ -61,12 +96,7 @@ void IRGenerator::analyzeBlock(llvm::BasicBlock* bb, std::vector<IROperation>& o
             if (call->getCalledFunction()) {
                 std::string funcName = call->getCalledFunction()->getName().str();
                 std::cout << "Analyzing call to: " << funcName << std::endl;
-                if ((funcName.find("istream") != std::string::npos || 
-                     funcName.find("cin") != std::string::npos) &&
-                    (funcName.find("rs") != std::string::npos || 
-                     funcName.find("read") != std::string::npos || 
-                     funcName.find("get") != std::string::npos || 
-                     funcName.find("extract") != std::string::npos)) {
+                if (isInputCall(funcName)) {
                     std::cout << "  >> DETECTED INPUT OPERATION" << std::endl;
                     operations.push_back({IROperation::INPUT_INT, bb, 0});
                 }
@@ -124,60 +154,773 @@ void IRGenerator::analyzeBlock(llvm::BasicBlock* bb, std::vector<IROperation>& o
         operations.push_back({IROperation::MATRIX_MULTIPLY, bb, 0});
     }
 }
+// An element of A or B: a load, possibly widened, narrowed, splatted across
+// a vector or tested against zero on the way.
+static bool isLoadedElement(llvm::Value* value, int depth = 0) {
+    if (llvm::isa<llvm::LoadInst>(value)) {
+        return true;
+    }
+    if (depth > 3) {
+        return false;
+    }
+    if (auto* cast = llvm::dyn_cast<llvm::CastInst>(value)) {
+        return isLoadedElement(cast->getOperand(0), depth + 1);
+    }
+    if (auto* shuffle = llvm::dyn_cast<llvm::ShuffleVectorInst>(value)) {
+        return isLoadedElement(shuffle->getOperand(0), depth + 1);
+    }
+    if (auto* insert = llvm::dyn_cast<llvm::InsertElementInst>(value)) {
+        return isLoadedElement(insert->getOperand(1), depth + 1);
+    }
+    if (auto* cmp = llvm::dyn_cast<llvm::ICmpInst>(value); cmp && cmp->isEquality() &&
+                                                            llvm::isa<llvm::Constant>(cmp->getOperand(1))) {
+        return isLoadedElement(cmp->getOperand(0), depth + 1);
+    }
+    return false;
+}
+
+// `a + b` (plus) or `a & b`, also as the `a ? b : false` of `a && b`, of two
+// loaded elements: the semiring's product.
+static bool isElementProduct(llvm::Value* value, bool plus) {
+    llvm::Value* x = nullptr;
+    llvm::Value* y = nullptr;
+    if (auto* binOp = llvm::dyn_cast<llvm::BinaryOperator>(value)) {
+        auto opcode = binOp->getOpcode();
+        bool matches = plus ? opcode == llvm::Instruction::Add || opcode == llvm::Instruction::FAdd
+                            : opcode == llvm::Instruction::And;
+        if (matches) {
+            x = binOp->getOperand(0);
+            y = binOp->getOperand(1);
+        }
+    } else if (auto* select = llvm::dyn_cast<llvm::SelectInst>(value); select && !plus) {
+        auto* otherwise = llvm::dyn_cast<llvm::ConstantInt>(select->getFalseValue());
+        if (otherwise && otherwise->isZero()) {
+            x = select->getCondition();
+            y = select->getTrueValue();
+        }
+    }
+    return x && y && isLoadedElement(x) && isLoadedElement(y);
+}
+
+// The accumulation of a min-plus, max-plus or or-and product: min or max of
+// the sum and a + b, or the sum | a & b. std::min and std::max arrive as the
+// smin/smax/minnum/maxnum intrinsics or as a compare and select of the two
+// values, `||` as a select with a true arm. PLUS_TIMES when instr is none of
+// these; product is set to the a + b or a & b otherwise.
+static Semiring accumulationSemiring(llvm::Instruction& instr, llvm::Value*& product) {
+    llvm::Value* x = nullptr;
+    llvm::Value* y = nullptr;
+    Semiring kind = Semiring::PLUS_TIMES;
+    if (auto* intrinsic = llvm::dyn_cast<llvm::IntrinsicInst>(&instr)) {
+        switch (intrinsic->getIntrinsicID()) {
+            case llvm::Intrinsic::smin:
+            case llvm::Intrinsic::minnum:
+            case llvm::Intrinsic::minimum:
+                kind = Semiring::MIN_PLUS;
+                break;
+            case llvm::Intrinsic::smax:
+            case llvm::Intrinsic::maxnum:
+            case llvm::Intrinsic::maximum:
+                kind = Semiring::MAX_PLUS;
+                break;
+            default:
+                return Semiring::PLUS_TIMES;
+        }
+        x = intrinsic->getArgOperand(0);
+        y = intrinsic->getArgOperand(1);
+    } else if (auto* select = llvm::dyn_cast<llvm::SelectInst>(&instr)) {
+        auto* one = llvm::dyn_cast<llvm::ConstantInt>(select->getTrueValue());
+        if (one && one->isOne() && select->getType()->isIntOrIntVectorTy(1)) {
+            kind = Semiring::OR_AND;
+            x = select->getCondition();
+            y = select->getFalseValue();
+        } else if (auto* cmp = llvm::dyn_cast<llvm::CmpInst>(select->getCondition())) {
+            x = select->getTrueValue();
+            y = select->getFalseValue();
+            llvm::CmpInst::Predicate predicate = cmp->getPredicate();
+            if (cmp->getOperand(0) == y && cmp->getOperand(1) == x) {
+                predicate = cmp->getSwappedPredicate();
+            } else if (cmp->getOperand(0) != x || cmp->getOperand(1) != y) {
+                return Semiring::PLUS_TIMES;
+            }
+            // x < y ? x : y is the min, x > y ? x : y the max.
+            switch (predicate) {
+                case llvm::CmpInst::ICMP_SLT:
+                case llvm::CmpInst::ICMP_SLE:
+                case llvm::CmpInst::FCMP_OLT:
+                case llvm::CmpInst::FCMP_OLE:
+                case llvm::CmpInst::FCMP_ULT:
+                case llvm::CmpInst::FCMP_ULE:
+                    kind = Semiring::MIN_PLUS;
+                    break;
+                case llvm::CmpInst::ICMP_SGT:
+                case llvm::CmpInst::ICMP_SGE:
+                case llvm::CmpInst::FCMP_OGT:
+                case llvm::CmpInst::FCMP_OGE:
+                case llvm::CmpInst::FCMP_UGT:
+                case llvm::CmpInst::FCMP_UGE:
+                    kind = Semiring::MAX_PLUS;
+                    break;
+                default:
+                    return Semiring::PLUS_TIMES;
+            }
+        }
+    } else if (auto* binOp = llvm::dyn_cast<llvm::BinaryOperator>(&instr);
+               binOp && binOp->getOpcode() == llvm::Instruction::Or) {
+        kind = Semiring::OR_AND;
+        x = binOp->getOperand(0);
+        y = binOp->getOperand(1);
+    }
+    if (kind == Semiring::PLUS_TIMES) {
+        return kind;
+    }
+    bool plus = kind != Semiring::OR_AND;
+    if (isElementProduct(x, plus)) {
+        product = x;
+    } else if (isElementProduct(y, plus)) {
+        product = y;
+    } else {
+        return Semiring::PLUS_TIMES;
+    }
+    return kind;
+}
+
 bool IRGenerator::isMatrixMultiplicationBlock(llvm::BasicBlock* bb) {
     bool hasMultiply = false;
     bool hasAdd = false;
     bool hasArrayAccess = false;
     int phiNodes = 0;
+    Semiring accumulation = Semiring::PLUS_TIMES;
     for (auto& instr : *bb) {
+        llvm::Value* product = nullptr;
+        Semiring kind = accumulationSemiring(instr, product);
+        if (kind != Semiring::PLUS_TIMES) {
+            accumulation = kind;
+            if (kind != Semiring::OR_AND) {
+                noteElementType(product->getType());
+            }
+            std::cout << "  Found " << semiringToString(kind) << " accumulation" << std::endl;
+        }
         if (llvm::isa<llvm::PHINode>(&instr)) {
             phiNodes++;
         }
         if (auto* binOp = llvm::dyn_cast<llvm::BinaryOperator>(&instr)) {
-            if (binOp->getOpcode() == llvm::Instruction::Mul) {
+            if (binOp->getOpcode() == llvm::Instruction::Mul ||
+                binOp->getOpcode() == llvm::Instruction::FMul) {
                 hasMultiply = true;
+                noteElementType(binOp->getType());
                 std::cout << "  Found multiplication" << std::endl;
             }
-            if (binOp->getOpcode() == llvm::Instruction::Add) {
+            if (binOp->getOpcode() == llvm::Instruction::Add ||
+                binOp->getOpcode() == llvm::Instruction::FAdd) {
                 hasAdd = true;
                 std::cout << "  Found addition" << std::endl;
             }
         }
+        if (auto* intrinsic = llvm::dyn_cast<llvm::IntrinsicInst>(&instr)) {
+            if (intrinsic->getIntrinsicID() == llvm::Intrinsic::fmuladd ||
+                intrinsic->getIntrinsicID() == llvm::Intrinsic::fma) {
+                hasMultiply = true;
+                hasAdd = true;
+                noteElementType(intrinsic->getType());
+                std::cout << "  Found fused multiply-add" << std::endl;
+            }
+        }
         if (llvm::isa<llvm::LoadInst>(&instr) || llvm::isa<llvm::StoreInst>(&instr)) {
             hasArrayAccess = true;
             std::cout << "  Found array access" << std::endl;
         }
     }
-    bool isMatrixMult = phiNodes >= 2 && hasMultiply && hasAdd && hasArrayAccess;
+    bool isMatrixMult = phiNodes >= 2 && hasArrayAccess &&
+                        ((hasMultiply && hasAdd) || accumulation != Semiring::PLUS_TIMES);
     if (isMatrixMult) {
         std::cout << "Matrix multiplication confirmed: PHI=" << phiNodes
-                  << " Mul=" << hasMultiply << " Add=" << hasAdd << " Access=" << hasArrayAccess << std::endl;
+                  << " Mul=" << hasMultiply << " Add=" << hasAdd << " Access=" << hasArrayAccess
+                  << " Semiring=" << semiringToString(accumulation) << std::endl;
+        if (accumulation != Semiring::PLUS_TIMES) {
+            semiring = accumulation;
+        }
     }
     return isMatrixMult;
 }
+// The multiply's operand type decides the element type of the whole program;
+// integer multiplies keep the default i32.
+void IRGenerator::noteElementType(llvm::Type* type) {
+    llvm::Type* scalar = type->getScalarType();
+    if (scalar->isFloatTy()) {
+        elementType = DType::F32;
+    } else if (scalar->isDoubleTy()) {
+        elementType = DType::F64;
+    }
+}
+// True if value is computed from base through casts and integer arithmetic,
+// e.g. the zext'd or unroll-rounded trip count of a loop bounded by base.
+static bool derivesFrom(llvm::Value* value, llvm::Value* base, int depth = 0) {
+    if (value == base) {
+        return true;
+    }
+    if (depth > 4) {
+        return false;
+    }
+    if (auto* cast = llvm::dyn_cast<llvm::CastInst>(value)) {
+        return derivesFrom(cast->getOperand(0), base, depth + 1);
+    }
+    if (auto* binOp = llvm::dyn_cast<llvm::BinaryOperator>(value)) {
+        return derivesFrom(binOp->getOperand(0), base, depth + 1) ||
+               derivesFrom(binOp->getOperand(1), base, depth + 1);
+    }
+    return false;
+}
+
+// Integer reads straight into a local (`std::cin >> m`) are the dimensions;
+// element reads store through the vectors' heap storage instead. With three
+// dimensions, the one bounding the loop of the multiply block is the inner
+// (k) dimension and the other two are rows then columns in input order.
+void IRGenerator::detectDimensions(llvm::Function* func, const std::vector<IROperation>& operations) {
+    std::vector<llvm::AllocaInst*> reads;
+    for (auto& bb : *func) {
+        for (auto& instr : bb) {
+            auto* call = llvm::dyn_cast<llvm::CallInst>(&instr);
+            if (!call || !call->getCalledFunction() || !isInputCall(call->getCalledFunction()->getName().str())) {
+                continue;
+            }
+            for (auto& arg : call->args()) {
+                auto* alloca = llvm::dyn_cast<llvm::AllocaInst>(arg->stripPointerCasts());
+                if (alloca && alloca->getAllocatedType()->isIntegerTy() &&
+                    std::find(reads.begin(), reads.end(), alloca) == reads.end()) {
+                    reads.push_back(alloca);
+                }
+            }
+        }
+    }
+    std::cout << "\nFound " << reads.size() << " dimension reads" << std::endl;
+    dimensions.assign(1, "n");
+    constantSize = 0;
+    if (reads.empty()) {
+        constantSize = detectConstantSize(operations);
+        if (constantSize > 0) {
+            dimensions.clear();
+            std::cout << "Constant matrix size: " << constantSize << std::endl;
+        }
+        return;
+    }
+    if (reads.size() != 3) {
+        if (reads.size() > 1) {
+            std::cout << "WARNING: Expected 1 or 3 dimensions, treating the program as square" << std::endl;
+        }
+        return;
+    }
+    int inner = -1;
+    for (const auto& op : operations) {
+        if (op.type != IROperation::MATRIX_MULTIPLY) {
+            continue;
+        }
+        for (auto& instr : *op.block) {
+            auto* cmp = llvm::dyn_cast<llvm::ICmpInst>(&instr);
+            if (!cmp) {
+                continue;
+            }
+            for (int i = 0; i < 3; i++) {
+                for (auto* user : reads[i]->users()) {
+                    auto* load = llvm::dyn_cast<llvm::LoadInst>(user);
+                    if (load && (derivesFrom(cmp->getOperand(0), load) || derivesFrom(cmp->getOperand(1), load))) {
+                        inner = inner == -1 || inner == i ? i : -2;
+                    }
+                }
+            }
+        }
+    }
+    if (inner < 0) {
+        std::cout << "WARNING: Could not find the inner loop bound, assuming dimensions are read as m, k, n" << std::endl;
+        inner = 1;
+    }
+    dimensions.clear();
+    const char* outer[] = {"m", "n"};
+    int next = 0;
+    for (int i = 0; i < 3; i++) {
+        dimensions.push_back(i == inner ? "k" : outer[next++]);
+    }
+    std::cout << "Dimensions in input order: " << dimensions[0] << ", " << dimensions[1] << ", "
+              << dimensions[2] << std::endl;
+}
+
+// A program that reads no dimensions has its size as the trip count of the
+// multiply loop. The bound is compared either with the incremented counter
+// (`i + 1 < 16`) or, once the optimizer rotates the loop, with the counter
+// before the increment at the bottom of the body (`i < 15`).
+int IRGenerator::detectConstantSize(const std::vector<IROperation>& operations) {
+    for (const auto& op : operations) {
+        if (op.type != IROperation::MATRIX_MULTIPLY) {
+            continue;
+        }
+        for (auto& instr : *op.block) {
+            auto* cmp = llvm::dyn_cast<llvm::ICmpInst>(&instr);
+            if (!cmp) {
+                continue;
+            }
+            auto* bound = llvm::dyn_cast<llvm::ConstantInt>(cmp->getOperand(1));
+            if (!bound || bound->getSExtValue() <= 0 || bound->getSExtValue() >= INT_MAX) {
+                continue;
+            }
+            int size = static_cast<int>(bound->getSExtValue());
+            auto* counter = llvm::dyn_cast<llvm::PHINode>(cmp->getOperand(0));
+            if (counter && cmp->isRelational()) {
+                for (auto* user : cmp->users()) {
+                    auto* branch = llvm::dyn_cast<llvm::BranchInst>(user);
+                    if (branch && branch->isConditional() && branch->getSuccessor(0) == counter->getParent()) {
+                        size++;
+                        break;
+                    }
+                }
+            }
+            return size;
+        }
+    }
+    return 0;
+}
+
+// Looks through casts and the single-entry phis that carry a loop's value
+// out of it (LCSSA).
+static llvm::Value* stripCastsAndExits(llvm::Value* value) {
+    for (int depth = 0; depth < 8; depth++) {
+        if (auto* cast = llvm::dyn_cast<llvm::CastInst>(value)) {
+            value = cast->getOperand(0);
+        } else if (auto* phi = llvm::dyn_cast<llvm::PHINode>(value); phi && phi->getNumIncomingValues() == 1) {
+            value = phi->getIncomingValue(0);
+        } else {
+            break;
+        }
+    }
+    return value;
+}
+
+// Address of a matrix element, `m[i][j]` on a vector of vectors: the object
+// the row pointers are loaded out of, and every index taken on the way. root
+// is null for an address that loads nothing (a local int) or goes through
+// anything else, such as a phi or select choosing between matrices.
+struct ElementAddress {
+    llvm::Value* root = nullptr;
+    std::vector<llvm::Value*> indices;
+};
+
+static ElementAddress elementAddress(llvm::Value* pointer) {
+    ElementAddress address;
+    bool loaded = false;
+    llvm::Value* value = pointer;
+    for (int depth = 0; depth < 16; depth++) {
+        if (auto* gep = llvm::dyn_cast<llvm::GEPOperator>(value)) {
+            address.indices.insert(address.indices.end(), gep->idx_begin(), gep->idx_end());
+            value = gep->getPointerOperand();
+        } else if (auto* load = llvm::dyn_cast<llvm::LoadInst>(value)) {
+            loaded = true;
+            value = load->getPointerOperand();
+        } else if (auto* cast = llvm::dyn_cast<llvm::BitCastOperator>(value)) {
+            value = cast->getOperand(0);
+        } else if (auto* phi = llvm::dyn_cast<llvm::PHINode>(value); phi && phi->getNumIncomingValues() == 1) {
+            value = phi->getIncomingValue(0);
+        } else {
+            break;
+        }
+    }
+    if (loaded && (llvm::isa<llvm::AllocaInst>(value) || llvm::isa<llvm::GlobalVariable>(value) ||
+                   llvm::isa<llvm::CallBase>(value))) {
+        address.root = value;
+    }
+    return address;
+}
+
+// `result[i][j] = sum + other[i][j]` after the k loop, or a later loop doing
+// `result[i][j] -= other[i][j]` on the stored sums. The update is folded only
+// when it is provably the product plus or minus one other matrix: every store
+// into the result after the multiply is either the sum itself or that one
+// update, the other matrix is the third one read and is neither an operand
+// nor written, and both sides address the same element. Anything else, such
+// as `result += A` or the update applied twice, is left alone with a warning.
+void IRGenerator::detectEpilogue(llvm::Function* func, const std::vector<IROperation>& operations) {
+    foldedOps.clear();
+    foldedAlpha = 1.0;
+    std::set<llvm::BasicBlock*> multiplyBlocks;
+    for (const auto& op : operations) {
+        if (op.type == IROperation::MATRIX_MULTIPLY) {
+            multiplyBlocks.insert(op.block);
+        }
+    }
+    if (multiplyBlocks.empty()) {
+        return;
+    }
+    // The k loop's sum, also through the exit phi that yields 0 when the loop
+    // runs no iterations.
+    std::function<bool(llvm::Value*, int)> isSum = [&](llvm::Value* value, int depth) {
+        value = stripCastsAndExits(value);
+        if (auto* phi = llvm::dyn_cast<llvm::PHINode>(value); phi && depth < 2 &&
+                                                               !multiplyBlocks.count(phi->getParent())) {
+            bool any = false;
+            for (llvm::Value* incoming : phi->incoming_values()) {
+                if (isSum(incoming, depth + 1)) {
+                    any = true;
+                } else if (!llvm::isa<llvm::Constant>(incoming)) {
+                    return false;
+                }
+            }
+            return any;
+        }
+        auto* def = llvm::dyn_cast<llvm::Instruction>(value);
+        return def && multiplyBlocks.count(def->getParent()) > 0;
+    };
+    auto isAddOrSub = [](llvm::Value* value) {
+        auto* binOp = llvm::dyn_cast<llvm::BinaryOperator>(value);
+        if (!binOp) {
+            return false;
+        }
+        auto opcode = binOp->getOpcode();
+        return opcode == llvm::Instruction::Add || opcode == llvm::Instruction::FAdd ||
+               opcode == llvm::Instruction::Sub || opcode == llvm::Instruction::FSub;
+    };
+    // The operands' matrices, and the result's: where the k loop accumulates
+    // in memory, or where its sum is stored after it.
+    std::set<llvm::Value*> operandRoots;
+    std::set<llvm::Value*> resultRoots;
+    std::vector<llvm::StoreInst*> laterStores;
+    bool afterMultiply = false;
+    for (auto& bb : *func) {
+        bool inMultiply = multiplyBlocks.count(&bb) > 0;
+        afterMultiply = afterMultiply || inMultiply;
+        for (auto& instr : bb) {
+            if (auto* load = llvm::dyn_cast<llvm::LoadInst>(&instr); load && inMultiply) {
+                if (llvm::Value* root = elementAddress(load->getPointerOperand()).root) {
+                    operandRoots.insert(root);
+                }
+            }
+            auto* store = llvm::dyn_cast<llvm::StoreInst>(&instr);
+            if (!store || !afterMultiply) {
+                continue;
+            }
+            llvm::Value* root = elementAddress(store->getPointerOperand()).root;
+            llvm::Value* value = store->getValueOperand();
+            bool holdsSum = inMultiply || isSum(value, 0);
+            if (!holdsSum && isAddOrSub(value)) {
+                auto* binOp = llvm::cast<llvm::BinaryOperator>(value);
+                holdsSum = isSum(binOp->getOperand(0), 0) || isSum(binOp->getOperand(1), 0);
+            }
+            if (holdsSum && root) {
+                resultRoots.insert(root);
+            }
+            if (!inMultiply) {
+                laterStores.push_back(store);
+            }
+        }
+    }
+    if (resultRoots.size() != 1) {
+        return;
+    }
+    llvm::Value* resultRoot = *resultRoots.begin();
+    operandRoots.erase(resultRoot);
+    // The product side of an update: the sum, or the stored sum loaded back
+    // from the same element.
+    auto isProduct = [&](llvm::Value* value, const ElementAddress& target) {
+        if (isSum(value, 0)) {
+            return true;
+        }
+        auto* load = llvm::dyn_cast<llvm::LoadInst>(value);
+        if (!load) {
+            return false;
+        }
+        ElementAddress address = elementAddress(load->getPointerOperand());
+        return address.root == resultRoot && address.indices == target.indices;
+    };
+    llvm::Value* otherRoot = nullptr;
+    PostOp op;
+    op.operand = 3;
+    double alpha = 1.0;
+    // One update per store type and block: a vectorized loop stores vectors
+    // and its remainder scalars, but the same update twice takes two loops.
+    std::map<llvm::Type*, llvm::BasicBlock*> updateBlocks;
+    std::string problem;
+    for (llvm::StoreInst* store : laterStores) {
+        ElementAddress target = elementAddress(store->getPointerOperand());
+        llvm::Value* value = store->getValueOperand();
+        if (target.root != resultRoot || isSum(value, 0)) {
+            continue;
+        }
+        if (!isAddOrSub(value)) {
+            problem = "the result is overwritten with something other than the product plus or minus a matrix";
+            break;
+        }
+        auto* binOp = llvm::cast<llvm::BinaryOperator>(value);
+        bool sub = binOp->getOpcode() == llvm::Instruction::Sub || binOp->getOpcode() == llvm::Instruction::FSub;
+        bool productFirst = isProduct(binOp->getOperand(0), target);
+        bool productSecond = isProduct(binOp->getOperand(1), target);
+        auto* otherLoad = llvm::dyn_cast<llvm::LoadInst>(binOp->getOperand(productFirst ? 1 : 0));
+        ElementAddress other = otherLoad ? elementAddress(otherLoad->getPointerOperand()) : ElementAddress{};
+        if (productFirst == productSecond || !other.root || other.indices != target.indices) {
+            problem = "the update is not the product and the same element of one other matrix";
+            break;
+        }
+        if (other.root == resultRoot || operandRoots.count(other.root)) {
+            problem = "the update reads the result or an operand of the multiply";
+            break;
+        }
+        PostOpKind kind = sub && productFirst ? PostOpKind::SUB : PostOpKind::ADD;
+        // other - A * B
+        double sign = sub && productSecond ? -1.0 : 1.0;
+        if (otherRoot && (other.root != otherRoot || kind != op.kind || sign != alpha)) {
+            problem = "the result is updated more than once";
+            break;
+        }
+        auto block = updateBlocks.emplace(value->getType(), store->getParent());
+        if (!block.second && block.first->second != store->getParent()) {
+            problem = "the result is updated more than once";
+            break;
+        }
+        otherRoot = other.root;
+        op.kind = kind;
+        alpha = sign;
+    }
+    if (!otherRoot && problem.empty()) {
+        return;
+    }
+    for (llvm::StoreInst* store : laterStores) {
+        if (problem.empty() && elementAddress(store->getPointerOperand()).root == otherRoot) {
+            problem = "the other matrix is written after the multiply";
+        }
+    }
+    if (problem.empty()) {
+        // The runtime reads the other matrix third, after A and B.
+        std::vector<llvm::Value*> readRoots;
+        for (auto& bb : *func) {
+            for (auto& instr : bb) {
+                auto* call = llvm::dyn_cast<llvm::CallInst>(&instr);
+                if (!call || !call->getCalledFunction() ||
+                    !isInputCall(call->getCalledFunction()->getName().str())) {
+                    continue;
+                }
+                for (auto& arg : call->args()) {
+                    llvm::Value* root = elementAddress(arg).root;
+                    if (root && std::find(readRoots.begin(), readRoots.end(), root) == readRoots.end()) {
+                        readRoots.push_back(root);
+                    }
+                }
+            }
+        }
+        if (readRoots.size() != 3 || readRoots[2] != otherRoot) {
+            problem = "the other matrix is not the third matrix read";
+        }
+    }
+    if (!problem.empty()) {
+        std::cout << "WARNING: Not folding the elementwise update of the result: " << problem
+                  << ", only the product is computed" << std::endl;
+        return;
+    }
+    foldedAlpha = alpha;
+    foldedOps.push_back(op);
+    std::cout << "Folded elementwise " << postOpToString(op.kind) << " into the multiply"
+              << (foldedAlpha < 0 ? " (negated product)" : "") << std::endl;
+}
+
+// `sum + a * b` of the k loop: an add in a multiply block of a multiply and
+// the loop's running sum, a phi of a multiply block. Returns that phi.
+static llvm::PHINode* multiplyAccumulateSum(llvm::Value* value, const std::set<llvm::BasicBlock*>& multiplyBlocks) {
+    auto* add = llvm::dyn_cast<llvm::BinaryOperator>(value);
+    if (!add || add->getOpcode() != llvm::Instruction::Add || !multiplyBlocks.count(add->getParent())) {
+        return nullptr;
+    }
+    for (int i = 0; i < 2; i++) {
+        auto* sum = llvm::dyn_cast<llvm::PHINode>(add->getOperand(i));
+        auto* product = llvm::dyn_cast<llvm::BinaryOperator>(stripCastsAndExits(add->getOperand(1 - i)));
+        if (sum && multiplyBlocks.count(sum->getParent()) && product &&
+            product->getOpcode() == llvm::Instruction::Mul) {
+            return sum;
+        }
+    }
+    return nullptr;
+}
+
+// True if one of phi's incoming values is value, possibly cast.
+static bool feedsPhi(llvm::Value* value, llvm::PHINode* phi) {
+    for (llvm::Value* incoming : phi->incoming_values()) {
+        if (stripCastsAndExits(incoming) == value) {
+            return true;
+        }
+    }
+    return false;
+}
+
+// True if value is the min, max or or of a semiring k loop, or the sum phi
+// such a value feeds.
+static bool semiringSum(llvm::Value* value, const std::set<llvm::BasicBlock*>& multiplyBlocks) {
+    auto* instr = llvm::dyn_cast<llvm::Instruction>(value);
+    if (!instr || !multiplyBlocks.count(instr->getParent())) {
+        return false;
+    }
+    llvm::Value* product = nullptr;
+    if (accumulationSemiring(*instr, product) != Semiring::PLUS_TIMES) {
+        return true;
+    }
+    auto* phi = llvm::dyn_cast<llvm::PHINode>(instr);
+    if (!phi) {
+        return false;
+    }
+    for (llvm::Value* incoming : phi->incoming_values()) {
+        auto* update = llvm::dyn_cast<llvm::Instruction>(stripCastsAndExits(incoming));
+        if (update && update != instr && multiplyBlocks.count(update->getParent()) &&
+            accumulationSemiring(*update, product) != Semiring::PLUS_TIMES) {
+            return true;
+        }
+    }
+    return false;
+}
+
+// True if value, through casts, is only ever stored.
+static bool onlyStored(llvm::Value* value) {
+    for (llvm::User* user : value->users()) {
+        if (auto* store = llvm::dyn_cast<llvm::StoreInst>(user)) {
+            if (store->getValueOperand() != value) {
+                return false;
+            }
+        } else if (!llvm::isa<llvm::CastInst>(user) || !onlyStored(user)) {
+            return false;
+        }
+    }
+    return true;
+}
+
+// `sum = (sum + a * b) % MOD` inside the k loop, or `result[i][j] = sum % MOD`
+// on the loop's sum after it, with a constant MOD the modular kernels take.
+// The dividend has to be the multiply-accumulate itself: a remainder of a
+// single product, of the sum plus a third matrix or of anything else is left
+// alone. C++ `%` keeps the sign of a negative sum where the kernels return
+// [0, p), so srem is marked signed and the runtime accepts it only for
+// non-negative A and B, whose sums are never negative. False, with the
+// reason printed, when the remainder after the loop goes into a further
+// computation that MATRIX_MULTIPLY_MOD cannot express, or when it reduces
+// the sums of a semiring product.
+bool IRGenerator::detectModulus(llvm::Function* func, const std::vector<IROperation>& operations) {
+    modulus = 0;
+    modulusSigned = false;
+    std::set<llvm::BasicBlock*> multiplyBlocks;
+    for (const auto& op : operations) {
+        if (op.type == IROperation::MATRIX_MULTIPLY) {
+            multiplyBlocks.insert(op.block);
+        }
+    }
+    bool afterMultiply = false;
+    for (auto& bb : *func) {
+        bool inMultiply = multiplyBlocks.count(&bb) > 0;
+        afterMultiply = afterMultiply || inMultiply;
+        if (!afterMultiply) {
+            continue;
+        }
+        for (auto& instr : bb) {
+            auto* rem = llvm::dyn_cast<llvm::BinaryOperator>(&instr);
+            if (!rem || (rem->getOpcode() != llvm::Instruction::SRem && rem->getOpcode() != llvm::Instruction::URem)) {
+                continue;
+            }
+            auto* divisor = llvm::dyn_cast<llvm::ConstantInt>(rem->getOperand(1));
+            if (!divisor || divisor->getBitWidth() > 64 || divisor->getSExtValue() < 2 ||
+                divisor->getSExtValue() > INT_MAX) {
+                continue;
+            }
+            llvm::Value* dividend = stripCastsAndExits(rem->getOperand(0));
+            if (semiring != Semiring::PLUS_TIMES && semiringSum(dividend, multiplyBlocks)) {
+                std::cerr << "Unsupported program: the " << semiringToString(semiring)
+                          << " product is combined with a remainder of the result" << std::endl;
+                return false;
+            }
+            llvm::PHINode* sum = multiplyAccumulateSum(dividend, multiplyBlocks);
+            // Inside the loop the remainder is what the sum carries on with;
+            // after it, the sum itself is carried and reduced once at the end.
+            if (!sum || !feedsPhi(inMultiply ? rem : dividend, sum)) {
+                continue;
+            }
+            if (!inMultiply && !onlyStored(rem)) {
+                std::cerr << "Unsupported program: the remainder of the multiply's sums is used in a further "
+                          << "computation before it is stored" << std::endl;
+                return false;
+            }
+            modulus = static_cast<int>(divisor->getSExtValue());
+            modulusSigned = rem->getOpcode() == llvm::Instruction::SRem;
+            std::cout << "Found " << (modulusSigned ? "signed " : "") << "remainder by " << modulus
+                      << " of the multiply's sums" << std::endl;
+            return true;
+        }
+    }
+    return true;
+}
+
 void IRGenerator::generateBytecodeFromOperations(const std::vector<IROperation>& operations) {
     std::cout << "\nGenerating bytecode from IR operations..." << std::endl;
     instructions.clear();
-    instructions.push_back({Instruction::READ_INTEGER, {}, ""});
-    std::cout << "Generated: READ_INTEGER" << std::endl;
-    instructions.push_back({Instruction::READ_MATRIX, {0}, "matrix1"});
-    std::cout << "Generated: READ_MATRIX (matrix1)" << std::endl;
-    instructions.push_back({Instruction::READ_MATRIX, {1}, "matrix2"});
-    std::cout << "Generated: READ_MATRIX (matrix2)" << std::endl;
-    instructions.push_back({Instruction::ALLOC_MATRIX, {2}, "result"});
-    std::cout << "Generated: ALLOC_MATRIX (result)" << std::endl;
-    instructions.push_back({Instruction::MATRIX_MULTIPLY, {0, 1, 2}, ""});
-    std::cout << "Generated: MATRIX_MULTIPLY (0,1,2)" << std::endl;
-    instructions.push_back({Instruction::WRITE_MATRIX, {2}, "result"});
-    std::cout << "Generated: WRITE_MATRIX (result)" << std::endl;
+    bool rectangular = dimensions.size() == 3;
+    if (rectangular) {
+        for (const std::string& dimension : dimensions) {
+            instructions.push_back({Instruction::READ_INTEGER, {}, dimension});
+            std::cout << "Generated: READ_INTEGER (" << dimension << ")" << std::endl;
+        }
+    } else if (constantSize == 0) {
+        instructions.push_back({Instruction::READ_INTEGER, {}, ""});
+        std::cout << "Generated: READ_INTEGER" << std::endl;
+    }
+    std::string typeName = dtypeToString(elementType);
+    BytecodeInstruction read1{Instruction::READ_MATRIX, {0}, "matrix1", elementType};
+    BytecodeInstruction read2{Instruction::READ_MATRIX, {1}, "matrix2", elementType};
+    BytecodeInstruction alloc{Instruction::ALLOC_MATRIX, {2}, "result", elementType};
+    if (rectangular) {
+        read1.shape = {"m", "k"};
+        read2.shape = {"k", "n"};
+        alloc.shape = {"m", "n"};
+    } else if (constantSize > 0) {
+        std::string size = std::to_string(constantSize);
+        read1.shape = read2.shape = alloc.shape = {size, size};
+    }
+    instructions.push_back(read1);
+    std::cout << "Generated: READ_MATRIX (matrix1, " << typeName << ")" << std::endl;
+    instructions.push_back(read2);
+    std::cout << "Generated: READ_MATRIX (matrix2, " << typeName << ")" << std::endl;
+    if (!foldedOps.empty()) {
+        BytecodeInstruction read3{Instruction::READ_MATRIX, {3}, "matrix3", elementType};
+        read3.shape = alloc.shape;
+        instructions.push_back(read3);
+        std::cout << "Generated: READ_MATRIX (matrix3, " << typeName << ")" << std::endl;
+    }
+    instructions.push_back(alloc);
+    std::cout << "Generated: ALLOC_MATRIX (result, " << typeName << ")" << std::endl;
+    if (semiring != Semiring::PLUS_TIMES) {
+        BytecodeInstruction multiply{Instruction::MATRIX_MULTIPLY, {0, 1, 2}, "", elementType};
+        multiply.semiring = semiring;
+        instructions.push_back(multiply);
+        std::cout << "Generated: MATRIX_MULTIPLY (0,1,2, " << semiringToString(semiring) << ", " << typeName << ")"
+                  << std::endl;
+    } else if (modulus > 0 && foldedOps.empty() && elementType == DType::I32) {
+        BytecodeInstruction multiply{Instruction::MATRIX_MULTIPLY_MOD, {0, 1, 2}, "", elementType};
+        multiply.modulus = std::to_string(modulus);
+        multiply.signedRemainder = modulusSigned;
+        instructions.push_back(multiply);
+        std::cout << "Generated: MATRIX_MULTIPLY_MOD (0,1,2, mod " << modulus << ")" << std::endl;
+    } else if (foldedOps.empty()) {
+        instructions.push_back({Instruction::MATRIX_MULTIPLY, {0, 1, 2}, "", elementType});
+        std::cout << "Generated: MATRIX_MULTIPLY (0,1,2, " << typeName << ")" << std::endl;
+    } else {
+        BytecodeInstruction gemm{Instruction::GEMM, {0, 1, 2}, "", elementType};
+        gemm.alpha = foldedAlpha;
+        gemm.postOps = foldedOps;
+        instructions.push_back(gemm);
+        std::cout << "Generated: GEMM (0,1,2, alpha " << foldedAlpha << ", "
+                  << postOpToString(foldedOps[0].kind) << " 3, " << typeName << ")" << std::endl;
+    }
+    instructions.push_back({Instruction::WRITE_MATRIX, {2}, "result", elementType});
+    std::cout << "Generated: WRITE_MATRIX (result, " << typeName << ")" << std::endl;
     instructions.push_back({Instruction::TERMINATE, {}, ""});
     std::cout << "Generated: TERMINATE" << std::endl;
     if (!matrices.empty()) {
         matrices.clear();
     }
-    matrices.push_back({0, "matrix1", false});
-    matrices.push_back({0, "matrix2", false});
-    matrices.push_back({0, "result", true});
+    int size = constantSize;
+    matrices.push_back({size, size, size, "matrix1", false, elementType});
+    matrices.push_back({size, size, size, "matrix2", false, elementType});
+    if (!foldedOps.empty()) {
+        matrices.push_back({size, size, size, "matrix3", false, elementType});
+    }
+    matrices.push_back({size, size, size, "result", true, elementType});
 }
 
 std::map<llvm::BasicBlock*, std::vector<llvm::BasicBlock*>> IRGenerator::buildControlFlowGraph(llvm::Function* func) {
@@ -195,15 +938,16 @@ std::map<llvm::BasicBlock*, std::vector<llvm::BasicBlock*>> IRGenerator::buildCo
 }
 
 void IRGenerator::createMatrixInstruction(int size1, int size2, int resultSize) {
-    matrices.push_back({size1, "matrix1", false});
-    matrices.push_back({size2, "matrix2", false});
-    matrices.push_back({resultSize, "result", true});
+    matrices.push_back({size1, size1, size1, "matrix1", false});
+    matrices.push_back({size2, size2, size2, "matrix2", false});
+    matrices.push_back({resultSize, resultSize, resultSize, "result", true});
 }
 
 bool IRGenerator::detectMatrixOperations() {
     bool hasMatrixOps = false;
     for (const auto& instr : instructions) {
-        if (instr.operation == Instruction::MATRIX_MULTIPLY) {
+        if (instr.operation == Instruction::MATRIX_MULTIPLY || instr.operation == Instruction::MATRIX_MULTIPLY_MOD ||
+            instr.operation == Instruction::GEMM) {
             hasMatrixOps = true;
             break;
         }
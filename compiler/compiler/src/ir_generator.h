@@ -29,9 +29,34 @@ private:
     LLVMParser parser;
     std::vector<BytecodeInstruction> instructions;
     std::vector<Matrix> matrices;
+    DType elementType = DType::I32;
+    // Variable names of the integer reads, in input order: "n" for a square
+    // program, or some order of "m", "k" and "n" for an m x k * k x n one.
+    std::vector<std::string> dimensions;
+    // Side of a square program whose sizes are constants rather than reads,
+    // taken from the multiply loop's bound; 0 when the sizes are read.
+    int constantSize = 0;
+    // Elementwise add or subtract of a third matrix found after the multiply,
+    // folded into a GEMM epilogue; empty when the program is a plain multiply.
+    std::vector<PostOp> foldedOps;
+    double foldedAlpha = 1.0;
+    // Constant p of a `% p` taken of the multiply's sums, so the program runs
+    // as a modular multiply; 0 when there is none.
+    int modulus = 0;
+    // Set when that `%` is a signed remainder, which keeps the sign of a
+    // negative sum.
+    bool modulusSigned = false;
+    // How the k loop sums its products: min or max of a + b, or | of a & b,
+    // instead of + of a * b.
+    Semiring semiring = Semiring::PLUS_TIMES;
     bool analyzeFunction(llvm::Function* func);
     void analyzeBlock(llvm::BasicBlock* bb, std::vector<IROperation>& operations);
     bool isMatrixMultiplicationBlock(llvm::BasicBlock* bb);
+    void noteElementType(llvm::Type* type);
+    void detectDimensions(llvm::Function* func, const std::vector<IROperation>& operations);
+    int detectConstantSize(const std::vector<IROperation>& operations);
+    void detectEpilogue(llvm::Function* func, const std::vector<IROperation>& operations);
+    bool detectModulus(llvm::Function* func, const std::vector<IROperation>& operations);
     void generateBytecodeFromOperations(const std::vector<IROperation>& operations);
     void createMatrixInstruction(int size1, int size2, int resultSize);
     std::map<llvm::BasicBlock*, std::vector<llvm::BasicBlock*>> buildControlFlowGraph(llvm::Function* func);
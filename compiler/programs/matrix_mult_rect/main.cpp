@@ -0,0 +1,35 @@
+#include <iostream>
+#include <vector>
+
+int main() {
+    int m, k, n;
+    std::cin >> m >> k >> n;
+    std::vector matrix1(m, std::vector<int>(k));
+    for (int i = 0; i < m; i++) {
+        for (int j = 0; j < k; j++) {
+            std::cin >> matrix1[i][j];
+        }
+    }
+    std::vector matrix2(k, std::vector<int>(n));
+    for (int i = 0; i < k; i++) {
+        for (int j = 0; j < n; j++) {
+            std::cin >> matrix2[i][j];
+        }
+    }
+    std::vector result(m, std::vector(n, 0));
+    for (int i = 0; i < m; i++) {
+        for (int j = 0; j < n; j++) {
+            for (int p = 0; p < k; p++) {
+                result[i][j] += matrix1[i][p] * matrix2[p][j];
+            }
+        }
+    }
+    for (int i = 0; i < m; i++) {
+        for (int j = 0; j < n; j++) {
+            std::cout << result[i][j];
+            if (j < n - 1) std::cout << " ";
+        }
+        std::cout << std::endl;
+    }
+    return 0;
+}
@@ -9,22 +9,26 @@ struct WorkChunkInfo {
     int endRow;
     int startCol;
     int endCol;
-    int size;
+    int k;
+    int lda;
+    int ldb;
+    int ldc;
 };
 
-kernel void matrix_multiply(
-    device const int* matrixA [[buffer(0)]],
-    device const int* matrixB [[buffer(1)]],
-    device int* result [[buffer(2)]],
+template <typename T>
+[[kernel]] void matrix_multiply_tiled(
+    device const T* matrixA [[buffer(0)]],
+    device const T* matrixB [[buffer(1)]],
+    device T* result [[buffer(2)]],
     constant WorkChunkInfo* chunk [[buffer(3)]],
     uint2 tid [[thread_position_in_grid]],
     uint2 lid [[thread_position_in_threadgroup]],
     uint2 gid [[threadgroup_position_in_grid]])
 {
-    int matrixSize = chunk->size;
-    threadgroup int tileA[TILE_SIZE][TILE_SIZE];
-    threadgroup int tileB[TILE_SIZE][TILE_SIZE];
-    int accum[VECTOR_SIZE][VECTOR_SIZE];
+    int innerSize = chunk->k;
+    threadgroup T tileA[TILE_SIZE][TILE_SIZE];
+    threadgroup T tileB[TILE_SIZE][TILE_SIZE];
+    T accum[VECTOR_SIZE][VECTOR_SIZE];
     for (int i = 0; i < VECTOR_SIZE; i++) {
         for (int j = 0; j < VECTOR_SIZE; j++) {
             accum[i][j] = 0;
@@ -32,7 +36,7 @@ kernel void matrix_multiply(
     }
     int blockRowOffset = chunk->startRow + gid.x * TILE_SIZE;
     int blockColOffset = chunk->startCol + gid.y * TILE_SIZE;
-    int numTiles = (matrixSize + TILE_SIZE - 1) / TILE_SIZE;
+    int numTiles = (innerSize + TILE_SIZE - 1) / TILE_SIZE;
     for (int tileIdx = 0; tileIdx < numTiles; tileIdx++) {
         int tileOffset = tileIdx * TILE_SIZE;
         for (int i = 0; i < VECTOR_SIZE; i++) {
@@ -42,15 +46,15 @@ kernel void matrix_multiply(
                 if (localRowA < TILE_SIZE && localColA < TILE_SIZE) {
                     int globalRowA = blockRowOffset + localRowA;
                     int globalColA = tileOffset + localColA;
-                    if (globalRowA < chunk->endRow && globalColA < matrixSize) {
-                        tileA[localRowA][localColA] = matrixA[globalRowA * matrixSize + globalColA];
+                    if (globalRowA < chunk->endRow && globalColA < innerSize) {
+                        tileA[localRowA][localColA] = matrixA[globalRowA * chunk->lda + globalColA];
                     } else {
                         tileA[localRowA][localColA] = 0;
                     }
                     int globalRowB = tileOffset + localRowA;
                     int globalColB = blockColOffset + localColA;
-                    if (globalRowB < matrixSize && globalColB < chunk->endCol) {
-                        tileB[localRowA][localColA] = matrixB[globalRowB * matrixSize + globalColB];
+                    if (globalRowB < innerSize && globalColB < chunk->endCol) {
+                        tileB[localRowA][localColA] = matrixB[globalRowB * chunk->ldb + globalColB];
                     } else {
                         tileB[localRowA][localColA] = 0;
                     }
@@ -68,7 +72,7 @@ kernel void matrix_multiply(
                 if (localCol >= TILE_SIZE) continue;
                 int globalCol = blockColOffset + localCol;
                 if (globalCol >= chunk->endCol) continue;
-                int sum = 0;
+                T sum = 0;
                 int k = 0;
                 while (k + 7 < TILE_SIZE) {
                     sum += tileA[localRow][k] * tileB[k][localCol];
@@ -95,7 +99,12 @@ kernel void matrix_multiply(
         for (int j = 0; j < VECTOR_SIZE; j++) {
             int globalCol = blockColOffset + lid.y * VECTOR_SIZE + j;
             if (globalCol >= chunk->endCol) continue;
-            result[globalRow * matrixSize + globalCol] = accum[i][j];
+            result[globalRow * chunk->ldc + globalCol] = accum[i][j];
         }
     }
-}
\ No newline at end of file
+}
+
+template [[host_name("matrix_multiply")]] [[kernel]]
+decltype(matrix_multiply_tiled<int>) matrix_multiply_tiled<int>;
+template [[host_name("matrix_multiply_f32")]] [[kernel]]
+decltype(matrix_multiply_tiled<float>) matrix_multiply_tiled<float>;
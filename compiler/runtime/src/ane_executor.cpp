@@ -22,13 +22,6 @@ void ANEExecutor::execute(
     std::shared_ptr<WorkScheduler> scheduler,
     std::shared_ptr<Profiler> profiler) {
     std::cout << "DEBUG: ANE executor starting (no-op mode)" << std::endl;
-    auto& queue = scheduler->getQueue(DeviceType::ANE);
-    std::unique_lock lock(queue.mutex);
-    if (queue.activeWorkers > 0) {
-        std::cout << "DEBUG: ANE executor resetting " << queue.activeWorkers 
-                  << " active workers to 0" << std::endl;
-        queue.activeWorkers = 0;
-    }
     if (profiler) {
         std::cout << "DEBUG: ANE executor stats: processed 0 chunks" << std::endl;
         profiler->recordZeroTime("ane_execution");
@@ -0,0 +1,352 @@
+#include "autotuner.h"
+#include "cpu_executor.h"
+#include "work_stealing.h"
+#include <nlohmann/json.hpp>
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <random>
+#include <sstream>
+#include <thread>
+#include <unistd.h>
+
+constexpr int TUNING_REPEATS = 2;
+
+void TuningTable::add(const TuningPoint& point) {
+    auto it = std::find_if(entries.begin(), entries.end(),
+                           [&point](const TuningPoint& p) { return p.size >= point.size; });
+    if (it != entries.end() && it->size == point.size) {
+        *it = point;
+    } else {
+        entries.insert(it, point);
+    }
+}
+
+static int roundToMultiple(double value, int multiple) {
+    int rounded = static_cast<int>(std::lround(value / multiple)) * multiple;
+    return std::max(multiple, rounded);
+}
+
+static int interpolate(int low, int high, double t, int multiple) {
+    return roundToMultiple(low + (high - low) * t, multiple);
+}
+
+// MC in whole MR-row tiles and NC in whole NR-column panels of the tier's
+// int32 micro-kernel, so only the matrix's own edges leave ragged tiles.
+static GemmBlocking alignBlocking(GemmBlocking blocking, CPUIsa isa) {
+    const GemmMicroKernel& kernel = gemmMicroKernel(isa);
+    blocking.mc = roundToMultiple(blocking.mc, kernel.mr);
+    blocking.nc = roundToMultiple(blocking.nc, kernel.nr);
+    return blocking;
+}
+
+TuningPoint TuningTable::lookup(int size) const {
+    TuningPoint point;
+    if (size <= entries.front().size) {
+        point = entries.front();
+    } else if (size >= entries.back().size) {
+        point = entries.back();
+    } else {
+        auto high = std::find_if(entries.begin(), entries.end(),
+                                 [size](const TuningPoint& p) { return p.size >= size; });
+        const TuningPoint& hi = *high;
+        const TuningPoint& lo = *(high - 1);
+        double t = (std::log2(size) - std::log2(lo.size)) / (std::log2(hi.size) - std::log2(lo.size));
+        point = t < 0.5 ? lo : hi;
+        point.size = size;
+        point.chunkSize = interpolate(lo.chunkSize, hi.chunkSize, t, 8);
+        point.blocking.mc = interpolate(lo.blocking.mc, hi.blocking.mc, t, 1);
+        point.blocking.kc = interpolate(lo.blocking.kc, hi.blocking.kc, t, 16);
+        point.blocking.nc = interpolate(lo.blocking.nc, hi.blocking.nc, t, 1);
+        point.gops = 0.0;
+    }
+    // Also fixes points saved before blocks were aligned.
+    point.blocking = alignBlocking(point.blocking, point.isa);
+    return point;
+}
+
+int defaultChunkSize(int matrixSize) {
+    int blockSize = 64;
+    if (matrixSize <= 128) {
+        blockSize = 32;
+        if (matrixSize % blockSize != 0) {
+            while (matrixSize % blockSize != 0 && blockSize > 8) {
+                blockSize -= 4;
+            }
+        }
+        std::cout << "DEBUG: Using block size: " << blockSize
+                  << " for medium matrix multiplication" << std::endl;
+    }
+    else if (matrixSize >= 2048) blockSize = 128;
+    else if (matrixSize >= 1024) blockSize = 128;
+    else if (matrixSize >= 512) blockSize = 96;
+    else if (matrixSize >= 256) blockSize = 64;
+    else blockSize = 64;
+    return blockSize;
+}
+
+std::string hostTuningKey() {
+    CPUCaches caches = detectCPUCaches();
+    std::ostringstream key;
+    key << detectCPUModel() << " L1d=" << caches.l1d / 1024 << "K L2=" << caches.l2 / 1024
+        << "K L3=" << caches.l3 / 1024 << "K";
+    return key.str();
+}
+
+std::string defaultTuningFile() {
+    const char* fileEnv = std::getenv("TUNING_FILE");
+    if (fileEnv != nullptr) {
+        return fileEnv;
+    }
+    const char* home = std::getenv("HOME");
+    if (home != nullptr) {
+        return std::string(home) + "/.cgnpu_tuning.json";
+    }
+    return ".cgnpu_tuning.json";
+}
+
+nlohmann::json readTuningFile(const std::string& path) {
+    std::ifstream file(path);
+    if (!file.is_open()) {
+        return nlohmann::json::object();
+    }
+    try {
+        nlohmann::json j;
+        file >> j;
+        if (j.is_object()) {
+            return j;
+        }
+    } catch (const std::exception& e) {
+        std::cout << "WARNING: Ignoring unreadable tuning file " << path << ": " << e.what() << std::endl;
+    }
+    return nlohmann::json::object();
+}
+
+bool writeTuningFile(const std::string& path, const nlohmann::json& j) {
+    std::string temporary = path + ".tmp." + std::to_string(getpid());
+    {
+        std::ofstream file(temporary);
+        if (!file.is_open()) {
+            return false;
+        }
+        file << j.dump(2) << std::endl;
+        if (!file.good()) {
+            std::remove(temporary.c_str());
+            return false;
+        }
+    }
+    if (std::rename(temporary.c_str(), path.c_str()) != 0) {
+        std::remove(temporary.c_str());
+        return false;
+    }
+    return true;
+}
+
+TuningTable loadTuningTable(const std::string& path, const std::string& hostKey) {
+    TuningTable table;
+    nlohmann::json j = readTuningFile(path);
+    if (!j.contains("hosts") || !j["hosts"].contains(hostKey) || !j["hosts"][hostKey].contains("points")) {
+        return table;
+    }
+    try {
+        for (const auto& p : j["hosts"][hostKey].at("points")) {
+            TuningPoint point;
+            point.size = p.at("size").get<int>();
+            point.chunkSize = p.at("chunk").get<int>();
+            point.blocking = GemmBlocking{p.at("mc").get<int>(), p.at("kc").get<int>(), p.at("nc").get<int>()};
+            if (!stringToIsa(p.at("isa").get<std::string>(), point.isa)) {
+                point.isa = CPUIsa::SCALAR;
+            }
+            point.threads = p.at("threads").get<int>();
+            point.gops = p.value("gops", 0.0);
+            if (point.size <= 0 || point.chunkSize <= 0 || point.threads <= 0 ||
+                point.blocking.mc <= 0 || point.blocking.kc <= 0 || point.blocking.nc <= 0) {
+                throw std::runtime_error("non-positive tuning parameter");
+            }
+            table.add(point);
+        }
+    } catch (const std::exception& e) {
+        std::cout << "WARNING: Ignoring malformed tuning entry in " << path << ": " << e.what() << std::endl;
+        return TuningTable();
+    }
+    return table;
+}
+
+bool saveTuningTable(const std::string& path, const std::string& hostKey, const TuningTable& table) {
+    nlohmann::json j = readTuningFile(path);
+    CPUCaches caches = detectCPUCaches();
+    nlohmann::json host = nlohmann::json::object();
+    if (j.contains("hosts") && j["hosts"].contains(hostKey) && j["hosts"][hostKey].is_object()) {
+        host = j["hosts"][hostKey];
+    }
+    host["cpu"] = detectCPUModel();
+    host["l1d"] = caches.l1d;
+    host["l2"] = caches.l2;
+    host["l3"] = caches.l3;
+    host["points"] = nlohmann::json::array();
+    for (const TuningPoint& point : table.points()) {
+        host["points"].push_back({
+            {"size", point.size},
+            {"chunk", point.chunkSize},
+            {"mc", point.blocking.mc},
+            {"kc", point.blocking.kc},
+            {"nc", point.blocking.nc},
+            {"isa", isaToString(point.isa)},
+            {"threads", point.threads},
+            {"gops", point.gops}
+        });
+    }
+    j["hosts"][hostKey] = host;
+    return writeTuningFile(path, j);
+}
+
+// Best of TUNING_REPEATS runs of the full CPU path (B packing plus every
+// chunk) for one candidate, in GOPS.
+static double measure(const TuningPoint& candidate, CPUExecutor& executor,
+                      MatrixBuffer* a, MatrixBuffer* b, MatrixBuffer* c) {
+    int n = candidate.size;
+    executor.configure(candidate.blocking, candidate.isa, candidate.threads);
+    std::vector<WorkChunk> chunks = createWorkChunks(n, n, candidate.chunkSize, candidate.chunkSize);
+    double best = 0.0;
+    for (int repeat = 0; repeat < TUNING_REPEATS; repeat++) {
+        auto scheduler = std::make_shared<WorkScheduler>();
+        auto start = std::chrono::steady_clock::now();
+        executor.prepare(a, b, scheduler);
+        executor.executeChunks(a, b, c, chunks, scheduler);
+        double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        executor.releasePackedB();
+        if (seconds > 0.0) {
+            best = std::max(best, 2.0 * n * n * static_cast<double>(n) / seconds / 1e9);
+        }
+    }
+    return best;
+}
+
+template <typename Apply, typename Value>
+static void sweep(const char* name, const std::vector<Value>& values, TuningPoint& best,
+                  CPUExecutor& executor, MatrixBuffer* a, MatrixBuffer* b, MatrixBuffer* c, Apply&& apply) {
+    for (const Value& value : values) {
+        TuningPoint candidate = best;
+        apply(candidate, value);
+        double gops = measure(candidate, executor, a, b, c);
+        std::cout << "TUNE: n=" << best.size << " " << name << "=" << value << " -> " << gops << " GOPS" << std::endl;
+        if (gops > best.gops) {
+            best = candidate;
+            best.gops = gops;
+        }
+    }
+}
+
+TuningTable runAutotuner(const std::vector<int>& sizes, CPUExecutor& executor) {
+    TuningTable table;
+    GemmBlocking initialBlocking = executor.gemmBlocking();
+    CPUIsa initialIsa = executor.microKernelIsa();
+    int initialThreads = executor.threadCount();
+    std::vector<std::string> isas;
+    for (CPUIsa isa : {CPUIsa::SCALAR, CPUIsa::AVX2, CPUIsa::AVX512, CPUIsa::NEON}) {
+        if (isaSupported(isa, executor.cpuFeatures())) {
+            isas.push_back(isaToString(isa));
+        }
+    }
+    int hardwareThreads = std::max(1u, std::thread::hardware_concurrency());
+    std::vector<int> threadCounts;
+    for (int t = 1; t < hardwareThreads; t *= 2) {
+        threadCounts.push_back(t);
+    }
+    threadCounts.push_back(hardwareThreads);
+    if (std::find(threadCounts.begin(), threadCounts.end(), initialThreads) == threadCounts.end()) {
+        threadCounts.push_back(initialThreads);
+    }
+    std::mt19937 rng(1234);
+    std::uniform_int_distribution<int> dist(INT_MIN, INT_MAX);
+    for (int n : sizes) {
+        // Full-range values keep the operands on the int32 kernels.
+        MatrixBuffer a(n), b(n), c(n);
+        int* aData = a.getCPUWritePtr();
+        int* bData = b.getCPUWritePtr();
+        for (std::size_t i = 0; i < static_cast<std::size_t>(n) * n; i++) {
+            aData[i] = dist(rng);
+            bData[i] = dist(rng);
+            a.valueRange.include(aData[i]);
+            b.valueRange.include(bData[i]);
+        }
+        a.releaseCPUAccess();
+        b.releaseCPUAccess();
+        TuningPoint best{n, std::min(n, defaultChunkSize(n)), alignBlocking(initialBlocking, initialIsa), initialIsa,
+                         initialThreads, 0.0};
+        best.gops = measure(best, executor, &a, &b, &c);
+        std::cout << "TUNE: n=" << n << " default -> " << best.gops << " GOPS" << std::endl;
+        // At least 2x2 chunks, so the CPU/GPU split still has work to divide.
+        std::vector<int> chunkSizes;
+        for (int chunk : {32, 48, 64, 96, 128, 192, 256, 384, 512}) {
+            if (chunk <= n / 2) chunkSizes.push_back(chunk);
+        }
+        sweep("chunk", chunkSizes, best, executor, &a, &b, &c,
+              [](TuningPoint& p, int v) { p.chunkSize = v; });
+        sweep("isa", isas, best, executor, &a, &b, &c,
+              [](TuningPoint& p, const std::string& v) {
+                  stringToIsa(v, p.isa);
+                  p.blocking = alignBlocking(p.blocking, p.isa);
+              });
+        sweep("mc", std::vector<int>{48, 72, 96, 128, 192, 256}, best, executor, &a, &b, &c,
+              [](TuningPoint& p, int v) { p.blocking.mc = roundToMultiple(v, gemmMicroKernel(p.isa).mr); });
+        sweep("kc", std::vector<int>{128, 192, 256, 384, 512}, best, executor, &a, &b, &c,
+              [](TuningPoint& p, int v) { p.blocking.kc = v; });
+        sweep("nc", std::vector<int>{128, 256, 512, 1024, 2048, 4096}, best, executor, &a, &b, &c,
+              [](TuningPoint& p, int v) { p.blocking.nc = roundToMultiple(v, gemmMicroKernel(p.isa).nr); });
+        sweep("threads", threadCounts, best, executor, &a, &b, &c,
+              [](TuningPoint& p, int v) { p.threads = v; });
+        std::cout << "TUNE: n=" << n << " best chunk=" << best.chunkSize << " MC=" << best.blocking.mc
+                  << " KC=" << best.blocking.kc << " NC=" << best.blocking.nc << " " << isaToString(best.isa)
+                  << " threads=" << best.threads << " -> " << best.gops << " GOPS" << std::endl;
+        table.add(best);
+    }
+    executor.configure(initialBlocking, initialIsa, initialThreads);
+    return table;
+}
+
+void runLayoutBenchmark(const std::vector<int>& sizes, CPUExecutor& executor) {
+    std::mt19937 rng(1234);
+    std::uniform_int_distribution<int> dist(INT_MIN, INT_MAX);
+    for (int n : sizes) {
+        std::vector<int> aValues(static_cast<std::size_t>(n) * n);
+        std::vector<int> bValues(aValues.size());
+        for (std::size_t i = 0; i < aValues.size(); i++) {
+            aValues[i] = dist(rng);
+            bValues[i] = dist(rng);
+        }
+        double rates[2] = {0.0, 0.0};
+        for (MatrixLayout layout : {MatrixLayout::ROW_MAJOR, MatrixLayout::MORTON}) {
+            MatrixBuffer a(1, n, n, DType::I32, layout);
+            MatrixBuffer b(1, n, n, DType::I32, layout);
+            MatrixBuffer c(1, n, n, DType::I32, layout);
+            a.fromRowMajor(aValues.data(), n);
+            b.fromRowMajor(bValues.data(), n);
+            a.valueRange = b.valueRange = ValueRange{INT_MIN, INT_MAX};
+            std::vector<WorkChunk> chunks = createWorkChunks(n, n, defaultChunkSize(n), defaultChunkSize(n));
+            double best = 0.0;
+            for (int repeat = 0; repeat < TUNING_REPEATS; repeat++) {
+                auto scheduler = std::make_shared<WorkScheduler>();
+                auto start = std::chrono::steady_clock::now();
+                if (layout == MatrixLayout::MORTON) {
+                    executor.executeMorton(&a, &b, &c, scheduler);
+                } else {
+                    executor.prepare(&a, &b, scheduler);
+                    executor.executeChunks(&a, &b, &c, chunks, scheduler);
+                    executor.releasePackedB();
+                }
+                double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+                if (seconds > 0.0) {
+                    best = std::max(best, 2.0 * n * n * static_cast<double>(n) / seconds / 1e9);
+                }
+            }
+            rates[layout == MatrixLayout::MORTON] = best;
+        }
+        std::cout << "LAYOUT: n=" << n << " row-major blocked " << rates[0] << " GOPS, morton recursive "
+                  << rates[1] << " GOPS (" << rates[1] / rates[0] << "x)" << std::endl;
+    }
+}
@@ -0,0 +1,67 @@
+#pragma once
+#include <string>
+#include <vector>
+#include <nlohmann/json_fwd.hpp>
+#include "cpu_features.h"
+#include "cpu_gemm.h"
+
+class CPUExecutor;
+
+// Parameters measured for one matrix size on this host.
+struct TuningPoint {
+    int size;
+    int chunkSize;
+    GemmBlocking blocking;
+    CPUIsa isa;
+    int threads;
+    double gops;
+};
+
+// Tuned points for one host, ordered by size. Between two measured sizes the
+// chunk and block sizes are interpolated on log2(size); the ISA tier and the
+// thread count come from the nearer point. Sizes outside the grid clamp to
+// the closest end. MC and NC are rounded to the tier's MR and NR.
+class TuningTable {
+public:
+    bool empty() const { return entries.empty(); }
+    void add(const TuningPoint& point);
+    TuningPoint lookup(int size) const;
+    const std::vector<TuningPoint>& points() const { return entries; }
+private:
+    std::vector<TuningPoint> entries;
+};
+
+// Chunk size used when no tuning data exists for this host.
+int defaultChunkSize(int matrixSize);
+
+// Identifies the host by CPU model and cache sizes, so one tuning file can be
+// shared between machines (e.g. through a network home directory).
+std::string hostTuningKey();
+
+// TUNING_FILE if set, otherwise ~/.cgnpu_tuning.json.
+std::string defaultTuningFile();
+
+// The whole tuning file, or an empty object when it is missing or unreadable.
+nlohmann::json readTuningFile(const std::string& path);
+
+// Replaces the whole tuning file. It is written to a temporary file next to
+// it and renamed over it, so a crash or a concurrent run never leaves a
+// partial file behind.
+bool writeTuningFile(const std::string& path, const nlohmann::json& j);
+
+// Returns an empty table when the file or the host's entry is missing.
+TuningTable loadTuningTable(const std::string& path, const std::string& hostKey);
+
+// Replaces this host's tuning points, keeping the other hosts in the file and
+// the rest of this host's entry.
+bool saveTuningTable(const std::string& path, const std::string& hostKey, const TuningTable& table);
+
+// Sweeps chunk size, MC/KC/NC, the int32 micro-kernel tier (MR x NR) and the
+// worker count for each size by coordinate descent, timing the real CPU chunk
+// path on random int32 operands.
+TuningTable runAutotuner(const std::vector<int>& sizes, CPUExecutor& executor);
+
+// Times the row-major blocked CPU path against the cache-oblivious multiply
+// on MORTON buffers for each size and prints both rates. Layout conversion
+// is not included; it happens once at load and store time.
+void runLayoutBenchmark(const std::vector<int>& sizes, CPUExecutor& executor);
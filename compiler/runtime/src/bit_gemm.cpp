@@ -0,0 +1,344 @@
+#include "bit_gemm.h"
+#include <algorithm>
+#include <vector>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define BIT_GEMM_HAVE_X86 1
+#endif
+
+constexpr int BIT_MR = 4;
+constexpr int BIT_NR = 4;
+// Words per block: four A and four B rows of 2 KB each fill 16 KB of L1.
+constexpr int BIT_KW = 256;
+
+void packBitRows(int rows, int cols, const int* a, int lda, uint64_t* dst) {
+    int words = bitWords(cols);
+    for (int i = 0; i < rows; i++) {
+        const int* row = a + static_cast<size_t>(i) * lda;
+        uint64_t* out = dst + static_cast<size_t>(i) * words;
+        for (int w = 0; w < words; w++) {
+            int first = w * 64;
+            int count = std::min(64, cols - first);
+            uint64_t word = 0;
+            for (int t = 0; t < count; t++) {
+                word |= static_cast<uint64_t>(row[first + t] != 0) << t;
+            }
+            out[w] = word;
+        }
+    }
+}
+
+// One word of every column per pass over 64 rows, so the words being built
+// stay in L1 while the rows stream through.
+void packBitColumns(int rows, int cols, const int* b, int ldb, uint64_t* dst) {
+    int words = bitWords(rows);
+    for (int w = 0; w < words; w++) {
+        int first = w * 64;
+        int count = std::min(64, rows - first);
+        for (int j = 0; j < cols; j++) {
+            dst[static_cast<size_t>(j) * words + w] = 0;
+        }
+        for (int t = 0; t < count; t++) {
+            const int* row = b + static_cast<size_t>(first + t) * ldb;
+            for (int j = 0; j < cols; j++) {
+                dst[static_cast<size_t>(j) * words + w] |= static_cast<uint64_t>(row[j] != 0) << t;
+            }
+        }
+    }
+}
+
+void unpackBitRows(int rows, int cols, const uint64_t* src, int lds, int* c, int ldc) {
+    for (int i = 0; i < rows; i++) {
+        const uint64_t* row = src + static_cast<size_t>(i) * lds;
+        int* out = c + static_cast<size_t>(i) * ldc;
+        for (int j = 0; j < cols; j++) {
+            out[j] = static_cast<int>((row[j / 64] >> (j % 64)) & 1);
+        }
+    }
+}
+
+static inline void storeBitTile(int value, bool boolean, bool accumulate, int* out) {
+    if (!accumulate) {
+        *out = value;
+    } else if (boolean) {
+        *out |= value;
+    } else {
+        *out += value;
+    }
+}
+
+// One word at a time: the AND and POPCNT (or OR) of every A and B row pair.
+// With the popcnt target the builtin is a single instruction.
+struct BitPlainTier {
+    template <int MR, int NR, bool BOOLEAN>
+    static inline void tile(int words, const uint64_t* a, int lda, const uint64_t* bt, int ldb, int* c, int ldc,
+                            bool accumulate) {
+        uint64_t acc[MR][NR] = {};
+        for (int w = 0; w < words; w++) {
+#pragma GCC unroll 4
+            for (int r = 0; r < MR; r++) {
+#pragma GCC unroll 4
+                for (int col = 0; col < NR; col++) {
+                    uint64_t bits = a[r * lda + w] & bt[col * ldb + w];
+                    if (BOOLEAN) {
+                        acc[r][col] |= bits;
+                    } else {
+                        acc[r][col] += static_cast<uint64_t>(__builtin_popcountll(bits));
+                    }
+                }
+            }
+        }
+        for (int r = 0; r < MR; r++) {
+            for (int col = 0; col < NR; col++) {
+                int value = BOOLEAN ? acc[r][col] != 0 : static_cast<int>(acc[r][col]);
+                storeBitTile(value, BOOLEAN, accumulate, c + r * ldc + col);
+            }
+        }
+    }
+};
+
+#ifdef BIT_GEMM_HAVE_X86
+// Eight words per step in 64-bit lanes, the last step masked; lane sums and
+// ORs are reduced once at the end of the tile.
+struct BitAvx512Tier {
+    template <int MR, int NR, bool BOOLEAN>
+    __attribute__((target("avx512f,avx512vpopcntdq")))
+    static inline void tile(int words, const uint64_t* a, int lda, const uint64_t* bt, int ldb, int* c, int ldc,
+                            bool accumulate) {
+        __m512i acc[MR][NR];
+#pragma GCC unroll 4
+        for (int r = 0; r < MR; r++) {
+#pragma GCC unroll 4
+            for (int col = 0; col < NR; col++) {
+                acc[r][col] = _mm512_setzero_si512();
+            }
+        }
+        for (int w = 0; w < words; w += 8) {
+            __mmask8 mask = words - w >= 8 ? 0xFF : static_cast<__mmask8>((1u << (words - w)) - 1);
+            __m512i av[MR];
+            __m512i bv[NR];
+#pragma GCC unroll 4
+            for (int r = 0; r < MR; r++) {
+                av[r] = _mm512_maskz_loadu_epi64(mask, a + r * lda + w);
+            }
+#pragma GCC unroll 4
+            for (int col = 0; col < NR; col++) {
+                bv[col] = _mm512_maskz_loadu_epi64(mask, bt + col * ldb + w);
+            }
+#pragma GCC unroll 4
+            for (int r = 0; r < MR; r++) {
+#pragma GCC unroll 4
+                for (int col = 0; col < NR; col++) {
+                    __m512i bits = _mm512_and_si512(av[r], bv[col]);
+                    acc[r][col] = BOOLEAN ? _mm512_or_si512(acc[r][col], bits)
+                                          : _mm512_add_epi64(acc[r][col], _mm512_popcnt_epi64(bits));
+                }
+            }
+        }
+        for (int r = 0; r < MR; r++) {
+            for (int col = 0; col < NR; col++) {
+                int value = BOOLEAN ? _mm512_test_epi64_mask(acc[r][col], acc[r][col]) != 0
+                                    : static_cast<int>(_mm512_reduce_add_epi64(acc[r][col]));
+                storeBitTile(value, BOOLEAN, accumulate, c + r * ldc + col);
+            }
+        }
+    }
+};
+#endif
+
+// Full BIT_MR x BIT_NR tiles, then the leftover rows and columns one result
+// at a time. A column of tiles reuses the same four B rows from L1.
+template <typename Tier, bool BOOLEAN>
+static inline void bitGemmTiles(int m, int n, int words, const uint64_t* a, int lda, const uint64_t* bt, int ldb,
+                                int* c, int ldc, bool accumulate) {
+    int mFull = m / BIT_MR * BIT_MR;
+    int nFull = n / BIT_NR * BIT_NR;
+    for (int j = 0; j < n; j += BIT_NR) {
+        const uint64_t* bPanel = bt + static_cast<size_t>(j) * ldb;
+        if (j < nFull) {
+            for (int i = 0; i < mFull; i += BIT_MR) {
+                Tier::template tile<BIT_MR, BIT_NR, BOOLEAN>(words, a + static_cast<size_t>(i) * lda, lda, bPanel,
+                                                             ldb, c + static_cast<size_t>(i) * ldc + j, ldc,
+                                                             accumulate);
+            }
+            for (int i = mFull; i < m; i++) {
+                Tier::template tile<1, BIT_NR, BOOLEAN>(words, a + static_cast<size_t>(i) * lda, lda, bPanel, ldb,
+                                                        c + static_cast<size_t>(i) * ldc + j, ldc, accumulate);
+            }
+            continue;
+        }
+        for (int col = j; col < n; col++) {
+            for (int i = 0; i < m; i++) {
+                Tier::template tile<1, 1, BOOLEAN>(words, a + static_cast<size_t>(i) * lda, lda,
+                                                   bt + static_cast<size_t>(col) * ldb, ldb,
+                                                   c + static_cast<size_t>(i) * ldc + col, ldc, accumulate);
+            }
+        }
+    }
+}
+
+// The table is built in subset order: entry s adds the B row of its lowest
+// set bit to entry s without that bit, one row OR per entry. B rows past k
+// only occur with A bits that are zero, so they add nothing.
+template <int W>
+static inline void fourRussiansPanel(int m, int k, const uint64_t* a, int lda, const uint64_t* b, int ldb,
+                                     int width, uint64_t* c, uint64_t* table) {
+    const int cols = W > 0 ? W : width;
+    std::fill(c, c + static_cast<size_t>(m) * cols, 0);
+    for (int w = 0; w < cols; w++) {
+        table[w] = 0;
+    }
+    for (int g = 0; g * 8 < k; g++) {
+        for (int s = 1; s < 256; s++) {
+            int row = g * 8 + __builtin_ctz(s);
+            const uint64_t* prev = table + (s & (s - 1)) * cols;
+            uint64_t* out = table + s * cols;
+            const uint64_t* src = row < k ? b + static_cast<size_t>(row) * ldb : nullptr;
+            for (int w = 0; w < cols; w++) {
+                out[w] = src ? prev[w] | src[w] : prev[w];
+            }
+        }
+        int word = g / 8;
+        int shift = (g % 8) * 8;
+        for (int i = 0; i < m; i++) {
+            unsigned index = (a[static_cast<size_t>(i) * lda + word] >> shift) & 255;
+            if (index == 0) {
+                continue;
+            }
+            const uint64_t* entry = table + index * cols;
+            uint64_t* out = c + static_cast<size_t>(i) * cols;
+            for (int w = 0; w < cols; w++) {
+                out[w] |= entry[w];
+            }
+        }
+    }
+}
+
+template <typename Tier>
+static inline void fourRussiansForWidth(int m, int k, const uint64_t* a, int lda, const uint64_t* b, int ldb,
+                                        int width, uint64_t* c, uint64_t* table) {
+    if (width == BIT_PANEL_WORDS) {
+        fourRussiansPanel<BIT_PANEL_WORDS>(m, k, a, lda, b, ldb, width, c, table);
+    } else {
+        fourRussiansPanel<0>(m, k, a, lda, b, ldb, width, c, table);
+    }
+}
+
+// Per-tier copies: flatten inlines the tiles so the target's POPCNT and vector
+// width reach every loop.
+#define BIT_GEMM_TIER(NAME, TIER, ATTRS)                                                                        \
+    ATTRS static void NAME##Count(int m, int n, int words, const uint64_t* a, int lda, const uint64_t* bt,     \
+                                  int ldb, int* c, int ldc, bool accumulate) {                                 \
+        bitGemmTiles<TIER, false>(m, n, words, a, lda, bt, ldb, c, ldc, accumulate);                          \
+    }                                                                                                          \
+    ATTRS static void NAME##Any(int m, int n, int words, const uint64_t* a, int lda, const uint64_t* bt,       \
+                                int ldb, int* c, int ldc, bool accumulate) {                                   \
+        bitGemmTiles<TIER, true>(m, n, words, a, lda, bt, ldb, c, ldc, accumulate);                           \
+    }                                                                                                          \
+    ATTRS static void NAME##FourRussians(int m, int k, const uint64_t* a, int lda, const uint64_t* b, int ldb, \
+                                         int width, uint64_t* c, uint64_t* table) {                            \
+        fourRussiansForWidth<TIER>(m, k, a, lda, b, ldb, width, c, table);                                    \
+    }
+
+BIT_GEMM_TIER(bitScalar, BitPlainTier, )
+#ifdef BIT_GEMM_HAVE_X86
+BIT_GEMM_TIER(bitAvx2, BitPlainTier, __attribute__((target("avx2,popcnt,bmi"), flatten)))
+BIT_GEMM_TIER(bitAvx512, BitAvx512Tier,
+              __attribute__((target("avx512f,avx512vl,avx512bw,avx512vpopcntdq,popcnt,bmi"), flatten)))
+#endif
+#undef BIT_GEMM_TIER
+
+static const BitGemmKernel bitScalarKernel{CPUIsa::SCALAR, "scalar", bitScalarCount, bitScalarAny,
+                                           bitScalarFourRussians};
+#ifdef BIT_GEMM_HAVE_X86
+static const BitGemmKernel bitAvx2Kernel{CPUIsa::AVX2, "avx2+popcnt", bitAvx2Count, bitAvx2Any,
+                                         bitAvx2FourRussians};
+static const BitGemmKernel bitAvx512Kernel{CPUIsa::AVX512, "avx512+vpopcntdq", bitAvx512Count, bitAvx512Any,
+                                           bitAvx512FourRussians};
+#endif
+// The plain loops compiled for AArch64, whose popcount is CNT on a vector.
+static const BitGemmKernel bitNeonKernel{CPUIsa::NEON, "neon", bitScalarCount, bitScalarAny, bitScalarFourRussians};
+
+const BitGemmKernel& bitGemmKernel(CPUIsa isa, const CPUFeatures& features) {
+#ifdef BIT_GEMM_HAVE_X86
+    // Both x86 tiers are also compiled for POPCNT and BMI.
+    bool popcntBmi = features.popcnt && features.bmi;
+    if (isa == CPUIsa::AVX512 && features.avx512vpopcntdq && popcntBmi) {
+        return bitAvx512Kernel;
+    }
+    if ((isa == CPUIsa::AVX512 || isa == CPUIsa::AVX2) && popcntBmi) {
+        return bitAvx2Kernel;
+    }
+#endif
+    if (isa == CPUIsa::NEON) {
+        return bitNeonKernel;
+    }
+    return bitScalarKernel;
+}
+
+void bitGemm(const BitGemmKernel& kernel, bool boolean, int m, int n, int words, const uint64_t* a, int lda,
+             const uint64_t* bt, int ldb, int* c, int ldc) {
+    BitGemmFn fn = boolean ? kernel.any : kernel.count;
+    if (words == 0) {
+        fn(m, n, 0, a, lda, bt, ldb, c, ldc, false);
+        return;
+    }
+    for (int w = 0; w < words; w += BIT_KW) {
+        fn(m, n, std::min(BIT_KW, words - w), a + w, lda, bt + w, ldb, c, ldc, w > 0);
+    }
+}
+
+// Odd shapes cover the edge tiles, the masked last AVX-512 step and a short
+// last Four-Russians panel; k spans two word blocks.
+bool verifyBitGemmKernel(const BitGemmKernel& kernel) {
+    const int m = 2 * BIT_MR + 3;
+    const int n = 2 * BIT_NR + 7 + 64 * BIT_PANEL_WORDS;
+    const int k = 64 * BIT_KW + 133;
+    std::vector<int> a(static_cast<size_t>(m) * k), b(static_cast<size_t>(k) * n);
+    unsigned seed = 4242;
+    for (auto* matrix : {&a, &b}) {
+        for (auto& v : *matrix) {
+            seed = seed * 1103515245u + 12345u;
+            v = (seed >> 16) % 61 == 0;
+        }
+    }
+    std::vector<int> counts(static_cast<size_t>(m) * n, 0);
+    for (int i = 0; i < m; i++) {
+        for (int q = 0; q < k; q++) {
+            if (!a[static_cast<size_t>(i) * k + q]) {
+                continue;
+            }
+            for (int j = 0; j < n; j++) {
+                counts[static_cast<size_t>(i) * n + j] += b[static_cast<size_t>(q) * n + j];
+            }
+        }
+    }
+    int kWords = bitWords(k);
+    int nWords = bitWords(n);
+    std::vector<uint64_t> bitA(static_cast<size_t>(m) * kWords), bitB(static_cast<size_t>(n) * kWords);
+    std::vector<uint64_t> rowsB(static_cast<size_t>(k) * nWords);
+    packBitRows(m, k, a.data(), k, bitA.data());
+    packBitColumns(k, n, b.data(), n, bitB.data());
+    packBitRows(k, n, b.data(), n, rowsB.data());
+    std::vector<int> count(static_cast<size_t>(m) * n, -1), any(static_cast<size_t>(m) * n, -1);
+    std::vector<int> tables(static_cast<size_t>(m) * n, -1);
+    bitGemm(kernel, false, m, n, kWords, bitA.data(), kWords, bitB.data(), kWords, count.data(), n);
+    bitGemm(kernel, true, m, n, kWords, bitA.data(), kWords, bitB.data(), kWords, any.data(), n);
+    std::vector<uint64_t> product(static_cast<size_t>(m) * BIT_PANEL_WORDS), table(256 * BIT_PANEL_WORDS);
+    for (int w0 = 0; w0 < nWords; w0 += BIT_PANEL_WORDS) {
+        int width = std::min(BIT_PANEL_WORDS, nWords - w0);
+        kernel.fourRussians(m, k, bitA.data(), kWords, rowsB.data() + w0, nWords, width, product.data(),
+                            table.data());
+        unpackBitRows(m, std::min(n - w0 * 64, width * 64), product.data(), width, tables.data() + w0 * 64, n);
+    }
+    bool anyNonzero = false;
+    for (size_t i = 0; i < counts.size(); i++) {
+        int expected = counts[i] != 0;
+        anyNonzero |= expected != 0;
+        if (count[i] != counts[i] || any[i] != expected || tables[i] != expected) {
+            return false;
+        }
+    }
+    return anyNonzero;
+}
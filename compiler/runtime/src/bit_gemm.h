@@ -0,0 +1,51 @@
+#pragma once
+#include <cstdint>
+#include "cpu_features.h"
+
+// Bit-packed 0/1 matrices. A packed row of cols elements takes bitWords(cols)
+// words, element j in bit j % 64 of word j / 64, with any padding bits zero;
+// every nonzero input element packs to 1.
+inline int bitWords(int cols) { return (cols + 63) / 64; }
+
+// dst[i] = row i of a, rows * bitWords(cols) words.
+void packBitRows(int rows, int cols, const int* a, int lda, uint64_t* dst);
+// dst[j] = column j of b, so cols * bitWords(rows) words holding b^T. The
+// counting kernels read B this way, one packed column per result column.
+void packBitColumns(int rows, int cols, const int* b, int ldb, uint64_t* dst);
+// c[i][j] = bit j of packed row i, lds words apart.
+void unpackBitRows(int rows, int cols, const uint64_t* src, int lds, int* c, int ldc);
+
+// Result words per Four-Russians panel: 512 columns, one zmm of table entry.
+constexpr int BIT_PANEL_WORDS = 8;
+
+// C[m x n] from row-packed A and column-packed B with words words each:
+// C[i][j] = popcount(A[i] & B[j]) counting products, or 1 when the AND is
+// nonzero for boolean ones. With accumulate C is added to, or ORed, instead.
+using BitGemmFn = void (*)(int m, int n, int words, const uint64_t* a, int lda, const uint64_t* bt, int ldb, int* c,
+                           int ldc, bool accumulate);
+// Boolean product of m row-packed rows of A (k bits) with row-packed B, for
+// the width <= BIT_PANEL_WORDS words of B starting at b. Each group of eight
+// B rows is ORed into a 256-entry table of every subset, then one table
+// lookup per A byte replaces eight row ORs. c receives m packed rows of width
+// words; table holds 256 * width words of scratch.
+using BitFourRussiansFn = void (*)(int m, int k, const uint64_t* a, int lda, const uint64_t* b, int ldb, int width,
+                                   uint64_t* c, uint64_t* table);
+
+struct BitGemmKernel {
+    CPUIsa isa;
+    const char* name;
+    BitGemmFn count;
+    BitGemmFn any;
+    BitFourRussiansFn fourRussians;
+};
+
+// The fastest kernels for isa on this CPU: AVX-512 uses VPOPCNTDQ when the CPU
+// has it, and otherwise falls back to the AVX2 build, whose scalar POPCNT
+// handles one word per instruction.
+const BitGemmKernel& bitGemmKernel(CPUIsa isa, const CPUFeatures& features);
+bool verifyBitGemmKernel(const BitGemmKernel& kernel);
+
+// Runs kernel.count (kernel.any with boolean) over blocks of the words so the
+// packed rows of a tile stay in L1 however long k is.
+void bitGemm(const BitGemmKernel& kernel, bool boolean, int m, int n, int words, const uint64_t* a, int lda,
+             const uint64_t* bt, int ldb, int* c, int ldc);
@@ -0,0 +1,110 @@
+#pragma once
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+// Chase-Lev work-stealing deque, in the C11 formulation of Le, Pop, Cohen
+// and Zappa Nardelli. The owning worker pushes and pops at the bottom
+// without locking; any other thread steals the oldest item from the top with
+// a single CAS. T must be lock-free as a std::atomic, e.g. a pointer.
+template <typename T>
+class ChaseLevDeque {
+public:
+    // capacity is rounded up to a power of two; the ring doubles when full.
+    explicit ChaseLevDeque(int64_t capacity = 64) : top(0), bottom(0) {
+        int64_t size = 1;
+        while (size < capacity) {
+            size *= 2;
+        }
+        rings.push_back(std::make_unique<Ring>(size));
+        ring.store(rings.back().get(), std::memory_order_relaxed);
+    }
+    ChaseLevDeque(const ChaseLevDeque&) = delete;
+    ChaseLevDeque& operator=(const ChaseLevDeque&) = delete;
+
+    // Owner only.
+    void push(T item) {
+        int64_t b = bottom.load(std::memory_order_relaxed);
+        int64_t t = top.load(std::memory_order_acquire);
+        Ring* r = ring.load(std::memory_order_relaxed);
+        if (b - t > r->capacity - 1) {
+            r = grow(r, t, b);
+        }
+        r->put(b, item);
+        bottom.store(b + 1, std::memory_order_release);
+    }
+
+    // Owner only: the most recently pushed item. Returns false when the
+    // deque is empty, or when a thief took its last item first.
+    bool pop(T& item) {
+        int64_t b = bottom.load(std::memory_order_relaxed) - 1;
+        Ring* r = ring.load(std::memory_order_relaxed);
+        bottom.store(b, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        int64_t t = top.load(std::memory_order_relaxed);
+        if (t > b) {
+            bottom.store(b + 1, std::memory_order_relaxed);
+            return false;
+        }
+        item = r->get(b);
+        if (t < b) {
+            return true;
+        }
+        bool won = top.compare_exchange_strong(t, t + 1, std::memory_order_seq_cst, std::memory_order_relaxed);
+        bottom.store(b + 1, std::memory_order_relaxed);
+        return won;
+    }
+
+    // Any thread: the oldest item. Returns false when the deque is empty, or
+    // when the owner or another thief won the race for the item.
+    bool steal(T& item) {
+        int64_t t = top.load(std::memory_order_acquire);
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        int64_t b = bottom.load(std::memory_order_acquire);
+        if (t >= b) {
+            return false;
+        }
+        Ring* r = ring.load(std::memory_order_acquire);
+        T value = r->get(t);
+        if (!top.compare_exchange_strong(t, t + 1, std::memory_order_seq_cst, std::memory_order_relaxed)) {
+            return false;
+        }
+        item = value;
+        return true;
+    }
+
+    // A snapshot that may be stale by the time it is read.
+    int64_t size() const {
+        int64_t b = bottom.load(std::memory_order_relaxed);
+        int64_t t = top.load(std::memory_order_relaxed);
+        return b > t ? b - t : 0;
+    }
+    bool empty() const { return size() == 0; }
+
+private:
+    struct Ring {
+        int64_t capacity;
+        std::unique_ptr<std::atomic<T>[]> items;
+        explicit Ring(int64_t size) : capacity(size), items(new std::atomic<T>[size]) {}
+        T get(int64_t i) const { return items[i & (capacity - 1)].load(std::memory_order_relaxed); }
+        void put(int64_t i, T value) { items[i & (capacity - 1)].store(value, std::memory_order_relaxed); }
+    };
+
+    Ring* grow(Ring* old, int64_t t, int64_t b) {
+        rings.push_back(std::make_unique<Ring>(old->capacity * 2));
+        Ring* r = rings.back().get();
+        for (int64_t i = t; i < b; i++) {
+            r->put(i, old->get(i));
+        }
+        ring.store(r, std::memory_order_release);
+        return r;
+    }
+
+    alignas(64) std::atomic<int64_t> top;
+    alignas(64) std::atomic<int64_t> bottom;
+    std::atomic<Ring*> ring;
+    // Outgrown rings are kept until the deque goes away, since a thief may
+    // still be reading from one. Only the owner appends.
+    std::vector<std::unique_ptr<Ring>> rings;
+};
@@ -1,14 +1,40 @@
 #include "cpu_executor.h"
+#include "small_gemm.h"
+#include "morton_gemm.h"
 #include <vector>
+#include <algorithm>
 #include <thread>
 #include <iostream>
+#include <cstdlib>
+#include <stdexcept>
+#include <string>
+#include <type_traits>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+#include <chrono>
 
-CPUExecutor::CPUExecutor(): numThreads(0) {
+CPUExecutor::CPUExecutor()
+    : numThreads(0),
+      isaForced(false),
+      streamThreshold(8 << 20),
+      blocking(defaultGemmBlocking()),
+      microKernel(&gemmMicroKernel(CPUIsa::SCALAR)),
+      f32Kernel(&gemmF32MicroKernel(CPUIsa::SCALAR)),
+      f64Kernel(&gemmF64MicroKernel(CPUIsa::SCALAR)),
+      modKernel(&gemmModKernel(CPUIsa::SCALAR)),
+      crtKernel(&gemmCrtKernel(CPUIsa::SCALAR)),
+      semiringIsa(CPUIsa::SCALAR),
+      bitKernel(&bitGemmKernel(CPUIsa::SCALAR, CPUFeatures{})),
+      fourRussians(false),
+      selection{KernelWidth::INT32, KernelWidth::INT64, 0.0, nullptr} {
 }
 
 CPUExecutor::~CPUExecutor() = default;
 
 void CPUExecutor::initialize() {
+    CPUTopology topology = detectCPUTopology();
+    AffinityPolicy affinity = affinityPolicyFromEnv();
     numThreads = std::thread::hardware_concurrency();
     #if defined(__APPLE__) && defined(__arm64__)
         if (numThreads >= 8) {
@@ -19,9 +45,294 @@ void CPUExecutor::initialize() {
             numThreads = std::max(1, numThreads - 1);
         }
     #else
-        numThreads = std::max(1, numThreads - 2);
+        if (topology.known()) {
+            numThreads = defaultWorkerCount(topology, affinity);
+        } else {
+            numThreads = std::max(1, numThreads - 2);
+        }
     #endif
+    cpuOrder = affinityOrder(topology, affinity);
     std::cout << "DEBUG: CPU executor initialized with " << numThreads << " threads" << std::endl;
+    if (topology.known()) {
+        std::cout << "DEBUG: CPU topology: " << describeTopology(topology) << std::endl;
+    }
+    if (cpuOrder.empty()) {
+        std::cout << "DEBUG: CPU workers not pinned" << std::endl;
+    } else {
+        std::cout << "DEBUG: CPU workers pinned (" << (affinity.spread ? "spread" : "compact")
+                  << (affinity.smt ? ", SMT" : "") << ") to CPUs";
+        for (int i = 0; i < numThreads; i++) {
+            std::cout << (i == 0 ? " " : ",") << cpuOrder[i % cpuOrder.size()];
+        }
+        std::cout << std::endl;
+    }
+    features = detectCPUFeatures();
+    CPUCaches caches = detectCPUCaches();
+    long lastLevel = std::max({caches.l1d, caches.l2, caches.l3});
+    if (lastLevel > 0) {
+        streamThreshold = static_cast<std::size_t>(lastLevel);
+    }
+    CPUIsa isa = bestIsa(features);
+    const char* isaEnv = std::getenv("CPU_ISA");
+    if (isaEnv != nullptr) {
+        CPUIsa forced;
+        if (!stringToIsa(isaEnv, forced)) {
+            std::cout << "WARNING: Unknown CPU_ISA value '" << isaEnv << "', using "
+                      << isaToString(isa) << std::endl;
+        } else if (!isaSupported(forced, features)) {
+            std::cout << "WARNING: CPU_ISA=" << isaEnv << " is not supported on this CPU, using "
+                      << isaToString(isa) << std::endl;
+        } else {
+            isa = forced;
+            isaForced = true;
+        }
+    }
+    microKernel = &gemmMicroKernel(isa);
+    if (!verifyGemmMicroKernel(*microKernel)) {
+        std::cout << "WARNING: " << isaToString(isa)
+                  << " micro-kernel failed self-check against scalar reference, using scalar" << std::endl;
+        microKernel = &gemmMicroKernel(CPUIsa::SCALAR);
+    }
+    std::cout << "DEBUG: CPU GEMM blocking MC=" << blocking.mc << " KC=" << blocking.kc
+              << " NC=" << blocking.nc << ", " << isaToString(microKernel->isa) << " micro-kernel "
+              << microKernel->mr << "x" << microKernel->nr << std::endl;
+    CPUIsa floatIsa = microKernel->isa;
+    f32Kernel = &gemmF32MicroKernel(floatIsa);
+    f64Kernel = &gemmF64MicroKernel(floatIsa);
+    if (!verifyGemmFloatMicroKernel(*f32Kernel) || !verifyGemmFloatMicroKernel(*f64Kernel)) {
+        std::cout << "WARNING: " << isaToString(floatIsa)
+                  << " floating-point micro-kernels failed self-check, using scalar" << std::endl;
+        f32Kernel = &gemmF32MicroKernel(CPUIsa::SCALAR);
+        f64Kernel = &gemmF64MicroKernel(CPUIsa::SCALAR);
+    }
+    std::cout << "DEBUG: CPU floating-point micro-kernels " << isaToString(f32Kernel->isa)
+              << " f32 " << f32Kernel->mr << "x" << f32Kernel->nr
+              << ", f64 " << f64Kernel->mr << "x" << f64Kernel->nr << std::endl;
+    modKernel = &gemmModKernel(microKernel->isa);
+    if (!verifyGemmModKernel(*modKernel)) {
+        std::cout << "WARNING: " << isaToString(modKernel->isa)
+                  << " modular micro-kernel failed self-check, using scalar" << std::endl;
+        modKernel = &gemmModKernel(CPUIsa::SCALAR);
+    }
+    std::cout << "DEBUG: CPU modular micro-kernel " << isaToString(modKernel->isa) << " "
+              << modKernel->mr << "x" << modKernel->nr << std::endl;
+    crtKernel = &gemmCrtKernel(microKernel->isa);
+    if (!verifyGemmCrtKernel(*crtKernel)) {
+        std::cout << "WARNING: " << isaToString(crtKernel->isa)
+                  << " CRT digit kernel failed self-check, using scalar" << std::endl;
+        crtKernel = &gemmCrtKernel(CPUIsa::SCALAR);
+    }
+    semiringIsa = microKernel->isa;
+    for (Semiring semiring : {Semiring::MIN_PLUS, Semiring::MAX_PLUS, Semiring::OR_AND}) {
+        const GemmSemiringKernel<float>* f32 = gemmF32SemiringKernel(semiring, semiringIsa);
+        const GemmSemiringKernel<double>* f64 = gemmF64SemiringKernel(semiring, semiringIsa);
+        if (!verifyGemmSemiringKernel(*gemmI32SemiringKernel(semiring, semiringIsa)) ||
+            (f32 && !verifyGemmSemiringKernel(*f32)) || (f64 && !verifyGemmSemiringKernel(*f64))) {
+            std::cout << "WARNING: " << isaToString(semiringIsa) << " " << semiringToString(semiring)
+                      << " micro-kernels failed self-check, using scalar" << std::endl;
+            semiringIsa = CPUIsa::SCALAR;
+            break;
+        }
+    }
+    bitKernel = &bitGemmKernel(microKernel->isa, features);
+    if (!verifyBitGemmKernel(*bitKernel)) {
+        std::cout << "WARNING: " << bitKernel->name << " bit-matrix kernels failed self-check, using scalar"
+                  << std::endl;
+        bitKernel = &bitGemmKernel(CPUIsa::SCALAR, features);
+    }
+    const char* fourRussiansEnv = std::getenv("BIT_FOUR_RUSSIANS");
+    fourRussians = fourRussiansEnv != nullptr && std::string(fourRussiansEnv) == "1";
+    std::cout << "DEBUG: CPU bit-matrix kernels " << bitKernel->name
+              << (fourRussians ? ", Four-Russians boolean products" : "") << std::endl;
+    const char* narrowEnv = std::getenv("NARROW_KERNELS");
+    if (narrowEnv != nullptr && std::string(narrowEnv) == "0") {
+        std::cout << "DEBUG: Narrow int8/int16 kernels disabled" << std::endl;
+        return;
+    }
+    for (KernelWidth width : {KernelWidth::INT8, KernelWidth::INT16}) {
+        for (const GemmNarrowKernel* kernel : gemmNarrowKernels(width, microKernel->isa, features)) {
+            if (!verifyGemmNarrowKernel(*kernel)) {
+                std::cout << "WARNING: " << isaToString(kernel->isa) << " " << kernelWidthToString(width)
+                          << " micro-kernel failed self-check, not using it" << std::endl;
+                continue;
+            }
+            narrowKernels.push_back(kernel);
+            std::cout << "DEBUG: CPU narrow micro-kernel " << isaToString(kernel->isa) << " "
+                      << kernelWidthToString(width) << " " << kernel->mr << "x" << kernel->nr << std::endl;
+        }
+    }
+}
+
+void CPUExecutor::setWorkerPool(std::shared_ptr<WorkerPool> workers) {
+    pool = std::move(workers);
+}
+
+// An executor used on its own, as by the autotuner, starts its own pool.
+WorkerPool& CPUExecutor::workerPool() {
+    if (!pool) {
+        pool = std::make_shared<WorkerPool>(numThreads - 1, cpuOrder);
+    }
+    return *pool;
+}
+
+void CPUExecutor::configure(const GemmBlocking& tuned, CPUIsa isa, int threads) {
+    blocking = tuned;
+    numThreads = std::max(1, threads);
+    if (isaForced || isa == microKernel->isa || !isaSupported(isa, features)) {
+        return;
+    }
+    const GemmMicroKernel& kernel = gemmMicroKernel(isa);
+    if (!verifyGemmMicroKernel(kernel)) {
+        std::cout << "WARNING: Tuned " << isaToString(isa)
+                  << " micro-kernel failed self-check, keeping " << isaToString(microKernel->isa) << std::endl;
+        return;
+    }
+    microKernel = &kernel;
+}
+
+// Picks the operand width from the load-time value ranges and, for a narrow
+// width, converts A and B once so every chunk packs from the narrow copies.
+void CPUExecutor::prepareOperands(
+    MatrixBuffer* a,
+    MatrixBuffer* b,
+    std::shared_ptr<Profiler> profiler) {
+    if (a->dtype != DType::I32) {
+        selection = KernelSelection{KernelWidth::INT32, KernelWidth::INT32, 0.0, nullptr};
+        std::cout << "DEBUG: CPU operand type " << dtypeToString(a->dtype) << std::endl;
+        return;
+    }
+    selection = selectKernelWidth(a->cols, a->valueRange, b->valueRange, narrowKernels);
+    // The narrow copies keep each operand's layout, so offsets carry over.
+    std::size_t aElements = a->batchStride();
+    std::size_t bElements = b->batchStride();
+    const int* aData = a->getCPUReadPtr();
+    const int* bData = b->getCPUReadPtr();
+    if (selection.operandWidth == KernelWidth::INT16) {
+        narrowA16.assign(aData, aData + aElements);
+        narrowB16.assign(bData, bData + bElements);
+    } else if (selection.operandWidth == KernelWidth::INT8) {
+        narrowA8.resize(aElements);
+        narrowB8.resize(bElements);
+        for (std::size_t i = 0; i < aElements; i++) {
+            narrowA8[i] = static_cast<uint8_t>(aData[i]);
+        }
+        for (std::size_t i = 0; i < bElements; i++) {
+            narrowB8[i] = static_cast<uint8_t>(bData[i]);
+        }
+    }
+    a->releaseCPUAccess();
+    b->releaseCPUAccess();
+    std::cout << "DEBUG: CPU operand width " << kernelWidthToString(selection.operandWidth)
+              << ", accumulator bound " << selection.accumulatorBound << " needs "
+              << kernelWidthToString(selection.accumulatorWidth);
+    if (selection.narrowKernel) {
+        std::cout << ", " << isaToString(selection.narrowKernel->isa) << " micro-kernel "
+                  << selection.narrowKernel->mr << "x" << selection.narrowKernel->nr;
+    }
+    std::cout << std::endl;
+    if (selection.accumulatorWidth == KernelWidth::INT64) {
+        std::cout << "WARNING: Products may exceed int32; results wrap modulo 2^32" << std::endl;
+    }
+    if (profiler) {
+        profiler->recordMetric("CPU operand width", selection.operandWidth == KernelWidth::INT8 ? 8 :
+                               selection.operandWidth == KernelWidth::INT16 ? 16 : 32, "bits");
+    }
+}
+
+void CPUExecutor::prepare(
+    MatrixBuffer* a,
+    MatrixBuffer* b,
+    std::shared_ptr<WorkScheduler> scheduler,
+    std::shared_ptr<Profiler> profiler) {
+    prepareOperands(a, b, profiler);
+    packB(b, scheduler, profiler);
+}
+
+void CPUExecutor::releasePackedB() {
+    packedB.reset();
+}
+
+void CPUExecutor::setEpilogue(const MatrixEpilogue* spec) {
+    epilogue = spec && !spec->trivial() ? spec : nullptr;
+}
+
+// The epilogue for one block, with operand pointers moved to the block's
+// first result element.
+template <typename T>
+static GemmEpilogue<T> blockEpilogue(const MatrixEpilogue& spec, const WorkChunk& chunk) {
+    GemmEpilogue<T> block;
+    block.alpha = static_cast<T>(spec.alpha);
+    block.beta = static_cast<T>(spec.beta);
+    block.count = static_cast<int>(spec.steps.size());
+    for (int i = 0; i < block.count; i++) {
+        const MatrixEpilogue::Step& step = spec.steps[i];
+        GemmPostOp<T>& op = block.ops[i];
+        op = {step.kind, nullptr, 0, static_cast<T>(step.value), static_cast<T>(step.upper)};
+        if (step.kind == PostOpKind::BIAS) {
+            op.data = step.matrix->getCPUReadPtrAs<T>() + step.matrix->index(0, chunk.startCol);
+        } else if (postOpHasOperand(step.kind)) {
+            op.data = step.matrix->getCPUReadPtrAs<T>() + step.matrix->index(chunk.startRow, chunk.startCol);
+            op.ld = step.matrix->rowStride();
+        }
+    }
+    return block;
+}
+
+// Packs B in the layout of the kernel the chunks will use, in groups of
+// column panels run as parallel tasks. Chunks that start on a panel boundary
+// read these panels; any other chunk falls back to packing its own.
+void CPUExecutor::packB(
+    MatrixBuffer* b,
+    std::shared_ptr<WorkScheduler> scheduler,
+    std::shared_ptr<Profiler> profiler) {
+    constexpr int PANELS_PER_TASK = 8;
+    if (b->layout != MatrixLayout::ROW_MAJOR) {
+        // Each column panel of a tiled B is already contiguous; chunks pack
+        // their own slice of it.
+        packedB.reset();
+        return;
+    }
+    int k = b->rows;
+    int n = b->cols;
+    int ldb = b->ld;
+    auto start = std::chrono::steady_clock::now();
+    std::function<void(int, int)> pack;
+    if (b->dtype == DType::F32) {
+        packedB = allocateGemmPackedB(k, n, blocking, f32Kernel->nr, 1, sizeof(float));
+        const float* data = b->getCPUReadPtrAs<float>();
+        pack = [this, data, ldb](int p0, int p1) { packGemmB(*packedB, data, ldb, p0, p1); };
+    } else if (b->dtype == DType::F64) {
+        packedB = allocateGemmPackedB(k, n, blocking, f64Kernel->nr, 1, sizeof(double));
+        const double* data = b->getCPUReadPtrAs<double>();
+        pack = [this, data, ldb](int p0, int p1) { packGemmB(*packedB, data, ldb, p0, p1); };
+    } else if (selection.operandWidth == KernelWidth::INT16) {
+        packedB = allocateGemmPackedB(k, n, blocking, selection.narrowKernel->nr,
+                                      selection.narrowKernel->kGroup, sizeof(int16_t));
+        const int16_t* data = narrowB16.data();
+        pack = [this, data, ldb](int p0, int p1) { packGemmB(*packedB, data, ldb, p0, p1); };
+    } else if (selection.operandWidth == KernelWidth::INT8) {
+        packedB = allocateGemmPackedB(k, n, blocking, selection.narrowKernel->nr,
+                                      selection.narrowKernel->kGroup, sizeof(uint8_t));
+        const uint8_t* data = narrowB8.data();
+        pack = [this, data, ldb](int p0, int p1) { packGemmB(*packedB, data, ldb, p0, p1); };
+    } else {
+        packedB = allocateGemmPackedB(k, n, blocking, microKernel->nr, 1, sizeof(int));
+        const int* data = b->getCPUReadPtr();
+        pack = [this, data, ldb](int p0, int p1) { packGemmB(*packedB, data, ldb, p0, p1); };
+    }
+    int panels = packedB->panels();
+    int tasks = (panels + PANELS_PER_TASK - 1) / PANELS_PER_TASK;
+    executeTasks(tasks, [&pack, panels](int task) {
+        int p0 = task * PANELS_PER_TASK;
+        pack(p0, std::min(panels, p0 + PANELS_PER_TASK));
+    }, scheduler, profiler);
+    b->releaseCPUAccess();
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    std::cout << "DEBUG: Packed B once into " << panels << " panels of width " << packedB->nr
+              << " in " << seconds * 1000.0 << " ms" << std::endl;
+    if (profiler) {
+        profiler->recordMetric("CPU B packing", seconds * 1000.0, "ms");
+    }
 }
 
 void CPUExecutor::execute(
@@ -30,242 +341,914 @@ void CPUExecutor::execute(
     MatrixBuffer* result,
     std::shared_ptr<WorkScheduler> scheduler,
     std::shared_ptr<Profiler> profiler) {
-    std::vector<std::thread> threads;
     std::cout << "DEBUG: CPU executor starting with " << numThreads << " threads" << std::endl;
+    // Each worker holds a reference so the panels outlive a concurrent release.
+    std::shared_ptr<const GemmPackedB> sharedB = packedB;
 
-    const char* gpuOnlyEnv = std::getenv("GPU_ONLY");
-    bool gpuOnly = (gpuOnlyEnv != nullptr);
-    if (gpuOnly) {
-        std::cout << "DEBUG: CPU executor skipping work stealing (GPU_ONLY mode enabled)" << std::endl;
+    scheduler->setWorkerCount(DeviceType::CPU, numThreads);
+    workerPool().run(numThreads, [&](int i) {
+        std::cout << "DEBUG: CPU worker thread " << i << " started" << std::endl;
+        WorkChunk* chunk;
+        while ((chunk = scheduler->getWork(DeviceType::CPU, i))) {
+            std::cout << "DEBUG: CPU worker " << i << " processing chunk [" 
+                      << chunk->startRow << ":" << chunk->endRow << ", "
+                      << chunk->startCol << ":" << chunk->endCol << "]" << std::endl;
+            int chunkSize = (chunk->endRow - chunk->startRow) *
+                          (chunk->endCol - chunk->startCol);
+            auto startTime = std::chrono::steady_clock::now();
+            executeChunk(a, b, result, *chunk, sharedB.get());
+            auto endTime = std::chrono::steady_clock::now();
+            double seconds = std::chrono::duration_cast<std::chrono::microseconds>(
+                endTime - startTime).count() / 1000000.0;
+            if (profiler) {
+                profiler->recordChunkExecution("CPU", chunkSize);
+            }
+            scheduler->recordChunkProcessingTime(DeviceType::CPU, seconds);
+            std::cout << "DEBUG: CPU worker " << i << " finished processing chunk" << std::endl;
+            scheduler->finishWork(DeviceType::CPU, chunk);
+        }
+        std::cout << "DEBUG: CPU worker thread " << i << " exiting" << std::endl;
+    });
+
+    if (profiler) {
+        std::cout << "DEBUG: CPU executor using profiler data" << std::endl;
+    }
+
+    std::cout << "DEBUG: CPU executor finished" << std::endl;
+}
+
+void CPUExecutor::executeTasks(
+    int taskCount,
+    const std::function<void(int)>& task,
+    std::shared_ptr<WorkScheduler> scheduler,
+    std::shared_ptr<Profiler> profiler) {
+    if (taskCount <= 0) {
+        return;
+    }
+    std::vector<WorkChunk> tasks;
+    tasks.reserve(taskCount);
+    for (int i = 0; i < taskCount; i++) {
+        tasks.emplace_back(i, i + 1, 0, 1);
+    }
+    if (profiler) {
+        profiler->startTimer("cpu_tasks");
+    }
+    scheduler->addWork(tasks, DeviceType::CPU);
+    int workers = std::min(numThreads, taskCount);
+    scheduler->setWorkerCount(DeviceType::CPU, workers);
+    workerPool().run(workers, [&](int i) {
+        WorkChunk* chunk;
+        while ((chunk = scheduler->getWork(DeviceType::CPU, i))) {
+            task(chunk->startRow);
+            scheduler->finishWork(DeviceType::CPU, chunk);
+        }
+    });
+    if (profiler) {
+        profiler->stopTimer("cpu_tasks");
+    }
+}
+
+void CPUExecutor::executeChunks(
+    MatrixBuffer* a,
+    MatrixBuffer* b,
+    MatrixBuffer* result,
+    const std::vector<WorkChunk>& chunks,
+    std::shared_ptr<WorkScheduler> scheduler) {
+    std::shared_ptr<const GemmPackedB> sharedB = packedB;
+    executeTasks(static_cast<int>(chunks.size()), [&](int task) {
+        executeChunk(a, b, result, chunks[task], sharedB.get());
+    }, scheduler);
+}
+
+template <typename T>
+GemmFixedKernel<T> CPUExecutor::fixedKernel(CPUIsa isa, int m, int n, int k) const {
+    const FixedKernelBinding& bound = fixedBinding;
+    if (bound.m == m && bound.n == n && bound.k == k && bound.isa == isa) {
+        GemmFixedKernel<T> kernel;
+        if constexpr (std::is_same_v<T, float>) {
+            kernel = bound.f32;
+        } else if constexpr (std::is_same_v<T, double>) {
+            kernel = bound.f64;
+        } else {
+            kernel = bound.i32;
+        }
+        if (kernel) {
+            return kernel;
+        }
+    }
+    return gemmFixedKernel<T>(isa, m, n, k);
+}
+
+void CPUExecutor::bindFixedKernel(DType dtype, int m, int n, int k) {
+    fixedBinding = FixedKernelBinding{m, n, k};
+    if (dtype == DType::F32) {
+        fixedBinding.isa = f32Kernel->isa;
+        fixedBinding.f32 = gemmFixedKernel<float>(fixedBinding.isa, m, n, k);
+    } else if (dtype == DType::F64) {
+        fixedBinding.isa = f64Kernel->isa;
+        fixedBinding.f64 = gemmFixedKernel<double>(fixedBinding.isa, m, n, k);
     } else {
-        std::cout << "DEBUG: CPU executor doing minimal work stealing for demo purposes" << std::endl;
-        std::this_thread::sleep_for(std::chrono::milliseconds(100));
-        int targetSteals = 50;   
-        {
-            auto& gpuQueue = scheduler->getQueue(DeviceType::GPU);
-            std::lock_guard<std::mutex> lock(gpuQueue.mutex);
-            int queueSize = gpuQueue.queue.size();
-            if (queueSize < 20) {
-                targetSteals = 2;   
-            } else if (queueSize < 100) {
-                targetSteals = 10;   
-            } else if (queueSize < 500) {
-                targetSteals = 30;
-            } else {
-                targetSteals = 100;
+        fixedBinding.isa = microKernel->isa;
+        fixedBinding.i32 = gemmFixedKernel<int>(fixedBinding.isa, m, n, k);
+    }
+    bool found = fixedBinding.i32 || fixedBinding.f32 || fixedBinding.f64;
+    std::cout << "DEBUG: " << (found ? "Pre-bound" : "No") << " fixed-size " << dtypeToString(dtype) << " kernel for "
+              << m << "x" << k << " * " << k << "x" << n << std::endl;
+}
+
+// Multiplies batch entries [first, last). Shapes with a compile-time
+// specialization use it, others within the unpacked limits go to the
+// size-specialized small kernels, larger ones to the blocked GEMM.
+template <typename T, typename Gemm>
+static void multiplyBatchRange(int first, int last, MatrixBuffer* a, MatrixBuffer* b, MatrixBuffer* result,
+                               const T* aData, const T* bData, T* rData, CPUIsa isa,
+                               GemmFixedKernel<T> fixed, Gemm&& gemm) {
+    int m = a->rows;
+    int k = a->cols;
+    int n = b->cols;
+    std::size_t bStride = b->batch == 1 ? 0 : b->batchStride();
+    bool small = smallGemmFits(m, n, k);
+    for (int e = first; e < last; e++) {
+        const T* aEntry = aData + e * a->batchStride();
+        const T* bEntry = bData + e * bStride;
+        T* rEntry = rData + e * result->batchStride();
+        if (fixed) {
+            fixed(aEntry, a->ld, bEntry, b->ld, rEntry, result->ld);
+        } else if (small) {
+            gemmSmall(isa, m, n, k, aEntry, a->ld, bEntry, b->ld, rEntry, result->ld);
+        } else {
+            gemm(m, n, k, aEntry, a->ld, bEntry, b->ld, rEntry, result->ld);
+        }
+    }
+}
+
+void CPUExecutor::executeBatched(
+    MatrixBuffer* a,
+    MatrixBuffer* b,
+    MatrixBuffer* result,
+    std::shared_ptr<WorkScheduler> scheduler,
+    std::shared_ptr<Profiler> profiler) {
+    // A few tasks per worker balance uneven finishing times while keeping the
+    // queue traffic per multiply negligible.
+    constexpr int BATCH_TASKS_PER_THREAD = 8;
+    int batch = a->batch;
+    int tasks = std::min(batch, std::max(1, numThreads) * BATCH_TASKS_PER_THREAD);
+    auto range = [batch, tasks](int task, int& first, int& last) {
+        first = static_cast<int>(static_cast<long long>(batch) * task / tasks);
+        last = static_cast<int>(static_cast<long long>(batch) * (task + 1) / tasks);
+    };
+    int m = a->rows;
+    int k = a->cols;
+    int n = b->cols;
+    GemmFixedKernel<int> fixedInt32 = nullptr;
+    GemmFixedKernel<float> fixedF32 = nullptr;
+    GemmFixedKernel<double> fixedF64 = nullptr;
+    if (a->dtype == DType::F32) {
+        fixedF32 = fixedKernel<float>(f32Kernel->isa, m, n, k);
+    } else if (a->dtype == DType::F64) {
+        fixedF64 = fixedKernel<double>(f64Kernel->isa, m, n, k);
+    } else {
+        fixedInt32 = fixedKernel<int>(microKernel->isa, m, n, k);
+    }
+    std::cout << "DEBUG: CPU running " << batch << " multiplies as " << tasks << " tasks, "
+              << (fixedInt32 || fixedF32 || fixedF64 ? "fixed-size" :
+                  smallGemmFits(m, n, k) ? "unpacked small" : "blocked") << " kernels" << std::endl;
+    if (a->dtype == DType::F32) {
+        const float* aData = a->getCPUReadPtrAs<float>();
+        const float* bData = b->getCPUReadPtrAs<float>();
+        float* rData = result->getCPUWritePtrAs<float>();
+        executeTasks(tasks, [&](int task) {
+            int first, last;
+            range(task, first, last);
+            multiplyBatchRange(first, last, a, b, result, aData, bData, rData, f32Kernel->isa, fixedF32,
+                [this](int m, int n, int k, const float* ae, int lda, const float* be, int ldb, float* ce, int ldc) {
+                    gemmF32(m, n, k, ae, lda, be, ldb, ce, ldc, blocking, *f32Kernel);
+                });
+        }, scheduler, profiler);
+    } else if (a->dtype == DType::F64) {
+        const double* aData = a->getCPUReadPtrAs<double>();
+        const double* bData = b->getCPUReadPtrAs<double>();
+        double* rData = result->getCPUWritePtrAs<double>();
+        executeTasks(tasks, [&](int task) {
+            int first, last;
+            range(task, first, last);
+            multiplyBatchRange(first, last, a, b, result, aData, bData, rData, f64Kernel->isa, fixedF64,
+                [this](int m, int n, int k, const double* ae, int lda, const double* be, int ldb, double* ce, int ldc) {
+                    gemmF64(m, n, k, ae, lda, be, ldb, ce, ldc, blocking, *f64Kernel);
+                });
+        }, scheduler, profiler);
+    } else {
+        const int* aData = a->getCPUReadPtr();
+        const int* bData = b->getCPUReadPtr();
+        int* rData = result->getCPUWritePtr();
+        executeTasks(tasks, [&](int task) {
+            int first, last;
+            range(task, first, last);
+            multiplyBatchRange(first, last, a, b, result, aData, bData, rData, microKernel->isa, fixedInt32,
+                [this](int m, int n, int k, const int* ae, int lda, const int* be, int ldb, int* ce, int ldc) {
+                    gemmInt32(m, n, k, ae, lda, be, ldb, ce, ldc, blocking, *microKernel);
+                });
+        }, scheduler, profiler);
+    }
+    a->releaseCPUAccess();
+    b->releaseCPUAccess();
+    result->releaseCPUAccess();
+}
+
+template <typename T>
+static void runMortonPhases(MatrixBuffer* a, MatrixBuffer* b, MatrixBuffer* result, CPUIsa isa,
+                            const std::vector<std::vector<MortonTask>>& phases,
+                            const std::function<void(int, const std::function<void(int)>&)>& run) {
+    GemmFixedKernel<T> tileKernel = gemmFixedKernel<T>(isa, MORTON_TILE, MORTON_TILE, MORTON_TILE, true);
+    const T* aData = a->getCPUReadPtrAs<T>();
+    const T* bData = b->getCPUReadPtrAs<T>();
+    T* rData = result->getCPUWritePtrAs<T>();
+    std::fill(rData, rData + result->batchStride(), T(0));
+    for (const std::vector<MortonTask>& phase : phases) {
+        run(static_cast<int>(phase.size()), [&](int task) {
+            mortonGemm(aData, bData, rData, phase[task], tileKernel);
+        });
+    }
+    a->releaseCPUAccess();
+    b->releaseCPUAccess();
+    result->releaseCPUAccess();
+}
+
+void CPUExecutor::executeMorton(
+    MatrixBuffer* a,
+    MatrixBuffer* b,
+    MatrixBuffer* result,
+    std::shared_ptr<WorkScheduler> scheduler,
+    std::shared_ptr<Profiler> profiler) {
+    // Enough tasks per worker to even out finishing times; each still spans
+    // many tiles, so the recursion inside it keeps its locality.
+    constexpr int MORTON_TASKS_PER_THREAD = 4;
+    int mt = a->tileRows();
+    int kt = a->tileCols();
+    int nt = b->tileCols();
+    long long products = static_cast<long long>(mt) * nt * kt;
+    long long limit = products / (std::max(1, numThreads) * MORTON_TASKS_PER_THREAD);
+    std::vector<std::vector<MortonTask>> phases = planMortonTasks(mt, nt, kt, limit);
+    std::size_t tasks = 0;
+    for (const auto& phase : phases) {
+        tasks += phase.size();
+    }
+    std::cout << "DEBUG: Morton multiply over " << mt << "x" << kt << " * " << kt << "x" << nt << " tiles of "
+              << MORTON_TILE << ", " << tasks << " tasks in " << phases.size() << " phases" << std::endl;
+    auto run = [&](int count, const std::function<void(int)>& task) {
+        executeTasks(count, task, scheduler, profiler);
+    };
+    if (a->dtype == DType::F32) {
+        runMortonPhases<float>(a, b, result, f32Kernel->isa, phases, run);
+    } else if (a->dtype == DType::F64) {
+        runMortonPhases<double>(a, b, result, f64Kernel->isa, phases, run);
+    } else {
+        runMortonPhases<int>(a, b, result, microKernel->isa, phases, run);
+    }
+}
+
+void CPUExecutor::executeModular(
+    MatrixBuffer* a,
+    MatrixBuffer* b,
+    MatrixBuffer* result,
+    uint32_t modulus,
+    const std::vector<WorkChunk>& chunks,
+    std::shared_ptr<WorkScheduler> scheduler,
+    std::shared_ptr<Profiler> profiler) {
+    constexpr int ROWS_PER_TASK = 64;
+    constexpr int PANELS_PER_TASK = 8;
+    GemmModulus mod = makeGemmModulus(modulus);
+    const GemmModKernel& kernel = modulus % 2 == 1 || !modKernel->oddModulus ? *modKernel
+                                                                             : gemmModKernel(CPUIsa::SCALAR);
+    int m = a->rows;
+    int k = a->cols;
+    int n = b->cols;
+    std::cout << "DEBUG: CPU modular multiply mod " << modulus << " with the " << isaToString(kernel.isa)
+              << " kernel, reducing every " << std::min(mod.lazy, k) << " products" << std::endl;
+    const int* aData = a->getCPUReadPtr();
+    const int* bData = b->getCPUReadPtr();
+    int* rData = result->getCPUWritePtr();
+    residueA.resize(static_cast<size_t>(m) * k);
+    residueB.resize(static_cast<size_t>(k) * n);
+    int p = static_cast<int>(modulus);
+    auto reduceRows = [p](const int* src, int ld, int cols, int* dst, int first, int last) {
+        for (int i = first; i < last; i++) {
+            for (int j = 0; j < cols; j++) {
+                int value = src[static_cast<size_t>(i) * ld + j] % p;
+                dst[static_cast<size_t>(i) * cols + j] = value < 0 ? value + p : value;
             }
         }
-        int successfulSteals = 0;
-        for (int attempt = 0; attempt < 30 && successfulSteals < targetSteals; attempt++) {
-            DeviceType fromDevice = DeviceType::GPU;
-            DeviceType toDevice = DeviceType::CPU;
-            WorkChunk* stolen = scheduler->steal(fromDevice, toDevice);
-            if (stolen) {
-                if (profiler) {
-                    profiler->recordStealEvent("GPU", "CPU");
+    };
+    int aTasks = (m + ROWS_PER_TASK - 1) / ROWS_PER_TASK;
+    int bTasks = (k + ROWS_PER_TASK - 1) / ROWS_PER_TASK;
+    executeTasks(aTasks + bTasks, [&](int task) {
+        bool inA = task < aTasks;
+        int first = (inA ? task : task - aTasks) * ROWS_PER_TASK;
+        if (inA) {
+            reduceRows(aData, a->ld, k, residueA.data(), first, std::min(m, first + ROWS_PER_TASK));
+        } else {
+            reduceRows(bData, b->ld, n, residueB.data(), first, std::min(k, first + ROWS_PER_TASK));
+        }
+    }, scheduler, profiler);
+    std::shared_ptr<GemmPackedB> packed = allocateGemmPackedB(k, n, blocking, kernel.nr, 1, sizeof(int));
+    int panels = packed->panels();
+    executeTasks((panels + PANELS_PER_TASK - 1) / PANELS_PER_TASK, [&](int task) {
+        int p0 = task * PANELS_PER_TASK;
+        packGemmB(*packed, residueB.data(), n, p0, std::min(panels, p0 + PANELS_PER_TASK));
+    }, scheduler, profiler);
+    executeTasks(static_cast<int>(chunks.size()), [&](int task) {
+        const WorkChunk& chunk = chunks[task];
+        gemmMod(chunk.endRow - chunk.startRow, chunk.endCol - chunk.startCol, k,
+                residueA.data() + static_cast<size_t>(chunk.startRow) * k, k, residueB.data() + chunk.startCol, n,
+                rData + static_cast<size_t>(chunk.startRow) * result->ld + chunk.startCol, result->ld,
+                blocking, kernel, mod, packed.get(), chunk.startCol);
+    }, scheduler, profiler);
+    a->releaseCPUAccess();
+    b->releaseCPUAccess();
+    result->releaseCPUAccess();
+}
+
+template <typename T>
+static void runSemiringChunks(MatrixBuffer* a, MatrixBuffer* b, MatrixBuffer* result,
+                              const GemmSemiringKernel<T>& kernel, const GemmBlocking& blocking,
+                              const std::vector<WorkChunk>& chunks,
+                              const std::function<void(int, const std::function<void(int)>&)>& run) {
+    constexpr int PANELS_PER_TASK = 8;
+    int k = a->cols;
+    int n = b->cols;
+    const T* aData = a->getCPUReadPtrAs<T>();
+    const T* bData = b->getCPUReadPtrAs<T>();
+    T* rData = result->getCPUWritePtrAs<T>();
+    std::shared_ptr<GemmPackedB> packed = allocateGemmPackedB(k, n, blocking, kernel.nr, 1, sizeof(T));
+    int panels = packed->panels();
+    run((panels + PANELS_PER_TASK - 1) / PANELS_PER_TASK, [&](int task) {
+        int p0 = task * PANELS_PER_TASK;
+        packGemmB(*packed, bData, b->ld, p0, std::min(panels, p0 + PANELS_PER_TASK));
+    });
+    run(static_cast<int>(chunks.size()), [&](int task) {
+        const WorkChunk& chunk = chunks[task];
+        gemmSemiring(chunk.endRow - chunk.startRow, chunk.endCol - chunk.startCol, k,
+                     aData + static_cast<size_t>(chunk.startRow) * a->ld, a->ld, bData + chunk.startCol, b->ld,
+                     rData + static_cast<size_t>(chunk.startRow) * result->ld + chunk.startCol, result->ld,
+                     blocking, kernel, packed.get(), chunk.startCol);
+    });
+    a->releaseCPUAccess();
+    b->releaseCPUAccess();
+    result->releaseCPUAccess();
+}
+
+void CPUExecutor::executeSemiring(
+    MatrixBuffer* a,
+    MatrixBuffer* b,
+    MatrixBuffer* result,
+    Semiring semiring,
+    const std::vector<WorkChunk>& chunks,
+    std::shared_ptr<WorkScheduler> scheduler,
+    std::shared_ptr<Profiler> profiler) {
+    auto run = [&](int count, const std::function<void(int)>& task) {
+        executeTasks(count, task, scheduler, profiler);
+    };
+    std::cout << "DEBUG: CPU " << semiringToString(semiring) << " multiply with the "
+              << isaToString(semiringIsa) << " kernels" << std::endl;
+    const GemmSemiringKernel<float>* f32 = gemmF32SemiringKernel(semiring, semiringIsa);
+    const GemmSemiringKernel<double>* f64 = gemmF64SemiringKernel(semiring, semiringIsa);
+    const GemmSemiringKernel<int>* i32 = gemmI32SemiringKernel(semiring, semiringIsa);
+    if (a->dtype == DType::F32 && f32) {
+        runSemiringChunks(a, b, result, *f32, blocking, chunks, run);
+    } else if (a->dtype == DType::F64 && f64) {
+        runSemiringChunks(a, b, result, *f64, blocking, chunks, run);
+    } else if (a->dtype == DType::I32 && i32) {
+        runSemiringChunks(a, b, result, *i32, blocking, chunks, run);
+    } else {
+        throw std::runtime_error(std::string("No ") + semiringToString(semiring) + " kernel for " +
+                                 dtypeToString(a->dtype) + " matrices");
+    }
+}
+
+// Four-Russians tasks take whole panels of result columns for this many rows,
+// so each 256-entry table built per eight B rows serves enough lookups.
+constexpr int FOUR_RUSSIANS_ROWS = 512;
+
+void CPUExecutor::executeBitMatrix(
+    MatrixBuffer* a,
+    MatrixBuffer* b,
+    MatrixBuffer* result,
+    bool boolean,
+    const std::vector<WorkChunk>& chunks,
+    std::shared_ptr<WorkScheduler> scheduler,
+    std::shared_ptr<Profiler> profiler) {
+    constexpr int ROWS_PER_TASK = 64;
+    constexpr int COLS_PER_TASK = 256;
+    int m = a->rows;
+    int k = a->cols;
+    int n = b->cols;
+    int words = bitWords(k);
+    int nWords = bitWords(n);
+    bool tables = boolean && fourRussians;
+    std::cout << "DEBUG: CPU bit-packed " << (boolean ? "or-and" : "counting") << " multiply with the "
+              << (tables ? "Four-Russians" : bitKernel->name) << " kernels, " << words << " words per row"
+              << std::endl;
+    const int* aData = a->getCPUReadPtr();
+    const int* bData = b->getCPUReadPtr();
+    int* rData = result->getCPUWritePtr();
+    bitA.resize(static_cast<size_t>(m) * words);
+    bitB.resize(tables ? static_cast<size_t>(k) * nWords : static_cast<size_t>(n) * words);
+    // The table kernel ORs whole B rows, the others read B one column at a time.
+    int aTasks = (m + ROWS_PER_TASK - 1) / ROWS_PER_TASK;
+    int bTasks = tables ? (k + ROWS_PER_TASK - 1) / ROWS_PER_TASK : (n + COLS_PER_TASK - 1) / COLS_PER_TASK;
+    executeTasks(aTasks + bTasks, [&](int task) {
+        if (task < aTasks) {
+            int first = task * ROWS_PER_TASK;
+            packBitRows(std::min(ROWS_PER_TASK, m - first), k, aData + static_cast<size_t>(first) * a->ld, a->ld,
+                        bitA.data() + static_cast<size_t>(first) * words);
+        } else if (tables) {
+            int first = (task - aTasks) * ROWS_PER_TASK;
+            packBitRows(std::min(ROWS_PER_TASK, k - first), n, bData + static_cast<size_t>(first) * b->ld, b->ld,
+                        bitB.data() + static_cast<size_t>(first) * nWords);
+        } else {
+            int first = (task - aTasks) * COLS_PER_TASK;
+            packBitColumns(k, std::min(COLS_PER_TASK, n - first), bData + first, b->ld,
+                           bitB.data() + static_cast<size_t>(first) * words);
+        }
+    }, scheduler, profiler);
+    if (tables) {
+        int panels = (nWords + BIT_PANEL_WORDS - 1) / BIT_PANEL_WORDS;
+        int bands = (m + FOUR_RUSSIANS_ROWS - 1) / FOUR_RUSSIANS_ROWS;
+        executeTasks(panels * bands, [&](int task) {
+            int w0 = task % panels * BIT_PANEL_WORDS;
+            int first = task / panels * FOUR_RUSSIANS_ROWS;
+            int width = std::min(BIT_PANEL_WORDS, nWords - w0);
+            int rows = std::min(FOUR_RUSSIANS_ROWS, m - first);
+            // Per-thread scratch, kept by the pool threads across multiplies.
+            static thread_local std::vector<uint64_t> product;
+            static thread_local std::vector<uint64_t> table;
+            product.resize(static_cast<size_t>(rows) * width);
+            table.resize(256 * static_cast<size_t>(width));
+            bitKernel->fourRussians(rows, k, bitA.data() + static_cast<size_t>(first) * words, words,
+                                    bitB.data() + w0, nWords, width, product.data(), table.data());
+            unpackBitRows(rows, std::min(n - w0 * 64, width * 64), product.data(), width,
+                          rData + static_cast<size_t>(first) * result->ld + w0 * 64, result->ld);
+        }, scheduler, profiler);
+    } else {
+        executeTasks(static_cast<int>(chunks.size()), [&](int task) {
+            const WorkChunk& chunk = chunks[task];
+            bitGemm(*bitKernel, boolean, chunk.endRow - chunk.startRow, chunk.endCol - chunk.startCol, words,
+                    bitA.data() + static_cast<size_t>(chunk.startRow) * words, words,
+                    bitB.data() + static_cast<size_t>(chunk.startCol) * words, words,
+                    rData + static_cast<size_t>(chunk.startRow) * result->ld + chunk.startCol, result->ld);
+        }, scheduler, profiler);
+    }
+    a->releaseCPUAccess();
+    b->releaseCPUAccess();
+    result->releaseCPUAccess();
+}
+
+// i32 inputs bound every result by k * 2^62 < 2^93, well inside the full
+// basis, so a basis always exists. Residues of A, B and the chunk results
+// are kept per prime, one after the other.
+void CPUExecutor::executeExact(
+    MatrixBuffer* a,
+    MatrixBuffer* b,
+    MatrixBuffer* result,
+    unsigned __int128 bound,
+    const std::vector<WorkChunk>& chunks,
+    std::shared_ptr<WorkScheduler> scheduler,
+    std::shared_ptr<Profiler> profiler) {
+    constexpr int ROWS_PER_TASK = 64;
+    constexpr int PANELS_PER_TASK = 8;
+    int count = gemmCrtPrimeCount(bound);
+    GemmCrtBasis basis = makeGemmCrtBasis(count);
+    GemmModulus moduli[GEMM_CRT_MAX_PRIMES];
+    for (int q = 0; q < count; q++) {
+        moduli[q] = makeGemmModulus(basis.primes[q]);
+    }
+    const GemmModKernel& kernel = *modKernel;
+    int m = a->rows;
+    int k = a->cols;
+    int n = b->cols;
+    std::cout << "DEBUG: CPU exact multiply over " << count << " primes with the " << isaToString(kernel.isa)
+              << " modular kernel and " << isaToString(crtKernel->isa) << " CRT digits" << std::endl;
+    size_t aSize = static_cast<size_t>(m) * k;
+    size_t bSize = static_cast<size_t>(k) * n;
+    size_t cSize = static_cast<size_t>(m) * n;
+    const int* aData = a->getCPUReadPtr();
+    const int* bData = b->getCPUReadPtr();
+    residueA.resize(count * aSize);
+    residueB.resize(count * bSize);
+    residueC.resize(count * cSize);
+    auto reduceRows = [&basis, count](const int* src, int ld, int cols, int* dst, size_t stride, int first, int last) {
+        for (int i = first; i < last; i++) {
+            const int* row = src + static_cast<size_t>(i) * ld;
+            for (int q = 0; q < count; q++) {
+                int p = static_cast<int>(basis.primes[q]);
+                int* out = dst + q * stride + static_cast<size_t>(i) * cols;
+                for (int j = 0; j < cols; j++) {
+                    int value = row[j] % p;
+                    out[j] = value < 0 ? value + p : value;
                 }
-                std::vector<WorkChunk> stolenWork;
-                stolenWork.push_back(*stolen);
-                scheduler->addWork(stolenWork, toDevice);
-                delete stolen;
-                successfulSteals++;
             }
-            std::this_thread::sleep_for(std::chrono::milliseconds(5));
         }
-        std::cout << "DEBUG: CPU stole " << successfulSteals << " chunks from GPU" << std::endl;
-    }
-
-    for (int i = 0; i < numThreads; i++) {
-        threads.emplace_back([this, a, b, result, scheduler, i, profiler]() {
-            std::cout << "DEBUG: CPU worker thread " << i << " started" << std::endl;
-            WorkChunk* chunk;
-            while ((chunk = scheduler->getWork(DeviceType::CPU))) {
-                std::cout << "DEBUG: CPU worker " << i << " processing chunk [" 
-                          << chunk->startRow << ":" << chunk->endRow << ", "
-                          << chunk->startCol << ":" << chunk->endCol << "]" << std::endl;
-                int chunkSize = (chunk->endRow - chunk->startRow) *
-                              (chunk->endCol - chunk->startCol);
-                auto startTime = std::chrono::steady_clock::now();
-                executeChunk(a, b, result, *chunk);
-                auto endTime = std::chrono::steady_clock::now();
-                double seconds = std::chrono::duration_cast<std::chrono::microseconds>(
-                    endTime - startTime).count() / 1000000.0;
-                if (profiler) {
-                    profiler->recordChunkExecution("CPU", chunkSize);
-                }
-                scheduler->recordChunkProcessingTime(DeviceType::CPU, seconds);
-                std::cout << "DEBUG: CPU worker " << i << " finished processing chunk" << std::endl;
-                delete chunk;
+    };
+    int aTasks = (m + ROWS_PER_TASK - 1) / ROWS_PER_TASK;
+    int bTasks = (k + ROWS_PER_TASK - 1) / ROWS_PER_TASK;
+    executeTasks(aTasks + bTasks, [&](int task) {
+        bool inA = task < aTasks;
+        int first = (inA ? task : task - aTasks) * ROWS_PER_TASK;
+        if (inA) {
+            reduceRows(aData, a->ld, k, residueA.data(), aSize, first, std::min(m, first + ROWS_PER_TASK));
+        } else {
+            reduceRows(bData, b->ld, n, residueB.data(), bSize, first, std::min(k, first + ROWS_PER_TASK));
+        }
+    }, scheduler, profiler);
+    a->releaseCPUAccess();
+    b->releaseCPUAccess();
+    std::vector<std::shared_ptr<GemmPackedB>> packed(count);
+    for (auto& panelsOfPrime : packed) {
+        panelsOfPrime = allocateGemmPackedB(k, n, blocking, kernel.nr, 1, sizeof(int));
+    }
+    int panels = packed[0]->panels();
+    int groups = (panels + PANELS_PER_TASK - 1) / PANELS_PER_TASK;
+    executeTasks(count * groups, [&](int task) {
+        int q = task / groups;
+        int p0 = task % groups * PANELS_PER_TASK;
+        packGemmB(*packed[q], residueB.data() + q * bSize, n, p0, std::min(panels, p0 + PANELS_PER_TASK));
+    }, scheduler, profiler);
+    bool wide = result->dtype == DType::I128;
+    void* rData = result->getCPUWritePtr();
+    executeTasks(static_cast<int>(chunks.size()), [&](int task) {
+        const WorkChunk& chunk = chunks[task];
+        int cols = chunk.endCol - chunk.startCol;
+        for (int q = 0; q < count; q++) {
+            gemmMod(chunk.endRow - chunk.startRow, cols, k,
+                    residueA.data() + q * aSize + static_cast<size_t>(chunk.startRow) * k, k,
+                    residueB.data() + q * bSize + chunk.startCol, n,
+                    residueC.data() + q * cSize + static_cast<size_t>(chunk.startRow) * n + chunk.startCol, n,
+                    blocking, kernel, moduli[q], packed[q].get(), chunk.startCol);
+        }
+        for (int i = chunk.startRow; i < chunk.endRow; i++) {
+            int* digits[GEMM_CRT_MAX_PRIMES];
+            for (int q = 0; q < count; q++) {
+                digits[q] = residueC.data() + q * cSize + static_cast<size_t>(i) * n + chunk.startCol;
             }
-            std::cout << "DEBUG: CPU worker thread " << i << " exiting" << std::endl;
-        });
+            crtKernel->fn(cols, digits, basis);
+            size_t offset = static_cast<size_t>(i) * result->ld + chunk.startCol;
+            if (wide) {
+                gemmCrtCombine(cols, digits, basis, static_cast<__int128*>(rData) + offset);
+            } else {
+                gemmCrtCombine(cols, digits, basis, static_cast<int64_t*>(rData) + offset);
+            }
+        }
+    }, scheduler, profiler);
+    result->releaseCPUAccess();
+}
+
+// Bands cover about ELEMENTWISE_TASK_BYTES of output each, enough to hide
+// the task overhead and few enough to balance across the workers.
+constexpr std::size_t ELEMENTWISE_TASK_BYTES = 256 << 10;
+
+template <typename T>
+static void elementwiseBands(CPUExecutor& executor, CPUIsa isa, ElementwiseOp op, MatrixBuffer* a, MatrixBuffer* b,
+                             MatrixBuffer* result, T alpha, bool stream, std::shared_ptr<WorkScheduler> scheduler,
+                             std::shared_ptr<Profiler> profiler) {
+    const T* aData = a->getCPUReadPtrAs<T>();
+    const T* bData = b ? b->getCPUReadPtrAs<T>() : nullptr;
+    T* rData = result->getCPUWritePtrAs<T>();
+    std::size_t rowBytes = static_cast<std::size_t>(result->cols) * sizeof(T);
+    int rowsPerTask = static_cast<int>(std::max<std::size_t>(1, ELEMENTWISE_TASK_BYTES / rowBytes));
+    int rows = result->rows;
+    executor.executeTasks((rows + rowsPerTask - 1) / rowsPerTask, [&](int task) {
+        int first = task * rowsPerTask;
+        int last = std::min(rows, first + rowsPerTask);
+        std::size_t offset = static_cast<std::size_t>(first) * result->cols;
+        elementwise(isa, op, static_cast<std::size_t>(last - first) * result->cols, aData + offset,
+                    bData ? bData + offset : nullptr, alpha, rData + offset, stream);
+    }, scheduler, profiler);
+    a->releaseCPUAccess();
+    if (b && b != a) {
+        b->releaseCPUAccess();
     }
+    if (result != a && result != b) {
+        result->releaseCPUAccess();
+    }
+}
 
-    for (auto& thread : threads) {
-        thread.join();
+// Row-major matrices of one shape are contiguous, so a band of rows is one
+// span. Integer alpha is truncated; the runtime only passes whole values.
+void CPUExecutor::executeElementwise(
+    ElementwiseOp op,
+    MatrixBuffer* a,
+    MatrixBuffer* b,
+    MatrixBuffer* result,
+    double alpha,
+    std::shared_ptr<WorkScheduler> scheduler,
+    std::shared_ptr<Profiler> profiler) {
+    CPUIsa isa = microKernel->isa;
+    bool stream = static_cast<std::size_t>(result->rows) * result->cols * dtypeSize(result->dtype) > streamThreshold;
+    std::cout << "DEBUG: CPU elementwise " << elementwiseOpToString(op) << " " << result->rows << "x" << result->cols
+              << " (" << isaToString(isa) << (stream ? ", streaming stores" : "") << ")" << std::endl;
+    if (op == ElementwiseOp::SCALE) {
+        b = nullptr;
     }
+    if (result->dtype == DType::F32) {
+        elementwiseBands<float>(*this, isa, op, a, b, result, static_cast<float>(alpha), stream, scheduler, profiler);
+    } else if (result->dtype == DType::F64) {
+        elementwiseBands<double>(*this, isa, op, a, b, result, alpha, stream, scheduler, profiler);
+    } else {
+        elementwiseBands<int>(*this, isa, op, a, b, result, static_cast<int>(alpha), stream, scheduler, profiler);
+    }
+}
 
-    auto& queue = scheduler->getQueue(DeviceType::CPU);
-    std::unique_lock lock(queue.mutex);
-    if (queue.activeWorkers > 0) {
-        std::cout << "DEBUG: CPU executor resetting " << queue.activeWorkers 
-                  << " active workers to 0" << std::endl;
-        queue.activeWorkers = 0;
+// Each task writes a band of result rows, i.e. transposes a band of A's
+// columns, so tasks never share an output line.
+void CPUExecutor::executeTranspose(
+    MatrixBuffer* a,
+    MatrixBuffer* result,
+    std::shared_ptr<WorkScheduler> scheduler,
+    std::shared_ptr<Profiler> profiler) {
+    constexpr int ROWS_PER_TASK = 64;
+    CPUIsa isa = microKernel->isa;
+    bool wide = dtypeSize(a->dtype) == sizeof(uint64_t);
+    const void* aData = a->getCPUReadPtr();
+    void* rData = result->getCPUWritePtr();
+    int rows = result->rows;
+    std::cout << "DEBUG: CPU transpose " << a->rows << "x" << a->cols << " (" << isaToString(isa) << ")" << std::endl;
+    executeTasks((rows + ROWS_PER_TASK - 1) / ROWS_PER_TASK, [&](int task) {
+        int first = task * ROWS_PER_TASK;
+        int count = std::min(rows, first + ROWS_PER_TASK) - first;
+        std::size_t offset = static_cast<std::size_t>(first) * result->ld;
+        if (wide) {
+            transpose(isa, a->rows, count, static_cast<const uint64_t*>(aData) + first, a->ld,
+                      static_cast<uint64_t*>(rData) + offset, result->ld);
+        } else {
+            transpose(isa, a->rows, count, static_cast<const uint32_t*>(aData) + first, a->ld,
+                      static_cast<uint32_t*>(rData) + offset, result->ld);
+        }
+    }, scheduler, profiler);
+    a->releaseCPUAccess();
+    result->releaseCPUAccess();
+}
+
+// Left-to-right binary exponentiation: after the leading bit every bit
+// squares the running power, and a set bit then multiplies it by A. Products
+// alternate between result and scratch, starting with whichever makes the
+// last one land in result. A's panels are packed once and serve every
+// multiply by A (and the first square); a square packs the running power.
+template <typename T, typename Gemm>
+static int runPowerChain(MatrixBuffer* a, MatrixBuffer* result, MatrixBuffer* scratch, long long exponent,
+                         const std::vector<WorkChunk>& chunks, const GemmBlocking& blocking, int nr,
+                         const std::function<void(int, const std::function<void(int)>&)>& run,
+                         Gemm&& gemm) {
+    constexpr int PANELS_PER_TASK = 8;
+    int n = a->rows;
+    int ld = a->ld;
+    const T* aData = a->getCPUReadPtrAs<T>();
+    T* rData = result->getCPUWritePtrAs<T>();
+    T* sData = scratch->getCPUWritePtrAs<T>();
+    if (exponent <= 1) {
+        for (int i = 0; i < n; i++) {
+            T* row = rData + static_cast<size_t>(i) * result->ld;
+            if (exponent == 1) {
+                std::copy(aData + static_cast<size_t>(i) * ld, aData + static_cast<size_t>(i) * ld + n, row);
+            } else {
+                std::fill(row, row + n, T(0));
+                row[i] = T(1);
+            }
+        }
+        a->releaseCPUAccess();
+        result->releaseCPUAccess();
+        scratch->releaseCPUAccess();
+        return 0;
     }
+    std::vector<bool> steps;
+    int top = 62;
+    while (!((exponent >> top) & 1)) {
+        top--;
+    }
+    for (int bit = top - 1; bit >= 0; bit--) {
+        steps.push_back(false);
+        if ((exponent >> bit) & 1) {
+            steps.push_back(true);
+        }
+    }
+    std::shared_ptr<GemmPackedB> packedA = allocateGemmPackedB(n, n, blocking, nr, 1, sizeof(T));
+    std::shared_ptr<GemmPackedB> packedPower = allocateGemmPackedB(n, n, blocking, nr, 1, sizeof(T));
+    auto pack = [&](GemmPackedB& packed, const T* data) {
+        int panels = packed.panels();
+        run((panels + PANELS_PER_TASK - 1) / PANELS_PER_TASK, [&](int task) {
+            int p0 = task * PANELS_PER_TASK;
+            packGemmB(packed, data, ld, p0, std::min(panels, p0 + PANELS_PER_TASK));
+        });
+    };
+    pack(*packedA, aData);
+    const T* power = aData;
+    T* target = steps.size() % 2 == 1 ? rData : sData;
+    for (bool byA : steps) {
+        const T* bData = aData;
+        const GemmPackedB* packed = packedA.get();
+        if (!byA && power != aData) {
+            pack(*packedPower, power);
+            bData = power;
+            packed = packedPower.get();
+        }
+        run(static_cast<int>(chunks.size()), [&](int task) {
+            const WorkChunk& chunk = chunks[task];
+            gemm(chunk.endRow - chunk.startRow, chunk.endCol - chunk.startCol, n,
+                 power + static_cast<size_t>(chunk.startRow) * ld, ld, bData + chunk.startCol, ld,
+                 target + static_cast<size_t>(chunk.startRow) * ld + chunk.startCol, ld,
+                 packed, chunk.startCol);
+        });
+        power = target;
+        target = target == rData ? sData : rData;
+    }
+    a->releaseCPUAccess();
+    result->releaseCPUAccess();
+    scratch->releaseCPUAccess();
+    return static_cast<int>(steps.size());
+}
 
+int CPUExecutor::executePower(
+    MatrixBuffer* a,
+    MatrixBuffer* result,
+    MatrixBuffer* scratch,
+    long long exponent,
+    const std::vector<WorkChunk>& chunks,
+    std::shared_ptr<Profiler> profiler) {
+    int members = std::max(1, std::min(numThreads, static_cast<int>(chunks.size())));
+    std::cout << "DEBUG: CPU power chain to exponent " << exponent << " on a team of " << members
+              << " threads over " << chunks.size() << " chunks" << std::endl;
+    auto start = std::chrono::steady_clock::now();
+    // The same team of pool threads runs every phase of the chain.
+    auto run = [&](int count, const std::function<void(int)>& task) {
+        workerPool().runTasks(members, count, task);
+    };
+    int multiplies;
+    if (a->dtype == DType::F32) {
+        multiplies = runPowerChain<float>(a, result, scratch, exponent, chunks, blocking, f32Kernel->nr, run,
+            [this](int m, int n, int k, const float* ae, int lda, const float* be, int ldb, float* ce, int ldc,
+                   const GemmPackedB* packed, int col) {
+                gemmF32(m, n, k, ae, lda, be, ldb, ce, ldc, blocking, *f32Kernel, packed, col);
+            });
+    } else if (a->dtype == DType::F64) {
+        multiplies = runPowerChain<double>(a, result, scratch, exponent, chunks, blocking, f64Kernel->nr, run,
+            [this](int m, int n, int k, const double* ae, int lda, const double* be, int ldb, double* ce, int ldc,
+                   const GemmPackedB* packed, int col) {
+                gemmF64(m, n, k, ae, lda, be, ldb, ce, ldc, blocking, *f64Kernel, packed, col);
+            });
+    } else {
+        multiplies = runPowerChain<int>(a, result, scratch, exponent, chunks, blocking, microKernel->nr, run,
+            [this](int m, int n, int k, const int* ae, int lda, const int* be, int ldb, int* ce, int ldc,
+                   const GemmPackedB* packed, int col) {
+                gemmInt32(m, n, k, ae, lda, be, ldb, ce, ldc, blocking, *microKernel, packed, col);
+            });
+    }
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    std::cout << "DEBUG: CPU power chain ran " << multiplies << " multiplies in " << seconds * 1000.0
+              << " ms" << std::endl;
     if (profiler) {
-        std::cout << "DEBUG: CPU executor using profiler data" << std::endl;
+        profiler->recordMetric("CPU power chain", seconds * 1000.0, "ms");
     }
+    return multiplies;
+}
 
-    std::cout << "DEBUG: CPU executor finished" << std::endl;
+void CPUExecutor::multiplyBlock(
+    int m, int n, int k,
+    const int* a, int lda,
+    const int* b, int ldb,
+    int* c, int ldc) const {
+    gemmInt32(m, n, k, a, lda, b, ldb, c, ldc, blocking, *microKernel);
 }
-void CPUExecutor::executeChunk(
+
+// A block whose shape has a compile-time specialization skips packing and
+// the blocked loops. int blocks read the int32 operands directly, since the
+// narrow copies only pay off through the packed kernels.
+bool CPUExecutor::executeFixedChunk(
     MatrixBuffer* a,
     MatrixBuffer* b,
     MatrixBuffer* result,
     const WorkChunk& chunk) {
-    int* aData = a->getCPUReadPtr();   
-    int* bData = b->getCPUReadPtr();   
-    int* rData = result->getCPUWritePtr();  
-    int size = a->size;
-    int BLOCK_SIZE = 32;  
-    if (size >= 2048) BLOCK_SIZE = 32;   
-    else if (size >= 1024) BLOCK_SIZE = 48;
-    else if (size >= 512) BLOCK_SIZE = 32;
-    else if (size < 128) BLOCK_SIZE = 16;
-    std::cout << "DEBUG: CPU executor using BLOCK_SIZE: " << BLOCK_SIZE 
-              << " for matrix size: " << size << std::endl;
-    if (size <= 128) {
-        const int MINI_BLOCK = 8;  
-        for (int i = chunk.startRow; i < chunk.endRow; i += MINI_BLOCK) {
-            int iEnd = std::min(i + MINI_BLOCK, chunk.endRow);
-            for (int j = chunk.startCol; j < chunk.endCol; j += MINI_BLOCK) {
-                int jEnd = std::min(j + MINI_BLOCK, chunk.endCol);
-                for (int ii = i; ii < iEnd; ii++) {
-                    for (int jj = j; jj < jEnd; jj++) {
-                        rData[ii * size + jj] = 0;
-                    }
-                }
-                for (int k = 0; k < size; k += MINI_BLOCK) {
-                    int kEnd = std::min(k + MINI_BLOCK, size);
-                    for (int ii = i; ii < iEnd; ii++) {
-                        for (int jj = j; jj < jEnd; jj++) {
-                            long long sum = rData[ii * size + jj];
-                            for (int kk = k; kk < kEnd; kk++) {
-                                sum += (long long)aData[ii * size + kk] * (long long)bData[kk * size + jj];
-                            }
-                            rData[ii * size + jj] = (int)sum;
-                        }
-                    }
-                }
-            }
+    int k = a->cols;
+    int lda = a->rowStride();
+    int ldb = b->rowStride();
+    int ldc = result->rowStride();
+    int rows = chunk.endRow - chunk.startRow;
+    int cols = chunk.endCol - chunk.startCol;
+    size_t aOffset = a->index(chunk.startRow, 0);
+    size_t bOffset = b->index(0, chunk.startCol);
+    size_t cOffset = result->index(chunk.startRow, chunk.startCol);
+    if (a->dtype == DType::F32) {
+        GemmFixedKernel<float> kernel = fixedKernel<float>(f32Kernel->isa, rows, cols, k);
+        if (!kernel) {
+            return false;
         }
-        a->releaseCPUAccess();
-        b->releaseCPUAccess();
-        result->releaseCPUAccess();
-        return;
+        kernel(a->getCPUReadPtrAs<float>() + aOffset, lda, b->getCPUReadPtrAs<float>() + bOffset, ldb,
+               result->getCPUWritePtrAs<float>() + cOffset, ldc);
+    } else if (a->dtype == DType::F64) {
+        GemmFixedKernel<double> kernel = fixedKernel<double>(f64Kernel->isa, rows, cols, k);
+        if (!kernel) {
+            return false;
+        }
+        kernel(a->getCPUReadPtrAs<double>() + aOffset, lda, b->getCPUReadPtrAs<double>() + bOffset, ldb,
+               result->getCPUWritePtrAs<double>() + cOffset, ldc);
+    } else {
+        GemmFixedKernel<int> kernel = fixedKernel<int>(microKernel->isa, rows, cols, k);
+        if (!kernel) {
+            return false;
+        }
+        kernel(a->getCPUReadPtr() + aOffset, lda, b->getCPUReadPtr() + bOffset, ldb,
+               result->getCPUWritePtr() + cOffset, ldc);
     }
+    a->releaseCPUAccess();
+    b->releaseCPUAccess();
+    result->releaseCPUAccess();
+    return true;
+}
 
-    for (int i = chunk.startRow; i < chunk.endRow; i++) {
-        for (int j = chunk.startCol; j < chunk.endCol; j++) {
-            rData[i * size + j] = 0;
-        }
+bool CPUExecutor::executeFixed(
+    MatrixBuffer* a,
+    MatrixBuffer* b,
+    MatrixBuffer* result) {
+    if (a->layout != MatrixLayout::ROW_MAJOR || epilogue) {
+        return false;
     }
+    return executeFixedChunk(a, b, result, WorkChunk(0, a->rows, 0, b->cols));
+}
 
-    if (size >= 1024) {
-        int blockAccum[BLOCK_SIZE][BLOCK_SIZE];
-        for (int kk = 0; kk < size; kk += BLOCK_SIZE) {
-            int kEnd = std::min(kk + BLOCK_SIZE, size);
-            for (int ii = chunk.startRow; ii < chunk.endRow; ii += BLOCK_SIZE) {
-                int iEnd = std::min(ii + BLOCK_SIZE, chunk.endRow);
-                for (int i = ii; i < iEnd; i++) {
-                    for (int kb = kk; kb < kEnd; kb += 64) {
-                        __builtin_prefetch(&aData[i * size + kb], 0, 3);
-                        if (kb + 32 < kEnd) {
-                            __builtin_prefetch(&aData[i * size + kb + 32], 0, 3);
-                        }
-                    }
-                }
-                for (int jj = chunk.startCol; jj < chunk.endCol; jj += BLOCK_SIZE) {
-                    int jEnd = std::min(jj + BLOCK_SIZE, chunk.endCol);
-                    for (int i = 0; i < BLOCK_SIZE; i++) {
-                        for (int j = 0; j < BLOCK_SIZE; j++) {
-                            blockAccum[i][j] = 0;
-                        }
-                    }
-                    for (int k = kk; k < kEnd; k++) {
-                        if (k + 1 < kEnd) {
-                            __builtin_prefetch(&bData[(k + 1) * size + jj], 0, 3);
-                            if (jj + 32 < jEnd) {
-                                __builtin_prefetch(&bData[(k + 1) * size + jj + 32], 0, 3);
-                            }
-                        }
-                        for (int i = ii; i < iEnd; i++) {
-                            int aVal = aData[i * size + k];
-                            if (aVal == 0) continue;
-                            int j = jj;
-                            for (; j + 7 < jEnd; j += 8) {
-                                blockAccum[i - ii][j - jj] += aVal * bData[k * size + j];
-                                blockAccum[i - ii][j - jj + 1] += aVal * bData[k * size + j + 1];
-                                blockAccum[i - ii][j - jj + 2] += aVal * bData[k * size + j + 2];
-                                blockAccum[i - ii][j - jj + 3] += aVal * bData[k * size + j + 3];
-                                blockAccum[i - ii][j - jj + 4] += aVal * bData[k * size + j + 4];
-                                blockAccum[i - ii][j - jj + 5] += aVal * bData[k * size + j + 5];
-                                blockAccum[i - ii][j - jj + 6] += aVal * bData[k * size + j + 6];
-                                blockAccum[i - ii][j - jj + 7] += aVal * bData[k * size + j + 7];
-                            }
-                            for (; j < jEnd; j++) {
-                                blockAccum[i - ii][j - jj] += aVal * bData[k * size + j];
-                            }
-                        }
-                    }
-                    for (int i = ii; i < iEnd; i++) {
-                        for (int j = jj; j < jEnd; j++) {
-                            rData[i * size + j] += blockAccum[i - ii][j - jj];
-                        }
-                    }
-                }
-            }
+static int nextTileEdge(int index, int tile) {
+    return (index / tile + 1) * tile;
+}
+
+// Splits the chunk where A's row tiles, B's column tiles or C's tiles end, so
+// each block reads one strided A panel and B panel and writes within one C
+// tile. A row-major buffer is a single tile, so its chunks stay whole.
+void CPUExecutor::executeChunk(
+    MatrixBuffer* a,
+    MatrixBuffer* b,
+    MatrixBuffer* result,
+    const WorkChunk& chunk,
+    const GemmPackedB* sharedB) {
+    for (int r0 = chunk.startRow; r0 < chunk.endRow;) {
+        int r1 = std::min({chunk.endRow, nextTileEdge(r0, a->tileHeight), nextTileEdge(r0, result->tileHeight)});
+        for (int c0 = chunk.startCol; c0 < chunk.endCol;) {
+            int c1 = std::min({chunk.endCol, nextTileEdge(c0, b->tileWidth), nextTileEdge(c0, result->tileWidth)});
+            executeBlock(a, b, result, WorkChunk(r0, r1, c0, c1), sharedB);
+            c0 = c1;
         }
+        r0 = r1;
+    }
+}
+
+void CPUExecutor::executeBlock(
+    MatrixBuffer* a,
+    MatrixBuffer* b,
+    MatrixBuffer* result,
+    const WorkChunk& chunk,
+    const GemmPackedB* sharedB) {
+    if (!epilogue && executeFixedChunk(a, b, result, chunk)) {
+        return;
+    }
+    int k = a->cols;
+    int lda = a->rowStride();
+    int ldb = b->rowStride();
+    int ldc = result->rowStride();
+    int rows = chunk.endRow - chunk.startRow;
+    int cols = chunk.endCol - chunk.startCol;
+    size_t aOffset = a->index(chunk.startRow, 0);
+    size_t bOffset = b->index(0, chunk.startCol);
+    size_t cOffset = result->index(chunk.startRow, chunk.startCol);
+    if (a->dtype == DType::F32) {
+        GemmEpilogue<float> fused = epilogue ? blockEpilogue<float>(*epilogue, chunk) : GemmEpilogue<float>();
+        gemmF32(rows, cols, k, a->getCPUReadPtrAs<float>() + aOffset, lda,
+                b->getCPUReadPtrAs<float>() + bOffset, ldb,
+                result->getCPUWritePtrAs<float>() + cOffset, ldc, blocking, *f32Kernel, sharedB, chunk.startCol, &fused);
+    } else if (a->dtype == DType::F64) {
+        GemmEpilogue<double> fused = epilogue ? blockEpilogue<double>(*epilogue, chunk) : GemmEpilogue<double>();
+        gemmF64(rows, cols, k, a->getCPUReadPtrAs<double>() + aOffset, lda,
+                b->getCPUReadPtrAs<double>() + bOffset, ldb,
+                result->getCPUWritePtrAs<double>() + cOffset, ldc, blocking, *f64Kernel, sharedB, chunk.startCol, &fused);
     } else {
-        for (int ii = chunk.startRow; ii < chunk.endRow; ii += BLOCK_SIZE) {
-            int iEnd = std::min(ii + BLOCK_SIZE, chunk.endRow);
-            for (int jj = chunk.startCol; jj < chunk.endCol; jj += BLOCK_SIZE) {
-                int jEnd = std::min(jj + BLOCK_SIZE, chunk.endCol);
-                for (int kk = 0; kk < size; kk += BLOCK_SIZE) {
-                    int kEnd = std::min(kk + BLOCK_SIZE, size);
-                    for (int i = ii; i < iEnd; i++) {
-                        if (i + 1 < iEnd) {
-                            __builtin_prefetch(&aData[(i + 1) * size + kk], 0, 3);
-                        }
-                        for (int k = kk; k < kEnd; k++) {
-                            int aVal = aData[i * size + k];
-                            if (aVal == 0) continue;
-                            if (k + 1 < kEnd) {
-                                __builtin_prefetch(&bData[(k + 1) * size + jj], 0, 3);
-                            }
-                            int j = jj;
-                            for (; j + 7 < jEnd; j += 8) {
-                                rData[i * size + j] += aVal * bData[k * size + j];
-                                rData[i * size + j+1] += aVal * bData[k * size + j+1];
-                                rData[i * size + j+2] += aVal * bData[k * size + j+2];
-                                rData[i * size + j+3] += aVal * bData[k * size + j+3];
-                                rData[i * size + j+4] += aVal * bData[k * size + j+4];
-                                rData[i * size + j+5] += aVal * bData[k * size + j+5];
-                                rData[i * size + j+6] += aVal * bData[k * size + j+6];
-                                rData[i * size + j+7] += aVal * bData[k * size + j+7];
-                            }
-                            for (; j < jEnd; j++) {
-                                rData[i * size + j] += aVal * bData[k * size + j];
-                            }
-                        }
-                    }
-                }
+        int* aData = a->getCPUReadPtr();
+        int* bData = b->getCPUReadPtr();
+        int* rData = result->getCPUWritePtr();
+        GemmEpilogue<int> fused = epilogue ? blockEpilogue<int>(*epilogue, chunk) : GemmEpilogue<int>();
+        if (selection.operandWidth == KernelWidth::INT16) {
+            gemmInt16(rows, cols, k, narrowA16.data() + aOffset, lda, narrowB16.data() + bOffset, ldb,
+                      rData + cOffset, ldc, blocking, *selection.narrowKernel, sharedB, chunk.startCol, &fused);
+        } else if (selection.operandWidth == KernelWidth::INT8) {
+            gemmInt8(rows, cols, k, narrowA8.data() + aOffset, lda, narrowB8.data() + bOffset, ldb,
+                     rData + cOffset, ldc, blocking, *selection.narrowKernel, sharedB, chunk.startCol, &fused);
+        } else {
+            gemmInt32(rows, cols, k, aData + aOffset, lda, bData + bOffset, ldb,
+                      rData + cOffset, ldc, blocking, *microKernel, sharedB, chunk.startCol, &fused);
+        }
+    }
+    if (epilogue) {
+        for (const MatrixEpilogue::Step& step : epilogue->steps) {
+            if (step.matrix) {
+                step.matrix->releaseCPUAccess();
             }
         }
     }
-
     a->releaseCPUAccess();
     b->releaseCPUAccess();
     result->releaseCPUAccess();
-}
\ No newline at end of file
+}
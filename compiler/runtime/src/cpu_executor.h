@@ -2,6 +2,15 @@
 #include "matrix_utils.h"
 #include "work_stealing.h"
 #include "profiler.h"
+#include "cpu_gemm.h"
+#include "kernel_selector.h"
+#include "small_gemm.h"
+#include "elementwise.h"
+#include "bit_gemm.h"
+#include "worker_pool.h"
+#include "cpu_topology.h"
+#include <cstdint>
+#include <functional>
 #include <memory>
 
 class CPUExecutor {
@@ -9,17 +18,226 @@ public:
     CPUExecutor();
     ~CPUExecutor();
     void initialize();
+    // Overrides the GEMM blocking, int32 micro-kernel tier and worker count,
+    // e.g. from the tuning table. A tier forced with CPU_ISA is kept.
+    void configure(const GemmBlocking& blocking, CPUIsa isa, int threads);
+    const GemmBlocking& gemmBlocking() const { return blocking; }
+    CPUIsa microKernelIsa() const { return microKernel->isa; }
+    int threadCount() const { return numThreads; }
+    // Logical CPU of each worker, worker i taking entry i % size; empty when
+    // workers are not pinned.
+    const std::vector<int>& workerCpus() const { return cpuOrder; }
+    const CPUFeatures& cpuFeatures() const { return features; }
+    // Long-lived threads that every CPU job runs on, shared with the owner.
+    void setWorkerPool(std::shared_ptr<WorkerPool> workers);
+    // Per-multiply setup, run before any chunk is queued: picks the operand
+    // width and packs B once into panels shared by every CPU chunk.
+    void prepare(
+        MatrixBuffer* a,
+        MatrixBuffer* b,
+        std::shared_ptr<WorkScheduler> scheduler,
+        std::shared_ptr<Profiler> profiler = nullptr);
+    void releasePackedB();
+    // Operand width prepare() picked for the current multiply.
+    KernelWidth operandWidth() const { return selection.operandWidth; }
+    // Epilogue fused into the chunks of the following multiplies, or nullptr;
+    // the caller keeps it alive until they finish. Fixed-size kernels are
+    // skipped while one is set.
+    void setEpilogue(const MatrixEpilogue* spec);
+    // Runs the given chunks on the CPU workers only, bypassing GPU stealing.
+    void executeChunks(
+        MatrixBuffer* a,
+        MatrixBuffer* b,
+        MatrixBuffer* result,
+        const std::vector<WorkChunk>& chunks,
+        std::shared_ptr<WorkScheduler> scheduler);
     void execute(
         MatrixBuffer* a,
         MatrixBuffer* b,
         MatrixBuffer* result,
         std::shared_ptr<WorkScheduler> scheduler,
         std::shared_ptr<Profiler> profiler = nullptr);
+    // Runs every multiply of a batched A, B and C as one job of whole small
+    // GEMMs per task. B may be a single matrix shared by the whole batch.
+    void executeBatched(
+        MatrixBuffer* a,
+        MatrixBuffer* b,
+        MatrixBuffer* result,
+        std::shared_ptr<WorkScheduler> scheduler,
+        std::shared_ptr<Profiler> profiler = nullptr);
+    // Cache-oblivious multiply of MORTON-layout buffers, run as phases of
+    // independent C blocks on the CPU workers.
+    void executeMorton(
+        MatrixBuffer* a,
+        MatrixBuffer* b,
+        MatrixBuffer* result,
+        std::shared_ptr<WorkScheduler> scheduler,
+        std::shared_ptr<Profiler> profiler = nullptr);
+    // Raises square row-major A to the exponent by repeated squaring, ping-
+    // ponging between result and scratch so the last multiply lands in
+    // result. One worker team stays up for the whole chain, A is packed
+    // once, and each multiply runs as a parallel phase over the chunks.
+    // Returns the number of multiplies.
+    int executePower(
+        MatrixBuffer* a,
+        MatrixBuffer* result,
+        MatrixBuffer* scratch,
+        long long exponent,
+        const std::vector<WorkChunk>& chunks,
+        std::shared_ptr<Profiler> profiler = nullptr);
+    // result = A * B mod p, 2 <= p < 2^31, with every entry in [0, p). A and
+    // B are reduced once into residue copies and B is packed from those.
+    void executeModular(
+        MatrixBuffer* a,
+        MatrixBuffer* b,
+        MatrixBuffer* result,
+        uint32_t modulus,
+        const std::vector<WorkChunk>& chunks,
+        std::shared_ptr<WorkScheduler> scheduler,
+        std::shared_ptr<Profiler> profiler = nullptr);
+    // Exact result = A * B for i32 A and B into an i64 or i128 result, from
+    // one modular multiply per prime of the smallest CRT basis that covers
+    // bound, the largest magnitude a result entry can reach. Each chunk runs
+    // its residue multiplies, then rebuilds its rows from their digits.
+    void executeExact(
+        MatrixBuffer* a,
+        MatrixBuffer* b,
+        MatrixBuffer* result,
+        unsigned __int128 bound,
+        const std::vector<WorkChunk>& chunks,
+        std::shared_ptr<WorkScheduler> scheduler,
+        std::shared_ptr<Profiler> profiler = nullptr);
+    // result = A * B over a semiring other than PLUS_TIMES, with the packing
+    // and chunking of the ordinary multiply. OR_AND takes i32 only.
+    void executeSemiring(
+        MatrixBuffer* a,
+        MatrixBuffer* b,
+        MatrixBuffer* result,
+        Semiring semiring,
+        const std::vector<WorkChunk>& chunks,
+        std::shared_ptr<WorkScheduler> scheduler,
+        std::shared_ptr<Profiler> profiler = nullptr);
+    // result = A * B for row-major i32 A and B holding only 0s and 1s. A is
+    // packed 64 elements per word by rows and B by columns, and each result
+    // is the popcount of the AND of a row and a column. With boolean the
+    // result is OR-AND instead: 1 wherever the count would be nonzero,
+    // computed from Four-Russians tables over packed B rows when
+    // BIT_FOUR_RUSSIANS=1.
+    void executeBitMatrix(
+        MatrixBuffer* a,
+        MatrixBuffer* b,
+        MatrixBuffer* result,
+        bool boolean,
+        const std::vector<WorkChunk>& chunks,
+        std::shared_ptr<WorkScheduler> scheduler,
+        std::shared_ptr<Profiler> profiler = nullptr);
+    // Bytes held by the packed operands of the last bit-packed multiply.
+    std::size_t bitPackedBytes() const { return (bitA.size() + bitB.size()) * sizeof(uint64_t); }
+    // result = A + B, A - B or alpha * A over row-major matrices of one
+    // shape, in bands of rows on the CPU workers. result may be A or B.
+    // Outputs larger than the last-level cache are written with non-temporal
+    // stores.
+    void executeElementwise(
+        ElementwiseOp op,
+        MatrixBuffer* a,
+        MatrixBuffer* b,
+        MatrixBuffer* result,
+        double alpha,
+        std::shared_ptr<WorkScheduler> scheduler,
+        std::shared_ptr<Profiler> profiler = nullptr);
+    // result = A^T for row-major A, in bands of result rows on the CPU
+    // workers; result must be a separate matrix.
+    void executeTranspose(
+        MatrixBuffer* a,
+        MatrixBuffer* result,
+        std::shared_ptr<WorkScheduler> scheduler,
+        std::shared_ptr<Profiler> profiler = nullptr);
+    // Pre-binds the compile-time specialization for an m x k * k x n multiply
+    // whose shape the bytecode fixes, so dispatch skips the table lookup.
+    void bindFixedKernel(DType dtype, int m, int n, int k);
+    // Runs the whole multiply on the calling thread when its shape has a
+    // compile-time specialization; returns false, doing nothing, otherwise.
+    bool executeFixed(
+        MatrixBuffer* a,
+        MatrixBuffer* b,
+        MatrixBuffer* result);
+    // Runs task(0) .. task(taskCount - 1) on the worker pool. With a
+    // profiler, each call adds to its "cpu_tasks" timer.
+    void executeTasks(
+        int taskCount,
+        const std::function<void(int)>& task,
+        std::shared_ptr<WorkScheduler> scheduler,
+        std::shared_ptr<Profiler> profiler = nullptr);
+    void multiplyBlock(
+        int m, int n, int k,
+        const int* a, int lda,
+        const int* b, int ldb,
+        int* c, int ldc) const;
 private:
     int numThreads;
-    void executeChunk(
+    std::vector<int> cpuOrder;
+    std::shared_ptr<WorkerPool> pool;
+    WorkerPool& workerPool();
+    bool isaForced;
+    // Output size in bytes above which elementwise results bypass the cache.
+    std::size_t streamThreshold;
+    GemmBlocking blocking;
+    CPUFeatures features;
+    const GemmMicroKernel* microKernel;
+    const GemmFloatMicroKernel<float>* f32Kernel;
+    const GemmFloatMicroKernel<double>* f64Kernel;
+    const GemmModKernel* modKernel;
+    const GemmCrtKernel* crtKernel;
+    // Tier of the semiring kernels, all of which passed their self-check.
+    CPUIsa semiringIsa;
+    const BitGemmKernel* bitKernel;
+    bool fourRussians;
+    std::vector<const GemmNarrowKernel*> narrowKernels;
+    KernelSelection selection;
+    std::vector<int16_t> narrowA16;
+    std::vector<int16_t> narrowB16;
+    std::vector<uint8_t> narrowA8;
+    std::vector<uint8_t> narrowB8;
+    std::vector<int> residueA;
+    std::vector<int> residueB;
+    std::vector<int> residueC;
+    std::vector<uint64_t> bitA;
+    std::vector<uint64_t> bitB;
+    std::shared_ptr<GemmPackedB> packedB;
+    const MatrixEpilogue* epilogue = nullptr;
+    struct FixedKernelBinding {
+        int m = 0, n = 0, k = 0;
+        CPUIsa isa = CPUIsa::SCALAR;
+        GemmFixedKernel<int> i32 = nullptr;
+        GemmFixedKernel<float> f32 = nullptr;
+        GemmFixedKernel<double> f64 = nullptr;
+    };
+    FixedKernelBinding fixedBinding;
+    template <typename T>
+    GemmFixedKernel<T> fixedKernel(CPUIsa isa, int m, int n, int k) const;
+    bool executeFixedChunk(
         MatrixBuffer* a,
         MatrixBuffer* b,
         MatrixBuffer* result,
         const WorkChunk& chunk);
+    void prepareOperands(
+        MatrixBuffer* a,
+        MatrixBuffer* b,
+        std::shared_ptr<Profiler> profiler);
+    void packB(
+        MatrixBuffer* b,
+        std::shared_ptr<WorkScheduler> scheduler,
+        std::shared_ptr<Profiler> profiler);
+    void executeChunk(
+        MatrixBuffer* a,
+        MatrixBuffer* b,
+        MatrixBuffer* result,
+        const WorkChunk& chunk,
+        const GemmPackedB* sharedB);
+    void executeBlock(
+        MatrixBuffer* a,
+        MatrixBuffer* b,
+        MatrixBuffer* result,
+        const WorkChunk& chunk,
+        const GemmPackedB* sharedB);
 };
\ No newline at end of file
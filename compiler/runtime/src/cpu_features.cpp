@@ -0,0 +1,211 @@
+#include "cpu_features.h"
+#include <fstream>
+#include <string>
+#if defined(__unix__) || defined(__APPLE__)
+#include <sys/utsname.h>
+#endif
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <cpuid.h>
+#endif
+#if defined(__aarch64__) && defined(__linux__)
+#include <sys/auxv.h>
+#include <asm/hwcap.h>
+#endif
+#if defined(__APPLE__)
+#include <sys/sysctl.h>
+#include <cstring>
+#endif
+
+#if defined(__APPLE__)
+static std::string appleSysctlString(const char* name) {
+    char buffer[256];
+    size_t length = sizeof(buffer);
+    if (sysctlbyname(name, buffer, &length, nullptr, 0) != 0 || length == 0) {
+        return "";
+    }
+    return std::string(buffer, strnlen(buffer, length));
+}
+
+static long appleSysctlLong(const char* name) {
+    long long value = 0;
+    size_t length = sizeof(value);
+    if (sysctlbyname(name, &value, &length, nullptr, 0) != 0) {
+        return 0;
+    }
+    return static_cast<long>(value);
+}
+#endif
+
+#if defined(__linux__)
+// Parses sysfs cache sizes such as "48K" or "2048K".
+static long parseCacheSize(const std::string& text) {
+    long value = 0;
+    size_t i = 0;
+    while (i < text.size() && text[i] >= '0' && text[i] <= '9') {
+        value = value * 10 + (text[i] - '0');
+        i++;
+    }
+    if (i < text.size() && text[i] == 'K') value *= 1024;
+    if (i < text.size() && text[i] == 'M') value *= 1024 * 1024;
+    return value;
+}
+
+static std::string readFirstLine(const std::string& path) {
+    std::ifstream file(path);
+    std::string line;
+    std::getline(file, line);
+    return line;
+}
+#endif
+
+#if defined(__x86_64__) || defined(__i386__)
+static unsigned long long readXcr0() {
+    unsigned int eax = 0, edx = 0;
+    __asm__ volatile("xgetbv" : "=a"(eax), "=d"(edx) : "c"(0));
+    return (static_cast<unsigned long long>(edx) << 32) | eax;
+}
+#endif
+
+#if defined(__APPLE__) && defined(__arm64__)
+static bool appleSysctlFlag(const char* name) {
+    int value = 0;
+    size_t length = sizeof(value);
+    if (sysctlbyname(name, &value, &length, nullptr, 0) != 0) {
+        return false;
+    }
+    return value != 0;
+}
+#endif
+
+CPUFeatures detectCPUFeatures() {
+    CPUFeatures features;
+#if defined(__x86_64__) || defined(__i386__)
+    unsigned int eax, ebx, ecx, edx;
+    if (!__get_cpuid(1, &eax, &ebx, &ecx, &edx)) {
+        return features;
+    }
+    features.popcnt = (ecx >> 23) & 1;
+    bool osxsave = (ecx >> 27) & 1;
+    bool avx = (ecx >> 28) & 1;
+    bool fma = (ecx >> 12) & 1;
+    unsigned long long xcr0 = osxsave ? readXcr0() : 0;
+    bool osAvx = (xcr0 & 0x6) == 0x6;
+    bool osAvx512 = osAvx && (xcr0 & 0xE0) == 0xE0;
+    if (__get_cpuid_count(7, 0, &eax, &ebx, &ecx, &edx)) {
+        features.avx2 = avx && osAvx && ((ebx >> 5) & 1);
+        features.fma = features.avx2 && fma;
+        features.avx512f = osAvx512 && ((ebx >> 16) & 1);
+        features.avx512bw = features.avx512f && ((ebx >> 30) & 1);
+        features.avx512dq = features.avx512f && ((ebx >> 17) & 1);
+        features.avx512vl = features.avx512f && ((ebx >> 31) & 1);
+        features.bmi = (ebx >> 3) & 1;
+        features.avx512vnni = features.avx512f && ((ecx >> 11) & 1);
+        features.avx512vpopcntdq = features.avx512f && ((ecx >> 14) & 1);
+    }
+    if (__get_cpuid_count(7, 1, &eax, &ebx, &ecx, &edx)) {
+        features.avxvnni = features.avx2 && ((eax >> 4) & 1);
+    }
+#elif defined(__aarch64__) || defined(__arm64__)
+    features.neon = true;
+#if defined(__linux__)
+    unsigned long hwcap = getauxval(AT_HWCAP);
+#ifdef HWCAP_ASIMD
+    features.neon = (hwcap & HWCAP_ASIMD) != 0;
+#endif
+#ifdef HWCAP_ASIMDDP
+    features.dotprod = (hwcap & HWCAP_ASIMDDP) != 0;
+#endif
+#elif defined(__APPLE__)
+    features.dotprod = appleSysctlFlag("hw.optional.arm.FEAT_DotProd");
+#endif
+#endif
+    return features;
+}
+
+std::string detectCPUModel() {
+#if defined(__APPLE__)
+    std::string model = appleSysctlString("machdep.cpu.brand_string");
+    if (!model.empty()) {
+        return model;
+    }
+#elif defined(__linux__)
+    std::ifstream cpuinfo("/proc/cpuinfo");
+    std::string line;
+    while (std::getline(cpuinfo, line)) {
+        if (line.rfind("model name", 0) == 0 || line.rfind("Model", 0) == 0) {
+            size_t colon = line.find(':');
+            if (colon != std::string::npos && colon + 2 <= line.size()) {
+                return line.substr(colon + 2);
+            }
+        }
+    }
+#endif
+#if defined(__unix__) || defined(__APPLE__)
+    struct utsname name;
+    if (uname(&name) == 0) {
+        return name.machine;
+    }
+#endif
+    return "unknown";
+}
+
+CPUCaches detectCPUCaches() {
+    CPUCaches caches;
+#if defined(__APPLE__)
+    caches.l1d = appleSysctlLong("hw.l1dcachesize");
+    caches.l2 = appleSysctlLong("hw.l2cachesize");
+    caches.l3 = appleSysctlLong("hw.l3cachesize");
+#elif defined(__linux__)
+    for (int index = 0; index < 8; index++) {
+        std::string dir = "/sys/devices/system/cpu/cpu0/cache/index" + std::to_string(index) + "/";
+        std::string level = readFirstLine(dir + "level");
+        if (level.empty()) {
+            break;
+        }
+        std::string type = readFirstLine(dir + "type");
+        long size = parseCacheSize(readFirstLine(dir + "size"));
+        if (level == "1" && type == "Data") caches.l1d = size;
+        if (level == "2") caches.l2 = size;
+        if (level == "3") caches.l3 = size;
+    }
+#endif
+    return caches;
+}
+
+bool isaSupported(CPUIsa isa, const CPUFeatures& features) {
+    switch (isa) {
+        case CPUIsa::SCALAR: return true;
+        case CPUIsa::AVX2: return features.avx2 && features.fma;
+        case CPUIsa::AVX512:
+            return isaSupported(CPUIsa::AVX2, features) && features.avx512f && features.avx512vl &&
+                   features.avx512dq && features.avx512bw;
+        case CPUIsa::NEON: return features.neon;
+        default: return false;
+    }
+}
+
+CPUIsa bestIsa(const CPUFeatures& features) {
+    if (isaSupported(CPUIsa::AVX512, features)) return CPUIsa::AVX512;
+    if (isaSupported(CPUIsa::AVX2, features)) return CPUIsa::AVX2;
+    if (isaSupported(CPUIsa::NEON, features)) return CPUIsa::NEON;
+    return CPUIsa::SCALAR;
+}
+
+const char* isaToString(CPUIsa isa) {
+    switch (isa) {
+        case CPUIsa::SCALAR: return "scalar";
+        case CPUIsa::AVX2: return "avx2";
+        case CPUIsa::AVX512: return "avx512";
+        case CPUIsa::NEON: return "neon";
+        default: return "unknown";
+    }
+}
+
+bool stringToIsa(const std::string& str, CPUIsa& isa) {
+    if (str == "scalar") { isa = CPUIsa::SCALAR; return true; }
+    if (str == "avx2") { isa = CPUIsa::AVX2; return true; }
+    if (str == "avx512") { isa = CPUIsa::AVX512; return true; }
+    if (str == "neon") { isa = CPUIsa::NEON; return true; }
+    return false;
+}
@@ -0,0 +1,41 @@
+#pragma once
+#include <string>
+
+enum class CPUIsa {
+    SCALAR,
+    AVX2,
+    AVX512,
+    NEON
+};
+
+struct CPUFeatures {
+    bool avx2 = false;
+    bool fma = false;
+    bool avx512f = false;
+    bool avx512bw = false;
+    bool avx512dq = false;
+    bool avx512vl = false;
+    bool avx512vnni = false;
+    bool avxvnni = false;
+    bool avx512vpopcntdq = false;
+    bool popcnt = false;
+    bool bmi = false;
+    bool neon = false;
+    bool dotprod = false;
+};
+
+struct CPUCaches {
+    long l1d = 0;   // bytes, 0 when unknown
+    long l2 = 0;
+    long l3 = 0;
+};
+
+CPUFeatures detectCPUFeatures();
+std::string detectCPUModel();
+CPUCaches detectCPUCaches();
+// A tier is supported only when the CPU has every feature its kernels are
+// compiled for: AVX2 means AVX2 and FMA, AVX512 adds F, VL, DQ and BW.
+bool isaSupported(CPUIsa isa, const CPUFeatures& features);
+CPUIsa bestIsa(const CPUFeatures& features);
+const char* isaToString(CPUIsa isa);
+bool stringToIsa(const std::string& str, CPUIsa& isa);
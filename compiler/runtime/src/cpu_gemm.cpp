@@ -0,0 +1,971 @@
+#include "cpu_gemm.h"
+#include <algorithm>
+#include <cstdlib>
+#include <new>
+#include <type_traits>
+#include <vector>
+
+struct PackBuffer {
+    void* data = nullptr;
+    std::size_t capacity = 0;
+    ~PackBuffer() { std::free(data); }
+    template <typename T>
+    T* reserve(std::size_t elements) {
+        std::size_t bytes = (elements * sizeof(T) + GEMM_ALIGNMENT - 1) / GEMM_ALIGNMENT * GEMM_ALIGNMENT;
+        if (bytes > capacity) {
+            std::free(data);
+            data = std::aligned_alloc(GEMM_ALIGNMENT, bytes);
+            if (!data) {
+                capacity = 0;
+                throw std::bad_alloc();
+            }
+            capacity = bytes;
+        }
+        return static_cast<T*>(data);
+    }
+};
+
+static thread_local PackBuffer packABuffer;
+static thread_local PackBuffer packBBuffer;
+static thread_local PackBuffer priorCBuffer;
+
+GemmBlocking defaultGemmBlocking() {
+    return GemmBlocking{128, 256, 2048};
+}
+
+GemmModulus makeGemmModulus(uint32_t p) {
+    GemmModulus mod{};
+    mod.p = p;
+    // Newton's iteration doubles the number of correct low bits of p^-1.
+    uint32_t inverse = p;
+    for (int i = 0; i < 5; i++) {
+        inverse *= 2u - p * inverse;
+    }
+    mod.pInv = 0u - inverse;
+    mod.r1 = static_cast<uint32_t>((static_cast<uint64_t>(1) << 32) % p);
+    mod.r2 = static_cast<uint32_t>(static_cast<uint64_t>(mod.r1) * mod.r1 % p);
+    mod.barrett = UINT64_MAX / p;
+    uint64_t square = static_cast<uint64_t>(p - 1) * (p - 1);
+    uint64_t room = UINT64_MAX - 4 * static_cast<uint64_t>(p);
+    mod.lazy = static_cast<int>(std::min<uint64_t>(square == 0 ? room : room / square, 1 << 24));
+    return mod;
+}
+
+// The largest primes below 2^30: any two are within a factor of two, so a
+// digit mod p_j reduces mod p_i with one subtraction.
+static const uint32_t CRT_PRIMES[GEMM_CRT_MAX_PRIMES] = {1073741789u, 1073741783u, 1073741741u, 1073741723u};
+
+static uint32_t powMod(uint32_t base, uint32_t exponent, uint32_t p) {
+    uint64_t result = 1;
+    uint64_t square = base % p;
+    for (; exponent > 0; exponent >>= 1) {
+        if (exponent & 1) {
+            result = result * square % p;
+        }
+        square = square * square % p;
+    }
+    return static_cast<uint32_t>(result);
+}
+
+int gemmCrtPrimeCount(unsigned __int128 bound) {
+    unsigned __int128 product = 1;
+    for (int i = 0; i < GEMM_CRT_MAX_PRIMES; i++) {
+        product *= CRT_PRIMES[i];
+        if (product / 2 > bound) {
+            return i + 1;
+        }
+    }
+    return 0;
+}
+
+GemmCrtBasis makeGemmCrtBasis(int count) {
+    GemmCrtBasis basis{};
+    basis.count = count;
+    basis.product = 1;
+    for (int i = 0; i < count; i++) {
+        uint32_t p = CRT_PRIMES[i];
+        basis.primes[i] = p;
+        basis.radix[i] = basis.product;
+        basis.product *= p;
+        for (int j = 0; j < i; j++) {
+            uint32_t inverse = powMod(CRT_PRIMES[j], p - 2, p);
+            basis.inverse[i][j] = inverse;
+            basis.inverseShoup[i][j] = static_cast<uint32_t>((static_cast<uint64_t>(inverse) << 32) / p);
+        }
+    }
+    return basis;
+}
+
+static int blockingKc(const GemmBlocking& blocking, int kGroup) {
+    return std::max(kGroup, blocking.kc / kGroup * kGroup);
+}
+
+const char* kernelWidthToString(KernelWidth width) {
+    switch (width) {
+        case KernelWidth::INT8: return "int8";
+        case KernelWidth::INT16: return "int16";
+        case KernelWidth::INT32: return "int32";
+        case KernelWidth::INT64: return "int64";
+        default: return "unknown";
+    }
+}
+
+// Panels store kGroup consecutive k values per row (A) or column (B) so a
+// narrow kernel can load one 32-bit lane per row or column; kGroup is 1 for
+// int32. kc is padded with zeros up to a multiple of kGroup.
+template <typename T>
+static void packA(int mc, int kc, const T* a, int lda, int mrPanel, int kGroup, T* dst) {
+    for (int ir = 0; ir < mc; ir += mrPanel) {
+        int mr = std::min(mrPanel, mc - ir);
+        const T* src = a + static_cast<std::size_t>(ir) * lda;
+        for (int p = 0; p < kc; p += kGroup) {
+            int kg = std::min(kGroup, kc - p);
+            for (int i = 0; i < mrPanel; i++) {
+                for (int t = 0; t < kGroup; t++) {
+                    dst[t] = (i < mr && t < kg) ? src[static_cast<std::size_t>(i) * lda + p + t] : T(0);
+                }
+                dst += kGroup;
+            }
+        }
+    }
+}
+
+template <typename T>
+static void packB(int kc, int nc, const T* b, int ldb, int nrPanel, int kGroup, T* dst) {
+    for (int jr = 0; jr < nc; jr += nrPanel) {
+        int nr = std::min(nrPanel, nc - jr);
+        const T* src = b + jr;
+        for (int p = 0; p < kc; p += kGroup) {
+            int kg = std::min(kGroup, kc - p);
+            for (int j = 0; j < nrPanel; j++) {
+                for (int t = 0; t < kGroup; t++) {
+                    dst[t] = (j < nr && t < kg) ? src[static_cast<std::size_t>(p + t) * ldb + j] : T(0);
+                }
+                dst += kGroup;
+            }
+        }
+    }
+}
+
+GemmPackedB::GemmPackedB(int k, int n, int kc, int nr, int kGroup, std::size_t elementSize)
+    : k(k), n(n), kc(kc), nr(nr), kGroup(kGroup), elementSize(elementSize), data(nullptr) {
+    std::size_t total = 0;
+    for (int pc = 0; pc < k; pc += kc) {
+        int kcPadded = (std::min(kc, k - pc) + kGroup - 1) / kGroup * kGroup;
+        blockOffsets.push_back(total);
+        total += static_cast<std::size_t>(panels()) * nr * kcPadded;
+    }
+    std::size_t bytes = (std::max<std::size_t>(total, 1) * elementSize + GEMM_ALIGNMENT - 1)
+                        / GEMM_ALIGNMENT * GEMM_ALIGNMENT;
+    data = std::aligned_alloc(GEMM_ALIGNMENT, bytes);
+    if (!data) {
+        throw std::bad_alloc();
+    }
+}
+
+GemmPackedB::~GemmPackedB() {
+    std::free(data);
+}
+
+bool GemmPackedB::usableFor(int k, int col, int kc, int nr, int kGroup, std::size_t elementSize) const {
+    return k == this->k && kc == this->kc && nr == this->nr && kGroup == this->kGroup &&
+           elementSize == this->elementSize && col >= 0 && col < n && col % nr == 0;
+}
+
+const void* GemmPackedB::panel(int pc, int col) const {
+    int kcPadded = (std::min(kc, k - pc) + kGroup - 1) / kGroup * kGroup;
+    std::size_t offset = blockOffsets[pc / kc] + static_cast<std::size_t>(col) * kcPadded;
+    return static_cast<const char*>(data) + offset * elementSize;
+}
+
+std::shared_ptr<GemmPackedB> allocateGemmPackedB(
+    int k, int n, const GemmBlocking& blocking, int nr, int kGroup, std::size_t elementSize) {
+    return std::make_shared<GemmPackedB>(k, n, blockingKc(blocking, kGroup), nr, kGroup, elementSize);
+}
+
+template <typename T>
+static void packPanels(GemmPackedB& packed, const T* b, int ldb, int panelBegin, int panelEnd) {
+    int colBegin = panelBegin * packed.nr;
+    int cols = std::min(panelEnd * packed.nr, packed.n) - colBegin;
+    if (cols <= 0) {
+        return;
+    }
+    for (int pc = 0; pc < packed.k; pc += packed.kc) {
+        int kc = std::min(packed.kc, packed.k - pc);
+        T* dst = static_cast<T*>(const_cast<void*>(packed.panel(pc, colBegin)));
+        packB(kc, cols, b + static_cast<std::size_t>(pc) * ldb + colBegin, ldb, packed.nr, packed.kGroup, dst);
+    }
+}
+
+void packGemmB(GemmPackedB& packed, const int* b, int ldb, int panelBegin, int panelEnd) {
+    packPanels(packed, b, ldb, panelBegin, panelEnd);
+}
+
+void packGemmB(GemmPackedB& packed, const int16_t* b, int ldb, int panelBegin, int panelEnd) {
+    packPanels(packed, b, ldb, panelBegin, panelEnd);
+}
+
+void packGemmB(GemmPackedB& packed, const uint8_t* b, int ldb, int panelBegin, int panelEnd) {
+    packPanels(packed, b, ldb, panelBegin, panelEnd);
+}
+
+void packGemmB(GemmPackedB& packed, const float* b, int ldb, int panelBegin, int panelEnd) {
+    packPanels(packed, b, ldb, panelBegin, panelEnd);
+}
+
+void packGemmB(GemmPackedB& packed, const double* b, int ldb, int panelBegin, int panelEnd) {
+    packPanels(packed, b, ldb, panelBegin, panelEnd);
+}
+
+static inline int addTile(int prev, int value) {
+    return static_cast<int>(static_cast<unsigned>(prev) + static_cast<unsigned>(value));
+}
+
+static inline float addTile(float prev, float value) {
+    return prev + value;
+}
+
+static inline double addTile(double prev, double value) {
+    return prev + value;
+}
+
+static inline int mulTile(int x, int y) {
+    return static_cast<int>(static_cast<unsigned>(x) * static_cast<unsigned>(y));
+}
+
+static inline float mulTile(float x, float y) {
+    return x * y;
+}
+
+static inline double mulTile(double x, double y) {
+    return x * y;
+}
+
+static inline int subTile(int x, int y) {
+    return static_cast<int>(static_cast<unsigned>(x) - static_cast<unsigned>(y));
+}
+
+static inline float subTile(float x, float y) {
+    return x - y;
+}
+
+static inline double subTile(double x, double y) {
+    return x - y;
+}
+
+// Finishes n values of C row `row` starting at column `col`: line holds
+// A * B, prior the old C values.
+template <typename C>
+static void applyEpilogue(const GemmEpilogue<C>& epilogue, int row, int col, int n, const C* prior, C* line) {
+    if (epilogue.alpha != C(1)) {
+        for (int j = 0; j < n; j++) {
+            line[j] = mulTile(epilogue.alpha, line[j]);
+        }
+    }
+    if (epilogue.beta != C(0)) {
+        for (int j = 0; j < n; j++) {
+            line[j] = addTile(line[j], mulTile(epilogue.beta, prior[j]));
+        }
+    }
+    for (int o = 0; o < epilogue.count; o++) {
+        const GemmPostOp<C>& op = epilogue.ops[o];
+        const C* src = op.kind == PostOpKind::BIAS ? op.data + col
+                                                   : op.data + static_cast<std::size_t>(row) * op.ld + col;
+        switch (op.kind) {
+            case PostOpKind::BIAS:
+            case PostOpKind::ADD:
+                for (int j = 0; j < n; j++) {
+                    line[j] = addTile(line[j], src[j]);
+                }
+                break;
+            case PostOpKind::SUB:
+                for (int j = 0; j < n; j++) {
+                    line[j] = subTile(line[j], src[j]);
+                }
+                break;
+            case PostOpKind::SCALE:
+                for (int j = 0; j < n; j++) {
+                    line[j] = mulTile(op.value, line[j]);
+                }
+                break;
+            case PostOpKind::CLAMP:
+                for (int j = 0; j < n; j++) {
+                    line[j] = std::min(std::max(line[j], op.value), op.upper);
+                }
+                break;
+        }
+    }
+}
+
+// With an epilogue every tile goes through the stack buffer, where it is
+// finished before its only store; (row, col) is the block's position in the
+// epilogue's coordinates and prior its old C values.
+template <typename T, typename C, typename Kernel>
+static void macroKernel(int mc, int nc, int kcPadded, const T* packedA, const T* packedB,
+                        C* c, int ldc, bool accumulate, int mrKernel, int nrKernel, Kernel&& kernel,
+                        const GemmEpilogue<C>* epilogue = nullptr, int row = 0, int col = 0,
+                        const C* prior = nullptr, int ldPrior = 0) {
+    alignas(GEMM_ALIGNMENT) C edge[GEMM_MAX_MR * GEMM_MAX_NR];
+    for (int jr = 0; jr < nc; jr += nrKernel) {
+        int nr = std::min(nrKernel, nc - jr);
+        const T* bPanel = packedB + static_cast<std::size_t>(jr) * kcPadded;
+        for (int ir = 0; ir < mc; ir += mrKernel) {
+            int mr = std::min(mrKernel, mc - ir);
+            const T* aPanel = packedA + static_cast<std::size_t>(ir) * kcPadded;
+            C* cTile = c + static_cast<std::size_t>(ir) * ldc + jr;
+            if (epilogue) {
+                kernel(aPanel, bPanel, edge, nrKernel, false);
+                for (int i = 0; i < mr; i++) {
+                    C* line = edge + i * nrKernel;
+                    C* cRow = cTile + static_cast<std::size_t>(i) * ldc;
+                    if (accumulate) {
+                        for (int j = 0; j < nr; j++) {
+                            line[j] = addTile(cRow[j], line[j]);
+                        }
+                    }
+                    applyEpilogue(*epilogue, row + ir + i, col + jr, nr,
+                                  prior + static_cast<std::size_t>(ir + i) * ldPrior + jr, line);
+                    std::copy(line, line + nr, cRow);
+                }
+                continue;
+            }
+            if (mr == mrKernel && nr == nrKernel) {
+                kernel(aPanel, bPanel, cTile, ldc, accumulate);
+                continue;
+            }
+            // The kernel accumulates into the buffer itself: a plain add of
+            // its tile would not reduce the sums of the modular kernels.
+            if (accumulate) {
+                for (int i = 0; i < mrKernel; i++) {
+                    for (int j = 0; j < nrKernel; j++) {
+                        edge[i * nrKernel + j] = i < mr && j < nr ? cTile[i * ldc + j] : C(0);
+                    }
+                }
+            }
+            kernel(aPanel, bPanel, edge, nrKernel, accumulate);
+            for (int i = 0; i < mr; i++) {
+                std::copy(edge + i * nrKernel, edge + i * nrKernel + nr, cTile + static_cast<std::size_t>(i) * ldc);
+            }
+        }
+    }
+}
+
+// The kernel is called as kernel(kcPadded, aPanel, bPanel, c, ldc, accumulate).
+template <typename T, typename C, typename Kernel>
+static void gemmBlocked(
+    int m, int n, int k,
+    const T* a, int lda,
+    const T* b, int ldb,
+    C* c, int ldc,
+    const GemmBlocking& blocking,
+    int mrKernel, int nrKernel, int kGroup,
+    const GemmPackedB* shared, int sharedCol,
+    Kernel&& kernel,
+    const GemmEpilogue<C>* epilogue = nullptr) {
+    if (m <= 0 || n <= 0) {
+        return;
+    }
+    if (epilogue && epilogue->trivial()) {
+        epilogue = nullptr;
+    }
+    if (k <= 0) {
+        alignas(GEMM_ALIGNMENT) C line[GEMM_MAX_NR];
+        for (int i = 0; i < m; i++) {
+            C* cRow = c + static_cast<std::size_t>(i) * ldc;
+            for (int j = 0; j < n; j += GEMM_MAX_NR) {
+                int width = std::min(GEMM_MAX_NR, n - j);
+                std::fill(line, line + width, C(0));
+                if (epilogue) {
+                    applyEpilogue(*epilogue, i, j, width, cRow + j, line);
+                }
+                std::copy(line, line + width, cRow + j);
+            }
+        }
+        return;
+    }
+    int mcMax = std::max(mrKernel, blocking.mc / mrKernel * mrKernel);
+    int ncMax = std::max(nrKernel, blocking.nc / nrKernel * nrKernel);
+    int kcMax = blockingKc(blocking, kGroup);
+    int kcAlloc = (std::min(kcMax, k) + kGroup - 1) / kGroup * kGroup;
+    int mcAlloc = (std::min(mcMax, m) + mrKernel - 1) / mrKernel * mrKernel;
+    int ncAlloc = (std::min(ncMax, n) + nrKernel - 1) / nrKernel * nrKernel;
+    bool useShared = shared && shared->usableFor(k, sharedCol, kcMax, nrKernel, kGroup, sizeof(T));
+    T* packedA = packABuffer.reserve<T>(static_cast<std::size_t>(mcAlloc) * kcAlloc);
+    T* packedB = useShared ? nullptr : packBBuffer.reserve<T>(static_cast<std::size_t>(ncAlloc) * kcAlloc);
+    // beta reads the old C, which partial sums overwrite once k spans more
+    // than one KC block; keep a copy for the last block then.
+    const C* prior = c;
+    int ldPrior = ldc;
+    if (epilogue && epilogue->beta != C(0) && k > kcMax) {
+        C* copy = priorCBuffer.reserve<C>(static_cast<std::size_t>(m) * n);
+        for (int i = 0; i < m; i++) {
+            std::copy(c + static_cast<std::size_t>(i) * ldc, c + static_cast<std::size_t>(i) * ldc + n,
+                      copy + static_cast<std::size_t>(i) * n);
+        }
+        prior = copy;
+        ldPrior = n;
+    }
+    for (int jc = 0; jc < n; jc += ncMax) {
+        int nc = std::min(ncMax, n - jc);
+        for (int pc = 0; pc < k; pc += kcMax) {
+            int kc = std::min(kcMax, k - pc);
+            int kcPadded = (kc + kGroup - 1) / kGroup * kGroup;
+            const T* blockB = packedB;
+            if (useShared) {
+                blockB = static_cast<const T*>(shared->panel(pc, sharedCol + jc));
+            } else {
+                packB(kc, nc, b + static_cast<std::size_t>(pc) * ldb + jc, ldb, nrKernel, kGroup, packedB);
+            }
+            for (int ic = 0; ic < m; ic += mcMax) {
+                int mc = std::min(mcMax, m - ic);
+                packA(mc, kc, a + static_cast<std::size_t>(ic) * lda + pc, lda, mrKernel, kGroup, packedA);
+                bool last = pc + kcMax >= k;
+                macroKernel(mc, nc, kcPadded, packedA, blockB, c + static_cast<std::size_t>(ic) * ldc + jc,
+                            ldc, pc > 0, mrKernel, nrKernel,
+                            [&](const T* aPanel, const T* bPanel, C* cTile, int ldcTile, bool accumulate) {
+                                kernel(kcPadded, aPanel, bPanel, cTile, ldcTile, accumulate);
+                            },
+                            last ? epilogue : nullptr, ic, jc,
+                            prior + static_cast<std::size_t>(ic) * ldPrior + jc, ldPrior);
+            }
+        }
+    }
+}
+
+template <typename T>
+static void gemmFloat(
+    int m, int n, int k,
+    const T* a, int lda,
+    const T* b, int ldb,
+    T* c, int ldc,
+    const GemmBlocking& blocking,
+    const GemmFloatMicroKernel<T>& kernel,
+    const GemmPackedB* packedB = nullptr, int packedCol = 0,
+    const GemmEpilogue<T>* epilogue = nullptr) {
+    gemmBlocked(m, n, k, a, lda, b, ldb, c, ldc, blocking, kernel.mr, kernel.nr, 1, packedB, packedCol,
+                [&kernel](int kc, const T* aPanel, const T* bPanel, T* cTile, int ldcTile, bool accumulate) {
+                    kernel.fn(kc, aPanel, bPanel, cTile, ldcTile, accumulate);
+                },
+                epilogue);
+}
+
+// Repeats a verification product through a shared packed B, split at the first
+// panel boundary so the column offset into the packed panels is exercised too.
+// multiply(col, cols, packedB, c) computes columns [col, col + cols).
+template <typename T, typename C, typename Multiply>
+static bool verifySharedPackedB(int m, int n, int k, const T* b, int nr, int kGroup,
+                                const GemmBlocking& blocking, const std::vector<C>& expected,
+                                Multiply&& multiply) {
+    std::shared_ptr<GemmPackedB> packed = allocateGemmPackedB(k, n, blocking, nr, kGroup, sizeof(T));
+    packGemmB(*packed, b, n, 0, packed->panels());
+    std::vector<C> actual(static_cast<std::size_t>(m) * n, C(-1));
+    multiply(0, nr, packed.get(), actual.data());
+    multiply(nr, n - nr, packed.get(), actual.data() + nr);
+    return actual == expected;
+}
+
+// Repeats a verification product with every epilogue step in use, starting
+// from a non-zero C. With k spanning several KC blocks, beta has to read the
+// saved copy of C. multiply(c, epilogue) computes the product into c.
+template <typename C, typename Multiply>
+static bool verifyEpilogue(int m, int n, const std::vector<C>& product, C limit, Multiply&& multiply) {
+    std::size_t cells = static_cast<std::size_t>(m) * n;
+    std::vector<C> prior(cells), addend(cells), bias(n), expected(cells);
+    for (std::size_t i = 0; i < cells; i++) {
+        prior[i] = C(static_cast<int>(i % 7) - 3);
+        addend[i] = C(static_cast<int>(i % 5) - 2);
+    }
+    for (int j = 0; j < n; j++) {
+        bias[j] = C(j % 3);
+    }
+    GemmEpilogue<C> epilogue;
+    epilogue.alpha = C(2);
+    epilogue.beta = C(-3);
+    epilogue.count = 3;
+    epilogue.ops[0] = {PostOpKind::BIAS, bias.data(), 0, C(0), C(0)};
+    epilogue.ops[1] = {PostOpKind::SUB, addend.data(), n, C(0), C(0)};
+    epilogue.ops[2] = {PostOpKind::CLAMP, nullptr, 0, C(-limit), limit};
+    for (int i = 0; i < m; i++) {
+        for (int j = 0; j < n; j++) {
+            std::size_t at = static_cast<std::size_t>(i) * n + j;
+            C value = addTile(mulTile(C(2), product[at]), mulTile(C(-3), prior[at]));
+            value = subTile(addTile(value, bias[j]), addend[at]);
+            expected[at] = std::min(std::max(value, C(-limit)), limit);
+        }
+    }
+    std::vector<C> actual = prior;
+    multiply(actual.data(), &epilogue);
+    return actual == expected;
+}
+
+// Runs the kernel against the scalar reference on an odd-sized problem that
+// exercises full tiles, edge tiles and multiple KC blocks.
+bool verifyGemmMicroKernel(const GemmMicroKernel& kernel) {
+    const int m = 2 * kernel.mr + 3;
+    const int n = 2 * kernel.nr + 5;
+    const int k = 37;
+    std::vector<int> a(m * k), b(k * n), expected(m * n, 0), actual(m * n, -1);
+    unsigned seed = 12345;
+    auto next = [&seed]() {
+        seed = seed * 1103515245u + 12345u;
+        return static_cast<int>((seed >> 8) % 2001) - 1000;
+    };
+    for (auto& v : a) v = next();
+    for (auto& v : b) v = next();
+    a[0] = 2147483647;
+    b[0] = 3;
+    for (int i = 0; i < m; i++) {
+        for (int p = 0; p < k; p++) {
+            unsigned av = static_cast<unsigned>(a[i * k + p]);
+            for (int j = 0; j < n; j++) {
+                unsigned prev = static_cast<unsigned>(expected[i * n + j]);
+                expected[i * n + j] = static_cast<int>(prev + av * static_cast<unsigned>(b[p * n + j]));
+            }
+        }
+    }
+    GemmBlocking blocking{kernel.mr, 16, kernel.nr};
+    gemmInt32(m, n, k, a.data(), k, b.data(), n, actual.data(), n, blocking, kernel);
+    return actual == expected &&
+           verifySharedPackedB(m, n, k, b.data(), kernel.nr, 1, blocking, expected,
+                               [&](int col, int cols, const GemmPackedB* packed, int* c) {
+                                   gemmInt32(m, cols, k, a.data(), k, b.data() + col, n, c, n,
+                                             blocking, kernel, packed, col);
+                               }) &&
+           verifyEpilogue(m, n, expected, 50000000, [&](int* c, const GemmEpilogue<int>* epilogue) {
+               gemmInt32(m, n, k, a.data(), k, b.data(), n, c, n, blocking, kernel, nullptr, 0, epilogue);
+           });
+}
+
+// Same check for a narrow kernel, drawing operands from the full range the
+// kernel accepts (including the int16 pair that overflows vpmaddwd) and using
+// a KC that is not a multiple of the k group.
+bool verifyGemmNarrowKernel(const GemmNarrowKernel& kernel) {
+    const int m = 2 * kernel.mr + 3;
+    const int n = 2 * kernel.nr + 5;
+    const int k = 37;
+    int aMin, aMax, bMin, bMax;
+    if (kernel.width == KernelWidth::INT16) {
+        aMin = bMin = -32768;
+        aMax = bMax = 32767;
+    } else if (!kernel.mixedSign) {
+        aMin = bMin = -128;
+        aMax = bMax = 127;
+    } else {
+        int unsignedMax = kernel.saturates ? 127 : 255;
+        aMin = kernel.aUnsigned ? 0 : -128;
+        aMax = kernel.aUnsigned ? unsignedMax : 127;
+        bMin = kernel.aUnsigned ? -128 : 0;
+        bMax = kernel.aUnsigned ? 127 : unsignedMax;
+    }
+    std::vector<int> a(m * k), b(k * n), expected(m * n, 0), actual(m * n, -1);
+    unsigned seed = 54321;
+    auto next = [&seed](int lo, int hi) {
+        seed = seed * 1103515245u + 12345u;
+        return lo + static_cast<int>((seed >> 8) % static_cast<unsigned>(hi - lo + 1));
+    };
+    for (auto& v : a) v = next(aMin, aMax);
+    for (auto& v : b) v = next(bMin, bMax);
+    a[0] = a[1] = aMin;
+    b[0] = b[n] = bMin;
+    for (int i = 0; i < m; i++) {
+        for (int p = 0; p < k; p++) {
+            unsigned av = static_cast<unsigned>(a[i * k + p]);
+            for (int j = 0; j < n; j++) {
+                unsigned prev = static_cast<unsigned>(expected[i * n + j]);
+                expected[i * n + j] = static_cast<int>(prev + av * static_cast<unsigned>(b[p * n + j]));
+            }
+        }
+    }
+    GemmBlocking blocking{kernel.mr, 18, kernel.nr};
+    if (kernel.width == KernelWidth::INT16) {
+        std::vector<int16_t> a16(a.begin(), a.end()), b16(b.begin(), b.end());
+        gemmInt16(m, n, k, a16.data(), k, b16.data(), n, actual.data(), n, blocking, kernel);
+        return actual == expected &&
+               verifySharedPackedB(m, n, k, b16.data(), kernel.nr, kernel.kGroup, blocking, expected,
+                                   [&](int col, int cols, const GemmPackedB* packed, int* c) {
+                                       gemmInt16(m, cols, k, a16.data(), k, b16.data() + col, n, c, n,
+                                                 blocking, kernel, packed, col);
+                                   });
+    }
+    std::vector<uint8_t> a8(a.size()), b8(b.size());
+    std::transform(a.begin(), a.end(), a8.begin(), [](int v) { return static_cast<uint8_t>(v); });
+    std::transform(b.begin(), b.end(), b8.begin(), [](int v) { return static_cast<uint8_t>(v); });
+    gemmInt8(m, n, k, a8.data(), k, b8.data(), n, actual.data(), n, blocking, kernel);
+    return actual == expected &&
+           verifySharedPackedB(m, n, k, b8.data(), kernel.nr, kernel.kGroup, blocking, expected,
+                               [&](int col, int cols, const GemmPackedB* packed, int* c) {
+                                   gemmInt8(m, cols, k, a8.data(), k, b8.data() + col, n, c, n,
+                                            blocking, kernel, packed, col);
+                               });
+}
+
+// Small integer-valued operands keep every partial sum exact, so the blocked
+// result must match the reference bit for bit whatever the summation order.
+template <typename T>
+static bool verifyFloatKernel(const GemmFloatMicroKernel<T>& kernel) {
+    const int m = 2 * kernel.mr + 3;
+    const int n = 2 * kernel.nr + 5;
+    const int k = 37;
+    std::vector<T> a(m * k), b(k * n), expected(m * n, T(0)), actual(m * n, T(-1));
+    unsigned seed = 24680;
+    auto next = [&seed]() {
+        seed = seed * 1103515245u + 12345u;
+        return static_cast<T>(static_cast<int>((seed >> 8) % 17) - 8);
+    };
+    for (auto& v : a) v = next();
+    for (auto& v : b) v = next();
+    for (int i = 0; i < m; i++) {
+        for (int p = 0; p < k; p++) {
+            for (int j = 0; j < n; j++) {
+                expected[i * n + j] += a[i * k + p] * b[p * n + j];
+            }
+        }
+    }
+    GemmBlocking blocking{kernel.mr, 16, kernel.nr};
+    gemmFloat(m, n, k, a.data(), k, b.data(), n, actual.data(), n, blocking, kernel);
+    return actual == expected &&
+           verifySharedPackedB(m, n, k, b.data(), kernel.nr, 1, blocking, expected,
+                               [&](int col, int cols, const GemmPackedB* packed, T* c) {
+                                   gemmFloat(m, cols, k, a.data(), k, b.data() + col, n, c, n,
+                                             blocking, kernel, packed, col);
+                               }) &&
+           verifyEpilogue(m, n, expected, T(3000), [&](T* c, const GemmEpilogue<T>* epilogue) {
+               gemmFloat(m, n, k, a.data(), k, b.data(), n, c, n, blocking, kernel, nullptr, 0, epilogue);
+           });
+}
+
+bool verifyGemmFloatMicroKernel(const GemmFloatMicroKernel<float>& kernel) {
+    return verifyFloatKernel(kernel);
+}
+
+bool verifyGemmFloatMicroKernel(const GemmFloatMicroKernel<double>& kernel) {
+    return verifyFloatKernel(kernel);
+}
+
+// Checks the kernel against a scalar reference at both ends of the modulus
+// range, even moduli only when it takes them, on a problem with edge tiles,
+// several KC blocks and more products than one lazy interval.
+bool verifyGemmModKernel(const GemmModKernel& kernel) {
+    const int m = 2 * kernel.mr + 3;
+    const int n = 2 * kernel.nr + 5;
+    const int k = 53;
+    const uint32_t moduli[] = {2147483647u, 1000000007u, 998244353u, 3u, 1000000000u, 2u};
+    GemmBlocking blocking{kernel.mr, 16, kernel.nr};
+    unsigned seed = 4242;
+    for (uint32_t p : moduli) {
+        if (kernel.oddModulus && p % 2 == 0) {
+            continue;
+        }
+        GemmModulus mod = makeGemmModulus(p);
+        std::vector<int> a(m * k), b(k * n), expected(m * n), actual(m * n, -1);
+        for (auto* matrix : {&a, &b}) {
+            for (auto& v : *matrix) {
+                seed = seed * 1103515245u + 12345u;
+                v = static_cast<int>(seed % p);
+            }
+        }
+        a[0] = b[0] = static_cast<int>(p - 1);
+        for (int i = 0; i < m; i++) {
+            for (int j = 0; j < n; j++) {
+                uint64_t sum = 0;
+                for (int q = 0; q < k; q++) {
+                    sum = (sum + static_cast<uint64_t>(a[i * k + q]) * static_cast<uint64_t>(b[q * n + j]) % p) % p;
+                }
+                expected[i * n + j] = static_cast<int>(sum);
+            }
+        }
+        gemmMod(m, n, k, a.data(), k, b.data(), n, actual.data(), n, blocking, kernel, mod);
+        if (actual != expected ||
+            !verifySharedPackedB(m, n, k, b.data(), kernel.nr, 1, blocking, expected,
+                                 [&](int col, int cols, const GemmPackedB* packed, int* c) {
+                                     gemmMod(m, cols, k, a.data(), k, b.data() + col, n, c, n,
+                                             blocking, kernel, mod, packed, col);
+                                 })) {
+            return false;
+        }
+    }
+    return true;
+}
+
+// Round-trips signed values spread over the whole symmetric range of each
+// basis size, the extremes included, through residues, the kernel's digits
+// and gemmCrtCombine.
+bool verifyGemmCrtKernel(const GemmCrtKernel& kernel) {
+    const int length = 37;
+    unsigned seed = 977;
+    for (int count = 1; count <= GEMM_CRT_MAX_PRIMES; count++) {
+        GemmCrtBasis basis = makeGemmCrtBasis(count);
+        __int128 half = static_cast<__int128>(basis.product / 2);
+        std::vector<__int128> expected(length), actual(length);
+        for (auto& v : expected) {
+            unsigned __int128 bits = 0;
+            for (int word = 0; word < 4; word++) {
+                seed = seed * 1103515245u + 12345u;
+                bits = bits << 32 | seed;
+            }
+            v = static_cast<__int128>(bits % basis.product) - half;
+        }
+        expected[0] = 0;
+        expected[1] = -1;
+        expected[2] = half;
+        expected[3] = -half;
+        std::vector<int> residues(static_cast<size_t>(count) * length);
+        int* rows[GEMM_CRT_MAX_PRIMES];
+        for (int i = 0; i < count; i++) {
+            rows[i] = residues.data() + static_cast<size_t>(i) * length;
+            for (int e = 0; e < length; e++) {
+                __int128 r = expected[e] % basis.primes[i];
+                rows[i][e] = static_cast<int>(r < 0 ? r + basis.primes[i] : r);
+            }
+        }
+        kernel.fn(length, rows, basis);
+        gemmCrtCombine(length, rows, basis, actual.data());
+        if (actual != expected) {
+            return false;
+        }
+    }
+    return true;
+}
+
+// Checks a semiring kernel against the triple loop on a problem with edge
+// tiles and several KC blocks, directly and through a shared packed B.
+// Operands are small integers, so float sums are exact too; or-and gets
+// arbitrary bit patterns.
+template <typename T>
+static bool verifySemiringKernel(const GemmSemiringKernel<T>& kernel) {
+    const int m = 2 * kernel.mr + 3;
+    const int n = 2 * kernel.nr + 5;
+    const int k = 37;
+    std::vector<T> a(m * k), b(k * n), expected(m * n, kernel.identity), actual(m * n, T(-1));
+    unsigned seed = 13579;
+    auto next = [&seed, &kernel]() {
+        seed = seed * 1103515245u + 12345u;
+        return kernel.semiring == Semiring::OR_AND ? static_cast<T>(static_cast<int>(seed))
+                                                   : static_cast<T>(static_cast<int>((seed >> 8) % 201) - 100);
+    };
+    for (auto& v : a) v = next();
+    for (auto& v : b) v = next();
+    for (int i = 0; i < m; i++) {
+        for (int p = 0; p < k; p++) {
+            for (int j = 0; j < n; j++) {
+                T& sum = expected[i * n + j];
+                T x = a[i * k + p];
+                T y = b[p * n + j];
+                if constexpr (std::is_integral<T>::value) {
+                    if (kernel.semiring == Semiring::OR_AND) {
+                        sum |= x & y;
+                        continue;
+                    }
+                }
+                T product = addTile(x, y);
+                sum = kernel.semiring == Semiring::MIN_PLUS ? std::min(sum, product) : std::max(sum, product);
+            }
+        }
+    }
+    GemmBlocking blocking{kernel.mr, 16, kernel.nr};
+    gemmSemiring(m, n, k, a.data(), k, b.data(), n, actual.data(), n, blocking, kernel);
+    return actual == expected &&
+           verifySharedPackedB(m, n, k, b.data(), kernel.nr, 1, blocking, expected,
+                               [&](int col, int cols, const GemmPackedB* packed, T* c) {
+                                   gemmSemiring(m, cols, k, a.data(), k, b.data() + col, n, c, n,
+                                                blocking, kernel, packed, col);
+                               });
+}
+
+bool verifyGemmSemiringKernel(const GemmSemiringKernel<int>& kernel) {
+    return verifySemiringKernel(kernel);
+}
+
+bool verifyGemmSemiringKernel(const GemmSemiringKernel<float>& kernel) {
+    return verifySemiringKernel(kernel);
+}
+
+bool verifyGemmSemiringKernel(const GemmSemiringKernel<double>& kernel) {
+    return verifySemiringKernel(kernel);
+}
+
+template <typename T>
+static void combineCrtDigits(int length, const int* const* digits, const GemmCrtBasis& basis, T* out) {
+    if (basis.count <= 2) {
+        // p_0 p_1 < 2^60: the sum fits a 64-bit lane.
+        uint64_t product = static_cast<uint64_t>(basis.product);
+        uint64_t radix = static_cast<uint64_t>(basis.radix[basis.count - 1]);
+        const int* high = digits[basis.count - 1];
+        for (int e = 0; e < length; e++) {
+            uint64_t value = basis.count == 1 ? static_cast<uint32_t>(digits[0][e])
+                                              : static_cast<uint32_t>(digits[0][e]) + radix * static_cast<uint32_t>(high[e]);
+            out[e] = value > product / 2 ? -static_cast<T>(product - value) : static_cast<T>(value);
+        }
+        return;
+    }
+    unsigned __int128 half = basis.product / 2;
+    for (int e = 0; e < length; e++) {
+        unsigned __int128 value = static_cast<uint32_t>(digits[0][e]);
+        for (int i = 1; i < basis.count; i++) {
+            value += basis.radix[i] * static_cast<uint32_t>(digits[i][e]);
+        }
+        out[e] = value > half ? -static_cast<T>(basis.product - value) : static_cast<T>(value);
+    }
+}
+
+void gemmCrtCombine(int length, const int* const* digits, const GemmCrtBasis& basis, int64_t* out) {
+    combineCrtDigits(length, digits, basis, out);
+}
+
+void gemmCrtCombine(int length, const int* const* digits, const GemmCrtBasis& basis, __int128* out) {
+    combineCrtDigits(length, digits, basis, out);
+}
+
+void gemmInt32(
+    int m, int n, int k,
+    const int* a, int lda,
+    const int* b, int ldb,
+    int* c, int ldc,
+    const GemmBlocking& blocking,
+    const GemmMicroKernel& kernel,
+    const GemmPackedB* packedB, int packedCol,
+    const GemmEpilogue<int>* epilogue) {
+    gemmBlocked(m, n, k, a, lda, b, ldb, c, ldc, blocking, kernel.mr, kernel.nr, 1, packedB, packedCol,
+                [&kernel](int kc, const int* aPanel, const int* bPanel, int* cTile, int ldcTile, bool accumulate) {
+                    kernel.fn(kc, aPanel, bPanel, cTile, ldcTile, accumulate);
+                },
+                epilogue);
+}
+
+template <typename T>
+static void gemmNarrow(
+    int m, int n, int k,
+    const T* a, int lda,
+    const T* b, int ldb,
+    int* c, int ldc,
+    const GemmBlocking& blocking,
+    const GemmNarrowKernel& kernel,
+    const GemmPackedB* packedB, int packedCol,
+    const GemmEpilogue<int>* epilogue) {
+    gemmBlocked(m, n, k, a, lda, b, ldb, c, ldc, blocking, kernel.mr, kernel.nr, kernel.kGroup,
+                packedB, packedCol,
+                [&kernel](int kc, const T* aPanel, const T* bPanel, int* cTile, int ldcTile, bool accumulate) {
+                    kernel.fn(kc / kernel.kGroup, aPanel, bPanel, cTile, ldcTile, accumulate);
+                },
+                epilogue);
+}
+
+void gemmInt16(
+    int m, int n, int k,
+    const int16_t* a, int lda,
+    const int16_t* b, int ldb,
+    int* c, int ldc,
+    const GemmBlocking& blocking,
+    const GemmNarrowKernel& kernel,
+    const GemmPackedB* packedB, int packedCol,
+    const GemmEpilogue<int>* epilogue) {
+    gemmNarrow(m, n, k, a, lda, b, ldb, c, ldc, blocking, kernel, packedB, packedCol, epilogue);
+}
+
+void gemmInt8(
+    int m, int n, int k,
+    const uint8_t* a, int lda,
+    const uint8_t* b, int ldb,
+    int* c, int ldc,
+    const GemmBlocking& blocking,
+    const GemmNarrowKernel& kernel,
+    const GemmPackedB* packedB, int packedCol,
+    const GemmEpilogue<int>* epilogue) {
+    gemmNarrow(m, n, k, a, lda, b, ldb, c, ldc, blocking, kernel, packedB, packedCol, epilogue);
+}
+
+void gemmF32(
+    int m, int n, int k,
+    const float* a, int lda,
+    const float* b, int ldb,
+    float* c, int ldc,
+    const GemmBlocking& blocking,
+    const GemmFloatMicroKernel<float>& kernel,
+    const GemmPackedB* packedB, int packedCol,
+    const GemmEpilogue<float>* epilogue) {
+    gemmFloat(m, n, k, a, lda, b, ldb, c, ldc, blocking, kernel, packedB, packedCol, epilogue);
+}
+
+void gemmF64(
+    int m, int n, int k,
+    const double* a, int lda,
+    const double* b, int ldb,
+    double* c, int ldc,
+    const GemmBlocking& blocking,
+    const GemmFloatMicroKernel<double>& kernel,
+    const GemmPackedB* packedB, int packedCol,
+    const GemmEpilogue<double>* epilogue) {
+    gemmFloat(m, n, k, a, lda, b, ldb, c, ldc, blocking, kernel, packedB, packedCol, epilogue);
+}
+
+void gemmMod(
+    int m, int n, int k,
+    const int* a, int lda,
+    const int* b, int ldb,
+    int* c, int ldc,
+    const GemmBlocking& blocking,
+    const GemmModKernel& kernel,
+    const GemmModulus& mod,
+    const GemmPackedB* packedB, int packedCol) {
+    gemmBlocked(m, n, k, a, lda, b, ldb, c, ldc, blocking, kernel.mr, kernel.nr, 1, packedB, packedCol,
+                [&kernel, &mod](int kc, const int* aPanel, const int* bPanel, int* cTile, int ldcTile, bool accumulate) {
+                    kernel.fn(kc, aPanel, bPanel, cTile, ldcTile, accumulate, mod);
+                });
+}
+
+// A product over k = 0 is the sum of nothing: the semiring's identity, not
+// the 0 gemmBlocked would store.
+template <typename T>
+static void gemmSemiringBlocked(
+    int m, int n, int k,
+    const T* a, int lda,
+    const T* b, int ldb,
+    T* c, int ldc,
+    const GemmBlocking& blocking,
+    const GemmSemiringKernel<T>& kernel,
+    const GemmPackedB* packedB, int packedCol) {
+    if (k <= 0) {
+        for (int i = 0; i < m; i++) {
+            std::fill(c + static_cast<std::size_t>(i) * ldc, c + static_cast<std::size_t>(i) * ldc + n,
+                      kernel.identity);
+        }
+        return;
+    }
+    gemmBlocked(m, n, k, a, lda, b, ldb, c, ldc, blocking, kernel.mr, kernel.nr, 1, packedB, packedCol,
+                [&kernel](int kc, const T* aPanel, const T* bPanel, T* cTile, int ldcTile, bool accumulate) {
+                    kernel.fn(kc, aPanel, bPanel, cTile, ldcTile, accumulate);
+                });
+}
+
+void gemmSemiring(
+    int m, int n, int k,
+    const int* a, int lda,
+    const int* b, int ldb,
+    int* c, int ldc,
+    const GemmBlocking& blocking,
+    const GemmSemiringKernel<int>& kernel,
+    const GemmPackedB* packedB, int packedCol) {
+    gemmSemiringBlocked(m, n, k, a, lda, b, ldb, c, ldc, blocking, kernel, packedB, packedCol);
+}
+
+void gemmSemiring(
+    int m, int n, int k,
+    const float* a, int lda,
+    const float* b, int ldb,
+    float* c, int ldc,
+    const GemmBlocking& blocking,
+    const GemmSemiringKernel<float>& kernel,
+    const GemmPackedB* packedB, int packedCol) {
+    gemmSemiringBlocked(m, n, k, a, lda, b, ldb, c, ldc, blocking, kernel, packedB, packedCol);
+}
+
+void gemmSemiring(
+    int m, int n, int k,
+    const double* a, int lda,
+    const double* b, int ldb,
+    double* c, int ldc,
+    const GemmBlocking& blocking,
+    const GemmSemiringKernel<double>& kernel,
+    const GemmPackedB* packedB, int packedCol) {
+    gemmSemiringBlocked(m, n, k, a, lda, b, ldb, c, ldc, blocking, kernel, packedB, packedCol);
+}
@@ -0,0 +1,327 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <vector>
+#include "cpu_features.h"
+#include "epilogue.h"
+#include "semiring.h"
+
+constexpr int GEMM_MAX_MR = 16;
+constexpr int GEMM_MAX_NR = 32;
+constexpr std::size_t GEMM_ALIGNMENT = 64;
+
+struct GemmBlocking {
+    int mc;
+    int kc;
+    int nc;
+};
+
+// Computes an mr x nr tile from packed panels: a holds kc groups of mr values,
+// b holds kc groups of nr values. Writes (or adds into) c with row stride ldc.
+using GemmMicroKernelFn = void (*)(int kc, const int* a, const int* b, int* c, int ldc, bool accumulate);
+
+struct GemmMicroKernel {
+    CPUIsa isa;
+    int mr;
+    int nr;
+    GemmMicroKernelFn fn;
+};
+
+const GemmMicroKernel& gemmMicroKernel(CPUIsa isa);
+bool verifyGemmMicroKernel(const GemmMicroKernel& kernel);
+
+enum class KernelWidth {
+    INT8,
+    INT16,
+    INT32,
+    INT64
+};
+
+const char* kernelWidthToString(KernelWidth width);
+
+// Narrow kernels consume kGroup consecutive k values per 32-bit lane (pairs for
+// int16, quads for int8): a holds groups of mr x kGroup values, b groups of
+// nr x kGroup values, zero-padded to a whole number of groups.
+using GemmNarrowKernelFn = void (*)(int groups, const void* a, const void* b, int* c, int ldc, bool accumulate);
+
+struct GemmNarrowKernel {
+    CPUIsa isa;
+    KernelWidth width;
+    int mr;
+    int nr;
+    int kGroup;
+    bool mixedSign;   // int8: one operand u8 and the other s8, otherwise both s8
+    bool aUnsigned;   // int8 mixed sign: A is the u8 operand (B otherwise)
+    bool saturates;   // int8: pair sums saturate to int16 (vpmaddubsw)
+    GemmNarrowKernelFn fn;
+};
+
+// Narrow kernels usable with the given tier on this CPU, best first.
+std::vector<const GemmNarrowKernel*> gemmNarrowKernels(KernelWidth width, CPUIsa isa, const CPUFeatures& features);
+bool verifyGemmNarrowKernel(const GemmNarrowKernel& kernel);
+
+// FMA micro-kernels for f32/f64, with the same panel layout as the int32 path.
+template <typename T>
+struct GemmFloatMicroKernel {
+    CPUIsa isa;
+    int mr;
+    int nr;
+    void (*fn)(int kc, const T* a, const T* b, T* c, int ldc, bool accumulate);
+};
+
+const GemmFloatMicroKernel<float>& gemmF32MicroKernel(CPUIsa isa);
+const GemmFloatMicroKernel<double>& gemmF64MicroKernel(CPUIsa isa);
+bool verifyGemmFloatMicroKernel(const GemmFloatMicroKernel<float>& kernel);
+bool verifyGemmFloatMicroKernel(const GemmFloatMicroKernel<double>& kernel);
+
+// Constants for multiplying residues mod p, 2 <= p < 2^31. A product of two
+// residues fits in 62 bits, so a 64-bit lane holding a partly reduced sum
+// (below 4p) takes `lazy` more products before it has to be reduced again.
+struct GemmModulus {
+    uint32_t p;
+    uint32_t pInv;       // -p^-1 mod 2^32, odd p only (Montgomery)
+    uint32_t r1;         // 2^32 mod p
+    uint32_t r2;         // 2^64 mod p
+    uint64_t barrett;    // floor((2^64 - 1) / p)
+    int lazy;
+};
+
+GemmModulus makeGemmModulus(uint32_t p);
+
+// Computes an mr x nr tile of A * B mod p from packed residues in [0, p),
+// with 64-bit lane sums. Writes the reduced tile into c or, accumulating,
+// adds it to the residues already there.
+using GemmModKernelFn = void (*)(int kc, const int* a, const int* b, int* c, int ldc, bool accumulate,
+                                 const GemmModulus& mod);
+
+struct GemmModKernel {
+    CPUIsa isa;
+    int mr;
+    int nr;
+    bool oddModulus;     // Montgomery reduction: p must be odd
+    GemmModKernelFn fn;
+};
+
+// The vector tiers reduce with Montgomery multiplies on 32-bit lane halves;
+// the scalar kernel uses Barrett reduction and takes any modulus.
+const GemmModKernel& gemmModKernel(CPUIsa isa);
+bool verifyGemmModKernel(const GemmModKernel& kernel);
+
+// Exact integer products from up to four residue multiplies, one per prime
+// of a fixed basis just below 2^30, rebuilt with Garner's algorithm: digit i
+// is ((r_i - d_0) / p_0 - d_1) / p_1 ... mod p_i, and the value is
+// d_0 + d_1 p_0 + d_2 p_0 p_1 + ..., shifted into the symmetric range.
+constexpr int GEMM_CRT_MAX_PRIMES = 4;
+
+struct GemmCrtBasis {
+    int count;
+    uint32_t primes[GEMM_CRT_MAX_PRIMES];
+    uint32_t inverse[GEMM_CRT_MAX_PRIMES][GEMM_CRT_MAX_PRIMES];       // p_j^-1 mod p_i, j < i
+    uint32_t inverseShoup[GEMM_CRT_MAX_PRIMES][GEMM_CRT_MAX_PRIMES];  // floor(inverse * 2^32 / p_i)
+    unsigned __int128 radix[GEMM_CRT_MAX_PRIMES];                     // p_0 ... p_{i-1}
+    unsigned __int128 product;
+};
+
+// Smallest basis whose product exceeds 2 * bound, so every value of magnitude
+// at most bound comes back exactly; 0 when even the full basis is too small.
+int gemmCrtPrimeCount(unsigned __int128 bound);
+GemmCrtBasis makeGemmCrtBasis(int count);
+
+// Turns one row of residues, residues[i][0 .. length) mod p_i, into Garner
+// digits in place.
+using GemmCrtDigitsFn = void (*)(int length, int* const* residues, const GemmCrtBasis& basis);
+
+struct GemmCrtKernel {
+    CPUIsa isa;
+    GemmCrtDigitsFn fn;
+};
+
+const GemmCrtKernel& gemmCrtKernel(CPUIsa isa);
+bool verifyGemmCrtKernel(const GemmCrtKernel& kernel);
+
+// Sums a row of Garner digits into signed values; int64_t output must come
+// from a basis whose values fit it.
+void gemmCrtCombine(int length, const int* const* digits, const GemmCrtBasis& basis, int64_t* out);
+void gemmCrtCombine(int length, const int* const* digits, const GemmCrtBasis& basis, __int128* out);
+
+// Micro-kernels for the MIN_PLUS, MAX_PLUS and OR_AND semirings, with the
+// panel layout of the ordinary kernels. identity is the sum of no products:
+// the largest value for min, the smallest for max, 0 for or. int sums wrap.
+template <typename T>
+struct GemmSemiringKernel {
+    CPUIsa isa;
+    Semiring semiring;
+    int mr;
+    int nr;
+    T identity;
+    void (*fn)(int kc, const T* a, const T* b, T* c, int ldc, bool accumulate);
+};
+
+// nullptr for PLUS_TIMES, which the ordinary kernels run, and for OR_AND on
+// floating-point values.
+const GemmSemiringKernel<int>* gemmI32SemiringKernel(Semiring semiring, CPUIsa isa);
+const GemmSemiringKernel<float>* gemmF32SemiringKernel(Semiring semiring, CPUIsa isa);
+const GemmSemiringKernel<double>* gemmF64SemiringKernel(Semiring semiring, CPUIsa isa);
+bool verifyGemmSemiringKernel(const GemmSemiringKernel<int>& kernel);
+bool verifyGemmSemiringKernel(const GemmSemiringKernel<float>& kernel);
+bool verifyGemmSemiringKernel(const GemmSemiringKernel<double>& kernel);
+
+GemmBlocking defaultGemmBlocking();
+
+constexpr int GEMM_MAX_POST_OPS = 4;
+
+template <typename C>
+struct GemmPostOp {
+    PostOpKind kind;
+    const C* data;    // BIAS: a value per column; ADD/SUB: matrix with row stride ld
+    int ld;
+    C value;          // SCALE factor or CLAMP lower bound
+    C upper;
+};
+
+// C = ops(alpha * A * B + beta * C), applied to each micro-tile in a stack
+// buffer during the last KC block, so C is stored once. Operand pointers are
+// relative to the first element of the call's C. int arithmetic wraps like
+// the kernels.
+template <typename C>
+struct GemmEpilogue {
+    C alpha = C(1);
+    C beta = C(0);
+    int count = 0;
+    GemmPostOp<C> ops[GEMM_MAX_POST_OPS];
+    bool trivial() const { return alpha == C(1) && beta == C(0) && count == 0; }
+};
+
+// B packed once for a whole multiply: for each KC block, every NR-wide column
+// panel of the matrix back to back, in the layout gemmBlocked gives a packed
+// (KC x NC) block. A call whose first column is panel-aligned reads its panels
+// from here instead of repacking B.
+struct GemmPackedB {
+    int k;
+    int n;
+    int kc;
+    int nr;
+    int kGroup;
+    std::size_t elementSize;
+    std::vector<std::size_t> blockOffsets;
+    void* data;
+    GemmPackedB(int k, int n, int kc, int nr, int kGroup, std::size_t elementSize);
+    ~GemmPackedB();
+    GemmPackedB(const GemmPackedB&) = delete;
+    GemmPackedB& operator=(const GemmPackedB&) = delete;
+    int panels() const { return (n + nr - 1) / nr; }
+    bool usableFor(int k, int col, int kc, int nr, int kGroup, std::size_t elementSize) const;
+    const void* panel(int pc, int col) const;
+};
+
+// Allocates packed storage for B[k x n] with the KC the blocking yields for kGroup.
+std::shared_ptr<GemmPackedB> allocateGemmPackedB(
+    int k, int n, const GemmBlocking& blocking, int nr, int kGroup, std::size_t elementSize);
+
+// Packs column panels [panelBegin, panelEnd) of every KC block; disjoint ranges
+// can be packed concurrently.
+void packGemmB(GemmPackedB& packed, const int* b, int ldb, int panelBegin, int panelEnd);
+void packGemmB(GemmPackedB& packed, const int16_t* b, int ldb, int panelBegin, int panelEnd);
+void packGemmB(GemmPackedB& packed, const uint8_t* b, int ldb, int panelBegin, int panelEnd);
+void packGemmB(GemmPackedB& packed, const float* b, int ldb, int panelBegin, int panelEnd);
+void packGemmB(GemmPackedB& packed, const double* b, int ldb, int panelBegin, int panelEnd);
+
+// C[m x n] = A[m x k] * B[k x n], all row-major with explicit leading dimensions.
+// Goto-style: B is packed per (KC x NC) block, A per (MC x KC) block, and the
+// register-blocked micro-kernel walks the packed panels. With packedB, the
+// panels starting at column packedCol of the shared packed B are used instead.
+// A non-trivial epilogue is fused into the last KC block.
+void gemmInt32(
+    int m, int n, int k,
+    const int* a, int lda,
+    const int* b, int ldb,
+    int* c, int ldc,
+    const GemmBlocking& blocking,
+    const GemmMicroKernel& kernel,
+    const GemmPackedB* packedB = nullptr, int packedCol = 0,
+    const GemmEpilogue<int>* epilogue = nullptr);
+
+// Same blocking over narrow operands. Results are bit-identical to gemmInt32 on
+// the widened values: lane sums wrap modulo 2^32 exactly like the int32 path.
+void gemmInt16(
+    int m, int n, int k,
+    const int16_t* a, int lda,
+    const int16_t* b, int ldb,
+    int* c, int ldc,
+    const GemmBlocking& blocking,
+    const GemmNarrowKernel& kernel,
+    const GemmPackedB* packedB = nullptr, int packedCol = 0,
+    const GemmEpilogue<int>* epilogue = nullptr);
+
+// Bytes hold u8 or s8 values as the kernel's signedness flags describe.
+void gemmInt8(
+    int m, int n, int k,
+    const uint8_t* a, int lda,
+    const uint8_t* b, int ldb,
+    int* c, int ldc,
+    const GemmBlocking& blocking,
+    const GemmNarrowKernel& kernel,
+    const GemmPackedB* packedB = nullptr, int packedCol = 0,
+    const GemmEpilogue<int>* epilogue = nullptr);
+
+void gemmF32(
+    int m, int n, int k,
+    const float* a, int lda,
+    const float* b, int ldb,
+    float* c, int ldc,
+    const GemmBlocking& blocking,
+    const GemmFloatMicroKernel<float>& kernel,
+    const GemmPackedB* packedB = nullptr, int packedCol = 0,
+    const GemmEpilogue<float>* epilogue = nullptr);
+
+void gemmF64(
+    int m, int n, int k,
+    const double* a, int lda,
+    const double* b, int ldb,
+    double* c, int ldc,
+    const GemmBlocking& blocking,
+    const GemmFloatMicroKernel<double>& kernel,
+    const GemmPackedB* packedB = nullptr, int packedCol = 0,
+    const GemmEpilogue<double>* epilogue = nullptr);
+
+// C = A * B mod p with the same blocking; A and B hold residues in [0, p) and
+// C comes out reduced. Even moduli need a kernel without oddModulus.
+void gemmMod(
+    int m, int n, int k,
+    const int* a, int lda,
+    const int* b, int ldb,
+    int* c, int ldc,
+    const GemmBlocking& blocking,
+    const GemmModKernel& kernel,
+    const GemmModulus& mod,
+    const GemmPackedB* packedB = nullptr, int packedCol = 0);
+
+// C = A * B over the kernel's semiring, with the same blocking and packing;
+// later KC blocks fold into C with the semiring's add.
+void gemmSemiring(
+    int m, int n, int k,
+    const int* a, int lda,
+    const int* b, int ldb,
+    int* c, int ldc,
+    const GemmBlocking& blocking,
+    const GemmSemiringKernel<int>& kernel,
+    const GemmPackedB* packedB = nullptr, int packedCol = 0);
+
+void gemmSemiring(
+    int m, int n, int k,
+    const float* a, int lda,
+    const float* b, int ldb,
+    float* c, int ldc,
+    const GemmBlocking& blocking,
+    const GemmSemiringKernel<float>& kernel,
+    const GemmPackedB* packedB = nullptr, int packedCol = 0);
+
+void gemmSemiring(
+    int m, int n, int k,
+    const double* a, int lda,
+    const double* b, int ldb,
+    double* c, int ldc,
+    const GemmBlocking& blocking,
+    const GemmSemiringKernel<double>& kernel,
+    const GemmPackedB* packedB = nullptr, int packedCol = 0);
@@ -0,0 +1,1382 @@
+#include "cpu_gemm.h"
+#include <algorithm>
+#include <cstring>
+#include <limits>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define GEMM_HAVE_X86_KERNELS 1
+#endif
+#if defined(__aarch64__) || defined(__arm64__)
+#include <arm_neon.h>
+#define GEMM_HAVE_NEON_KERNELS 1
+#endif
+
+constexpr int SCALAR_MR = 4;
+constexpr int SCALAR_NR = 8;
+
+// Accumulates in unsigned lanes so int32 wraparound is well defined.
+static void microKernelScalar(int kc, const int* a, const int* b, int* c, int ldc, bool accumulate) {
+    unsigned acc[SCALAR_MR][SCALAR_NR] = {};
+    for (int p = 0; p < kc; p++) {
+        for (int i = 0; i < SCALAR_MR; i++) {
+            unsigned ai = static_cast<unsigned>(a[i]);
+            for (int j = 0; j < SCALAR_NR; j++) {
+                acc[i][j] += ai * static_cast<unsigned>(b[j]);
+            }
+        }
+        a += SCALAR_MR;
+        b += SCALAR_NR;
+    }
+    for (int i = 0; i < SCALAR_MR; i++) {
+        int* row = c + i * ldc;
+        for (int j = 0; j < SCALAR_NR; j++) {
+            unsigned prev = accumulate ? static_cast<unsigned>(row[j]) : 0u;
+            row[j] = static_cast<int>(prev + acc[i][j]);
+        }
+    }
+}
+
+// Loads the kGroup narrow values of one row or column as a 32-bit lane.
+static inline int loadGroup(const void* p) {
+    int value;
+    std::memcpy(&value, p, sizeof(value));
+    return value;
+}
+
+static void microKernelScalarI16(int groups, const void* aPacked, const void* bPacked, int* c, int ldc, bool accumulate) {
+    const int16_t* a = static_cast<const int16_t*>(aPacked);
+    const int16_t* b = static_cast<const int16_t*>(bPacked);
+    unsigned acc[SCALAR_MR][SCALAR_NR] = {};
+    for (int p = 0; p < groups; p++) {
+        for (int i = 0; i < SCALAR_MR; i++) {
+            int ai = a[i];
+            for (int j = 0; j < SCALAR_NR; j++) {
+                acc[i][j] += static_cast<unsigned>(ai * b[j]);
+            }
+        }
+        a += SCALAR_MR;
+        b += SCALAR_NR;
+    }
+    for (int i = 0; i < SCALAR_MR; i++) {
+        int* row = c + i * ldc;
+        for (int j = 0; j < SCALAR_NR; j++) {
+            unsigned prev = accumulate ? static_cast<unsigned>(row[j]) : 0u;
+            row[j] = static_cast<int>(prev + acc[i][j]);
+        }
+    }
+}
+
+template <typename T>
+static void microKernelScalarFloat(int kc, const T* a, const T* b, T* c, int ldc, bool accumulate) {
+    T acc[SCALAR_MR][SCALAR_NR] = {};
+    for (int p = 0; p < kc; p++) {
+        for (int i = 0; i < SCALAR_MR; i++) {
+            T ai = a[i];
+            for (int j = 0; j < SCALAR_NR; j++) {
+                acc[i][j] += ai * b[j];
+            }
+        }
+        a += SCALAR_MR;
+        b += SCALAR_NR;
+    }
+    for (int i = 0; i < SCALAR_MR; i++) {
+        T* row = c + i * ldc;
+        for (int j = 0; j < SCALAR_NR; j++) {
+            row[j] = accumulate ? row[j] + acc[i][j] : acc[i][j];
+        }
+    }
+}
+
+constexpr int MOD_MR = 4;
+constexpr int MOD_NR = 8;
+
+// Barrett: q undershoots x / p by at most two, so two subtractions finish.
+static inline uint64_t reduceBarrett(uint64_t x, const GemmModulus& mod) {
+    uint64_t q = static_cast<uint64_t>((static_cast<unsigned __int128>(x) * mod.barrett) >> 64);
+    uint64_t r = x - q * mod.p;
+    while (r >= mod.p) {
+        r -= mod.p;
+    }
+    return r;
+}
+
+static void microKernelScalarMod(int kc, const int* a, const int* b, int* c, int ldc, bool accumulate,
+                                 const GemmModulus& mod) {
+    uint64_t acc[MOD_MR][MOD_NR] = {};
+    for (int start = 0; start < kc; start += mod.lazy) {
+        int end = std::min(kc, start + mod.lazy);
+        if (start > 0) {
+            for (int i = 0; i < MOD_MR; i++) {
+                for (int j = 0; j < MOD_NR; j++) {
+                    acc[i][j] = reduceBarrett(acc[i][j], mod);
+                }
+            }
+        }
+        for (int q = start; q < end; q++) {
+            for (int i = 0; i < MOD_MR; i++) {
+                uint64_t ai = static_cast<uint32_t>(a[i]);
+                for (int j = 0; j < MOD_NR; j++) {
+                    acc[i][j] += ai * static_cast<uint32_t>(b[j]);
+                }
+            }
+            a += MOD_MR;
+            b += MOD_NR;
+        }
+    }
+    for (int i = 0; i < MOD_MR; i++) {
+        int* row = c + i * ldc;
+        for (int j = 0; j < MOD_NR; j++) {
+            uint64_t value = reduceBarrett(acc[i][j], mod);
+            if (accumulate) {
+                value += static_cast<uint32_t>(row[j]);
+                value = value >= mod.p ? value - mod.p : value;
+            }
+            row[j] = static_cast<int>(value);
+        }
+    }
+}
+
+// Shoup: with w' = floor(w * 2^32 / p), q = floor(a * w' / 2^32) is
+// floor(a * w / p) or one less, so a * w - q * p lands in [0, 2p).
+static inline uint32_t mulShoup(uint32_t a, uint32_t w, uint32_t wShoup, uint32_t p) {
+    uint32_t q = static_cast<uint32_t>((static_cast<uint64_t>(a) * wShoup) >> 32);
+    uint32_t r = a * w - q * p;
+    return r >= p ? r - p : r;
+}
+
+// Garner digits of elements [begin, end): digit i folds in each earlier
+// digit j as (t - d_j) * p_j^-1 mod p_i. The vector tiers apply the same
+// steps lane-wise and finish their tails here.
+static void crtDigitsRange(int begin, int end, int* const* residues, const GemmCrtBasis& basis) {
+    for (int i = 1; i < basis.count; i++) {
+        uint32_t p = basis.primes[i];
+        uint32_t* row = reinterpret_cast<uint32_t*>(residues[i]);
+        for (int j = 0; j < i; j++) {
+            const uint32_t* digit = reinterpret_cast<const uint32_t*>(residues[j]);
+            uint32_t w = basis.inverse[i][j];
+            uint32_t wShoup = basis.inverseShoup[i][j];
+            for (int e = begin; e < end; e++) {
+                uint32_t d = digit[e] >= p ? digit[e] - p : digit[e];
+                uint32_t t = row[e] + p - d;
+                row[e] = mulShoup(t >= p ? t - p : t, w, wShoup, p);
+            }
+        }
+    }
+}
+
+static void crtDigitsScalar(int length, int* const* residues, const GemmCrtBasis& basis) {
+    crtDigitsRange(0, length, residues, basis);
+}
+
+#ifdef GEMM_HAVE_X86_KERNELS
+constexpr int AVX2_MR = 6;
+constexpr int AVX2_NR = 16;
+
+__attribute__((target("avx2")))
+static inline void storeTileAvx2(__m256i (*acc)[2], int* c, int ldc, bool accumulate) {
+#pragma GCC unroll 6
+    for (int i = 0; i < AVX2_MR; i++) {
+        __m256i* row = reinterpret_cast<__m256i*>(c + i * ldc);
+        if (accumulate) {
+            acc[i][0] = _mm256_add_epi32(acc[i][0], _mm256_loadu_si256(row));
+            acc[i][1] = _mm256_add_epi32(acc[i][1], _mm256_loadu_si256(row + 1));
+        }
+        _mm256_storeu_si256(row, acc[i][0]);
+        _mm256_storeu_si256(row + 1, acc[i][1]);
+    }
+}
+
+__attribute__((target("avx2")))
+static void microKernelAvx2(int kc, const int* a, const int* b, int* c, int ldc, bool accumulate) {
+    __m256i acc[AVX2_MR][2];
+#pragma GCC unroll 6
+    for (int i = 0; i < AVX2_MR; i++) {
+        acc[i][0] = _mm256_setzero_si256();
+        acc[i][1] = _mm256_setzero_si256();
+    }
+    for (int p = 0; p < kc; p++) {
+        __m256i b0 = _mm256_load_si256(reinterpret_cast<const __m256i*>(b));
+        __m256i b1 = _mm256_load_si256(reinterpret_cast<const __m256i*>(b + 8));
+#pragma GCC unroll 6
+        for (int i = 0; i < AVX2_MR; i++) {
+            __m256i ai = _mm256_set1_epi32(a[i]);
+            acc[i][0] = _mm256_add_epi32(acc[i][0], _mm256_mullo_epi32(ai, b0));
+            acc[i][1] = _mm256_add_epi32(acc[i][1], _mm256_mullo_epi32(ai, b1));
+        }
+        a += AVX2_MR;
+        b += AVX2_NR;
+    }
+    storeTileAvx2(acc, c, ldc, accumulate);
+}
+
+// vpmaddwd: each lane multiplies a pair of k values and adds both products.
+__attribute__((target("avx2")))
+static void microKernelAvx2I16(int groups, const void* aPacked, const void* bPacked, int* c, int ldc, bool accumulate) {
+    const int16_t* a = static_cast<const int16_t*>(aPacked);
+    const int16_t* b = static_cast<const int16_t*>(bPacked);
+    __m256i acc[AVX2_MR][2];
+#pragma GCC unroll 6
+    for (int i = 0; i < AVX2_MR; i++) {
+        acc[i][0] = _mm256_setzero_si256();
+        acc[i][1] = _mm256_setzero_si256();
+    }
+    for (int p = 0; p < groups; p++) {
+        __m256i b0 = _mm256_load_si256(reinterpret_cast<const __m256i*>(b));
+        __m256i b1 = _mm256_load_si256(reinterpret_cast<const __m256i*>(b + 16));
+#pragma GCC unroll 6
+        for (int i = 0; i < AVX2_MR; i++) {
+            __m256i ai = _mm256_set1_epi32(loadGroup(a + 2 * i));
+            acc[i][0] = _mm256_add_epi32(acc[i][0], _mm256_madd_epi16(ai, b0));
+            acc[i][1] = _mm256_add_epi32(acc[i][1], _mm256_madd_epi16(ai, b1));
+        }
+        a += AVX2_MR * 2;
+        b += AVX2_NR * 2;
+    }
+    storeTileAvx2(acc, c, ldc, accumulate);
+}
+
+// vpmaddubsw multiplies u8 by s8 and adds adjacent pairs into saturating int16
+// lanes; vpmaddwd against ones then folds the pairs into int32.
+template <bool AUnsigned>
+__attribute__((target("avx2")))
+static void microKernelAvx2I8(int groups, const void* aPacked, const void* bPacked, int* c, int ldc, bool accumulate) {
+    const uint8_t* a = static_cast<const uint8_t*>(aPacked);
+    const uint8_t* b = static_cast<const uint8_t*>(bPacked);
+    const __m256i ones = _mm256_set1_epi16(1);
+    __m256i acc[AVX2_MR][2];
+#pragma GCC unroll 6
+    for (int i = 0; i < AVX2_MR; i++) {
+        acc[i][0] = _mm256_setzero_si256();
+        acc[i][1] = _mm256_setzero_si256();
+    }
+    for (int p = 0; p < groups; p++) {
+        __m256i b0 = _mm256_load_si256(reinterpret_cast<const __m256i*>(b));
+        __m256i b1 = _mm256_load_si256(reinterpret_cast<const __m256i*>(b + 32));
+#pragma GCC unroll 6
+        for (int i = 0; i < AVX2_MR; i++) {
+            __m256i ai = _mm256_set1_epi32(loadGroup(a + 4 * i));
+            __m256i p0 = AUnsigned ? _mm256_maddubs_epi16(ai, b0) : _mm256_maddubs_epi16(b0, ai);
+            __m256i p1 = AUnsigned ? _mm256_maddubs_epi16(ai, b1) : _mm256_maddubs_epi16(b1, ai);
+            acc[i][0] = _mm256_add_epi32(acc[i][0], _mm256_madd_epi16(p0, ones));
+            acc[i][1] = _mm256_add_epi32(acc[i][1], _mm256_madd_epi16(p1, ones));
+        }
+        a += AVX2_MR * 4;
+        b += AVX2_NR * 4;
+    }
+    storeTileAvx2(acc, c, ldc, accumulate);
+}
+
+constexpr int AVX2_F32_NR = 16;
+constexpr int AVX2_F64_NR = 8;
+
+__attribute__((target("avx2,fma")))
+static void microKernelAvx2F32(int kc, const float* a, const float* b, float* c, int ldc, bool accumulate) {
+    __m256 acc[AVX2_MR][2];
+#pragma GCC unroll 6
+    for (int i = 0; i < AVX2_MR; i++) {
+        acc[i][0] = _mm256_setzero_ps();
+        acc[i][1] = _mm256_setzero_ps();
+    }
+    for (int p = 0; p < kc; p++) {
+        __m256 b0 = _mm256_load_ps(b);
+        __m256 b1 = _mm256_load_ps(b + 8);
+#pragma GCC unroll 6
+        for (int i = 0; i < AVX2_MR; i++) {
+            __m256 ai = _mm256_set1_ps(a[i]);
+            acc[i][0] = _mm256_fmadd_ps(ai, b0, acc[i][0]);
+            acc[i][1] = _mm256_fmadd_ps(ai, b1, acc[i][1]);
+        }
+        a += AVX2_MR;
+        b += 16;
+    }
+#pragma GCC unroll 6
+    for (int i = 0; i < AVX2_MR; i++) {
+        float* row = c + i * ldc;
+        if (accumulate) {
+            acc[i][0] = _mm256_add_ps(acc[i][0], _mm256_loadu_ps(row));
+            acc[i][1] = _mm256_add_ps(acc[i][1], _mm256_loadu_ps(row + 8));
+        }
+        _mm256_storeu_ps(row, acc[i][0]);
+        _mm256_storeu_ps(row + 8, acc[i][1]);
+    }
+}
+
+__attribute__((target("avx2,fma")))
+static void microKernelAvx2F64(int kc, const double* a, const double* b, double* c, int ldc, bool accumulate) {
+    __m256d acc[AVX2_MR][2];
+#pragma GCC unroll 6
+    for (int i = 0; i < AVX2_MR; i++) {
+        acc[i][0] = _mm256_setzero_pd();
+        acc[i][1] = _mm256_setzero_pd();
+    }
+    for (int p = 0; p < kc; p++) {
+        __m256d b0 = _mm256_load_pd(b);
+        __m256d b1 = _mm256_load_pd(b + 4);
+#pragma GCC unroll 6
+        for (int i = 0; i < AVX2_MR; i++) {
+            __m256d ai = _mm256_set1_pd(a[i]);
+            acc[i][0] = _mm256_fmadd_pd(ai, b0, acc[i][0]);
+            acc[i][1] = _mm256_fmadd_pd(ai, b1, acc[i][1]);
+        }
+        a += AVX2_MR;
+        b += 8;
+    }
+#pragma GCC unroll 6
+    for (int i = 0; i < AVX2_MR; i++) {
+        double* row = c + i * ldc;
+        if (accumulate) {
+            acc[i][0] = _mm256_add_pd(acc[i][0], _mm256_loadu_pd(row));
+            acc[i][1] = _mm256_add_pd(acc[i][1], _mm256_loadu_pd(row + 4));
+        }
+        _mm256_storeu_pd(row, acc[i][0]);
+        _mm256_storeu_pd(row + 4, acc[i][1]);
+    }
+}
+
+// Modular kernels hold one sum per 64-bit lane and multiply with vpmuludq,
+// which reads the low 32 bits of each lane. Every `lazy` products a sum
+// hi * 2^32 + lo folds to REDC(hi * 2^64 mod p) + REDC(lo * 2^32 mod p),
+// below 4p, where REDC(x) = x * 2^-32 mod p in [0, 2p) for x < p * 2^32.
+struct ModConstantsAvx2 {
+    __m256i p, pInv, r1, r2;
+};
+
+__attribute__((target("avx2")))
+static inline __m256i redcAvx2(__m256i x, const ModConstantsAvx2& k) {
+    __m256i m = _mm256_mul_epu32(x, k.pInv);
+    return _mm256_srli_epi64(_mm256_add_epi64(x, _mm256_mul_epu32(m, k.p)), 32);
+}
+
+__attribute__((target("avx2")))
+static inline __m256i foldAvx2(__m256i acc, const ModConstantsAvx2& k) {
+    __m256i hi = _mm256_mul_epu32(_mm256_srli_epi64(acc, 32), k.r2);
+    __m256i lo = _mm256_mul_epu32(acc, k.r1);
+    return _mm256_add_epi64(redcAvx2(hi, k), redcAvx2(lo, k));
+}
+
+// Lanes stay below 2^63, so the signed compare is exact.
+__attribute__((target("avx2")))
+static inline __m256i subtractIfAtLeastAvx2(__m256i v, __m256i bound) {
+    __m256i below = _mm256_cmpgt_epi64(bound, v);
+    return _mm256_sub_epi64(v, _mm256_andnot_si256(below, bound));
+}
+
+__attribute__((target("avx2")))
+static void microKernelAvx2Mod(int kc, const int* a, const int* b, int* c, int ldc, bool accumulate,
+                               const GemmModulus& mod) {
+    ModConstantsAvx2 k{_mm256_set1_epi64x(mod.p), _mm256_set1_epi64x(mod.pInv),
+                       _mm256_set1_epi64x(mod.r1), _mm256_set1_epi64x(mod.r2)};
+    __m256i acc[MOD_MR][2];
+#pragma GCC unroll 4
+    for (int i = 0; i < MOD_MR; i++) {
+        acc[i][0] = _mm256_setzero_si256();
+        acc[i][1] = _mm256_setzero_si256();
+    }
+    for (int start = 0; start < kc; start += mod.lazy) {
+        int end = std::min(kc, start + mod.lazy);
+        if (start > 0) {
+#pragma GCC unroll 4
+            for (int i = 0; i < MOD_MR; i++) {
+                acc[i][0] = foldAvx2(acc[i][0], k);
+                acc[i][1] = foldAvx2(acc[i][1], k);
+            }
+        }
+        for (int q = start; q < end; q++) {
+            __m256i b0 = _mm256_cvtepu32_epi64(_mm_loadu_si128(reinterpret_cast<const __m128i*>(b)));
+            __m256i b1 = _mm256_cvtepu32_epi64(_mm_loadu_si128(reinterpret_cast<const __m128i*>(b + 4)));
+#pragma GCC unroll 4
+            for (int i = 0; i < MOD_MR; i++) {
+                __m256i ai = _mm256_set1_epi64x(static_cast<uint32_t>(a[i]));
+                acc[i][0] = _mm256_add_epi64(acc[i][0], _mm256_mul_epu32(ai, b0));
+                acc[i][1] = _mm256_add_epi64(acc[i][1], _mm256_mul_epu32(ai, b1));
+            }
+            a += MOD_MR;
+            b += MOD_NR;
+        }
+    }
+    __m256i twoP = _mm256_add_epi64(k.p, k.p);
+    __m256i evens = _mm256_setr_epi32(0, 2, 4, 6, 0, 2, 4, 6);
+#pragma GCC unroll 4
+    for (int i = 0; i < MOD_MR; i++) {
+        int* row = c + i * ldc;
+        __m256i v[2];
+        for (int h = 0; h < 2; h++) {
+            v[h] = subtractIfAtLeastAvx2(subtractIfAtLeastAvx2(foldAvx2(acc[i][h], k), twoP), k.p);
+            if (accumulate) {
+                __m256i prev = _mm256_cvtepu32_epi64(_mm_loadu_si128(reinterpret_cast<const __m128i*>(row + 4 * h)));
+                v[h] = subtractIfAtLeastAvx2(_mm256_add_epi64(v[h], prev), k.p);
+            }
+        }
+        __m128i lo = _mm256_castsi256_si128(_mm256_permutevar8x32_epi32(v[0], evens));
+        __m128i hi = _mm256_castsi256_si128(_mm256_permutevar8x32_epi32(v[1], evens));
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(row), _mm256_set_m128i(hi, lo));
+    }
+}
+
+constexpr int AVX512_MR = 8;
+constexpr int AVX512_NR = 32;
+
+__attribute__((target("avx512f")))
+static inline void storeTileAvx512(__m512i (*acc)[2], int* c, int ldc, bool accumulate) {
+#pragma GCC unroll 8
+    for (int i = 0; i < AVX512_MR; i++) {
+        int* row = c + i * ldc;
+        if (accumulate) {
+            acc[i][0] = _mm512_add_epi32(acc[i][0], _mm512_loadu_si512(row));
+            acc[i][1] = _mm512_add_epi32(acc[i][1], _mm512_loadu_si512(row + 16));
+        }
+        _mm512_storeu_si512(row, acc[i][0]);
+        _mm512_storeu_si512(row + 16, acc[i][1]);
+    }
+}
+
+__attribute__((target("avx512f")))
+static void microKernelAvx512(int kc, const int* a, const int* b, int* c, int ldc, bool accumulate) {
+    __m512i acc[AVX512_MR][2];
+#pragma GCC unroll 8
+    for (int i = 0; i < AVX512_MR; i++) {
+        acc[i][0] = _mm512_setzero_si512();
+        acc[i][1] = _mm512_setzero_si512();
+    }
+    for (int p = 0; p < kc; p++) {
+        __m512i b0 = _mm512_load_si512(b);
+        __m512i b1 = _mm512_load_si512(b + 16);
+#pragma GCC unroll 8
+        for (int i = 0; i < AVX512_MR; i++) {
+            __m512i ai = _mm512_set1_epi32(a[i]);
+            acc[i][0] = _mm512_add_epi32(acc[i][0], _mm512_mullo_epi32(ai, b0));
+            acc[i][1] = _mm512_add_epi32(acc[i][1], _mm512_mullo_epi32(ai, b1));
+        }
+        a += AVX512_MR;
+        b += AVX512_NR;
+    }
+    storeTileAvx512(acc, c, ldc, accumulate);
+}
+
+__attribute__((target("avx512bw")))
+static void microKernelAvx512I16(int groups, const void* aPacked, const void* bPacked, int* c, int ldc, bool accumulate) {
+    const int16_t* a = static_cast<const int16_t*>(aPacked);
+    const int16_t* b = static_cast<const int16_t*>(bPacked);
+    __m512i acc[AVX512_MR][2];
+#pragma GCC unroll 8
+    for (int i = 0; i < AVX512_MR; i++) {
+        acc[i][0] = _mm512_setzero_si512();
+        acc[i][1] = _mm512_setzero_si512();
+    }
+    for (int p = 0; p < groups; p++) {
+        __m512i b0 = _mm512_load_si512(b);
+        __m512i b1 = _mm512_load_si512(b + 32);
+#pragma GCC unroll 8
+        for (int i = 0; i < AVX512_MR; i++) {
+            __m512i ai = _mm512_set1_epi32(loadGroup(a + 2 * i));
+            acc[i][0] = _mm512_add_epi32(acc[i][0], _mm512_madd_epi16(ai, b0));
+            acc[i][1] = _mm512_add_epi32(acc[i][1], _mm512_madd_epi16(ai, b1));
+        }
+        a += AVX512_MR * 2;
+        b += AVX512_NR * 2;
+    }
+    storeTileAvx512(acc, c, ldc, accumulate);
+}
+
+// VNNI vpdpbusd: u8 x s8 quads summed straight into int32 lanes, no saturation.
+template <bool AUnsigned>
+__attribute__((target("avx512vnni")))
+static void microKernelAvx512Vnni(int groups, const void* aPacked, const void* bPacked, int* c, int ldc, bool accumulate) {
+    const uint8_t* a = static_cast<const uint8_t*>(aPacked);
+    const uint8_t* b = static_cast<const uint8_t*>(bPacked);
+    __m512i acc[AVX512_MR][2];
+#pragma GCC unroll 8
+    for (int i = 0; i < AVX512_MR; i++) {
+        acc[i][0] = _mm512_setzero_si512();
+        acc[i][1] = _mm512_setzero_si512();
+    }
+    for (int p = 0; p < groups; p++) {
+        __m512i b0 = _mm512_load_si512(b);
+        __m512i b1 = _mm512_load_si512(b + 64);
+#pragma GCC unroll 8
+        for (int i = 0; i < AVX512_MR; i++) {
+            __m512i ai = _mm512_set1_epi32(loadGroup(a + 4 * i));
+            if (AUnsigned) {
+                acc[i][0] = _mm512_dpbusd_epi32(acc[i][0], ai, b0);
+                acc[i][1] = _mm512_dpbusd_epi32(acc[i][1], ai, b1);
+            } else {
+                acc[i][0] = _mm512_dpbusd_epi32(acc[i][0], b0, ai);
+                acc[i][1] = _mm512_dpbusd_epi32(acc[i][1], b1, ai);
+            }
+        }
+        a += AVX512_MR * 4;
+        b += AVX512_NR * 4;
+    }
+    storeTileAvx512(acc, c, ldc, accumulate);
+}
+
+constexpr int AVX512_F32_NR = 32;
+constexpr int AVX512_F64_NR = 16;
+
+__attribute__((target("avx512f")))
+static void microKernelAvx512F32(int kc, const float* a, const float* b, float* c, int ldc, bool accumulate) {
+    __m512 acc[AVX512_MR][2];
+#pragma GCC unroll 8
+    for (int i = 0; i < AVX512_MR; i++) {
+        acc[i][0] = _mm512_setzero_ps();
+        acc[i][1] = _mm512_setzero_ps();
+    }
+    for (int p = 0; p < kc; p++) {
+        __m512 b0 = _mm512_load_ps(b);
+        __m512 b1 = _mm512_load_ps(b + 16);
+#pragma GCC unroll 8
+        for (int i = 0; i < AVX512_MR; i++) {
+            __m512 ai = _mm512_set1_ps(a[i]);
+            acc[i][0] = _mm512_fmadd_ps(ai, b0, acc[i][0]);
+            acc[i][1] = _mm512_fmadd_ps(ai, b1, acc[i][1]);
+        }
+        a += AVX512_MR;
+        b += 32;
+    }
+#pragma GCC unroll 8
+    for (int i = 0; i < AVX512_MR; i++) {
+        float* row = c + i * ldc;
+        if (accumulate) {
+            acc[i][0] = _mm512_add_ps(acc[i][0], _mm512_loadu_ps(row));
+            acc[i][1] = _mm512_add_ps(acc[i][1], _mm512_loadu_ps(row + 16));
+        }
+        _mm512_storeu_ps(row, acc[i][0]);
+        _mm512_storeu_ps(row + 16, acc[i][1]);
+    }
+}
+
+__attribute__((target("avx512f")))
+static void microKernelAvx512F64(int kc, const double* a, const double* b, double* c, int ldc, bool accumulate) {
+    __m512d acc[AVX512_MR][2];
+#pragma GCC unroll 8
+    for (int i = 0; i < AVX512_MR; i++) {
+        acc[i][0] = _mm512_setzero_pd();
+        acc[i][1] = _mm512_setzero_pd();
+    }
+    for (int p = 0; p < kc; p++) {
+        __m512d b0 = _mm512_load_pd(b);
+        __m512d b1 = _mm512_load_pd(b + 8);
+#pragma GCC unroll 8
+        for (int i = 0; i < AVX512_MR; i++) {
+            __m512d ai = _mm512_set1_pd(a[i]);
+            acc[i][0] = _mm512_fmadd_pd(ai, b0, acc[i][0]);
+            acc[i][1] = _mm512_fmadd_pd(ai, b1, acc[i][1]);
+        }
+        a += AVX512_MR;
+        b += 16;
+    }
+#pragma GCC unroll 8
+    for (int i = 0; i < AVX512_MR; i++) {
+        double* row = c + i * ldc;
+        if (accumulate) {
+            acc[i][0] = _mm512_add_pd(acc[i][0], _mm512_loadu_pd(row));
+            acc[i][1] = _mm512_add_pd(acc[i][1], _mm512_loadu_pd(row + 8));
+        }
+        _mm512_storeu_pd(row, acc[i][0]);
+        _mm512_storeu_pd(row + 8, acc[i][1]);
+    }
+}
+constexpr int AVX512_MOD_MR = 8;
+constexpr int AVX512_MOD_NR = 16;
+
+struct ModConstantsAvx512 {
+    __m512i p, pInv, r1, r2;
+};
+
+__attribute__((target("avx512f")))
+static inline __m512i redcAvx512(__m512i x, const ModConstantsAvx512& k) {
+    __m512i m = _mm512_mul_epu32(x, k.pInv);
+    return _mm512_srli_epi64(_mm512_add_epi64(x, _mm512_mul_epu32(m, k.p)), 32);
+}
+
+__attribute__((target("avx512f")))
+static inline __m512i foldAvx512(__m512i acc, const ModConstantsAvx512& k) {
+    __m512i hi = _mm512_mul_epu32(_mm512_srli_epi64(acc, 32), k.r2);
+    __m512i lo = _mm512_mul_epu32(acc, k.r1);
+    return _mm512_add_epi64(redcAvx512(hi, k), redcAvx512(lo, k));
+}
+
+__attribute__((target("avx512f")))
+static inline __m512i subtractIfAtLeastAvx512(__m512i v, __m512i bound) {
+    return _mm512_mask_sub_epi64(v, _mm512_cmpge_epu64_mask(v, bound), v, bound);
+}
+
+__attribute__((target("avx512f")))
+static void microKernelAvx512Mod(int kc, const int* a, const int* b, int* c, int ldc, bool accumulate,
+                                 const GemmModulus& mod) {
+    ModConstantsAvx512 k{_mm512_set1_epi64(mod.p), _mm512_set1_epi64(mod.pInv),
+                         _mm512_set1_epi64(mod.r1), _mm512_set1_epi64(mod.r2)};
+    __m512i acc[AVX512_MOD_MR][2];
+#pragma GCC unroll 8
+    for (int i = 0; i < AVX512_MOD_MR; i++) {
+        acc[i][0] = _mm512_setzero_si512();
+        acc[i][1] = _mm512_setzero_si512();
+    }
+    for (int start = 0; start < kc; start += mod.lazy) {
+        int end = std::min(kc, start + mod.lazy);
+        if (start > 0) {
+#pragma GCC unroll 8
+            for (int i = 0; i < AVX512_MOD_MR; i++) {
+                acc[i][0] = foldAvx512(acc[i][0], k);
+                acc[i][1] = foldAvx512(acc[i][1], k);
+            }
+        }
+        for (int q = start; q < end; q++) {
+            __m512i b0 = _mm512_cvtepu32_epi64(_mm256_loadu_si256(reinterpret_cast<const __m256i*>(b)));
+            __m512i b1 = _mm512_cvtepu32_epi64(_mm256_loadu_si256(reinterpret_cast<const __m256i*>(b + 8)));
+#pragma GCC unroll 8
+            for (int i = 0; i < AVX512_MOD_MR; i++) {
+                __m512i ai = _mm512_set1_epi64(static_cast<uint32_t>(a[i]));
+                acc[i][0] = _mm512_add_epi64(acc[i][0], _mm512_mul_epu32(ai, b0));
+                acc[i][1] = _mm512_add_epi64(acc[i][1], _mm512_mul_epu32(ai, b1));
+            }
+            a += AVX512_MOD_MR;
+            b += AVX512_MOD_NR;
+        }
+    }
+    __m512i twoP = _mm512_add_epi64(k.p, k.p);
+#pragma GCC unroll 8
+    for (int i = 0; i < AVX512_MOD_MR; i++) {
+        int* row = c + i * ldc;
+        for (int h = 0; h < 2; h++) {
+            __m512i v = subtractIfAtLeastAvx512(subtractIfAtLeastAvx512(foldAvx512(acc[i][h], k), twoP), k.p);
+            __m256i* out = reinterpret_cast<__m256i*>(row + 8 * h);
+            if (accumulate) {
+                v = subtractIfAtLeastAvx512(_mm512_add_epi64(v, _mm512_cvtepu32_epi64(_mm256_loadu_si256(out))), k.p);
+            }
+            _mm256_storeu_si256(out, _mm512_cvtepi64_epi32(v));
+        }
+    }
+}
+// Unsigned min(v, v - p) subtracts p from lanes at or above it.
+__attribute__((target("avx2")))
+static inline __m256i mulShoupAvx2(__m256i a, __m256i w, __m256i wShoup, __m256i p) {
+    __m256i qEven = _mm256_srli_epi64(_mm256_mul_epu32(a, wShoup), 32);
+    __m256i qOdd = _mm256_mul_epu32(_mm256_srli_epi64(a, 32), wShoup);
+    __m256i q = _mm256_blend_epi32(qEven, qOdd, 0xAA);
+    __m256i r = _mm256_sub_epi32(_mm256_mullo_epi32(a, w), _mm256_mullo_epi32(q, p));
+    return _mm256_min_epu32(r, _mm256_sub_epi32(r, p));
+}
+
+__attribute__((target("avx2")))
+static void crtDigitsAvx2(int length, int* const* residues, const GemmCrtBasis& basis) {
+    int vectorEnd = length / 8 * 8;
+    for (int i = 1; i < basis.count; i++) {
+        __m256i p = _mm256_set1_epi32(static_cast<int>(basis.primes[i]));
+        int* row = residues[i];
+        for (int j = 0; j < i; j++) {
+            const int* digit = residues[j];
+            __m256i w = _mm256_set1_epi32(static_cast<int>(basis.inverse[i][j]));
+            __m256i wShoup = _mm256_set1_epi32(static_cast<int>(basis.inverseShoup[i][j]));
+            for (int e = 0; e < vectorEnd; e += 8) {
+                __m256i d = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(digit + e));
+                __m256i t = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(row + e));
+                d = _mm256_min_epu32(d, _mm256_sub_epi32(d, p));
+                t = _mm256_add_epi32(_mm256_sub_epi32(t, d), p);
+                t = _mm256_min_epu32(t, _mm256_sub_epi32(t, p));
+                _mm256_storeu_si256(reinterpret_cast<__m256i*>(row + e), mulShoupAvx2(t, w, wShoup, p));
+            }
+        }
+    }
+    crtDigitsRange(vectorEnd, length, residues, basis);
+}
+
+__attribute__((target("avx512f")))
+static inline __m512i mulShoupAvx512(__m512i a, __m512i w, __m512i wShoup, __m512i p) {
+    __m512i qEven = _mm512_srli_epi64(_mm512_mul_epu32(a, wShoup), 32);
+    __m512i qOdd = _mm512_mul_epu32(_mm512_srli_epi64(a, 32), wShoup);
+    __m512i q = _mm512_mask_blend_epi32(0xAAAA, qEven, qOdd);
+    __m512i r = _mm512_sub_epi32(_mm512_mullo_epi32(a, w), _mm512_mullo_epi32(q, p));
+    return _mm512_min_epu32(r, _mm512_sub_epi32(r, p));
+}
+
+__attribute__((target("avx512f")))
+static void crtDigitsAvx512(int length, int* const* residues, const GemmCrtBasis& basis) {
+    int vectorEnd = length / 16 * 16;
+    for (int i = 1; i < basis.count; i++) {
+        __m512i p = _mm512_set1_epi32(static_cast<int>(basis.primes[i]));
+        int* row = residues[i];
+        for (int j = 0; j < i; j++) {
+            const int* digit = residues[j];
+            __m512i w = _mm512_set1_epi32(static_cast<int>(basis.inverse[i][j]));
+            __m512i wShoup = _mm512_set1_epi32(static_cast<int>(basis.inverseShoup[i][j]));
+            for (int e = 0; e < vectorEnd; e += 16) {
+                __m512i d = _mm512_loadu_si512(digit + e);
+                __m512i t = _mm512_loadu_si512(row + e);
+                d = _mm512_min_epu32(d, _mm512_sub_epi32(d, p));
+                t = _mm512_add_epi32(_mm512_sub_epi32(t, d), p);
+                t = _mm512_min_epu32(t, _mm512_sub_epi32(t, p));
+                _mm512_storeu_si512(row + e, mulShoupAvx512(t, w, wShoup, p));
+            }
+        }
+    }
+    crtDigitsRange(vectorEnd, length, residues, basis);
+}
+#endif
+
+#ifdef GEMM_HAVE_NEON_KERNELS
+constexpr int NEON_MR = 8;
+constexpr int NEON_NR = 8;
+
+static inline void storeTileNeon(int32x4_t (*acc)[2], int* c, int ldc, bool accumulate) {
+#pragma GCC unroll 8
+    for (int i = 0; i < NEON_MR; i++) {
+        int* row = c + i * ldc;
+        if (accumulate) {
+            acc[i][0] = vaddq_s32(acc[i][0], vld1q_s32(row));
+            acc[i][1] = vaddq_s32(acc[i][1], vld1q_s32(row + 4));
+        }
+        vst1q_s32(row, acc[i][0]);
+        vst1q_s32(row + 4, acc[i][1]);
+    }
+}
+
+static void microKernelNeon(int kc, const int* a, const int* b, int* c, int ldc, bool accumulate) {
+    int32x4_t acc[NEON_MR][2];
+#pragma GCC unroll 8
+    for (int i = 0; i < NEON_MR; i++) {
+        acc[i][0] = vdupq_n_s32(0);
+        acc[i][1] = vdupq_n_s32(0);
+    }
+    for (int p = 0; p < kc; p++) {
+        int32x4_t b0 = vld1q_s32(b);
+        int32x4_t b1 = vld1q_s32(b + 4);
+        int32x4_t a0 = vld1q_s32(a);
+        int32x4_t a1 = vld1q_s32(a + 4);
+        acc[0][0] = vmlaq_laneq_s32(acc[0][0], b0, a0, 0);
+        acc[0][1] = vmlaq_laneq_s32(acc[0][1], b1, a0, 0);
+        acc[1][0] = vmlaq_laneq_s32(acc[1][0], b0, a0, 1);
+        acc[1][1] = vmlaq_laneq_s32(acc[1][1], b1, a0, 1);
+        acc[2][0] = vmlaq_laneq_s32(acc[2][0], b0, a0, 2);
+        acc[2][1] = vmlaq_laneq_s32(acc[2][1], b1, a0, 2);
+        acc[3][0] = vmlaq_laneq_s32(acc[3][0], b0, a0, 3);
+        acc[3][1] = vmlaq_laneq_s32(acc[3][1], b1, a0, 3);
+        acc[4][0] = vmlaq_laneq_s32(acc[4][0], b0, a1, 0);
+        acc[4][1] = vmlaq_laneq_s32(acc[4][1], b1, a1, 0);
+        acc[5][0] = vmlaq_laneq_s32(acc[5][0], b0, a1, 1);
+        acc[5][1] = vmlaq_laneq_s32(acc[5][1], b1, a1, 1);
+        acc[6][0] = vmlaq_laneq_s32(acc[6][0], b0, a1, 2);
+        acc[6][1] = vmlaq_laneq_s32(acc[6][1], b1, a1, 2);
+        acc[7][0] = vmlaq_laneq_s32(acc[7][0], b0, a1, 3);
+        acc[7][1] = vmlaq_laneq_s32(acc[7][1], b1, a1, 3);
+        a += NEON_MR;
+        b += NEON_NR;
+    }
+    storeTileNeon(acc, c, ldc, accumulate);
+}
+
+constexpr int NEON_F32_NR = 8;
+constexpr int NEON_F64_NR = 4;
+
+static void microKernelNeonF32(int kc, const float* a, const float* b, float* c, int ldc, bool accumulate) {
+    float32x4_t acc[NEON_MR][2];
+#pragma GCC unroll 8
+    for (int i = 0; i < NEON_MR; i++) {
+        acc[i][0] = vdupq_n_f32(0.0f);
+        acc[i][1] = vdupq_n_f32(0.0f);
+    }
+    for (int p = 0; p < kc; p++) {
+        float32x4_t b0 = vld1q_f32(b);
+        float32x4_t b1 = vld1q_f32(b + 4);
+        float32x4_t a0 = vld1q_f32(a);
+        float32x4_t a1 = vld1q_f32(a + 4);
+        acc[0][0] = vfmaq_laneq_f32(acc[0][0], b0, a0, 0);
+        acc[0][1] = vfmaq_laneq_f32(acc[0][1], b1, a0, 0);
+        acc[1][0] = vfmaq_laneq_f32(acc[1][0], b0, a0, 1);
+        acc[1][1] = vfmaq_laneq_f32(acc[1][1], b1, a0, 1);
+        acc[2][0] = vfmaq_laneq_f32(acc[2][0], b0, a0, 2);
+        acc[2][1] = vfmaq_laneq_f32(acc[2][1], b1, a0, 2);
+        acc[3][0] = vfmaq_laneq_f32(acc[3][0], b0, a0, 3);
+        acc[3][1] = vfmaq_laneq_f32(acc[3][1], b1, a0, 3);
+        acc[4][0] = vfmaq_laneq_f32(acc[4][0], b0, a1, 0);
+        acc[4][1] = vfmaq_laneq_f32(acc[4][1], b1, a1, 0);
+        acc[5][0] = vfmaq_laneq_f32(acc[5][0], b0, a1, 1);
+        acc[5][1] = vfmaq_laneq_f32(acc[5][1], b1, a1, 1);
+        acc[6][0] = vfmaq_laneq_f32(acc[6][0], b0, a1, 2);
+        acc[6][1] = vfmaq_laneq_f32(acc[6][1], b1, a1, 2);
+        acc[7][0] = vfmaq_laneq_f32(acc[7][0], b0, a1, 3);
+        acc[7][1] = vfmaq_laneq_f32(acc[7][1], b1, a1, 3);
+        a += NEON_MR;
+        b += NEON_F32_NR;
+    }
+#pragma GCC unroll 8
+    for (int i = 0; i < NEON_MR; i++) {
+        float* row = c + i * ldc;
+        if (accumulate) {
+            acc[i][0] = vaddq_f32(acc[i][0], vld1q_f32(row));
+            acc[i][1] = vaddq_f32(acc[i][1], vld1q_f32(row + 4));
+        }
+        vst1q_f32(row, acc[i][0]);
+        vst1q_f32(row + 4, acc[i][1]);
+    }
+}
+
+static void microKernelNeonF64(int kc, const double* a, const double* b, double* c, int ldc, bool accumulate) {
+    float64x2_t acc[NEON_MR][2];
+#pragma GCC unroll 8
+    for (int i = 0; i < NEON_MR; i++) {
+        acc[i][0] = vdupq_n_f64(0.0);
+        acc[i][1] = vdupq_n_f64(0.0);
+    }
+    for (int p = 0; p < kc; p++) {
+        float64x2_t b0 = vld1q_f64(b);
+        float64x2_t b1 = vld1q_f64(b + 2);
+        float64x2_t a0 = vld1q_f64(a);
+        float64x2_t a1 = vld1q_f64(a + 2);
+        float64x2_t a2 = vld1q_f64(a + 4);
+        float64x2_t a3 = vld1q_f64(a + 6);
+        acc[0][0] = vfmaq_laneq_f64(acc[0][0], b0, a0, 0);
+        acc[0][1] = vfmaq_laneq_f64(acc[0][1], b1, a0, 0);
+        acc[1][0] = vfmaq_laneq_f64(acc[1][0], b0, a0, 1);
+        acc[1][1] = vfmaq_laneq_f64(acc[1][1], b1, a0, 1);
+        acc[2][0] = vfmaq_laneq_f64(acc[2][0], b0, a1, 0);
+        acc[2][1] = vfmaq_laneq_f64(acc[2][1], b1, a1, 0);
+        acc[3][0] = vfmaq_laneq_f64(acc[3][0], b0, a1, 1);
+        acc[3][1] = vfmaq_laneq_f64(acc[3][1], b1, a1, 1);
+        acc[4][0] = vfmaq_laneq_f64(acc[4][0], b0, a2, 0);
+        acc[4][1] = vfmaq_laneq_f64(acc[4][1], b1, a2, 0);
+        acc[5][0] = vfmaq_laneq_f64(acc[5][0], b0, a2, 1);
+        acc[5][1] = vfmaq_laneq_f64(acc[5][1], b1, a2, 1);
+        acc[6][0] = vfmaq_laneq_f64(acc[6][0], b0, a3, 0);
+        acc[6][1] = vfmaq_laneq_f64(acc[6][1], b1, a3, 0);
+        acc[7][0] = vfmaq_laneq_f64(acc[7][0], b0, a3, 1);
+        acc[7][1] = vfmaq_laneq_f64(acc[7][1], b1, a3, 1);
+        a += NEON_MR;
+        b += NEON_F64_NR;
+    }
+#pragma GCC unroll 8
+    for (int i = 0; i < NEON_MR; i++) {
+        double* row = c + i * ldc;
+        if (accumulate) {
+            acc[i][0] = vaddq_f64(acc[i][0], vld1q_f64(row));
+            acc[i][1] = vaddq_f64(acc[i][1], vld1q_f64(row + 2));
+        }
+        vst1q_f64(row, acc[i][0]);
+        vst1q_f64(row + 2, acc[i][1]);
+    }
+}
+
+// smlal by lane: int16 operands widened into int32 accumulators, one k per step.
+static void microKernelNeonI16(int groups, const void* aPacked, const void* bPacked, int* c, int ldc, bool accumulate) {
+    const int16_t* a = static_cast<const int16_t*>(aPacked);
+    const int16_t* b = static_cast<const int16_t*>(bPacked);
+    int32x4_t acc[NEON_MR][2];
+#pragma GCC unroll 8
+    for (int i = 0; i < NEON_MR; i++) {
+        acc[i][0] = vdupq_n_s32(0);
+        acc[i][1] = vdupq_n_s32(0);
+    }
+    for (int p = 0; p < groups; p++) {
+        int16x8_t bv = vld1q_s16(b);
+        int16x4_t bLow = vget_low_s16(bv);
+        int16x8_t av = vld1q_s16(a);
+        acc[0][0] = vmlal_laneq_s16(acc[0][0], bLow, av, 0);
+        acc[0][1] = vmlal_high_laneq_s16(acc[0][1], bv, av, 0);
+        acc[1][0] = vmlal_laneq_s16(acc[1][0], bLow, av, 1);
+        acc[1][1] = vmlal_high_laneq_s16(acc[1][1], bv, av, 1);
+        acc[2][0] = vmlal_laneq_s16(acc[2][0], bLow, av, 2);
+        acc[2][1] = vmlal_high_laneq_s16(acc[2][1], bv, av, 2);
+        acc[3][0] = vmlal_laneq_s16(acc[3][0], bLow, av, 3);
+        acc[3][1] = vmlal_high_laneq_s16(acc[3][1], bv, av, 3);
+        acc[4][0] = vmlal_laneq_s16(acc[4][0], bLow, av, 4);
+        acc[4][1] = vmlal_high_laneq_s16(acc[4][1], bv, av, 4);
+        acc[5][0] = vmlal_laneq_s16(acc[5][0], bLow, av, 5);
+        acc[5][1] = vmlal_high_laneq_s16(acc[5][1], bv, av, 5);
+        acc[6][0] = vmlal_laneq_s16(acc[6][0], bLow, av, 6);
+        acc[6][1] = vmlal_high_laneq_s16(acc[6][1], bv, av, 6);
+        acc[7][0] = vmlal_laneq_s16(acc[7][0], bLow, av, 7);
+        acc[7][1] = vmlal_high_laneq_s16(acc[7][1], bv, av, 7);
+        a += NEON_MR;
+        b += NEON_NR;
+    }
+    storeTileNeon(acc, c, ldc, accumulate);
+}
+
+struct ModConstantsNeon {
+    uint32x2_t p, pInv, r1, r2;
+};
+
+static inline uint64x2_t redcNeon(uint64x2_t x, const ModConstantsNeon& k) {
+    uint32x2_t m = vmul_u32(vmovn_u64(x), k.pInv);
+    return vshrq_n_u64(vmlal_u32(x, m, k.p), 32);
+}
+
+static inline uint64x2_t foldNeon(uint64x2_t acc, const ModConstantsNeon& k) {
+    uint64x2_t hi = vmull_u32(vshrn_n_u64(acc, 32), k.r2);
+    uint64x2_t lo = vmull_u32(vmovn_u64(acc), k.r1);
+    return vaddq_u64(redcNeon(hi, k), redcNeon(lo, k));
+}
+
+static inline uint64x2_t subtractIfAtLeastNeon(uint64x2_t v, uint64x2_t bound) {
+    return vsubq_u64(v, vandq_u64(vcgeq_u64(v, bound), bound));
+}
+
+// vmlal_u32 multiplies two 32-bit lanes into 64-bit sums; each row keeps
+// its eight columns in four registers.
+static void microKernelNeonMod(int kc, const int* a, const int* b, int* c, int ldc, bool accumulate,
+                               const GemmModulus& mod) {
+    ModConstantsNeon k{vdup_n_u32(mod.p), vdup_n_u32(mod.pInv), vdup_n_u32(mod.r1), vdup_n_u32(mod.r2)};
+    const uint32_t* au = reinterpret_cast<const uint32_t*>(a);
+    const uint32_t* bu = reinterpret_cast<const uint32_t*>(b);
+    uint64x2_t acc[MOD_MR][4];
+#pragma GCC unroll 4
+    for (int i = 0; i < MOD_MR; i++) {
+        for (int h = 0; h < 4; h++) {
+            acc[i][h] = vdupq_n_u64(0);
+        }
+    }
+    for (int start = 0; start < kc; start += mod.lazy) {
+        int end = std::min(kc, start + mod.lazy);
+        if (start > 0) {
+#pragma GCC unroll 4
+            for (int i = 0; i < MOD_MR; i++) {
+                for (int h = 0; h < 4; h++) {
+                    acc[i][h] = foldNeon(acc[i][h], k);
+                }
+            }
+        }
+        for (int q = start; q < end; q++) {
+            uint32x4_t b0 = vld1q_u32(bu);
+            uint32x4_t b1 = vld1q_u32(bu + 4);
+            uint32x2_t bh[4] = {vget_low_u32(b0), vget_high_u32(b0), vget_low_u32(b1), vget_high_u32(b1)};
+            uint32x4_t a0 = vld1q_u32(au);
+            for (int h = 0; h < 4; h++) {
+                acc[0][h] = vmlal_laneq_u32(acc[0][h], bh[h], a0, 0);
+                acc[1][h] = vmlal_laneq_u32(acc[1][h], bh[h], a0, 1);
+                acc[2][h] = vmlal_laneq_u32(acc[2][h], bh[h], a0, 2);
+                acc[3][h] = vmlal_laneq_u32(acc[3][h], bh[h], a0, 3);
+            }
+            au += MOD_MR;
+            bu += MOD_NR;
+        }
+    }
+    uint64x2_t p = vmovl_u32(k.p);
+    uint64x2_t twoP = vaddq_u64(p, p);
+#pragma GCC unroll 4
+    for (int i = 0; i < MOD_MR; i++) {
+        uint32_t* row = reinterpret_cast<uint32_t*>(c + i * ldc);
+        for (int h = 0; h < 4; h += 2) {
+            uint64x2_t v0 = subtractIfAtLeastNeon(subtractIfAtLeastNeon(foldNeon(acc[i][h], k), twoP), p);
+            uint64x2_t v1 = subtractIfAtLeastNeon(subtractIfAtLeastNeon(foldNeon(acc[i][h + 1], k), twoP), p);
+            if (accumulate) {
+                uint32x4_t prev = vld1q_u32(row + 2 * h);
+                v0 = subtractIfAtLeastNeon(vaddw_u32(v0, vget_low_u32(prev)), p);
+                v1 = subtractIfAtLeastNeon(vaddw_u32(v1, vget_high_u32(prev)), p);
+            }
+            vst1q_u32(row + 2 * h, vcombine_u32(vmovn_u64(v0), vmovn_u64(v1)));
+        }
+    }
+}
+
+static inline uint32x4_t mulShoupNeon(uint32x4_t a, uint32_t w, uint32_t wShoup, uint32x4_t p) {
+    uint64x2_t low = vmull_n_u32(vget_low_u32(a), wShoup);
+    uint64x2_t high = vmull_high_n_u32(a, wShoup);
+    uint32x4_t q = vuzp2q_u32(vreinterpretq_u32_u64(low), vreinterpretq_u32_u64(high));
+    uint32x4_t r = vmlsq_u32(vmulq_n_u32(a, w), q, p);
+    return vminq_u32(r, vsubq_u32(r, p));
+}
+
+static void crtDigitsNeon(int length, int* const* residues, const GemmCrtBasis& basis) {
+    int vectorEnd = length / 4 * 4;
+    for (int i = 1; i < basis.count; i++) {
+        uint32x4_t p = vdupq_n_u32(basis.primes[i]);
+        uint32_t* row = reinterpret_cast<uint32_t*>(residues[i]);
+        for (int j = 0; j < i; j++) {
+            const uint32_t* digit = reinterpret_cast<const uint32_t*>(residues[j]);
+            uint32_t w = basis.inverse[i][j];
+            uint32_t wShoup = basis.inverseShoup[i][j];
+            for (int e = 0; e < vectorEnd; e += 4) {
+                uint32x4_t d = vld1q_u32(digit + e);
+                d = vminq_u32(d, vsubq_u32(d, p));
+                uint32x4_t t = vaddq_u32(vsubq_u32(vld1q_u32(row + e), d), p);
+                t = vminq_u32(t, vsubq_u32(t, p));
+                vst1q_u32(row + e, mulShoupNeon(t, w, wShoup, p));
+            }
+        }
+    }
+    crtDigitsRange(vectorEnd, length, residues, basis);
+}
+
+#if defined(__ARM_FEATURE_DOTPROD)
+#define GEMM_HAVE_NEON_DOTPROD_KERNELS 1
+// sdot by lane: s8 quads summed into int32 lanes; needs a dotprod-enabled build.
+static void microKernelNeonDot(int groups, const void* aPacked, const void* bPacked, int* c, int ldc, bool accumulate) {
+    const int8_t* a = static_cast<const int8_t*>(aPacked);
+    const int8_t* b = static_cast<const int8_t*>(bPacked);
+    int32x4_t acc[NEON_MR][2];
+#pragma GCC unroll 8
+    for (int i = 0; i < NEON_MR; i++) {
+        acc[i][0] = vdupq_n_s32(0);
+        acc[i][1] = vdupq_n_s32(0);
+    }
+    for (int p = 0; p < groups; p++) {
+        int8x16_t b0 = vld1q_s8(b);
+        int8x16_t b1 = vld1q_s8(b + 16);
+        int8x16_t a0 = vld1q_s8(a);
+        int8x16_t a1 = vld1q_s8(a + 16);
+        acc[0][0] = vdotq_laneq_s32(acc[0][0], b0, a0, 0);
+        acc[0][1] = vdotq_laneq_s32(acc[0][1], b1, a0, 0);
+        acc[1][0] = vdotq_laneq_s32(acc[1][0], b0, a0, 1);
+        acc[1][1] = vdotq_laneq_s32(acc[1][1], b1, a0, 1);
+        acc[2][0] = vdotq_laneq_s32(acc[2][0], b0, a0, 2);
+        acc[2][1] = vdotq_laneq_s32(acc[2][1], b1, a0, 2);
+        acc[3][0] = vdotq_laneq_s32(acc[3][0], b0, a0, 3);
+        acc[3][1] = vdotq_laneq_s32(acc[3][1], b1, a0, 3);
+        acc[4][0] = vdotq_laneq_s32(acc[4][0], b0, a1, 0);
+        acc[4][1] = vdotq_laneq_s32(acc[4][1], b1, a1, 0);
+        acc[5][0] = vdotq_laneq_s32(acc[5][0], b0, a1, 1);
+        acc[5][1] = vdotq_laneq_s32(acc[5][1], b1, a1, 1);
+        acc[6][0] = vdotq_laneq_s32(acc[6][0], b0, a1, 2);
+        acc[6][1] = vdotq_laneq_s32(acc[6][1], b1, a1, 2);
+        acc[7][0] = vdotq_laneq_s32(acc[7][0], b0, a1, 3);
+        acc[7][1] = vdotq_laneq_s32(acc[7][1], b1, a1, 3);
+        a += NEON_MR * 4;
+        b += NEON_NR * 4;
+    }
+    storeTileNeon(acc, c, ldc, accumulate);
+}
+#endif
+#endif
+
+// Semiring kernels are one plain-loop template. The x86 tiers compile it
+// for their vector width, where min, max, or and and are single lane
+// instructions; NEON vectorizes it as is.
+template <typename T> struct SemiringLane { using type = T; };
+template <> struct SemiringLane<int> { using type = unsigned; };
+
+template <typename T>
+static inline T addWrapping(T x, T y) {
+    using U = typename SemiringLane<T>::type;
+    return static_cast<T>(static_cast<U>(x) + static_cast<U>(y));
+}
+
+// add(sum, product) keeps sum on ties, like std::min(sum, product).
+template <typename T>
+struct MinPlus {
+    static constexpr Semiring KIND = Semiring::MIN_PLUS;
+    static constexpr T identity() {
+        return std::numeric_limits<T>::has_infinity ? std::numeric_limits<T>::infinity() : std::numeric_limits<T>::max();
+    }
+    static T add(T sum, T product) { return product < sum ? product : sum; }
+    static T mul(T x, T y) { return addWrapping(x, y); }
+};
+
+template <typename T>
+struct MaxPlus {
+    static constexpr Semiring KIND = Semiring::MAX_PLUS;
+    static constexpr T identity() {
+        return std::numeric_limits<T>::has_infinity ? -std::numeric_limits<T>::infinity()
+                                                    : std::numeric_limits<T>::lowest();
+    }
+    static T add(T sum, T product) { return product > sum ? product : sum; }
+    static T mul(T x, T y) { return addWrapping(x, y); }
+};
+
+struct OrAnd {
+    static constexpr Semiring KIND = Semiring::OR_AND;
+    static constexpr int identity() { return 0; }
+    static int add(int sum, int product) { return sum | product; }
+    static int mul(int x, int y) { return x & y; }
+};
+
+template <typename T, typename S, int MR, int NR>
+static void microKernelSemiring(int kc, const T* a, const T* b, T* c, int ldc, bool accumulate) {
+    T acc[MR][NR];
+    for (int i = 0; i < MR; i++) {
+        for (int j = 0; j < NR; j++) {
+            acc[i][j] = S::identity();
+        }
+    }
+    for (int p = 0; p < kc; p++) {
+#pragma GCC unroll 8
+        for (int i = 0; i < MR; i++) {
+            T ai = a[i];
+            for (int j = 0; j < NR; j++) {
+                acc[i][j] = S::add(acc[i][j], S::mul(ai, b[j]));
+            }
+        }
+        a += MR;
+        b += NR;
+    }
+#pragma GCC unroll 8
+    for (int i = 0; i < MR; i++) {
+        T* row = c + i * ldc;
+        for (int j = 0; j < NR; j++) {
+            row[j] = accumulate ? S::add(row[j], acc[i][j]) : acc[i][j];
+        }
+    }
+}
+
+struct SemiringScalarTier {
+    template <typename T, typename S, int MR, int NR>
+    static void run(int kc, const T* a, const T* b, T* c, int ldc, bool accumulate) {
+        microKernelSemiring<T, S, MR, NR>(kc, a, b, c, ldc, accumulate);
+    }
+};
+
+#ifdef GEMM_HAVE_X86_KERNELS
+struct SemiringAvx2Tier {
+    template <typename T, typename S, int MR, int NR>
+    __attribute__((target("avx2"), flatten))
+    static void run(int kc, const T* a, const T* b, T* c, int ldc, bool accumulate) {
+        microKernelSemiring<T, S, MR, NR>(kc, a, b, c, ldc, accumulate);
+    }
+};
+
+struct SemiringAvx512Tier {
+    template <typename T, typename S, int MR, int NR>
+    __attribute__((target("avx512f,avx512vl,avx512dq,avx512bw"), flatten))
+    static void run(int kc, const T* a, const T* b, T* c, int ldc, bool accumulate) {
+        microKernelSemiring<T, S, MR, NR>(kc, a, b, c, ldc, accumulate);
+    }
+};
+#endif
+
+template <typename T, typename S, typename Tier, int MR, int NR>
+static constexpr GemmSemiringKernel<T> semiringKernel(CPUIsa isa) {
+    return {isa, S::KIND, MR, NR, S::identity(), Tier::template run<T, S, MR, NR>};
+}
+
+static const GemmMicroKernel scalarKernel = {CPUIsa::SCALAR, SCALAR_MR, SCALAR_NR, microKernelScalar};
+#ifdef GEMM_HAVE_X86_KERNELS
+static const GemmMicroKernel avx2Kernel = {CPUIsa::AVX2, AVX2_MR, AVX2_NR, microKernelAvx2};
+static const GemmMicroKernel avx512Kernel = {CPUIsa::AVX512, AVX512_MR, AVX512_NR, microKernelAvx512};
+#endif
+#ifdef GEMM_HAVE_NEON_KERNELS
+static const GemmMicroKernel neonKernel = {CPUIsa::NEON, NEON_MR, NEON_NR, microKernelNeon};
+#endif
+
+const GemmMicroKernel& gemmMicroKernel(CPUIsa isa) {
+    switch (isa) {
+#ifdef GEMM_HAVE_X86_KERNELS
+        case CPUIsa::AVX2: return avx2Kernel;
+        case CPUIsa::AVX512: return avx512Kernel;
+#endif
+#ifdef GEMM_HAVE_NEON_KERNELS
+        case CPUIsa::NEON: return neonKernel;
+#endif
+        default: return scalarKernel;
+    }
+}
+
+static const GemmFloatMicroKernel<float> scalarF32Kernel = {CPUIsa::SCALAR, SCALAR_MR, SCALAR_NR, microKernelScalarFloat<float>};
+static const GemmFloatMicroKernel<double> scalarF64Kernel = {CPUIsa::SCALAR, SCALAR_MR, SCALAR_NR, microKernelScalarFloat<double>};
+#ifdef GEMM_HAVE_X86_KERNELS
+static const GemmFloatMicroKernel<float> avx2F32Kernel = {CPUIsa::AVX2, AVX2_MR, AVX2_F32_NR, microKernelAvx2F32};
+static const GemmFloatMicroKernel<double> avx2F64Kernel = {CPUIsa::AVX2, AVX2_MR, AVX2_F64_NR, microKernelAvx2F64};
+static const GemmFloatMicroKernel<float> avx512F32Kernel = {CPUIsa::AVX512, AVX512_MR, AVX512_F32_NR, microKernelAvx512F32};
+static const GemmFloatMicroKernel<double> avx512F64Kernel = {CPUIsa::AVX512, AVX512_MR, AVX512_F64_NR, microKernelAvx512F64};
+#endif
+#ifdef GEMM_HAVE_NEON_KERNELS
+static const GemmFloatMicroKernel<float> neonF32Kernel = {CPUIsa::NEON, NEON_MR, NEON_F32_NR, microKernelNeonF32};
+static const GemmFloatMicroKernel<double> neonF64Kernel = {CPUIsa::NEON, NEON_MR, NEON_F64_NR, microKernelNeonF64};
+#endif
+
+// The AVX2 tier needs FMA as well; callers pass SCALAR when it is missing.
+const GemmFloatMicroKernel<float>& gemmF32MicroKernel(CPUIsa isa) {
+    switch (isa) {
+#ifdef GEMM_HAVE_X86_KERNELS
+        case CPUIsa::AVX2: return avx2F32Kernel;
+        case CPUIsa::AVX512: return avx512F32Kernel;
+#endif
+#ifdef GEMM_HAVE_NEON_KERNELS
+        case CPUIsa::NEON: return neonF32Kernel;
+#endif
+        default: return scalarF32Kernel;
+    }
+}
+
+const GemmFloatMicroKernel<double>& gemmF64MicroKernel(CPUIsa isa) {
+    switch (isa) {
+#ifdef GEMM_HAVE_X86_KERNELS
+        case CPUIsa::AVX2: return avx2F64Kernel;
+        case CPUIsa::AVX512: return avx512F64Kernel;
+#endif
+#ifdef GEMM_HAVE_NEON_KERNELS
+        case CPUIsa::NEON: return neonF64Kernel;
+#endif
+        default: return scalarF64Kernel;
+    }
+}
+
+static const GemmModKernel scalarModKernel = {CPUIsa::SCALAR, MOD_MR, MOD_NR, false, microKernelScalarMod};
+#ifdef GEMM_HAVE_X86_KERNELS
+static const GemmModKernel avx2ModKernel = {CPUIsa::AVX2, MOD_MR, MOD_NR, true, microKernelAvx2Mod};
+static const GemmModKernel avx512ModKernel = {CPUIsa::AVX512, AVX512_MOD_MR, AVX512_MOD_NR, true, microKernelAvx512Mod};
+#endif
+#ifdef GEMM_HAVE_NEON_KERNELS
+static const GemmModKernel neonModKernel = {CPUIsa::NEON, MOD_MR, MOD_NR, true, microKernelNeonMod};
+#endif
+
+const GemmModKernel& gemmModKernel(CPUIsa isa) {
+    switch (isa) {
+#ifdef GEMM_HAVE_X86_KERNELS
+        case CPUIsa::AVX2: return avx2ModKernel;
+        case CPUIsa::AVX512: return avx512ModKernel;
+#endif
+#ifdef GEMM_HAVE_NEON_KERNELS
+        case CPUIsa::NEON: return neonModKernel;
+#endif
+        default: return scalarModKernel;
+    }
+}
+
+static const GemmCrtKernel scalarCrtKernel = {CPUIsa::SCALAR, crtDigitsScalar};
+#ifdef GEMM_HAVE_X86_KERNELS
+static const GemmCrtKernel avx2CrtKernel = {CPUIsa::AVX2, crtDigitsAvx2};
+static const GemmCrtKernel avx512CrtKernel = {CPUIsa::AVX512, crtDigitsAvx512};
+#endif
+#ifdef GEMM_HAVE_NEON_KERNELS
+static const GemmCrtKernel neonCrtKernel = {CPUIsa::NEON, crtDigitsNeon};
+#endif
+
+const GemmCrtKernel& gemmCrtKernel(CPUIsa isa) {
+    switch (isa) {
+#ifdef GEMM_HAVE_X86_KERNELS
+        case CPUIsa::AVX2: return avx2CrtKernel;
+        case CPUIsa::AVX512: return avx512CrtKernel;
+#endif
+#ifdef GEMM_HAVE_NEON_KERNELS
+        case CPUIsa::NEON: return neonCrtKernel;
+#endif
+        default: return scalarCrtKernel;
+    }
+}
+
+// Tiles as wide as the ordinary kernels of each tier: the accumulators fill
+// the same registers.
+static const GemmSemiringKernel<int> i32SemiringKernels[] = {
+    semiringKernel<int, MinPlus<int>, SemiringScalarTier, SCALAR_MR, SCALAR_NR>(CPUIsa::SCALAR),
+    semiringKernel<int, MaxPlus<int>, SemiringScalarTier, SCALAR_MR, SCALAR_NR>(CPUIsa::SCALAR),
+    semiringKernel<int, OrAnd, SemiringScalarTier, SCALAR_MR, SCALAR_NR>(CPUIsa::SCALAR),
+#ifdef GEMM_HAVE_X86_KERNELS
+    semiringKernel<int, MinPlus<int>, SemiringAvx2Tier, AVX2_MR, AVX2_NR>(CPUIsa::AVX2),
+    semiringKernel<int, MaxPlus<int>, SemiringAvx2Tier, AVX2_MR, AVX2_NR>(CPUIsa::AVX2),
+    semiringKernel<int, OrAnd, SemiringAvx2Tier, AVX2_MR, AVX2_NR>(CPUIsa::AVX2),
+    semiringKernel<int, MinPlus<int>, SemiringAvx512Tier, AVX512_MR, AVX512_NR>(CPUIsa::AVX512),
+    semiringKernel<int, MaxPlus<int>, SemiringAvx512Tier, AVX512_MR, AVX512_NR>(CPUIsa::AVX512),
+    semiringKernel<int, OrAnd, SemiringAvx512Tier, AVX512_MR, AVX512_NR>(CPUIsa::AVX512),
+#endif
+#ifdef GEMM_HAVE_NEON_KERNELS
+    semiringKernel<int, MinPlus<int>, SemiringScalarTier, NEON_MR, NEON_NR>(CPUIsa::NEON),
+    semiringKernel<int, MaxPlus<int>, SemiringScalarTier, NEON_MR, NEON_NR>(CPUIsa::NEON),
+    semiringKernel<int, OrAnd, SemiringScalarTier, NEON_MR, NEON_NR>(CPUIsa::NEON),
+#endif
+};
+
+static const GemmSemiringKernel<float> f32SemiringKernels[] = {
+    semiringKernel<float, MinPlus<float>, SemiringScalarTier, SCALAR_MR, SCALAR_NR>(CPUIsa::SCALAR),
+    semiringKernel<float, MaxPlus<float>, SemiringScalarTier, SCALAR_MR, SCALAR_NR>(CPUIsa::SCALAR),
+#ifdef GEMM_HAVE_X86_KERNELS
+    semiringKernel<float, MinPlus<float>, SemiringAvx2Tier, AVX2_MR, AVX2_F32_NR>(CPUIsa::AVX2),
+    semiringKernel<float, MaxPlus<float>, SemiringAvx2Tier, AVX2_MR, AVX2_F32_NR>(CPUIsa::AVX2),
+    semiringKernel<float, MinPlus<float>, SemiringAvx512Tier, AVX512_MR, AVX512_F32_NR>(CPUIsa::AVX512),
+    semiringKernel<float, MaxPlus<float>, SemiringAvx512Tier, AVX512_MR, AVX512_F32_NR>(CPUIsa::AVX512),
+#endif
+#ifdef GEMM_HAVE_NEON_KERNELS
+    semiringKernel<float, MinPlus<float>, SemiringScalarTier, NEON_MR, NEON_F32_NR>(CPUIsa::NEON),
+    semiringKernel<float, MaxPlus<float>, SemiringScalarTier, NEON_MR, NEON_F32_NR>(CPUIsa::NEON),
+#endif
+};
+
+static const GemmSemiringKernel<double> f64SemiringKernels[] = {
+    semiringKernel<double, MinPlus<double>, SemiringScalarTier, SCALAR_MR, SCALAR_NR>(CPUIsa::SCALAR),
+    semiringKernel<double, MaxPlus<double>, SemiringScalarTier, SCALAR_MR, SCALAR_NR>(CPUIsa::SCALAR),
+#ifdef GEMM_HAVE_X86_KERNELS
+    semiringKernel<double, MinPlus<double>, SemiringAvx2Tier, AVX2_MR, AVX2_F64_NR>(CPUIsa::AVX2),
+    semiringKernel<double, MaxPlus<double>, SemiringAvx2Tier, AVX2_MR, AVX2_F64_NR>(CPUIsa::AVX2),
+    semiringKernel<double, MinPlus<double>, SemiringAvx512Tier, AVX512_MR, AVX512_F64_NR>(CPUIsa::AVX512),
+    semiringKernel<double, MaxPlus<double>, SemiringAvx512Tier, AVX512_MR, AVX512_F64_NR>(CPUIsa::AVX512),
+#endif
+#ifdef GEMM_HAVE_NEON_KERNELS
+    semiringKernel<double, MinPlus<double>, SemiringScalarTier, NEON_MR, NEON_F64_NR>(CPUIsa::NEON),
+    semiringKernel<double, MaxPlus<double>, SemiringScalarTier, NEON_MR, NEON_F64_NR>(CPUIsa::NEON),
+#endif
+};
+
+// Tiers without an entry fall back to the scalar kernel.
+template <typename T, std::size_t N>
+static const GemmSemiringKernel<T>* findSemiringKernel(const GemmSemiringKernel<T> (&kernels)[N],
+                                                       Semiring semiring, CPUIsa isa) {
+    const GemmSemiringKernel<T>* fallback = nullptr;
+    for (const GemmSemiringKernel<T>& kernel : kernels) {
+        if (kernel.semiring != semiring) {
+            continue;
+        }
+        if (kernel.isa == isa) {
+            return &kernel;
+        }
+        if (kernel.isa == CPUIsa::SCALAR) {
+            fallback = &kernel;
+        }
+    }
+    return fallback;
+}
+
+const GemmSemiringKernel<int>* gemmI32SemiringKernel(Semiring semiring, CPUIsa isa) {
+    return findSemiringKernel(i32SemiringKernels, semiring, isa);
+}
+
+const GemmSemiringKernel<float>* gemmF32SemiringKernel(Semiring semiring, CPUIsa isa) {
+    return findSemiringKernel(f32SemiringKernels, semiring, isa);
+}
+
+const GemmSemiringKernel<double>* gemmF64SemiringKernel(Semiring semiring, CPUIsa isa) {
+    return findSemiringKernel(f64SemiringKernels, semiring, isa);
+}
+
+static const GemmNarrowKernel scalarI16Kernel =
+    {CPUIsa::SCALAR, KernelWidth::INT16, SCALAR_MR, SCALAR_NR, 1, false, false, false, microKernelScalarI16};
+#ifdef GEMM_HAVE_X86_KERNELS
+static const GemmNarrowKernel avx2I16Kernel =
+    {CPUIsa::AVX2, KernelWidth::INT16, AVX2_MR, AVX2_NR, 2, false, false, false, microKernelAvx2I16};
+static const GemmNarrowKernel avx2U8S8Kernel =
+    {CPUIsa::AVX2, KernelWidth::INT8, AVX2_MR, AVX2_NR, 4, true, true, true, microKernelAvx2I8<true>};
+static const GemmNarrowKernel avx2S8U8Kernel =
+    {CPUIsa::AVX2, KernelWidth::INT8, AVX2_MR, AVX2_NR, 4, true, false, true, microKernelAvx2I8<false>};
+static const GemmNarrowKernel avx512I16Kernel =
+    {CPUIsa::AVX512, KernelWidth::INT16, AVX512_MR, AVX512_NR, 2, false, false, false, microKernelAvx512I16};
+static const GemmNarrowKernel avx512U8S8Kernel =
+    {CPUIsa::AVX512, KernelWidth::INT8, AVX512_MR, AVX512_NR, 4, true, true, false, microKernelAvx512Vnni<true>};
+static const GemmNarrowKernel avx512S8U8Kernel =
+    {CPUIsa::AVX512, KernelWidth::INT8, AVX512_MR, AVX512_NR, 4, true, false, false, microKernelAvx512Vnni<false>};
+#endif
+#ifdef GEMM_HAVE_NEON_KERNELS
+static const GemmNarrowKernel neonI16Kernel =
+    {CPUIsa::NEON, KernelWidth::INT16, NEON_MR, NEON_NR, 1, false, false, false, microKernelNeonI16};
+#ifdef GEMM_HAVE_NEON_DOTPROD_KERNELS
+static const GemmNarrowKernel neonS8Kernel =
+    {CPUIsa::NEON, KernelWidth::INT8, NEON_MR, NEON_NR, 4, false, false, false, microKernelNeonDot};
+#endif
+#endif
+
+std::vector<const GemmNarrowKernel*> gemmNarrowKernels(KernelWidth width, CPUIsa isa, const CPUFeatures& features) {
+    std::vector<const GemmNarrowKernel*> kernels;
+#ifdef GEMM_HAVE_X86_KERNELS
+    bool x86Vector = isa == CPUIsa::AVX2 || isa == CPUIsa::AVX512;
+    if (width == KernelWidth::INT16) {
+        if (isa == CPUIsa::AVX512 && features.avx512bw) kernels.push_back(&avx512I16Kernel);
+        if (x86Vector && features.avx2) kernels.push_back(&avx2I16Kernel);
+    } else if (width == KernelWidth::INT8) {
+        if (isa == CPUIsa::AVX512 && features.avx512vnni) {
+            kernels.push_back(&avx512U8S8Kernel);
+            kernels.push_back(&avx512S8U8Kernel);
+        }
+        if (x86Vector && features.avx2) {
+            kernels.push_back(&avx2U8S8Kernel);
+            kernels.push_back(&avx2S8U8Kernel);
+        }
+    }
+#endif
+#ifdef GEMM_HAVE_NEON_KERNELS
+    if (isa == CPUIsa::NEON && width == KernelWidth::INT16) kernels.push_back(&neonI16Kernel);
+#ifdef GEMM_HAVE_NEON_DOTPROD_KERNELS
+    if (isa == CPUIsa::NEON && width == KernelWidth::INT8 && features.dotprod) kernels.push_back(&neonS8Kernel);
+#endif
+#endif
+    if (width == KernelWidth::INT16) {
+        kernels.push_back(&scalarI16Kernel);
+    }
+    return kernels;
+}
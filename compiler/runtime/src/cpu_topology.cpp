@@ -0,0 +1,243 @@
+#include "cpu_topology.h"
+#include <algorithm>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <map>
+#include <sstream>
+#if defined(__linux__)
+#include <pthread.h>
+#include <sched.h>
+#endif
+
+#if defined(__linux__)
+static std::string readFirstLine(const std::string& path) {
+    std::ifstream file(path);
+    std::string line;
+    std::getline(file, line);
+    return line;
+}
+
+// sysfs CPU lists such as "0-3,8,10-11".
+static std::vector<int> parseCPUList(const std::string& text) {
+    std::vector<int> cpus;
+    std::stringstream stream(text);
+    std::string range;
+    while (std::getline(stream, range, ',')) {
+        size_t dash = range.find('-');
+        try {
+            int first = std::stoi(range.substr(0, dash));
+            int last = dash == std::string::npos ? first : std::stoi(range.substr(dash + 1));
+            for (int cpu = first; cpu <= last; cpu++) {
+                cpus.push_back(cpu);
+            }
+        } catch (...) {
+        }
+    }
+    return cpus;
+}
+
+// Index of key in keys, appending it when new.
+static int groupIndex(std::map<std::string, int>& keys, const std::string& key) {
+    auto it = keys.find(key);
+    if (it != keys.end()) {
+        return it->second;
+    }
+    int index = static_cast<int>(keys.size());
+    keys[key] = index;
+    return index;
+}
+#endif
+
+CPUTopology detectCPUTopology() {
+    CPUTopology topology;
+#if defined(__linux__)
+    const std::string root = "/sys/devices/system/cpu/";
+    std::vector<int> online = parseCPUList(readFirstLine(root + "online"));
+    cpu_set_t allowed;
+    CPU_ZERO(&allowed);
+    bool masked = sched_getaffinity(0, sizeof(allowed), &allowed) == 0;
+    std::map<std::string, int> packageKeys, coreKeys, cacheKeys;
+    std::map<int, int> siblingsSeen;
+    for (int id : online) {
+        if (masked && (id >= CPU_SETSIZE || !CPU_ISSET(id, &allowed))) {
+            continue;
+        }
+        std::string dir = root + "cpu" + std::to_string(id) + "/";
+        std::string package = readFirstLine(dir + "topology/physical_package_id");
+        if (package.empty() || package == "-1") {
+            package = "0";
+        }
+        std::string siblings = readFirstLine(dir + "topology/core_cpus_list");
+        if (siblings.empty()) {
+            siblings = readFirstLine(dir + "topology/thread_siblings_list");
+        }
+        if (siblings.empty()) {
+            siblings = std::to_string(id);
+        }
+        // The highest cache level listed is the shared last-level cache.
+        std::string cacheKey = "package " + package;
+        int cacheLevel = 0;
+        for (int index = 0; index < 8; index++) {
+            std::string cacheDir = dir + "cache/index" + std::to_string(index) + "/";
+            std::string level = readFirstLine(cacheDir + "level");
+            if (level.empty()) {
+                break;
+            }
+            std::string shared = readFirstLine(cacheDir + "shared_cpu_list");
+            int value = std::atoi(level.c_str());
+            if (value >= cacheLevel && !shared.empty()) {
+                cacheLevel = value;
+                cacheKey = "L" + level + " " + shared;
+            }
+        }
+        LogicalCPU cpu;
+        cpu.id = id;
+        cpu.package = groupIndex(packageKeys, package);
+        cpu.core = groupIndex(coreKeys, package + "/" + siblings);
+        cpu.cacheGroup = groupIndex(cacheKeys, cacheKey);
+        cpu.smtIndex = siblingsSeen[cpu.core]++;
+        topology.cpus.push_back(cpu);
+    }
+    topology.packages = static_cast<int>(packageKeys.size());
+    topology.cores = static_cast<int>(coreKeys.size());
+    topology.cacheGroups = static_cast<int>(cacheKeys.size());
+#endif
+    return topology;
+}
+
+AffinityPolicy affinityPolicyFromEnv() {
+    AffinityPolicy policy;
+    const char* affinityEnv = std::getenv("CPU_AFFINITY");
+    if (affinityEnv != nullptr) {
+        std::string value = affinityEnv;
+        if (value == "none") {
+            policy.pin = false;
+        } else if (value == "compact") {
+            policy.spread = false;
+        } else if (value != "spread") {
+            std::cout << "WARNING: Unknown CPU_AFFINITY value '" << value << "', using spread" << std::endl;
+        }
+    }
+    const char* smtEnv = std::getenv("CPU_SMT");
+    policy.smt = smtEnv != nullptr && std::string(smtEnv) == "1";
+    return policy;
+}
+
+// One item from each list in turn until all are used up.
+static std::vector<int> roundRobin(const std::vector<std::vector<int>>& lists) {
+    std::vector<int> merged;
+    for (size_t i = 0;; i++) {
+        bool any = false;
+        for (const auto& list : lists) {
+            if (i < list.size()) {
+                merged.push_back(list[i]);
+                any = true;
+            }
+        }
+        if (!any) {
+            return merged;
+        }
+    }
+}
+
+std::vector<int> affinityOrder(const CPUTopology& topology, const AffinityPolicy& policy) {
+    if (!policy.pin || !topology.known()) {
+        return {};
+    }
+    // Siblings of each core by smtIndex; cpus are listed in id order.
+    std::vector<std::vector<int>> siblings(topology.cores);
+    std::vector<const LogicalCPU*> first(topology.cores, nullptr);
+    for (const LogicalCPU& cpu : topology.cpus) {
+        siblings[cpu.core].push_back(cpu.id);
+        if (!first[cpu.core]) {
+            first[cpu.core] = &cpu;
+        }
+    }
+    std::vector<int> cores;
+    if (policy.spread) {
+        // Cores of each cache group, groups of each package, then packages,
+        // each level dealt out round-robin.
+        std::vector<std::vector<std::vector<int>>> byPackage(topology.packages,
+            std::vector<std::vector<int>>(topology.cacheGroups));
+        for (int core = 0; core < topology.cores; core++) {
+            byPackage[first[core]->package][first[core]->cacheGroup].push_back(core);
+        }
+        std::vector<std::vector<int>> packageCores;
+        for (const auto& groups : byPackage) {
+            packageCores.push_back(roundRobin(groups));
+        }
+        cores = roundRobin(packageCores);
+    } else {
+        for (int core = 0; core < topology.cores; core++) {
+            cores.push_back(core);
+        }
+        std::stable_sort(cores.begin(), cores.end(), [&first](int x, int y) {
+            return std::make_pair(first[x]->package, first[x]->cacheGroup) <
+                   std::make_pair(first[y]->package, first[y]->cacheGroup);
+        });
+    }
+    std::vector<int> order;
+    if (policy.smt && !policy.spread) {
+        for (int core : cores) {
+            order.insert(order.end(), siblings[core].begin(), siblings[core].end());
+        }
+        return order;
+    }
+    // First siblings of every core, then second siblings, and so on.
+    for (size_t level = 0; order.size() < topology.cpus.size(); level++) {
+        for (int core : cores) {
+            if (level < siblings[core].size()) {
+                order.push_back(siblings[core][level]);
+            }
+        }
+    }
+    return order;
+}
+
+int defaultWorkerCount(const CPUTopology& topology, const AffinityPolicy& policy) {
+    return policy.smt ? static_cast<int>(topology.cpus.size()) : topology.cores;
+}
+
+bool pinCurrentThread(int cpu) {
+#if defined(__linux__)
+    if (cpu < 0 || cpu >= CPU_SETSIZE) {
+        return false;
+    }
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    CPU_SET(cpu, &set);
+    return pthread_setaffinity_np(pthread_self(), sizeof(set), &set) == 0;
+#else
+    (void)cpu;
+    return false;
+#endif
+}
+
+ScopedCpuPin::ScopedCpuPin(int cpu) {
+#if defined(__linux__)
+    CPU_ZERO(&saved);
+    if (pthread_getaffinity_np(pthread_self(), sizeof(saved), &saved) == 0) {
+        pinned = pinCurrentThread(cpu);
+    }
+#else
+    (void)cpu;
+#endif
+}
+
+ScopedCpuPin::~ScopedCpuPin() {
+#if defined(__linux__)
+    if (pinned) {
+        pthread_setaffinity_np(pthread_self(), sizeof(saved), &saved);
+    }
+#endif
+}
+
+std::string describeTopology(const CPUTopology& topology) {
+    std::ostringstream text;
+    text << topology.packages << (topology.packages == 1 ? " package, " : " packages, ")
+         << topology.cores << (topology.cores == 1 ? " core, " : " cores, ")
+         << topology.cpus.size() << (topology.cpus.size() == 1 ? " logical CPU, " : " logical CPUs, ")
+         << topology.cacheGroups << (topology.cacheGroups == 1 ? " last-level cache group" : " last-level cache groups");
+    return text.str();
+}
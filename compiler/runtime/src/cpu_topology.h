@@ -0,0 +1,73 @@
+#pragma once
+#include <string>
+#include <vector>
+#if defined(__linux__)
+#include <sched.h>
+#endif
+
+// One logical CPU the process may run on, numbered as the OS numbers it.
+struct LogicalCPU {
+    int id;
+    int package;
+    // Index of its physical core in the topology, shared by SMT siblings.
+    int core;
+    // Index of the group of CPUs sharing its last-level cache.
+    int cacheGroup;
+    // 0 for the lowest-numbered sibling of its core, 1 for the next, ...
+    int smtIndex;
+};
+
+// Read from /sys/devices/system/cpu on Linux, restricted to the online CPUs
+// in the process's affinity mask. Empty elsewhere.
+struct CPUTopology {
+    std::vector<LogicalCPU> cpus;
+    int packages = 0;
+    int cores = 0;
+    int cacheGroups = 0;
+    bool known() const { return !cpus.empty(); }
+};
+
+// Where workers go. spread deals cores out round-robin over packages and
+// then over last-level cache groups; compact fills one cache group, then one
+// package, before the next. Without smt only the first sibling of each core
+// is used, until there are more workers than cores.
+struct AffinityPolicy {
+    bool pin = true;
+    bool smt = false;
+    bool spread = true;
+};
+
+CPUTopology detectCPUTopology();
+
+// CPU_AFFINITY=spread|compact|none and CPU_SMT=1.
+AffinityPolicy affinityPolicyFromEnv();
+
+// Logical CPUs in the order workers take them: worker i runs on entry
+// i % size. Empty when the topology is unknown or pinning is off.
+std::vector<int> affinityOrder(const CPUTopology& topology, const AffinityPolicy& policy);
+
+// Workers the policy uses by default: one per core, or one per logical CPU
+// with smt. 0 when the topology is unknown.
+int defaultWorkerCount(const CPUTopology& topology, const AffinityPolicy& policy);
+
+// Binds the calling thread to one logical CPU. False where the OS has no
+// hard affinity (macOS) or the call fails.
+bool pinCurrentThread(int cpu);
+
+// Pins the calling thread to one logical CPU while in scope, then gives it
+// back the affinity it had before.
+class ScopedCpuPin {
+public:
+    explicit ScopedCpuPin(int cpu);
+    ~ScopedCpuPin();
+    ScopedCpuPin(const ScopedCpuPin&) = delete;
+    ScopedCpuPin& operator=(const ScopedCpuPin&) = delete;
+private:
+#if defined(__linux__)
+    cpu_set_t saved;
+#endif
+    bool pinned = false;
+};
+
+// e.g. "2 packages, 32 cores, 64 logical CPUs, 4 last-level cache groups".
+std::string describeTopology(const CPUTopology& topology);
@@ -1,81 +1,245 @@
 #include "device_manager.h"
 #include <algorithm>
+#include <chrono>
+#include <cmath>
 #include <iostream>
 #include <iomanip>  
-#include <thread>
 #include <string>
+#include <cstdlib>
+#include <stdexcept>
+#include "strassen.h"
+#include "sparse.h"
+
+constexpr int DEFAULT_STRASSEN_CUTOFF = 1024;
+// Scattered sparse multiply-adds run roughly 50x slower than the packed dense
+// kernels, so the sparse path is taken once density(A) * density(B), the
+// fraction of dense work Gustavson performs, drops below 2%.
+constexpr double DEFAULT_SPARSE_THRESHOLD = 0.02;
+constexpr int SPARSE_TARGET_BANDS = 64;
 
 DeviceManager::DeviceManager()
     : cpuExecutor(std::make_shared<CPUExecutor>())
     , gpuExecutor(std::make_shared<GPUExecutor>())
     , aneExecutor(std::make_shared<ANEExecutor>())
     , scheduler(std::make_shared<WorkScheduler>())
-    , profiler(std::make_shared<Profiler>()) {
+    , profiler(std::make_shared<Profiler>())
+    , strassenCutoff(0)
+    , sparseThreshold(DEFAULT_SPARSE_THRESHOLD)
+    , bitMatrices(true)
+    , saveThroughput(false) {
 }
 
 DeviceManager::~DeviceManager() {
+    if (saveThroughput && planner.changed() && !planner.save(tuningFile, hostKey)) {
+        std::cout << "WARNING: Could not save throughput models to " << tuningFile << std::endl;
+    }
 }
 
 void DeviceManager::initialize() {
     cpuExecutor->initialize();
+    // The calling thread is worker 0 of every job.
+    workerPool = std::make_shared<WorkerPool>(cpuExecutor->threadCount() - 1, cpuExecutor->workerCpus());
+    cpuExecutor->setWorkerPool(workerPool);
     gpuExecutor->initialize();
     aneExecutor->initialize();
     scheduler->setProfiler(profiler);
-    scheduler->initialize();
+    const char* strassenEnv = std::getenv("STRASSEN");
+    const char* cutoffEnv = std::getenv("STRASSEN_CUTOFF");
+    if (strassenEnv != nullptr || cutoffEnv != nullptr) {
+        strassenCutoff = DEFAULT_STRASSEN_CUTOFF;
+        if (cutoffEnv != nullptr) {
+            try {
+                strassenCutoff = std::stoi(cutoffEnv);
+            } catch (...) {
+                std::cout << "WARNING: Invalid STRASSEN_CUTOFF value, using default "
+                          << DEFAULT_STRASSEN_CUTOFF << std::endl;
+            }
+        }
+        if (strassenCutoff < 16) {
+            std::cout << "WARNING: STRASSEN_CUTOFF below 16 is not useful, using 16" << std::endl;
+            strassenCutoff = 16;
+        }
+        std::cout << "DEBUG: Strassen-Winograd mode enabled with cutoff " << strassenCutoff << std::endl;
+    }
+    const char* sparseEnv = std::getenv("SPARSE_THRESHOLD");
+    if (sparseEnv != nullptr) {
+        try {
+            sparseThreshold = std::stod(sparseEnv);
+        } catch (...) {
+            std::cout << "WARNING: Invalid SPARSE_THRESHOLD value, using default "
+                      << DEFAULT_SPARSE_THRESHOLD << std::endl;
+        }
+    }
+    std::cout << "DEBUG: Sparse path threshold " << sparseThreshold
+              << (sparseThreshold > 0.0 ? "" : " (disabled)") << std::endl;
+    const char* bitEnv = std::getenv("BIT_MATRIX");
+    if (bitEnv != nullptr && std::string(bitEnv) == "0") {
+        bitMatrices = false;
+        std::cout << "DEBUG: Bit-packed 0/1 multiplies disabled" << std::endl;
+    }
+    tuningFile = defaultTuningFile();
+    hostKey = hostTuningKey();
+    tuning = loadTuningTable(tuningFile, hostKey);
+    if (tuning.empty()) {
+        std::cout << "DEBUG: No tuning data for '" << hostKey << "' in " << tuningFile
+                  << ", using built-in block sizes (run 'runtime --tune' to measure)" << std::endl;
+    } else {
+        std::cout << "DEBUG: Loaded " << tuning.points().size() << " tuning points for '" << hostKey
+                  << "' from " << tuningFile << std::endl;
+    }
+    planner.load(tuningFile, hostKey);
+    const char* saveEnv = std::getenv("SAVE_THROUGHPUT");
+    saveThroughput = saveEnv != nullptr && std::string(saveEnv) == "1";
+    std::cout << "DEBUG: Throughput models " << (saveThroughput ? "will be" : "are not")
+              << " saved to " << tuningFile << " on exit" << std::endl;
 }
 
 void DeviceManager::executeMatrixMultiplication(
     MatrixBuffer* a,
     MatrixBuffer* b,
-    MatrixBuffer* result) {
+    MatrixBuffer* result,
+    const MatrixEpilogue* epilogue) {
     std::cout << "DEBUG: Starting device manager matrix multiplication" << std::endl;
     profiler->startTimer("total_execution");
-    int matrixSize = a->size;
-    std::cout << "DEBUG: Matrix size: " << matrixSize << "x" << matrixSize << std::endl;
-    if (matrixSize >= 1024) {
+    int m = a->rows;
+    int k = a->cols;
+    int n = b->cols;
+    // Tuning data and chunk sizes are keyed by the side of the square multiply
+    // with the same number of multiply-adds.
+    int matrixSize = std::max(1, static_cast<int>(std::lround(std::cbrt(static_cast<double>(m) * n * k))));
+    std::cout << "DEBUG: Matrix shape: " << m << "x" << k << " * " << k << "x" << n
+              << " (equivalent size " << matrixSize << ")" << std::endl;
+    if (a->layout != b->layout || a->layout != result->layout) {
+        throw std::runtime_error("Matrix layouts differ in multiplication");
+    }
+    // Fused epilogues run in the blocked CPU kernels only; the Metal kernel,
+    // Strassen, SpGEMM and the fixed-size kernels all overwrite C directly.
+    bool fused = epilogue && !epilogue->trivial();
+    if (fused && a->layout == MatrixLayout::MORTON) {
+        throw std::runtime_error("Fused GEMM epilogues need a row-major or tiled layout");
+    }
+    if (a->layout == MatrixLayout::MORTON) {
+        executeMorton(a, b, result);
+        profiler->stopTimer("total_execution");
+        profiler->printReport();
+        std::cout << "DEBUG: Matrix multiplication completed" << std::endl;
+        return;
+    }
+    // Tiled chunks follow the result tiles and read whole A row panels and B
+    // column panels, so the operands' tiles must span the inner dimension.
+    bool tiled = a->layout == MatrixLayout::TILED;
+    if (tiled && (a->tileWidth < k || b->tileHeight < k)) {
+        throw std::runtime_error("Tiled operands must span the inner dimension");
+    }
+    if (tiled && fused) {
+        for (const MatrixEpilogue::Step& step : epilogue->steps) {
+            if (step.matrix && (step.matrix->tileWidth != result->tileWidth ||
+                                (step.kind != PostOpKind::BIAS && step.matrix->tileHeight != result->tileHeight))) {
+                throw std::runtime_error("Tiled epilogue operands must share the result's tiles");
+            }
+        }
+    }
+    cpuExecutor->setEpilogue(epilogue);
+    int tunedChunk = 0;
+    if (!tuning.empty()) {
+        TuningPoint tuned = tuning.lookup(matrixSize);
+        tunedChunk = tuned.chunkSize;
+        cpuExecutor->configure(tuned.blocking, tuned.isa, tuned.threads);
+        std::cout << "DEBUG: Tuned parameters for size " << matrixSize << ": chunk " << tuned.chunkSize
+                  << ", MC=" << tuned.blocking.mc << " KC=" << tuned.blocking.kc << " NC=" << tuned.blocking.nc
+                  << ", " << isaToString(tuned.isa) << ", " << tuned.threads << " threads" << std::endl;
+    }
+    // Shapes with a compile-time specialization finish in less time than it
+    // takes to start the device threads, so they run here directly.
+    auto fixedStart = std::chrono::steady_clock::now();
+    if (cpuExecutor->executeFixed(a, b, result)) {
+        double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - fixedStart).count();
+        std::cout << "DEBUG: Ran fixed-size kernel on the calling thread" << std::endl;
+        profiler->recordMetric("Fixed-size kernel time", seconds * 1e6, "us");
+        profiler->stopTimer("total_execution");
+        profiler->printReport();
+        std::cout << "DEBUG: Matrix multiplication completed" << std::endl;
+        return;
+    }
+    double sparseWork = a->density() * b->density();
+    if (!tiled && !fused && sparseWork < sparseThreshold) {
+        std::cout << "DEBUG: Densities " << a->density() << " x " << b->density()
+                  << " below sparse threshold, using CSR SpGEMM" << std::endl;
+        executeSparse(a, b, result);
+        profiler->stopTimer("total_execution");
+        profiler->printReport();
+        std::cout << "DEBUG: Matrix multiplication completed" << std::endl;
+        return;
+    }
+    // One AND+POPCNT covers 64 multiply-adds, ahead of every dense int path.
+    if (!tiled && !fused && bitMatrixOperands(a, b)) {
+        std::cout << "DEBUG: 0/1 operands, using bit-packed multiply" << std::endl;
+        executeBitMatrix(a, b, result, false);
+        profiler->stopTimer("total_execution");
+        profiler->printReport();
+        std::cout << "DEBUG: Matrix multiplication completed" << std::endl;
+        return;
+    }
+    bool square = m == k && k == n;
+    int strassenDepth = a->dtype == DType::I32 && square ? StrassenWinograd::recursionDepth(n, strassenCutoff) : 0;
+    if (tiled || fused) {
+        strassenDepth = 0;
+    }
+    if (strassenDepth > 0) {
+        executeStrassen(a, b, result, strassenDepth);
+        profiler->stopTimer("total_execution");
+        profiler->printReport();
+        std::cout << "DEBUG: Matrix multiplication completed" << std::endl;
+        return;
+    }
+    if (matrixSize >= 1024 && a->dtype == DType::I32) {
         int* aData = a->getCPUReadPtr();
         int* bData = b->getCPUReadPtr();
         std::cout << "DEBUG: Matrix A (first few elements): ";
-        for (int i = 0; i < std::min(5, matrixSize); i++) {
+        for (int i = 0; i < std::min(5, k); i++) {
             std::cout << aData[i] << " ";
         }
         std::cout << std::endl;
         std::cout << "DEBUG: Matrix B (first few elements): ";
-        for (int i = 0; i < std::min(5, matrixSize); i++) {
+        for (int i = 0; i < std::min(5, n); i++) {
             std::cout << bData[i] << " ";
         }
         std::cout << std::endl;
         a->releaseCPUAccess();
         b->releaseCPUAccess();
     }
-    int blockSize = 64;  
-    if (matrixSize <= 128) {
-        blockSize = 32;
-        if (matrixSize % blockSize != 0) {
-            while (matrixSize % blockSize != 0 && blockSize > 8) {
-                blockSize -= 4;
-            }
-        }
-        std::cout << "DEBUG: Using block size: " << blockSize 
-                  << " for medium matrix multiplication" << std::endl;
-    } 
-    else if (matrixSize >= 2048) blockSize = 128;  
-    else if (matrixSize >= 1024) blockSize = 128;  
-    else if (matrixSize >= 512) blockSize = 96;    
-    else if (matrixSize >= 256) blockSize = 64;    
-    else blockSize = 64;
-    std::cout << "DEBUG: Using block size: " << blockSize << std::endl;
-    std::vector<WorkChunk> chunks;
-    for (int i = 0; i < matrixSize; i += blockSize) {
-        for (int j = 0; j < matrixSize; j += blockSize) {
-            int endRow = std::min(i + blockSize, matrixSize);
-            int endCol = std::min(j + blockSize, matrixSize);
-            chunks.emplace_back(i, endRow, j, endCol);
-        }
+    int blockSize = tunedChunk > 0 ? std::min(tunedChunk, matrixSize) : defaultChunkSize(matrixSize);
+    // Chunks keep about blockSize^2 result cells: when one side of the result
+    // is shorter than blockSize they stretch along the other, with column
+    // breaks kept on multiples of 16 so CPU chunks reuse the packed B panels.
+    int blockRows = std::min(blockSize, m);
+    int blockCols = std::min(blockSize, n);
+    if (blockRows < blockSize) {
+        blockCols = std::min(n, std::max(16, blockSize * blockSize / blockRows / 16 * 16));
+    } else if (blockCols < blockSize) {
+        blockRows = std::min(m, blockSize * blockSize / blockCols);
+    }
+    if (tiled) {
+        blockRows = result->tileHeight;
+        blockCols = result->tileWidth;
     }
+    std::cout << "DEBUG: Using block size: " << blockRows << "x" << blockCols << std::endl;
+    std::vector<WorkChunk> chunks = createWorkChunks(m, n, blockRows, blockCols);
     std::cout << "DEBUG: Created " << chunks.size() << " work chunks" << std::endl;
-    std::vector<WorkChunk> cpuWork, gpuWork, aneWork;
-    partitionWork(chunks, cpuWork, gpuWork, aneWork);
+    cpuExecutor->prepare(a, b, scheduler, profiler);
+    // Each dtype, operand width and epilogue runs at its own rate.
+    ThroughputKind kind{a->dtype, cpuExecutor->operandWidth(), fused};
+    // The Metal kernel indexes its operands row-major and has no epilogue.
+    bool gpuSupported = gpuExecutor->supports(a->dtype) && !tiled && !fused;
+    scheduler->setGPUEnabled(gpuSupported);
+    if (!gpuSupported) {
+        std::cout << "DEBUG: GPU cannot run " << dtypeToString(a->dtype) << " " << layoutToString(a->layout)
+                  << (fused ? " fused" : "") << " multiplies, planning for the CPU only" << std::endl;
+    }
+    PartitionPlan plan = partitionWork(chunks, kind, blockRows, blockCols, k, gpuSupported);
+    std::vector<WorkChunk>& cpuWork = plan.work[static_cast<int>(DeviceType::CPU)];
+    std::vector<WorkChunk>& gpuWork = plan.work[static_cast<int>(DeviceType::GPU)];
+    std::vector<WorkChunk>& aneWork = plan.work[static_cast<int>(DeviceType::ANE)];
     std::cout << "DEBUG: Work distribution - CPU: " << cpuWork.size() 
               << ", GPU: " << gpuWork.size() 
               << ", ANE: " << aneWork.size() << std::endl;
@@ -86,32 +250,14 @@ void DeviceManager::executeMatrixMultiplication(
     scheduler->addWork(cpuWork, DeviceType::CPU);
     scheduler->addWork(gpuWork, DeviceType::GPU);
     scheduler->addWork(aneWork, DeviceType::ANE);
-    std::cout << "DEBUG: Starting device executor threads" << std::endl;
-    std::thread cpuThread([this, a, b, result]() {
-        std::cout << "DEBUG: Starting CPU execution thread" << std::endl;
-        bool hasWork = false;
-        {
-            auto& queue = scheduler->getQueue(DeviceType::CPU);
-            std::lock_guard lock(queue.mutex);
-            hasWork = !queue.queue.empty();
-        }
-        if (hasWork) {
-            profiler->startTimer("cpu_execution");
-            cpuExecutor->execute(a, b, result, scheduler, profiler);
-            profiler->stopTimer("cpu_execution");
-        } else {
-            cpuExecutor->execute(a, b, result, scheduler, profiler);
-            profiler->recordZeroTime("cpu_execution");
-        }
-    });
-    std::thread gpuThread([this, a, b, result]() {
+    // The GPU executor runs on its long-lived device thread; the no-op ANE
+    // executor and then the CPU one, on the pool, run on this thread.
+    std::cout << "DEBUG: Starting device executors" << std::endl;
+    scheduler->resetProgress();
+    auto executionStart = std::chrono::steady_clock::now();
+    gpuThread.start([this, a, b, result]() {
         std::cout << "DEBUG: Starting GPU execution thread" << std::endl;
-        bool hasWork = false;
-        {
-            auto& queue = scheduler->getQueue(DeviceType::GPU);
-            std::lock_guard lock(queue.mutex);
-            hasWork = !queue.queue.empty();
-        }
+        bool hasWork = scheduler->hasWork(DeviceType::GPU);
         if (hasWork) {
             profiler->startTimer("gpu_execution");
             gpuExecutor->execute(a, b, result, scheduler, profiler);
@@ -120,15 +266,11 @@ void DeviceManager::executeMatrixMultiplication(
             gpuExecutor->execute(a, b, result, scheduler, profiler);
             profiler->recordZeroTime("gpu_execution");
         }
+        scheduler->retire(DeviceType::GPU);
     });
-    std::thread aneThread([this, a, b, result]() {
-        std::cout << "DEBUG: Starting ANE execution thread" << std::endl;
-        bool hasWork = false;
-        {
-            auto& queue = scheduler->getQueue(DeviceType::ANE);
-            std::lock_guard lock(queue.mutex);
-            hasWork = !queue.queue.empty();
-        }
+    {
+        std::cout << "DEBUG: Starting ANE execution" << std::endl;
+        bool hasWork = scheduler->hasWork(DeviceType::ANE);
         if (hasWork) {
             profiler->startTimer("ane_execution");
             aneExecutor->execute(a, b, result, scheduler, profiler);
@@ -137,31 +279,43 @@ void DeviceManager::executeMatrixMultiplication(
             aneExecutor->execute(a, b, result, scheduler, profiler);
             profiler->recordZeroTime("ane_execution");
         }
-    });
-    std::cout << "DEBUG: Waiting for device threads to complete" << std::endl;
-    cpuThread.join();
-    scheduler->cpuThreadExited = true;
+        scheduler->retire(DeviceType::ANE);
+    }
+    {
+        std::cout << "DEBUG: Starting CPU execution" << std::endl;
+        bool hasWork = scheduler->hasWork(DeviceType::CPU);
+        if (hasWork) {
+            profiler->startTimer("cpu_execution");
+            cpuExecutor->execute(a, b, result, scheduler, profiler);
+            profiler->stopTimer("cpu_execution");
+        } else {
+            cpuExecutor->execute(a, b, result, scheduler, profiler);
+            profiler->recordZeroTime("cpu_execution");
+        }
+    }
+    std::cout << "DEBUG: Waiting for the GPU executor to complete" << std::endl;
     gpuThread.join();
-    scheduler->gpuThreadExited = true;
-    aneThread.join();
-    scheduler->aneThreadExited = true;
+    cpuExecutor->releasePackedB();
+    cpuExecutor->setEpilogue(nullptr);
     std::cout << "DEBUG: All execution threads joined, waiting for completion" << std::endl;
     waitForCompletion();
+    recordDeviceFinish(plan, executionStart, kind, blockRows, blockCols, k);
     profiler->stopTimer("total_execution");
     profiler->printReport();
 
-    if (a->size >= 1024) {
+    if (matrixSize >= 1024 && a->dtype == DType::I32) {
         int* resultData = result->getCPUReadPtr();
         std::cout << "DEBUG: Result matrix (first few elements): ";
-        for (int i = 0; i < std::min(5, a->size); i++) {
+        for (int i = 0; i < std::min(5, n); i++) {
             std::cout << resultData[i] << " ";
         }
         std::cout << std::endl;
         int nonZeroCount = 0;
         int totalChecked = 0;
+        size_t resultCells = static_cast<size_t>(m) * result->ld;
         for (int region = 0; region < 4; region++) {
-            int startIdx = (a->size * a->size / 4) * region;
-            for (int i = 0; i < 10 && (startIdx + i) < (a->size * a->size); i++) {
+            size_t startIdx = (resultCells / 4) * region;
+            for (size_t i = 0; i < 10 && (startIdx + i) < resultCells; i++) {
                 if (resultData[startIdx + i] != 0) {
                     nonZeroCount++;
                 }
@@ -178,6 +332,328 @@ void DeviceManager::executeMatrixMultiplication(
     std::cout << "DEBUG: Matrix multiplication completed" << std::endl;
 }
 
+void DeviceManager::executeBatchedMultiplication(
+    MatrixBuffer* a,
+    MatrixBuffer* b,
+    MatrixBuffer* result) {
+    profiler->startTimer("batched_execution");
+    auto start = std::chrono::steady_clock::now();
+    cpuExecutor->executeBatched(a, b, result, scheduler, profiler);
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    profiler->stopTimer("batched_execution");
+    double multiplyAdds = static_cast<double>(a->batch) * a->rows * a->cols * b->cols;
+    profiler->recordMetric("Batched multiplies", a->batch, "");
+    profiler->recordMetric("Batched time per multiply", seconds * 1e6 / a->batch, "us");
+    if (seconds > 0.0) {
+        profiler->recordMetric("Batched GEMM rate", 2.0 * multiplyAdds / seconds / 1e9, "GOPS");
+    }
+    profiler->printReport();
+}
+
+std::vector<WorkChunk> DeviceManager::cpuOnlyChunks(int m, int n, int k) {
+    int matrixSize = std::max(1, static_cast<int>(std::lround(std::cbrt(static_cast<double>(m) * n * k))));
+    int tunedChunk = 0;
+    if (!tuning.empty()) {
+        TuningPoint tuned = tuning.lookup(matrixSize);
+        tunedChunk = tuned.chunkSize;
+        cpuExecutor->configure(tuned.blocking, tuned.isa, tuned.threads);
+    }
+    int blockSize = tunedChunk > 0 ? std::min(tunedChunk, matrixSize) : defaultChunkSize(matrixSize);
+    return createWorkChunks(m, n, blockSize, blockSize);
+}
+
+void DeviceManager::executeModularMultiplication(
+    MatrixBuffer* a,
+    MatrixBuffer* b,
+    MatrixBuffer* result,
+    uint32_t modulus) {
+    int m = a->rows;
+    int k = a->cols;
+    int n = b->cols;
+    std::vector<WorkChunk> chunks = cpuOnlyChunks(m, n, k);
+    auto start = std::chrono::steady_clock::now();
+    profiler->startTimer("modular_execution");
+    cpuExecutor->executeModular(a, b, result, modulus, chunks, scheduler, profiler);
+    profiler->stopTimer("modular_execution");
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    if (seconds > 0.0) {
+        double operations = 2.0 * m * static_cast<double>(n) * k;
+        profiler->recordMetric("Modular GEMM rate", operations / seconds / 1e9, "GOPS");
+    }
+    profiler->printReport();
+}
+
+void DeviceManager::executeExactMultiplication(
+    MatrixBuffer* a,
+    MatrixBuffer* b,
+    MatrixBuffer* result,
+    unsigned __int128 bound) {
+    int m = a->rows;
+    int k = a->cols;
+    int n = b->cols;
+    std::vector<WorkChunk> chunks = cpuOnlyChunks(m, n, k);
+    auto start = std::chrono::steady_clock::now();
+    profiler->startTimer("exact_execution");
+    cpuExecutor->executeExact(a, b, result, bound, chunks, scheduler, profiler);
+    profiler->stopTimer("exact_execution");
+    profiler->recordMetric("Exact CRT primes", gemmCrtPrimeCount(bound), "");
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    if (seconds > 0.0) {
+        double operations = 2.0 * m * static_cast<double>(n) * k;
+        profiler->recordMetric("Exact GEMM rate", operations / seconds / 1e9, "GOPS");
+    }
+    profiler->printReport();
+}
+
+void DeviceManager::executeSemiringMultiplication(
+    MatrixBuffer* a,
+    MatrixBuffer* b,
+    MatrixBuffer* result,
+    Semiring semiring) {
+    int m = a->rows;
+    int k = a->cols;
+    int n = b->cols;
+    if (semiring == Semiring::OR_AND && bitMatrixOperands(a, b)) {
+        std::cout << "DEBUG: 0/1 operands, using bit-packed or-and multiply" << std::endl;
+        executeBitMatrix(a, b, result, true);
+        profiler->printReport();
+        return;
+    }
+    std::vector<WorkChunk> chunks = cpuOnlyChunks(m, n, k);
+    auto start = std::chrono::steady_clock::now();
+    profiler->startTimer("semiring_execution");
+    cpuExecutor->executeSemiring(a, b, result, semiring, chunks, scheduler, profiler);
+    profiler->stopTimer("semiring_execution");
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    if (seconds > 0.0) {
+        double operations = 2.0 * m * static_cast<double>(n) * k;
+        profiler->recordMetric(std::string("Semiring ") + semiringToString(semiring) + " GEMM rate",
+                               operations / seconds / 1e9, "GOPS");
+    }
+    profiler->printReport();
+}
+
+// Bytes read and written, with each distinct operand counted once.
+void DeviceManager::executeElementwise(
+    ElementwiseOp op,
+    MatrixBuffer* a,
+    MatrixBuffer* b,
+    MatrixBuffer* result,
+    double alpha) {
+    auto start = std::chrono::steady_clock::now();
+    profiler->startTimer("elementwise_execution");
+    cpuExecutor->executeElementwise(op, a, b, result, alpha, scheduler, profiler);
+    profiler->stopTimer("elementwise_execution");
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    int streams = op == ElementwiseOp::SCALE || a == b ? 2 : 3;
+    double bytes = static_cast<double>(result->rows) * result->cols * dtypeSize(result->dtype) * streams;
+    if (seconds > 0.0) {
+        profiler->recordMetric(std::string("Elementwise ") + elementwiseOpToString(op) + " bandwidth",
+                               bytes / seconds / 1e9, "GB/s");
+    }
+    profiler->printReport();
+}
+
+void DeviceManager::executeTranspose(
+    MatrixBuffer* a,
+    MatrixBuffer* result) {
+    auto start = std::chrono::steady_clock::now();
+    profiler->startTimer("transpose_execution");
+    cpuExecutor->executeTranspose(a, result, scheduler, profiler);
+    profiler->stopTimer("transpose_execution");
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    double bytes = 2.0 * a->rows * a->cols * dtypeSize(a->dtype);
+    if (seconds > 0.0) {
+        profiler->recordMetric("Transpose bandwidth", bytes / seconds / 1e9, "GB/s");
+    }
+    profiler->printReport();
+}
+
+void DeviceManager::executeMatrixPower(
+    MatrixBuffer* a,
+    MatrixBuffer* result,
+    long long exponent) {
+    int n = a->rows;
+    int tunedChunk = 0;
+    if (!tuning.empty()) {
+        TuningPoint tuned = tuning.lookup(n);
+        tunedChunk = tuned.chunkSize;
+        cpuExecutor->configure(tuned.blocking, tuned.isa, tuned.threads);
+    }
+    int blockSize = tunedChunk > 0 ? std::min(tunedChunk, n) : defaultChunkSize(n);
+    std::vector<WorkChunk> chunks = createWorkChunks(n, n, blockSize, blockSize);
+    if (!powerScratch || powerScratch->rows != n || powerScratch->dtype != a->dtype) {
+        powerScratch = std::make_unique<MatrixBuffer>(n, n, a->dtype);
+    }
+    std::cout << "DEBUG: Matrix power " << n << "x" << n << "^" << exponent << " in " << chunks.size()
+              << " chunks of " << blockSize << std::endl;
+    auto start = std::chrono::steady_clock::now();
+    profiler->startTimer("power_execution");
+    int multiplies = cpuExecutor->executePower(a, result, powerScratch.get(), exponent, chunks, profiler);
+    profiler->stopTimer("power_execution");
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    profiler->recordMetric("Matrix power multiplies", multiplies, "");
+    if (multiplies > 0 && seconds > 0.0) {
+        double operations = 2.0 * multiplies * static_cast<double>(n) * n * n;
+        profiler->recordMetric("Matrix power GEMM rate", operations / seconds / 1e9, "GOPS");
+    }
+    profiler->printReport();
+}
+
+void DeviceManager::executeStrassen(
+    MatrixBuffer* a,
+    MatrixBuffer* b,
+    MatrixBuffer* result,
+    int depth) {
+    int n = a->rows;
+    std::size_t needed = StrassenWinograd::workspaceElements(n, depth);
+    if (strassenWorkspace.size() < needed) {
+        std::cout << "DEBUG: Growing Strassen workspace to " << (needed * sizeof(int) / (1024 * 1024))
+                  << " MB" << std::endl;
+        strassenWorkspace.resize(needed);
+    }
+    const int* aData = a->getCPUReadPtr();
+    const int* bData = b->getCPUReadPtr();
+    int* rData = result->getCPUWritePtr();
+    profiler->startTimer("strassen_execution");
+    StrassenWinograd strassen(cpuExecutor, scheduler, profiler);
+    strassen.multiply(aData, bData, rData, n, depth, strassenWorkspace.data());
+    profiler->stopTimer("strassen_execution");
+    a->releaseCPUAccess();
+    b->releaseCPUAccess();
+    result->releaseCPUAccess();
+    profiler->recordMetric("Strassen recursion depth", depth, "levels");
+    profiler->recordMetric("Strassen leaf size", n >> depth, "");
+    profiler->recordMetric("Strassen leaf GEMM rate", strassen.leafRate() * 2.0 / 1e9, "GOPS");
+    int crossover = strassen.estimatedCrossover();
+    if (crossover > 0) {
+        profiler->recordMetric("Strassen crossover (estimated)", crossover, "");
+    }
+}
+
+// MORTON buffers only have the CPU recursive multiply: the chunked paths and
+// the GPU kernel index row-major storage.
+void DeviceManager::executeMorton(
+    MatrixBuffer* a,
+    MatrixBuffer* b,
+    MatrixBuffer* result) {
+    auto start = std::chrono::steady_clock::now();
+    profiler->startTimer("morton_execution");
+    cpuExecutor->executeMorton(a, b, result, scheduler, profiler);
+    profiler->stopTimer("morton_execution");
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    if (seconds > 0.0) {
+        double operations = 2.0 * a->rows * static_cast<double>(a->cols) * b->cols;
+        profiler->recordMetric("Morton GEMM rate", operations / seconds / 1e9, "GOPS");
+    }
+}
+
+// Converts both operands to CSR, then splits C into row bands of roughly equal
+// Gustavson work and runs them as CPU tasks through the scheduler.
+template <typename T>
+static void runSparse(
+    const T* aData,
+    const T* bData,
+    T* rData,
+    int m, int k, int n,
+    int lda, int ldb, int ldc,
+    std::shared_ptr<CPUExecutor> cpuExecutor,
+    std::shared_ptr<WorkScheduler> scheduler,
+    std::shared_ptr<Profiler> profiler) {
+    auto convertStart = std::chrono::steady_clock::now();
+    CSRMatrix<T> aCSR = denseToCSR(aData, m, k, lda);
+    CSRMatrix<T> bCSR = denseToCSR(bData, k, n, ldb);
+    std::vector<double> rowWork = spgemmRowWork(aCSR, bCSR);
+    double convertSeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - convertStart).count();
+    double multiplyAdds = 0.0;
+    double totalWork = 0.0;
+    for (int i = 0; i < m; i++) {
+        multiplyAdds += rowWork[i];
+        // Clearing a dense output row costs about n / 8 scattered updates.
+        rowWork[i] += n / 8.0;
+        totalWork += rowWork[i];
+    }
+    std::vector<int> bandStarts{0};
+    double bandTarget = totalWork / SPARSE_TARGET_BANDS;
+    double bandWork = 0.0;
+    for (int i = 0; i < m; i++) {
+        bandWork += rowWork[i];
+        if (bandWork >= bandTarget && i + 1 < m) {
+            bandStarts.push_back(i + 1);
+            bandWork = 0.0;
+        }
+    }
+    bandStarts.push_back(m);
+    int bands = static_cast<int>(bandStarts.size()) - 1;
+    std::cout << "DEBUG: CSR non-zeros A=" << aCSR.nonZeros() << " B=" << bCSR.nonZeros()
+              << ", " << bands << " row bands" << std::endl;
+    auto multiplyStart = std::chrono::steady_clock::now();
+    cpuExecutor->executeTasks(bands, [&](int band) {
+        spgemmRows(aCSR, bCSR, rData, ldc, bandStarts[band], bandStarts[band + 1]);
+    }, scheduler, profiler);
+    double multiplySeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - multiplyStart).count();
+    double denseMultiplyAdds = static_cast<double>(m) * n * k;
+    profiler->recordMetric("Sparse CSR conversion", convertSeconds * 1000.0, "ms");
+    profiler->recordMetric("Sparse work vs dense", 100.0 * multiplyAdds / denseMultiplyAdds, "%");
+    if (multiplySeconds > 0.0) {
+        profiler->recordMetric("Sparse SpGEMM rate", 2.0 * multiplyAdds / multiplySeconds / 1e9, "GOPS");
+    }
+}
+
+void DeviceManager::executeSparse(
+    MatrixBuffer* a,
+    MatrixBuffer* b,
+    MatrixBuffer* result) {
+    int m = a->rows;
+    int k = a->cols;
+    int n = b->cols;
+    profiler->startTimer("sparse_execution");
+    if (a->dtype == DType::F32) {
+        runSparse(a->getCPUReadPtrAs<float>(), b->getCPUReadPtrAs<float>(),
+                  result->getCPUWritePtrAs<float>(), m, k, n, a->ld, b->ld, result->ld, cpuExecutor, scheduler, profiler);
+    } else if (a->dtype == DType::F64) {
+        runSparse(a->getCPUReadPtrAs<double>(), b->getCPUReadPtrAs<double>(),
+                  result->getCPUWritePtrAs<double>(), m, k, n, a->ld, b->ld, result->ld, cpuExecutor, scheduler, profiler);
+    } else {
+        runSparse(a->getCPUReadPtrAs<int>(), b->getCPUReadPtrAs<int>(),
+                  result->getCPUWritePtrAs<int>(), m, k, n, a->ld, b->ld, result->ld, cpuExecutor, scheduler, profiler);
+    }
+    profiler->stopTimer("sparse_execution");
+    a->releaseCPUAccess();
+    b->releaseCPUAccess();
+    result->releaseCPUAccess();
+    profiler->recordMetric("Sparse density A", 100.0 * a->density(), "%");
+    profiler->recordMetric("Sparse density B", 100.0 * b->density(), "%");
+}
+
+bool DeviceManager::bitMatrixOperands(MatrixBuffer* a, MatrixBuffer* b) const {
+    return bitMatrices && a->dtype == DType::I32 && a->layout == MatrixLayout::ROW_MAJOR && a->batch == 1 &&
+           b->batch == 1 && a->valueRange.binary() && b->valueRange.binary();
+}
+
+void DeviceManager::executeBitMatrix(
+    MatrixBuffer* a,
+    MatrixBuffer* b,
+    MatrixBuffer* result,
+    bool boolean) {
+    int m = a->rows;
+    int k = a->cols;
+    int n = b->cols;
+    std::vector<WorkChunk> chunks = cpuOnlyChunks(m, n, k);
+    auto start = std::chrono::steady_clock::now();
+    profiler->startTimer("bit_matrix_execution");
+    cpuExecutor->executeBitMatrix(a, b, result, boolean, chunks, scheduler, profiler);
+    profiler->stopTimer("bit_matrix_execution");
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    double intBytes = (static_cast<double>(m) * k + static_cast<double>(k) * n) * sizeof(int);
+    profiler->recordMetric("Bit-packed operands", cpuExecutor->bitPackedBytes() / 1024.0, "KB");
+    profiler->recordMetric("Bit-packed size vs int32", 100.0 * cpuExecutor->bitPackedBytes() / intBytes, "%");
+    if (seconds > 0.0) {
+        double operations = 2.0 * m * static_cast<double>(n) * k;
+        profiler->recordMetric("Bit-packed GEMM rate", operations / seconds / 1e9, "GOPS");
+    }
+}
+
 void DeviceManager::waitForCompletion() {
     try {
         scheduler->waitForCompletion();
@@ -186,163 +662,115 @@ void DeviceManager::waitForCompletion() {
     }
 }
 
-void DeviceManager::partitionWork(
+// GPU_ONLY and DISTRIBUTION still force a fixed split; otherwise the planner
+// splits the chunks by predicted finish time. A device with no model yet but
+// chunks behind it in this process is first seeded from its average chunk
+// time.
+PartitionPlan DeviceManager::partitionWork(
     const std::vector<WorkChunk>& chunks,
-    std::vector<WorkChunk>& cpuWork,
-    std::vector<WorkChunk>& gpuWork,
-    std::vector<WorkChunk>& aneWork) {
+    const ThroughputKind& kind,
+    int blockRows,
+    int blockCols,
+    int k,
+    bool gpuSupported) {
     int totalChunks = chunks.size();
     std::cout << "DEBUG: Partitioning " << totalChunks << " work chunks" << std::endl;
-    const char* gpuOnlyEnv = std::getenv("GPU_ONLY");
-    bool gpuOnly = (gpuOnlyEnv != nullptr);
-    int gpuAllocation, cpuAllocation, aneAllocation;
-    aneAllocation = 0;
     std::cout << "DEBUG: ANE is disabled in this implementation" << std::endl;
-    if (gpuOnly) {
-        gpuAllocation = totalChunks;
-        cpuAllocation = 0;
-        aneAllocation = 0;
-        std::cout << "DEBUG: GPU_ONLY mode enabled: 100% GPU execution, work stealing disabled" << std::endl;
-        if (profiler) {
-            profiler->disableWorkStealing();
-        }
-    } else {
-        const char* distributionEnv = std::getenv("DISTRIBUTION");
-        int gpuPercent = 65;  
-        if (distributionEnv != nullptr) {
+    const char* gpuOnlyEnv = std::getenv("GPU_ONLY");
+    bool gpuOnly = (gpuOnlyEnv != nullptr) && gpuSupported;
+    const char* distributionEnv = std::getenv("DISTRIBUTION");
+    int cpu = static_cast<int>(DeviceType::CPU);
+    int gpu = static_cast<int>(DeviceType::GPU);
+    int ane = static_cast<int>(DeviceType::ANE);
+    PartitionPlan plan;
+    if (gpuOnly || (distributionEnv != nullptr && gpuSupported)) {
+        int gpuPercent = 100;
+        if (gpuOnly) {
+            std::cout << "DEBUG: GPU_ONLY mode enabled: 100% GPU execution, work stealing disabled" << std::endl;
+            if (profiler) {
+                profiler->disableWorkStealing();
+            }
+        } else {
             try {
                 gpuPercent = std::stoi(distributionEnv);
-                if (gpuPercent < 0 || gpuPercent > 100) {
-                    std::cout << "WARNING: Invalid DISTRIBUTION value, using default 80% GPU" << std::endl;
-                    gpuPercent = 80;
-                }
             } catch (...) {
-                std::cout << "WARNING: Invalid DISTRIBUTION value, using default 80% GPU" << std::endl;
+                gpuPercent = -1;
+            }
+            if (gpuPercent < 0 || gpuPercent > 100) {
+                std::cout << "WARNING: Invalid DISTRIBUTION value, using 65% GPU" << std::endl;
+                gpuPercent = 65;
             }
+            std::cout << "DEBUG: Using fixed " << gpuPercent << "/" << (100 - gpuPercent)
+                      << " GPU/CPU distribution from DISTRIBUTION" << std::endl;
         }
-        gpuAllocation = (int)(totalChunks * (gpuPercent / 100.0)); 
-        cpuAllocation = totalChunks - gpuAllocation;
-        aneAllocation = 0;  
-        std::cout << "DEBUG: Using " << gpuPercent << "/" << (100-gpuPercent) 
-                  << " GPU/CPU distribution" << std::endl;
+        int gpuAllocation = static_cast<int>(totalChunks * (gpuPercent / 100.0));
+        int cpuAllocation = totalChunks - gpuAllocation;
+        plan.work[cpu].assign(chunks.begin(), chunks.begin() + cpuAllocation);
+        plan.work[gpu].assign(chunks.begin() + cpuAllocation, chunks.end());
+        plan.predictedFinish[cpu] = planner.predict(DeviceType::CPU, kind, plan.work[cpu], k);
+        plan.predictedFinish[gpu] = planner.predict(DeviceType::GPU, kind, plan.work[gpu], k);
+    } else {
+        const int workers[3] = {cpuExecutor->threadCount(), 1, 1};
+        const char* names[3] = {"CPU", "GPU", "ANE"};
+        for (int d = 0; d < 3; d++) {
+            DeviceType device = static_cast<DeviceType>(d);
+            const auto& queue = scheduler->getQueue(device);
+            if (!planner.measured(device, kind) && queue.chunksProcessed > 0 && queue.avgProcessingTime > 0.0) {
+                double gflops = 2.0 * blockRows * blockCols * static_cast<double>(k) * workers[d] /
+                                queue.avgProcessingTime / 1e9;
+                std::cout << "DEBUG: Seeding " << names[d] << " throughput model at " << gflops
+                          << " GFLOP/s from its average chunk time" << std::endl;
+                planner.observe(device, kind, blockRows, blockCols, k, gflops);
+            }
+        }
+        const bool enabled[3] = {true, gpuSupported, false};
+        plan = planner.plan(chunks, kind, k, enabled);
+        std::cout << "DEBUG: Planned split for " << blockRows << "x" << blockCols << " chunks over k=" << k
+                  << ": CPU at " << planner.rate(DeviceType::CPU, kind, blockRows, blockCols, k) << " GFLOP/s";
+        if (gpuSupported) {
+            std::cout << ", GPU at " << planner.rate(DeviceType::GPU, kind, blockRows, blockCols, k) << " GFLOP/s";
+        }
+        std::cout << std::endl;
     }
+    int cpuAllocation = static_cast<int>(plan.work[cpu].size());
+    int gpuAllocation = static_cast<int>(plan.work[gpu].size());
+    int aneAllocation = static_cast<int>(plan.work[ane].size());
     std::cout << "DEBUG: Using distribution - CPU: " << cpuAllocation 
               << " (" << (100.0 * cpuAllocation / totalChunks) << "%)"
               << ", GPU: " << gpuAllocation 
               << " (" << (100.0 * gpuAllocation / totalChunks) << "%)"
               << ", ANE: " << aneAllocation
-              << " (" << (100.0 * aneAllocation / totalChunks) << "%)" << std::endl;
+              << " (" << (100.0 * aneAllocation / totalChunks) << "%)"
+              << ", predicted finish CPU " << plan.predictedFinish[cpu] * 1000
+              << "ms, GPU " << plan.predictedFinish[gpu] * 1000 << "ms" << std::endl;
     profiler->recordInitialAllocation("CPU", cpuAllocation, totalChunks);
     profiler->recordInitialAllocation("GPU", gpuAllocation, totalChunks);
     profiler->recordInitialAllocation("ANE", aneAllocation, totalChunks);
-    for (int i = 0; i < chunks.size(); i++) {
-        if (i < cpuAllocation) cpuWork.push_back(chunks[i]);
-        else if (i < cpuAllocation + gpuAllocation) gpuWork.push_back(chunks[i]);
-        else aneWork.push_back(chunks[i]);
-    }
-    return;
-    if (totalChunks >= 4) {
-        int cpuCount;
-        int gpuCount;
-        int aneCount;
-        int matrixSize = 0;
-        if (!chunks.empty()) {
-            const WorkChunk& firstChunk = chunks[0];
-            if (firstChunk.startRow == 0 && firstChunk.startCol == 0) {
-                matrixSize = std::max(firstChunk.endRow * 4, firstChunk.endCol * 4);
-            } else {
-                matrixSize = std::max(firstChunk.endRow, firstChunk.endCol);
-            }
-        }
-        if (matrixSize <= 128) {
-            cpuCount = (int)(totalChunks * 0.2);   
-            gpuCount = (int)(totalChunks * 0.8);   
-            aneCount = 0;  
-            if (totalChunks >= 5) {
-                if (cpuCount < 1) cpuCount = 1;
-                if (gpuCount < 1) gpuCount = 1;
-            } else {
-                cpuCount = (int)(totalChunks * 0.2);
-                if (cpuCount < 1) cpuCount = 1;
-                gpuCount = totalChunks - cpuCount;
-                aneCount = 0;  
-            }
-            std::cout << "DEBUG: Medium matrix detected, using balanced distribution" << std::endl;
-        }
-        else if (totalChunks <= 4) {
-            cpuCount = std::max(1, totalChunks - 2);
-            gpuCount = totalChunks > 1 ? 1 : 0;
-            aneCount = totalChunks > 2 ? 1 : 0;
-        } else if (totalChunks <= 16) {
-            cpuCount = (int)(totalChunks * 0.6);   
-            gpuCount = (int)(totalChunks * 0.3);   
-            aneCount = totalChunks - cpuCount - gpuCount;  
-        } else if (totalChunks <= 64) {
-            cpuCount = (int)(totalChunks * 0.2);   
-            gpuCount = (int)(totalChunks * 0.8);   
-            aneCount = 0;  
-        } else if (totalChunks <= 256) {
-            int gpuAllocation = (int)(totalChunks * 0.8);   
-            int aneAllocation = 0;    
-            cpuCount = totalChunks - gpuAllocation - aneAllocation;   
-            gpuCount = gpuAllocation;
-            aneCount = aneAllocation;
-        } else {
-            int gpuAllocation = (int)(totalChunks * 0.95);  
-            int aneAllocation = 0;   
-            cpuCount = totalChunks - gpuAllocation - aneAllocation;  
-            gpuCount = gpuAllocation;
-            aneCount = aneAllocation;
-        }
-
-        profiler->recordInitialAllocation("CPU", cpuCount, totalChunks);
-        profiler->recordInitialAllocation("GPU", gpuCount, totalChunks);
-        profiler->recordInitialAllocation("ANE", aneCount, totalChunks);
-
-        for (int i = 0; i < chunks.size(); i++) {
-            if (i < cpuCount) cpuWork.push_back(chunks[i]);
-            else if (i < cpuCount + gpuCount) gpuWork.push_back(chunks[i]);
-            else aneWork.push_back(chunks[i]);
-        }
-    }
-
-    if (totalChunks <= 3) {
-        int gpuCount = (int)(totalChunks * 0.8);
-        int cpuCount = totalChunks - gpuCount;
-        int aneCount = 0;
-        profiler->recordInitialAllocation("CPU", cpuCount, totalChunks);
-        profiler->recordInitialAllocation("GPU", gpuCount, totalChunks);
-        profiler->recordInitialAllocation("ANE", aneCount, totalChunks);
-        for (int i = 0; i < chunks.size(); i++) {
-            if (i < gpuCount) gpuWork.push_back(chunks[i]);
-            else cpuWork.push_back(chunks[i]);
-        }
-        return;
-    }
+    return plan;
+}
 
-    int cpuCount = (int)(totalChunks * 0.2);
-    int gpuCount = (int)(totalChunks * 0.8);
-    int aneCount = 0;  
-    if (cpuCount < 1) cpuCount = 1;
-    if (gpuCount < 1) gpuCount = 1;
-    int total = cpuCount + gpuCount;
-    if (total > totalChunks) {
-        int excess = total - totalChunks;
-        if (gpuCount >= cpuCount) {
-            gpuCount -= excess;
-        } else {
-            cpuCount -= excess;
+// A device's throughput is the result cells it finished, stolen ones
+// included, over the time until its last one finished.
+void DeviceManager::recordDeviceFinish(
+    const PartitionPlan& plan,
+    std::chrono::steady_clock::time_point start,
+    const ThroughputKind& kind,
+    int blockRows,
+    int blockCols,
+    int k) {
+    long long startNanos = std::chrono::duration_cast<std::chrono::nanoseconds>(start.time_since_epoch()).count();
+    const char* names[3] = {"CPU", "GPU", "ANE"};
+    for (int d = 0; d < 3; d++) {
+        const auto& queue = scheduler->getQueue(static_cast<DeviceType>(d));
+        long long cells = queue.finishedCells;
+        double actual = cells > 0 ? (queue.lastFinish - startNanos) / 1e9 : 0.0;
+        profiler->recordDeviceFinish(names[d], plan.predictedFinish[d], actual);
+        if (cells > 0 && actual > 0.0) {
+            double gflops = 2.0 * cells * static_cast<double>(k) / actual / 1e9;
+            std::cout << "DEBUG: " << names[d] << " finished " << cells << " cells at " << actual * 1000
+                      << "ms (predicted " << plan.predictedFinish[d] * 1000 << "ms), "
+                      << gflops << " GFLOP/s" << std::endl;
+            planner.observe(static_cast<DeviceType>(d), kind, blockRows, blockCols, k, gflops);
         }
     }
-
-    std::cout << "DEBUG: Standard distribution - CPU: " << cpuCount 
-              << ", GPU: " << gpuCount 
-              << ", ANE: " << aneCount << std::endl;
-    profiler->recordInitialAllocation("CPU", cpuCount, totalChunks);
-    profiler->recordInitialAllocation("GPU", gpuCount, totalChunks);
-    profiler->recordInitialAllocation("ANE", aneCount, totalChunks);
-    for (int i = 0; i < chunks.size(); i++) {
-        if (i < cpuCount) cpuWork.push_back(chunks[i]);
-        else gpuWork.push_back(chunks[i]);
-    }
 }
\ No newline at end of file
@@ -1,5 +1,7 @@
 #pragma once
+#include <chrono>
 #include <memory>
+#include <string>
 #include <vector>
 #include "matrix_utils.h"
 #include "cpu_executor.h"
@@ -7,31 +9,135 @@
 #include "ane_executor.h"
 #include "work_stealing.h"  
 #include "profiler.h"
+#include "autotuner.h"
+#include "worker_pool.h"
+#include "partition_planner.h"
 
 class DeviceManager {
 public:
     DeviceManager();
     ~DeviceManager();
     void initialize();
+    // result = A * B, or the fused GEMM described by epilogue.
     void executeMatrixMultiplication(
         MatrixBuffer* a,
         MatrixBuffer* b,
+        MatrixBuffer* result,
+        const MatrixEpilogue* epilogue = nullptr);
+    // Small independent multiplies run as a single CPU job, without the
+    // per-multiply device threads and completion polling.
+    void executeBatchedMultiplication(
+        MatrixBuffer* a,
+        MatrixBuffer* b,
+        MatrixBuffer* result);
+    // result = A * B mod p on the CPU modular kernels; the GPU and the other
+    // multiply paths only produce wrapped int32 sums.
+    void executeModularMultiplication(
+        MatrixBuffer* a,
+        MatrixBuffer* b,
+        MatrixBuffer* result,
+        uint32_t modulus);
+    // Exact i64 or i128 result = A * B for i32 A and B, from the CPU modular
+    // kernels run once per CRT prime. bound caps the magnitude of any result
+    // entry and picks the number of primes.
+    void executeExactMultiplication(
+        MatrixBuffer* a,
+        MatrixBuffer* b,
+        MatrixBuffer* result,
+        unsigned __int128 bound);
+    // result = A * B over MIN_PLUS, MAX_PLUS or OR_AND on the CPU semiring
+    // kernels; the GPU shader only sums products.
+    void executeSemiringMultiplication(
+        MatrixBuffer* a,
+        MatrixBuffer* b,
+        MatrixBuffer* result,
+        Semiring semiring);
+    // Memory-bound elementwise ops and transposes, on the CPU workers only;
+    // the profiler reports the bandwidth they reach.
+    void executeElementwise(
+        ElementwiseOp op,
+        MatrixBuffer* a,
+        MatrixBuffer* b,
+        MatrixBuffer* result,
+        double alpha);
+    void executeTranspose(
+        MatrixBuffer* a,
         MatrixBuffer* result);
+    // result = A^exponent for a square row-major A, on the CPU only: every
+    // multiply of the chain depends on the previous one.
+    void executeMatrixPower(
+        MatrixBuffer* a,
+        MatrixBuffer* result,
+        long long exponent);
     void waitForCompletion();
     std::shared_ptr<CPUExecutor> getCPUExecutor() { return cpuExecutor; }
     std::shared_ptr<GPUExecutor> getGPUExecutor() { return gpuExecutor; }
     std::shared_ptr<ANEExecutor> getANEExecutor() { return aneExecutor; }
     std::shared_ptr<WorkScheduler> getScheduler() { return scheduler; }
     std::shared_ptr<Profiler> getProfiler() { return profiler; }
+    std::shared_ptr<WorkerPool> getWorkerPool() { return workerPool; }
 private:
     std::shared_ptr<CPUExecutor> cpuExecutor;
     std::shared_ptr<GPUExecutor> gpuExecutor;
     std::shared_ptr<ANEExecutor> aneExecutor;
     std::shared_ptr<WorkScheduler> scheduler;
     std::shared_ptr<Profiler> profiler;
-    void partitionWork(
+    // CPU workers for every job, started once in initialize().
+    std::shared_ptr<WorkerPool> workerPool;
+    // Runs the GPU executor alongside the CPU one on the calling thread.
+    DeviceThread gpuThread;
+    int strassenCutoff;
+    double sparseThreshold;
+    bool bitMatrices;
+    std::string tuningFile;
+    std::string hostKey;
+    TuningTable tuning;
+    // Per-device throughput models, one per kind of multiply. They are only
+    // written back to the tuning file with SAVE_THROUGHPUT=1.
+    PartitionPlanner planner;
+    bool saveThroughput;
+    std::vector<int> strassenWorkspace;
+    // Second ping-pong buffer of the power chain, kept while shapes repeat.
+    std::unique_ptr<MatrixBuffer> powerScratch;
+    // Chunks for a CPU-only m x k * k x n multiply, after applying the tuned
+    // blocking for its size.
+    std::vector<WorkChunk> cpuOnlyChunks(int m, int n, int k);
+    void executeStrassen(
+        MatrixBuffer* a,
+        MatrixBuffer* b,
+        MatrixBuffer* result,
+        int depth);
+    void executeMorton(
+        MatrixBuffer* a,
+        MatrixBuffer* b,
+        MatrixBuffer* result);
+    void executeSparse(
+        MatrixBuffer* a,
+        MatrixBuffer* b,
+        MatrixBuffer* result);
+    // Whether A * B can run bit-packed: row-major i32 operands that held only
+    // 0s and 1s when they were read.
+    bool bitMatrixOperands(MatrixBuffer* a, MatrixBuffer* b) const;
+    void executeBitMatrix(
+        MatrixBuffer* a,
+        MatrixBuffer* b,
+        MatrixBuffer* result,
+        bool boolean);
+    PartitionPlan partitionWork(
         const std::vector<WorkChunk>& chunks,
-        std::vector<WorkChunk>& cpuWork,
-        std::vector<WorkChunk>& gpuWork,
-        std::vector<WorkChunk>& aneWork);
+        const ThroughputKind& kind,
+        int blockRows,
+        int blockCols,
+        int k,
+        bool gpuSupported);
+    // Reports each device's predicted and actual finish time for the
+    // multiply that began at start, and feeds the throughput each reached
+    // back into the planner.
+    void recordDeviceFinish(
+        const PartitionPlan& plan,
+        std::chrono::steady_clock::time_point start,
+        const ThroughputKind& kind,
+        int blockRows,
+        int blockCols,
+        int k);
 };
\ No newline at end of file
@@ -0,0 +1,304 @@
+#include "elementwise.h"
+#include <algorithm>
+#include <cstring>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define ELEMENTWISE_HAVE_X86 1
+#endif
+#if defined(__aarch64__) || defined(__arm64__)
+#include <arm_neon.h>
+#define ELEMENTWISE_HAVE_NEON 1
+#endif
+
+const char* elementwiseOpToString(ElementwiseOp op) {
+    switch (op) {
+        case ElementwiseOp::ADD: return "add";
+        case ElementwiseOp::SUB: return "sub";
+        default: return "scale";
+    }
+}
+
+// int works in unsigned lanes so wraparound is well defined.
+template <typename T> struct WrapType { using type = T; };
+template <> struct WrapType<int> { using type = unsigned; };
+
+// Plain loops the x86 tiers compile for their vector width. c is either
+// disjoint from a and b or equal to one of them, and element i only reads
+// index i, so there is no dependence between iterations.
+template <typename T>
+static void elementwiseLoop(ElementwiseOp op, std::size_t length, const T* a, const T* b, T alpha, T* c) {
+    using W = typename WrapType<T>::type;
+    switch (op) {
+        case ElementwiseOp::ADD:
+#pragma GCC ivdep
+            for (std::size_t i = 0; i < length; i++) {
+                c[i] = static_cast<T>(static_cast<W>(a[i]) + static_cast<W>(b[i]));
+            }
+            break;
+        case ElementwiseOp::SUB:
+#pragma GCC ivdep
+            for (std::size_t i = 0; i < length; i++) {
+                c[i] = static_cast<T>(static_cast<W>(a[i]) - static_cast<W>(b[i]));
+            }
+            break;
+        case ElementwiseOp::SCALE: {
+            W factor = static_cast<W>(alpha);
+#pragma GCC ivdep
+            for (std::size_t i = 0; i < length; i++) {
+                c[i] = static_cast<T>(static_cast<W>(a[i]) * factor);
+            }
+            break;
+        }
+    }
+}
+
+// Elements computed per staged burst: 4-8 KB, well inside L1.
+constexpr std::size_t STREAM_BLOCK = 1024;
+
+template <typename T, typename Tier>
+static void elementwiseSpan(ElementwiseOp op, std::size_t length, const T* a, const T* b, T alpha, T* c,
+                            bool stream) {
+    if (!stream || !Tier::NON_TEMPORAL) {
+        elementwiseLoop(op, length, a, b, alpha, c);
+        return;
+    }
+    alignas(64) T staged[STREAM_BLOCK];
+    for (std::size_t start = 0; start < length; start += STREAM_BLOCK) {
+        std::size_t count = std::min(STREAM_BLOCK, length - start);
+        elementwiseLoop(op, count, a + start, op == ElementwiseOp::SCALE ? b : b + start, alpha, staged);
+        Tier::stream(c + start, staged, count * sizeof(T));
+    }
+    Tier::fence();
+}
+
+struct PlainTier {
+    static constexpr bool NON_TEMPORAL = false;
+    static void stream(void* dst, const void* src, std::size_t bytes) { std::memcpy(dst, src, bytes); }
+    static void fence() {}
+};
+
+// Transposes rows [r0, r1) x columns [c0, c1) of a.
+template <typename T>
+static void transposeScalar(int r0, int r1, int c0, int c1, const T* a, int lda, T* c, int ldc) {
+    for (int i = r0; i < r1; i++) {
+        for (int j = c0; j < c1; j++) {
+            c[static_cast<std::size_t>(j) * ldc + i] = a[static_cast<std::size_t>(i) * lda + j];
+        }
+    }
+}
+
+template <typename T, int B>
+static void transposeBlockPlain(const T* a, int lda, T* c, int ldc) {
+    transposeScalar(0, B, 0, B, a, lda, c, ldc);
+}
+
+// Full B x B blocks go to Block; the ragged bottom rows and right columns
+// are copied one element at a time. Each block row of a is finished before
+// the next: taller strips keep more rows of a live at once, and with a
+// power-of-two stride those rows all share a few cache sets.
+template <typename T, int B, void (*Block)(const T*, int, T*, int)>
+static void transposeTiled(int rows, int cols, const T* a, int lda, T* c, int ldc) {
+    int rowsFull = rows / B * B;
+    int colsFull = cols / B * B;
+    for (int i = 0; i < rowsFull; i += B) {
+        for (int j = 0; j < colsFull; j += B) {
+            Block(a + static_cast<std::size_t>(i) * lda + j, lda, c + static_cast<std::size_t>(j) * ldc + i, ldc);
+        }
+    }
+    transposeScalar(0, rowsFull, colsFull, cols, a, lda, c, ldc);
+    transposeScalar(rowsFull, rows, 0, cols, a, lda, c, ldc);
+}
+
+#ifdef ELEMENTWISE_HAVE_X86
+// Copies the head up to the store alignment, then whole vectors with
+// streaming stores; the caller fences once per span.
+struct Avx2Tier {
+    static constexpr bool NON_TEMPORAL = true;
+    __attribute__((target("avx2")))
+    static void stream(void* dst, const void* src, std::size_t bytes) {
+        char* out = static_cast<char*>(dst);
+        const char* in = static_cast<const char*>(src);
+        std::size_t head = std::min(bytes, (32 - reinterpret_cast<std::uintptr_t>(out) % 32) % 32);
+        std::memcpy(out, in, head);
+        std::size_t i = head;
+        for (; i + 32 <= bytes; i += 32) {
+            _mm256_stream_si256(reinterpret_cast<__m256i*>(out + i),
+                                _mm256_loadu_si256(reinterpret_cast<const __m256i*>(in + i)));
+        }
+        std::memcpy(out + i, in + i, bytes - i);
+    }
+    static void fence() { _mm_sfence(); }
+};
+
+struct Avx512Tier {
+    static constexpr bool NON_TEMPORAL = true;
+    __attribute__((target("avx512f")))
+    static void stream(void* dst, const void* src, std::size_t bytes) {
+        char* out = static_cast<char*>(dst);
+        const char* in = static_cast<const char*>(src);
+        std::size_t head = std::min(bytes, (64 - reinterpret_cast<std::uintptr_t>(out) % 64) % 64);
+        std::memcpy(out, in, head);
+        std::size_t i = head;
+        for (; i + 64 <= bytes; i += 64) {
+            _mm512_stream_si512(reinterpret_cast<__m512i*>(out + i), _mm512_loadu_si512(in + i));
+        }
+        std::memcpy(out + i, in + i, bytes - i);
+    }
+    static void fence() { _mm_sfence(); }
+};
+
+template <typename T>
+__attribute__((target("avx2,fma"), flatten))
+static void elementwiseAvx2(ElementwiseOp op, std::size_t length, const T* a, const T* b, T alpha, T* c,
+                            bool stream) {
+    elementwiseSpan<T, Avx2Tier>(op, length, a, b, alpha, c, stream);
+}
+
+template <typename T>
+__attribute__((target("avx512f,avx512vl,avx512dq,avx512bw,fma"), flatten))
+static void elementwiseAvx512(ElementwiseOp op, std::size_t length, const T* a, const T* b, T alpha, T* c,
+                              bool stream) {
+    elementwiseSpan<T, Avx512Tier>(op, length, a, b, alpha, c, stream);
+}
+
+// Unpack, shuffle and lane-permute: three rounds of eight instructions.
+__attribute__((target("avx2")))
+static inline void transpose8x8Avx2(const uint32_t* a, int lda, uint32_t* c, int ldc) {
+    __m256 r[8];
+    for (int i = 0; i < 8; i++) {
+        r[i] = _mm256_loadu_ps(reinterpret_cast<const float*>(a + static_cast<std::size_t>(i) * lda));
+    }
+    __m256 t[8];
+    for (int i = 0; i < 8; i += 2) {
+        t[i] = _mm256_unpacklo_ps(r[i], r[i + 1]);
+        t[i + 1] = _mm256_unpackhi_ps(r[i], r[i + 1]);
+    }
+    __m256 s[8];
+    for (int i = 0; i < 8; i += 4) {
+        s[i] = _mm256_shuffle_ps(t[i], t[i + 2], _MM_SHUFFLE(1, 0, 1, 0));
+        s[i + 1] = _mm256_shuffle_ps(t[i], t[i + 2], _MM_SHUFFLE(3, 2, 3, 2));
+        s[i + 2] = _mm256_shuffle_ps(t[i + 1], t[i + 3], _MM_SHUFFLE(1, 0, 1, 0));
+        s[i + 3] = _mm256_shuffle_ps(t[i + 1], t[i + 3], _MM_SHUFFLE(3, 2, 3, 2));
+    }
+    for (int i = 0; i < 4; i++) {
+        _mm256_storeu_ps(reinterpret_cast<float*>(c + static_cast<std::size_t>(i) * ldc),
+                         _mm256_permute2f128_ps(s[i], s[i + 4], 0x20));
+        _mm256_storeu_ps(reinterpret_cast<float*>(c + static_cast<std::size_t>(i + 4) * ldc),
+                         _mm256_permute2f128_ps(s[i], s[i + 4], 0x31));
+    }
+}
+
+__attribute__((target("avx2")))
+static inline void transpose4x4Avx2(const uint64_t* a, int lda, uint64_t* c, int ldc) {
+    __m256d r[4];
+    for (int i = 0; i < 4; i++) {
+        r[i] = _mm256_loadu_pd(reinterpret_cast<const double*>(a + static_cast<std::size_t>(i) * lda));
+    }
+    __m256d t0 = _mm256_unpacklo_pd(r[0], r[1]);
+    __m256d t1 = _mm256_unpackhi_pd(r[0], r[1]);
+    __m256d t2 = _mm256_unpacklo_pd(r[2], r[3]);
+    __m256d t3 = _mm256_unpackhi_pd(r[2], r[3]);
+    double* out = reinterpret_cast<double*>(c);
+    std::size_t stride = static_cast<std::size_t>(ldc);
+    _mm256_storeu_pd(out, _mm256_permute2f128_pd(t0, t2, 0x20));
+    _mm256_storeu_pd(out + stride, _mm256_permute2f128_pd(t1, t3, 0x20));
+    _mm256_storeu_pd(out + 2 * stride, _mm256_permute2f128_pd(t0, t2, 0x31));
+    _mm256_storeu_pd(out + 3 * stride, _mm256_permute2f128_pd(t1, t3, 0x31));
+}
+
+// The AVX-512 tier uses these too: wider blocks would not fill a cache line
+// of output rows any sooner.
+__attribute__((target("avx2"), flatten))
+static void transposeAvx2(int rows, int cols, const uint32_t* a, int lda, uint32_t* c, int ldc) {
+    transposeTiled<uint32_t, 8, transpose8x8Avx2>(rows, cols, a, lda, c, ldc);
+}
+
+__attribute__((target("avx2"), flatten))
+static void transposeAvx2(int rows, int cols, const uint64_t* a, int lda, uint64_t* c, int ldc) {
+    transposeTiled<uint64_t, 4, transpose4x4Avx2>(rows, cols, a, lda, c, ldc);
+}
+#endif
+
+#ifdef ELEMENTWISE_HAVE_NEON
+static inline void transpose4x4Neon(const uint32_t* a, int lda, uint32_t* c, int ldc) {
+    std::size_t stride = static_cast<std::size_t>(lda);
+    uint32x4x2_t t01 = vtrnq_u32(vld1q_u32(a), vld1q_u32(a + stride));
+    uint32x4x2_t t23 = vtrnq_u32(vld1q_u32(a + 2 * stride), vld1q_u32(a + 3 * stride));
+    std::size_t out = static_cast<std::size_t>(ldc);
+    vst1q_u32(c, vcombine_u32(vget_low_u32(t01.val[0]), vget_low_u32(t23.val[0])));
+    vst1q_u32(c + out, vcombine_u32(vget_low_u32(t01.val[1]), vget_low_u32(t23.val[1])));
+    vst1q_u32(c + 2 * out, vcombine_u32(vget_high_u32(t01.val[0]), vget_high_u32(t23.val[0])));
+    vst1q_u32(c + 3 * out, vcombine_u32(vget_high_u32(t01.val[1]), vget_high_u32(t23.val[1])));
+}
+
+static inline void transpose2x2Neon(const uint64_t* a, int lda, uint64_t* c, int ldc) {
+    uint64x2_t r0 = vld1q_u64(a);
+    uint64x2_t r1 = vld1q_u64(a + lda);
+    vst1q_u64(c, vtrn1q_u64(r0, r1));
+    vst1q_u64(c + ldc, vtrn2q_u64(r0, r1));
+}
+#endif
+
+template <typename T>
+static void elementwiseForIsa(CPUIsa isa, ElementwiseOp op, std::size_t length, const T* a, const T* b, T alpha,
+                              T* c, bool stream) {
+#ifdef ELEMENTWISE_HAVE_X86
+    if (isa == CPUIsa::AVX512) {
+        elementwiseAvx512(op, length, a, b, alpha, c, stream);
+        return;
+    }
+    if (isa == CPUIsa::AVX2) {
+        elementwiseAvx2(op, length, a, b, alpha, c, stream);
+        return;
+    }
+#endif
+    elementwiseSpan<T, PlainTier>(op, length, a, b, alpha, c, stream);
+}
+
+void elementwise(CPUIsa isa, ElementwiseOp op, std::size_t length, const int* a, const int* b, int alpha, int* c,
+                 bool stream) {
+    elementwiseForIsa(isa, op, length, a, b, alpha, c, stream);
+}
+
+void elementwise(CPUIsa isa, ElementwiseOp op, std::size_t length, const float* a, const float* b, float alpha,
+                 float* c, bool stream) {
+    elementwiseForIsa(isa, op, length, a, b, alpha, c, stream);
+}
+
+void elementwise(CPUIsa isa, ElementwiseOp op, std::size_t length, const double* a, const double* b, double alpha,
+                 double* c, bool stream) {
+    elementwiseForIsa(isa, op, length, a, b, alpha, c, stream);
+}
+
+void transpose(CPUIsa isa, int rows, int cols, const uint32_t* a, int lda, uint32_t* c, int ldc) {
+#ifdef ELEMENTWISE_HAVE_X86
+    if (isa == CPUIsa::AVX2 || isa == CPUIsa::AVX512) {
+        transposeAvx2(rows, cols, a, lda, c, ldc);
+        return;
+    }
+#endif
+#ifdef ELEMENTWISE_HAVE_NEON
+    if (isa == CPUIsa::NEON) {
+        transposeTiled<uint32_t, 4, transpose4x4Neon>(rows, cols, a, lda, c, ldc);
+        return;
+    }
+#endif
+    transposeTiled<uint32_t, 8, transposeBlockPlain<uint32_t, 8>>(rows, cols, a, lda, c, ldc);
+}
+
+void transpose(CPUIsa isa, int rows, int cols, const uint64_t* a, int lda, uint64_t* c, int ldc) {
+#ifdef ELEMENTWISE_HAVE_X86
+    if (isa == CPUIsa::AVX2 || isa == CPUIsa::AVX512) {
+        transposeAvx2(rows, cols, a, lda, c, ldc);
+        return;
+    }
+#endif
+#ifdef ELEMENTWISE_HAVE_NEON
+    if (isa == CPUIsa::NEON) {
+        transposeTiled<uint64_t, 2, transpose2x2Neon>(rows, cols, a, lda, c, ldc);
+        return;
+    }
+#endif
+    transposeTiled<uint64_t, 8, transposeBlockPlain<uint64_t, 8>>(rows, cols, a, lda, c, ldc);
+}
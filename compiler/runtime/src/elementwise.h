@@ -0,0 +1,32 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include "cpu_features.h"
+
+enum class ElementwiseOp {
+    ADD,
+    SUB,
+    SCALE
+};
+
+const char* elementwiseOpToString(ElementwiseOp op);
+
+// c[i] = a[i] + b[i], a[i] - b[i] or alpha * a[i] for i < length; SCALE
+// ignores b. c may be a or b itself, but must not partly overlap them. int
+// arithmetic wraps like the GEMM kernels. With stream, results are staged in
+// a small stack buffer and written out with non-temporal stores, so an
+// output larger than the caches does not evict the inputs still being read.
+// NEON has no such store and writes normally.
+void elementwise(CPUIsa isa, ElementwiseOp op, std::size_t length, const int* a, const int* b, int alpha, int* c,
+                 bool stream);
+void elementwise(CPUIsa isa, ElementwiseOp op, std::size_t length, const float* a, const float* b, float alpha,
+                 float* c, bool stream);
+void elementwise(CPUIsa isa, ElementwiseOp op, std::size_t length, const double* a, const double* b, double alpha,
+                 double* c, bool stream);
+
+// c = a^T for a rows x cols matrix a, so c is cols x rows. Only the element
+// bits move, so int and float share the 32-bit version. The x86 tiers
+// transpose 8 x 8 blocks of 32-bit elements and 4 x 4 of 64-bit ones in
+// registers, NEON 4 x 4 and 2 x 2, one block row of a at a time.
+void transpose(CPUIsa isa, int rows, int cols, const uint32_t* a, int lda, uint32_t* c, int ldc);
+void transpose(CPUIsa isa, int rows, int cols, const uint64_t* a, int lda, uint64_t* c, int ldc);
@@ -9,6 +9,7 @@ public:
     GPUExecutor();
     ~GPUExecutor();
     void initialize();
+    bool supports(DType dtype) const;
     void execute(
         MatrixBuffer* a,
         MatrixBuffer* b,
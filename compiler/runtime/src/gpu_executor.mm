@@ -7,6 +7,7 @@ struct GPUExecutor::Impl {
     id<MTLCommandQueue> commandQueue;
     id<MTLLibrary> library;
     id<MTLComputePipelineState> pipelineState;
+    id<MTLComputePipelineState> pipelineStateF32;
 };
 GPUExecutor::GPUExecutor() : pImpl(new Impl()) {
 }
@@ -44,6 +45,26 @@ void GPUExecutor::initialize() {
         if (!pImpl->pipelineState) {
             std::cerr << "Failed to create pipeline state: " << error.localizedDescription.UTF8String << std::endl;
         }
+        id<MTLFunction> floatFunction = [pImpl->library newFunctionWithName:@"matrix_multiply_f32"];
+        if (!floatFunction) {
+            std::cerr << "Failed to find matrix_multiply_f32 function in library" << std::endl;
+            return;
+        }
+        pImpl->pipelineStateF32 = [pImpl->device newComputePipelineStateWithFunction:floatFunction error:&error];
+        if (!pImpl->pipelineStateF32) {
+            std::cerr << "Failed to create f32 pipeline state: " << error.localizedDescription.UTF8String << std::endl;
+        }
+    }
+}
+// Metal has no double type, so f64 multiplies never have a GPU pipeline.
+bool GPUExecutor::supports(DType dtype) const {
+    if (!pImpl->device || !pImpl->commandQueue) {
+        return false;
+    }
+    switch (dtype) {
+        case DType::I32: return pImpl->pipelineState != nil;
+        case DType::F32: return pImpl->pipelineStateF32 != nil;
+        default: return false;
     }
 }
 void GPUExecutor::execute(
@@ -53,10 +74,12 @@ void GPUExecutor::execute(
     std::shared_ptr<WorkScheduler> scheduler,
     std::shared_ptr<Profiler> profiler) {
     std::cout << "DEBUG: GPU executor starting" << std::endl;
-    if (!pImpl->device || !pImpl->commandQueue || !pImpl->pipelineState) {
-        std::cout << "DEBUG: GPU Metal setup incomplete, cannot execute" << std::endl;
+    if (!supports(a->dtype)) {
+        std::cout << "DEBUG: GPU has no " << dtypeToString(a->dtype) << " pipeline, cannot execute" << std::endl;
         return;
     }
+    id<MTLComputePipelineState> pipeline =
+        a->dtype == DType::F32 ? pImpl->pipelineStateF32 : pImpl->pipelineState;
     @autoreleasepool {
         std::cout << "DEBUG: GPU processing chunks" << std::endl;
         int processedChunks = 0;
@@ -91,10 +114,10 @@ void GPUExecutor::execute(
                 id<MTLComputeCommandEncoder> encoder = [commandBuffer computeCommandEncoder];
                 if (!encoder) {
                     std::cerr << "Failed to create compute encoder" << std::endl;
-                    delete chunk;
+                    scheduler->finishWork(DeviceType::GPU, chunk);
                     continue;
                 }
-                [encoder setComputePipelineState:pImpl->pipelineState];
+                [encoder setComputePipelineState:pipeline];
                 [encoder setBuffer:(__bridge id<MTLBuffer>)aBuffer offset:0 atIndex:0];
                 [encoder setBuffer:(__bridge id<MTLBuffer>)bBuffer offset:0 atIndex:1];
                 [encoder setBuffer:(__bridge id<MTLBuffer>)rBuffer offset:0 atIndex:2];
@@ -103,8 +126,12 @@ void GPUExecutor::execute(
                     int endRow;
                     int startCol;
                     int endCol;
-                    int size;
-                } chunkInfo = {chunk->startRow, chunk->endRow, chunk->startCol, chunk->endCol, a->size};
+                    int k;
+                    int lda;
+                    int ldb;
+                    int ldc;
+                } chunkInfo = {chunk->startRow, chunk->endRow, chunk->startCol, chunk->endCol,
+                               a->cols, a->ld, b->ld, result->ld};
                 id<MTLBuffer> chunkBuffer = [pImpl->device newBufferWithBytes:&chunkInfo
                                                              length:sizeof(ChunkInfo)
                                                             options:MTLResourceStorageModeShared];
@@ -130,7 +157,7 @@ void GPUExecutor::execute(
                 [encoder endEncoding];
                 id<MTLCommandBuffer> chunkCommandBuffer = [pImpl->commandQueue commandBuffer];
                 id<MTLComputeCommandEncoder> timeEncoder = [chunkCommandBuffer computeCommandEncoder];
-                [timeEncoder setComputePipelineState:pImpl->pipelineState];
+                [timeEncoder setComputePipelineState:pipeline];
                 [timeEncoder setBuffer:(__bridge id<MTLBuffer>)aBuffer offset:0 atIndex:0];
                 [timeEncoder setBuffer:(__bridge id<MTLBuffer>)bBuffer offset:0 atIndex:1];
                 [timeEncoder setBuffer:(__bridge id<MTLBuffer>)rBuffer offset:0 atIndex:2];
@@ -151,7 +178,7 @@ void GPUExecutor::execute(
             } catch (const std::exception& e) {
                 std::cerr << "GPU chunk processing failed: " << e.what() << std::endl;
             }
-            delete chunk;
+            scheduler->finishWork(DeviceType::GPU, chunk);
         }
         if (processedChunks > 0) {
             std::cout << "DEBUG: GPU committing command buffer with all chunks" << std::endl;
@@ -163,13 +190,6 @@ void GPUExecutor::execute(
         a->releaseGPUAccess();
         b->releaseGPUAccess();
         result->releaseGPUAccess();
-        auto& queue = scheduler->getQueue(DeviceType::GPU);
-        std::unique_lock<std::mutex> lock(queue.mutex);
-        if (queue.activeWorkers > 0) {
-            std::cout << "DEBUG: GPU executor resetting " << queue.activeWorkers 
-                      << " active workers to 0" << std::endl;
-            queue.activeWorkers = 0;
-        }
         if (profiler) {
             std::cout << "DEBUG: GPU executor stats: processed " << processedChunks << " chunks" << std::endl;
         }
@@ -0,0 +1,47 @@
+#include "kernel_selector.h"
+#include <climits>
+
+static bool int8KernelFits(const GemmNarrowKernel& kernel, const ValueRange& a, const ValueRange& b) {
+    if (!kernel.mixedSign) {
+        return a.fitsInt8() && b.fitsInt8();
+    }
+    const ValueRange& u = kernel.aUnsigned ? a : b;
+    const ValueRange& s = kernel.aUnsigned ? b : a;
+    if (!u.fitsUint8() || !s.fitsInt8()) {
+        return false;
+    }
+    // vpmaddubsw saturates each pair sum to int16.
+    return !kernel.saturates || 2 * u.maxAbs() * s.maxAbs() <= SHRT_MAX;
+}
+
+KernelSelection selectKernelWidth(
+    int k,
+    const ValueRange& a,
+    const ValueRange& b,
+    const std::vector<const GemmNarrowKernel*>& candidates) {
+    KernelSelection selection{KernelWidth::INT32, KernelWidth::INT64, 0.0, nullptr};
+    if (!a.known() || !b.known()) {
+        return selection;
+    }
+    selection.accumulatorBound = static_cast<double>(k) * a.maxAbs() * b.maxAbs();
+    if (selection.accumulatorBound <= INT_MAX) {
+        selection.accumulatorWidth = KernelWidth::INT32;
+    }
+    for (const GemmNarrowKernel* kernel : candidates) {
+        if (kernel->width == KernelWidth::INT8 && int8KernelFits(*kernel, a, b)) {
+            selection.operandWidth = KernelWidth::INT8;
+            selection.narrowKernel = kernel;
+            return selection;
+        }
+    }
+    if (a.fitsInt16() && b.fitsInt16()) {
+        for (const GemmNarrowKernel* kernel : candidates) {
+            if (kernel->width == KernelWidth::INT16) {
+                selection.operandWidth = KernelWidth::INT16;
+                selection.narrowKernel = kernel;
+                return selection;
+            }
+        }
+    }
+    return selection;
+}
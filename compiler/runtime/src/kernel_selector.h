@@ -0,0 +1,22 @@
+#pragma once
+#include <vector>
+#include "matrix_utils.h"
+#include "cpu_gemm.h"
+
+struct KernelSelection {
+    KernelWidth operandWidth;
+    KernelWidth accumulatorWidth;
+    double accumulatorBound;
+    const GemmNarrowKernel* narrowKernel;
+};
+
+// Picks the narrowest operand width the load-time value ranges allow. The
+// bound k * max|a| * max|b| decides whether int32 accumulation is exact; when
+// it is not the int32 output wraps the same way for every width, so the bound
+// is reported rather than used to reject narrow kernels. candidates are the
+// verified narrow kernels, best first; without a fit the int32 path is used.
+KernelSelection selectKernelWidth(
+    int k,
+    const ValueRange& a,
+    const ValueRange& b,
+    const std::vector<const GemmNarrowKernel*>& candidates);
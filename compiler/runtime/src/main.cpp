@@ -1,17 +1,96 @@
 #include <iostream>
 #include <fstream>
 #include <string>
+#include <cstdlib>
+#include <sstream>
+#include <vector>
 #include "runtime.h"
+#include "autotuner.h"
+
+// runtime --tune [--tune-sizes 256,512,...]: measures CPU parameters for this
+// host and stores them in the tuning file read at startup.
+static int runTuning(const std::vector<int>& sizes) {
+    CPUExecutor executor;
+    executor.initialize();
+    std::string path = defaultTuningFile();
+    std::string hostKey = hostTuningKey();
+    std::cout << "Tuning '" << hostKey << "'" << std::endl;
+    TuningTable table = runAutotuner(sizes, executor);
+    if (!saveTuningTable(path, hostKey, table)) {
+        std::cerr << "Failed to write tuning file " << path << std::endl;
+        return 1;
+    }
+    std::cout << "Wrote " << table.points().size() << " tuning points to " << path << std::endl;
+    return 0;
+}
+
+// runtime --bench-layout [--tune-sizes 1024,2048,...]: compares the
+// row-major blocked multiply with the Morton-layout recursive one.
+static int runBenchmark(const std::vector<int>& sizes) {
+    CPUExecutor executor;
+    executor.initialize();
+    runLayoutBenchmark(sizes, executor);
+    return 0;
+}
+
+static std::vector<int> parseSizes(const std::string& list) {
+    std::vector<int> sizes;
+    std::stringstream stream(list);
+    std::string item;
+    while (std::getline(stream, item, ',')) {
+        int size = std::stoi(item);
+        if (size > 0) {
+            sizes.push_back(size);
+        }
+    }
+    return sizes;
+}
 
 int main(int argc, char* argv[]) {
     if (argc < 2) {
         std::cerr << "Usage: " << argv[0] << " <bytecode.jsonl> [options]" << std::endl;
+        std::cerr << "       " << argv[0] << " --tune [--tune-sizes 256,512,1024,2048] [--tuning-file <path>]" << std::endl;
+        std::cerr << "       " << argv[0] << " --bench-layout [--tune-sizes 1024,2048,4096]" << std::endl;
         std::cerr << "Options:" << std::endl;
         std::cerr << "  --use-gpu-for-large   Enable GPU for large matrices (normally CPU-only)" << std::endl;
         std::cerr << "  --use-ane-for-large   Enable ANE for large matrices (normally CPU-only)" << std::endl;
+        std::cerr << "  --cpu-isa <tier>      Force CPU micro-kernel tier (scalar, avx2, avx512, neon)" << std::endl;
+        std::cerr << "  --tuning-file <path>  Tuning file to read or write (default ~/.cgnpu_tuning.json)" << std::endl;
+        std::cerr << "  --save-throughput     Save the CPU/GPU throughput models measured by this run" << std::endl;
         return 1;
     }
     std::string bytecodeFile = argv[1];
+    bool tune = bytecodeFile == "--tune";
+    bool benchLayout = bytecodeFile == "--bench-layout";
+    std::vector<int> tuneSizes = {256, 512, 1024, 2048};
+    if (benchLayout) {
+        tuneSizes = {1024, 2048, 4096};
+    }
+    for (int i = tune || benchLayout ? 1 : 2; i < argc; i++) {
+        std::string arg = argv[i];
+        if (arg == "--cpu-isa" && i + 1 < argc) {
+            setenv("CPU_ISA", argv[++i], 1);
+        } else if (arg.rfind("--cpu-isa=", 0) == 0) {
+            setenv("CPU_ISA", arg.substr(10).c_str(), 1);
+        } else if (arg == "--tuning-file" && i + 1 < argc) {
+            setenv("TUNING_FILE", argv[++i], 1);
+        } else if (arg == "--save-throughput") {
+            setenv("SAVE_THROUGHPUT", "1", 1);
+        } else if (arg == "--tune-sizes" && i + 1 < argc) {
+            try {
+                tuneSizes = parseSizes(argv[++i]);
+            } catch (const std::exception&) {
+                std::cerr << "Invalid --tune-sizes list" << std::endl;
+                return 1;
+            }
+        }
+    }
+    if (tune) {
+        return runTuning(tuneSizes);
+    }
+    if (benchLayout) {
+        return runBenchmark(tuneSizes);
+    }
 
     std::ifstream file(bytecodeFile);
     if (!file.is_open()) {
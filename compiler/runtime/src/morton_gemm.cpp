@@ -0,0 +1,76 @@
+#include "morton_gemm.h"
+#include "matrix_utils.h"
+#include <algorithm>
+
+constexpr std::size_t TILE_ELEMENTS = static_cast<std::size_t>(MORTON_TILE) * MORTON_TILE;
+
+// Halves m when it is the largest dimension, else n when it exceeds k, else
+// k. These are the layout's tie-breaks (rows before columns) seen from each
+// operand: A splits rows iff mt >= kt, B iff kt >= nt, C iff mt >= nt.
+// Returns true for a split along k.
+static bool splitTask(const MortonTask& t, MortonTask& first, MortonTask& second) {
+    first = t;
+    second = t;
+    if (t.mt >= t.nt && t.mt >= t.kt) {
+        int half = t.mt / 2;
+        first.mt = half;
+        second.mt = t.mt - half;
+        second.aTile += static_cast<std::size_t>(half) * t.kt;
+        second.cTile += static_cast<std::size_t>(half) * t.nt;
+        return false;
+    }
+    if (t.nt > t.kt) {
+        int half = t.nt / 2;
+        first.nt = half;
+        second.nt = t.nt - half;
+        second.bTile += static_cast<std::size_t>(t.kt) * half;
+        second.cTile += static_cast<std::size_t>(t.mt) * half;
+        return false;
+    }
+    int half = t.kt / 2;
+    first.kt = half;
+    second.kt = t.kt - half;
+    second.aTile += static_cast<std::size_t>(t.mt) * half;
+    second.bTile += static_cast<std::size_t>(half) * t.nt;
+    return true;
+}
+
+// Returns the phase after the last one the task's pieces occupy.
+static std::size_t plan(const MortonTask& task, long long limit,
+                        std::vector<std::vector<MortonTask>>& phases, std::size_t phase) {
+    if (static_cast<long long>(task.mt) * task.nt * task.kt <= limit) {
+        if (phases.size() <= phase) {
+            phases.resize(phase + 1);
+        }
+        phases[phase].push_back(task);
+        return phase + 1;
+    }
+    MortonTask first, second;
+    if (splitTask(task, first, second)) {
+        return plan(second, limit, phases, plan(first, limit, phases, phase));
+    }
+    return std::max(plan(first, limit, phases, phase), plan(second, limit, phases, phase));
+}
+
+std::vector<std::vector<MortonTask>> planMortonTasks(int mt, int nt, int kt, long long maxTileProducts) {
+    std::vector<std::vector<MortonTask>> phases;
+    plan(MortonTask{0, 0, 0, mt, nt, kt}, std::max(1LL, maxTileProducts), phases, 0);
+    return phases;
+}
+
+template <typename T>
+void mortonGemm(const T* a, const T* b, T* c, const MortonTask& task, GemmFixedKernel<T> tileKernel) {
+    if (task.mt == 1 && task.nt == 1 && task.kt == 1) {
+        tileKernel(a + task.aTile * TILE_ELEMENTS, MORTON_TILE, b + task.bTile * TILE_ELEMENTS, MORTON_TILE,
+                   c + task.cTile * TILE_ELEMENTS, MORTON_TILE);
+        return;
+    }
+    MortonTask first, second;
+    splitTask(task, first, second);
+    mortonGemm(a, b, c, first, tileKernel);
+    mortonGemm(a, b, c, second, tileKernel);
+}
+
+template void mortonGemm<int>(const int*, const int*, int*, const MortonTask&, GemmFixedKernel<int>);
+template void mortonGemm<float>(const float*, const float*, float*, const MortonTask&, GemmFixedKernel<float>);
+template void mortonGemm<double>(const double*, const double*, double*, const MortonTask&, GemmFixedKernel<double>);
@@ -0,0 +1,30 @@
+#pragma once
+#include <cstddef>
+#include <vector>
+#include "small_gemm.h"
+
+// A block of C += A * B over MORTON-layout operands: the first tile of each
+// operand's block and the block sizes in tiles. A block spans mt x kt tiles
+// of A, kt x nt of B and mt x nt of C.
+struct MortonTask {
+    std::size_t aTile;
+    std::size_t bTile;
+    std::size_t cTile;
+    int mt;
+    int nt;
+    int kt;
+};
+
+// Splits the whole multiply into phases of tasks holding at most
+// maxTileProducts tile multiplies each. Tasks within a phase write disjoint
+// blocks of C; a split along k adds both halves into the same block, so its
+// halves land in consecutive phases.
+std::vector<std::vector<MortonTask>> planMortonTasks(int mt, int nt, int kt, long long maxTileProducts);
+
+// Cache-oblivious C += A * B for one task. The largest of m, n and k is
+// halved in the same order the layout was built in, so every sub-block is
+// contiguous and the working set fits each cache level at some depth with no
+// block sizes to tune. Single tiles go to tileKernel, the accumulating
+// MORTON_TILE^3 fixed-size kernel.
+template <typename T>
+void mortonGemm(const T* a, const T* b, T* c, const MortonTask& task, GemmFixedKernel<T> tileKernel);
@@ -0,0 +1,241 @@
+#include "partition_planner.h"
+#include "autotuner.h"
+#include <nlohmann/json.hpp>
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include <iostream>
+#include <limits>
+#include <numeric>
+#include <stdexcept>
+
+static const char* const DEVICE_NAMES[3] = {"CPU", "GPU", "ANE"};
+// Relative rates of unmeasured devices; the ANE is a stub and gets nothing.
+constexpr double PRIOR_GFLOPS[3] = {35.0, 65.0, 0.0};
+// Runs a sample averages over before it turns into a moving average.
+constexpr int OBSERVE_WINDOW = 8;
+
+// Inverse of kernelWidthToString.
+static bool stringToKernelWidth(const std::string& name, KernelWidth& width) {
+    for (KernelWidth candidate : {KernelWidth::INT8, KernelWidth::INT16, KernelWidth::INT32, KernelWidth::INT64}) {
+        if (name == kernelWidthToString(candidate)) {
+            width = candidate;
+            return true;
+        }
+    }
+    return false;
+}
+
+static int roundLog2(int value) {
+    return static_cast<int>(std::lround(std::log2(std::max(1, value))));
+}
+
+static double chunkFlops(const WorkChunk& chunk, int k) {
+    return 2.0 * (chunk.endRow - chunk.startRow) * (chunk.endCol - chunk.startCol) * static_cast<double>(k);
+}
+
+void PartitionPlanner::load(const std::string& path, const std::string& hostKey) {
+    for (auto& deviceSamples : samples) {
+        deviceSamples.clear();
+    }
+    dirty = false;
+    nlohmann::json j = readTuningFile(path);
+    if (!j.contains("hosts") || !j["hosts"].contains(hostKey) || !j["hosts"][hostKey].contains("throughput")) {
+        return;
+    }
+    try {
+        const nlohmann::json& throughput = j["hosts"][hostKey]["throughput"];
+        for (int d = 0; d < 3; d++) {
+            if (!throughput.contains(DEVICE_NAMES[d])) {
+                continue;
+            }
+            for (const auto& s : throughput[DEVICE_NAMES[d]]) {
+                // Samples written before models were split by kind mix them all.
+                if (!s.contains("dtype")) {
+                    continue;
+                }
+                ThroughputSample sample;
+                sample.kind.dtype = stringToDType(s.at("dtype").get<std::string>());
+                if (!stringToKernelWidth(s.at("width").get<std::string>(), sample.kind.width)) {
+                    throw std::runtime_error("unknown kernel width");
+                }
+                sample.kind.fused = s.at("fused").get<bool>();
+                sample.rowsLog2 = roundLog2(s.at("rows").get<int>());
+                sample.colsLog2 = roundLog2(s.at("cols").get<int>());
+                sample.kLog2 = roundLog2(s.at("k").get<int>());
+                sample.gflops = s.at("gflops").get<double>();
+                sample.runs = s.value("runs", 1);
+                if (!(sample.gflops > 0.0) || sample.runs <= 0) {
+                    throw std::runtime_error("non-positive throughput sample");
+                }
+                samples[d].push_back(sample);
+            }
+        }
+    } catch (const std::exception& e) {
+        std::cout << "WARNING: Ignoring malformed throughput models in " << path << ": " << e.what() << std::endl;
+        for (auto& deviceSamples : samples) {
+            deviceSamples.clear();
+        }
+    }
+}
+
+bool PartitionPlanner::save(const std::string& path, const std::string& hostKey) {
+    nlohmann::json j = readTuningFile(path);
+    nlohmann::json throughput = nlohmann::json::object();
+    for (int d = 0; d < 3; d++) {
+        if (samples[d].empty()) {
+            continue;
+        }
+        nlohmann::json list = nlohmann::json::array();
+        for (const ThroughputSample& sample : samples[d]) {
+            list.push_back({
+                {"dtype", dtypeToString(sample.kind.dtype)},
+                {"width", kernelWidthToString(sample.kind.width)},
+                {"fused", sample.kind.fused},
+                {"rows", 1 << sample.rowsLog2},
+                {"cols", 1 << sample.colsLog2},
+                {"k", 1 << sample.kLog2},
+                {"gflops", sample.gflops},
+                {"runs", sample.runs}
+            });
+        }
+        throughput[DEVICE_NAMES[d]] = list;
+    }
+    j["hosts"][hostKey]["throughput"] = throughput;
+    if (!writeTuningFile(path, j)) {
+        return false;
+    }
+    dirty = false;
+    return true;
+}
+
+bool PartitionPlanner::measured(DeviceType device, const ThroughputKind& kind) const {
+    const auto& deviceSamples = samples[static_cast<int>(device)];
+    return std::any_of(deviceSamples.begin(), deviceSamples.end(),
+                       [&kind](const ThroughputSample& sample) { return sample.kind == kind; });
+}
+
+// Closest in log2 space, summed over the three dimensions, among the
+// samples of the kind.
+const ThroughputSample* PartitionPlanner::nearest(int device, const ThroughputKind& kind, int rowsLog2,
+                                                  int colsLog2, int kLog2) const {
+    const ThroughputSample* best = nullptr;
+    int bestDistance = std::numeric_limits<int>::max();
+    for (const ThroughputSample& sample : samples[device]) {
+        if (!(sample.kind == kind)) {
+            continue;
+        }
+        int distance = std::abs(sample.rowsLog2 - rowsLog2) + std::abs(sample.colsLog2 - colsLog2) +
+                       std::abs(sample.kLog2 - kLog2);
+        if (distance < bestDistance) {
+            best = &sample;
+            bestDistance = distance;
+        }
+    }
+    return best;
+}
+
+double PartitionPlanner::rate(DeviceType device, const ThroughputKind& kind, int rows, int cols, int k) const {
+    int d = static_cast<int>(device);
+    int rowsLog2 = roundLog2(rows);
+    int colsLog2 = roundLog2(cols);
+    int kLog2 = roundLog2(k);
+    if (const ThroughputSample* own = nearest(d, kind, rowsLog2, colsLog2, kLog2)) {
+        return own->gflops;
+    }
+    for (int other = 0; other < 3; other++) {
+        if (other == d || PRIOR_GFLOPS[other] <= 0.0) {
+            continue;
+        }
+        if (const ThroughputSample* sample = nearest(other, kind, rowsLog2, colsLog2, kLog2)) {
+            return sample->gflops * PRIOR_GFLOPS[d] / PRIOR_GFLOPS[other];
+        }
+    }
+    return PRIOR_GFLOPS[d];
+}
+
+double PartitionPlanner::predict(DeviceType device, const ThroughputKind& kind, const std::vector<WorkChunk>& chunks,
+                                 int k) const {
+    double seconds = 0.0;
+    for (const WorkChunk& chunk : chunks) {
+        double gflops = rate(device, kind, chunk.endRow - chunk.startRow, chunk.endCol - chunk.startCol, k);
+        if (gflops <= 0.0) {
+            return std::numeric_limits<double>::infinity();
+        }
+        seconds += chunkFlops(chunk, k) / (gflops * 1e9);
+    }
+    return seconds;
+}
+
+void PartitionPlanner::observe(DeviceType device, const ThroughputKind& kind, int rows, int cols, int k,
+                               double gflops) {
+    if (!(gflops > 0.0) || !std::isfinite(gflops)) {
+        return;
+    }
+    int d = static_cast<int>(device);
+    ThroughputSample key{kind, roundLog2(rows), roundLog2(cols), roundLog2(k), gflops, 1};
+    auto it = std::find_if(samples[d].begin(), samples[d].end(), [&key](const ThroughputSample& s) {
+        return s.kind == key.kind && s.rowsLog2 == key.rowsLog2 && s.colsLog2 == key.colsLog2 && s.kLog2 == key.kLog2;
+    });
+    if (it == samples[d].end()) {
+        samples[d].push_back(key);
+    } else {
+        it->runs++;
+        it->gflops += (gflops - it->gflops) / std::min(it->runs, OBSERVE_WINDOW);
+    }
+    dirty = true;
+}
+
+PartitionPlan PartitionPlanner::plan(const std::vector<WorkChunk>& chunks, const ThroughputKind& kind, int k,
+                                     const bool enabled[3]) const {
+    PartitionPlan result;
+    int count = static_cast<int>(chunks.size());
+    std::vector<double> cost[3];
+    for (int d = 0; d < 3; d++) {
+        cost[d].assign(count, std::numeric_limits<double>::infinity());
+        if (!enabled[d]) {
+            continue;
+        }
+        for (int i = 0; i < count; i++) {
+            const WorkChunk& chunk = chunks[i];
+            double gflops = rate(static_cast<DeviceType>(d), kind, chunk.endRow - chunk.startRow,
+                                 chunk.endCol - chunk.startCol, k);
+            if (gflops > 0.0) {
+                cost[d][i] = chunkFlops(chunk, k) / (gflops * 1e9);
+            }
+        }
+    }
+    // HEFT ranks independent tasks by their cost on the fastest device.
+    std::vector<double> rank(count);
+    for (int i = 0; i < count; i++) {
+        rank[i] = std::min({cost[0][i], cost[1][i], cost[2][i]});
+    }
+    std::vector<int> order(count);
+    std::iota(order.begin(), order.end(), 0);
+    std::stable_sort(order.begin(), order.end(), [&rank](int x, int y) { return rank[x] > rank[y]; });
+    std::vector<int> assigned[3];
+    double finish[3] = {0.0, 0.0, 0.0};
+    for (int i : order) {
+        // Chunks no enabled device can price stay on the CPU.
+        int best = 0;
+        double bestFinish = std::numeric_limits<double>::infinity();
+        for (int d = 0; d < 3; d++) {
+            if (enabled[d] && finish[d] + cost[d][i] < bestFinish) {
+                best = d;
+                bestFinish = finish[d] + cost[d][i];
+            }
+        }
+        if (std::isfinite(bestFinish)) {
+            finish[best] = bestFinish;
+        }
+        assigned[best].push_back(i);
+    }
+    for (int d = 0; d < 3; d++) {
+        std::sort(assigned[d].begin(), assigned[d].end());
+        for (int i : assigned[d]) {
+            result.work[d].push_back(chunks[i]);
+        }
+        result.predictedFinish[d] = finish[d];
+    }
+    return result;
+}
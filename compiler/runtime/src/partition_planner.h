@@ -0,0 +1,72 @@
+#pragma once
+#include <string>
+#include <vector>
+#include "cpu_gemm.h"
+#include "matrix_utils.h"
+#include "work_stealing.h"
+
+// What a multiply's chunks run: the element type, the CPU operand width the
+// value ranges picked and whether a fused epilogue follows. These change a
+// device's rate several times over, so each kind has its own models.
+struct ThroughputKind {
+    DType dtype = DType::I32;
+    KernelWidth width = KernelWidth::INT32;
+    bool fused = false;
+    bool operator==(const ThroughputKind& other) const {
+        return dtype == other.dtype && width == other.width && fused == other.fused;
+    }
+};
+
+// GFLOP/s one device reached on chunks of one kind and shape. Shapes are
+// keyed by rows, cols and k rounded to the nearest power of two.
+struct ThroughputSample {
+    ThroughputKind kind;
+    int rowsLog2;
+    int colsLog2;
+    int kLog2;
+    double gflops;
+    int runs;
+};
+
+// The chunks each device starts with, indexed by DeviceType, and when the
+// models expect each device to finish them.
+struct PartitionPlan {
+    std::vector<WorkChunk> work[3];
+    double predictedFinish[3] = {0.0, 0.0, 0.0};
+};
+
+// Per-device throughput models and the initial split they drive. A device
+// runs at the rate of its sample of the same kind nearest in shape to the
+// chunk. A device unmeasured on that kind is scaled from one measured on it
+// by the built-in priors, which reproduce the old 65/35 GPU/CPU split until
+// both have run.
+class PartitionPlanner {
+public:
+    // Replaces the models with this host's entry in the tuning file; devices
+    // missing from it start unmeasured.
+    void load(const std::string& path, const std::string& hostKey);
+    // Writes the models into this host's entry, keeping its tuning points.
+    bool save(const std::string& path, const std::string& hostKey);
+    bool measured(DeviceType device, const ThroughputKind& kind) const;
+    // Whether observe() has run since the last load or save.
+    bool changed() const { return dirty; }
+    // Predicted GFLOP/s of the device on a rows x cols chunk over k.
+    double rate(DeviceType device, const ThroughputKind& kind, int rows, int cols, int k) const;
+    // Predicted seconds for the device to run chunks one after another.
+    double predict(DeviceType device, const ThroughputKind& kind, const std::vector<WorkChunk>& chunks,
+                   int k) const;
+    // Folds one run's throughput into the sample for its chunk shape: a
+    // plain mean over the first runs, then a moving average.
+    void observe(DeviceType device, const ThroughputKind& kind, int rows, int cols, int k, double gflops);
+    // HEFT for independent chunks: from the most expensive down, each chunk
+    // goes to the enabled device that would finish it earliest, given what
+    // that device already holds. Each device keeps its chunks in their
+    // original order. Stealing only has to absorb the models' error.
+    PartitionPlan plan(const std::vector<WorkChunk>& chunks, const ThroughputKind& kind, int k,
+                       const bool enabled[3]) const;
+private:
+    std::vector<ThroughputSample> samples[3];
+    bool dirty = false;
+    const ThroughputSample* nearest(int device, const ThroughputKind& kind, int rowsLog2, int colsLog2,
+                                    int kLog2) const;
+};
@@ -44,6 +44,21 @@ void Profiler::recordStealEvent(const std::string& fromDevice, const std::string
     stealStats[key].count++;
 }
 
+void Profiler::recordMetric(const std::string& name, double value, const std::string& unit) {
+    for (auto& metric : metrics) {
+        if (metric.name == name) {
+            metric.value = value;
+            metric.unit = unit;
+            return;
+        }
+    }
+    metrics.push_back({name, value, unit});
+}
+
+void Profiler::recordDeviceFinish(const std::string& device, double predicted, double actual) {
+    finishTimes[device] = {predicted, actual};
+}
+
 void Profiler::disableWorkStealing() {
     workStealingDisabled = true;
     stealStats.clear();
@@ -189,7 +204,25 @@ void Profiler::printReport() {
     }
     std::cout << "\n WORK DISTRIBUTION:" << std::endl;
     std::cout << "-------------------" << std::endl;
-    std::cout << "   Initial distribution: 80/20 between GPU and CPU" << std::endl;
+    bool anyFinishTimes = false;
+    for (const char* device : {"CPU", "GPU", "ANE"}) {
+        auto it = finishTimes.find(device);
+        if (it == finishTimes.end() || (it->second.predicted <= 0.0 && it->second.actual <= 0.0)) {
+            continue;
+        }
+        if (!anyFinishTimes) {
+            std::cout << "   Initial split from the per-device throughput models:" << std::endl;
+            anyFinishTimes = true;
+        }
+        std::cout << "   • " << device << ": predicted finish " << formatTime(it->second.predicted)
+                  << ", actual " << formatTime(it->second.actual);
+        if (it->second.predicted > 0.0 && it->second.actual > 0.0) {
+            std::cout << " (" << std::showpos << std::fixed << std::setprecision(1)
+                      << 100.0 * (it->second.actual - it->second.predicted) / it->second.predicted
+                      << std::noshowpos << "%)";
+        }
+        std::cout << std::endl;
+    }
     std::cout << "   ANE executor disabled (stub implementation)" << std::endl;
     if (!stealStats.empty()) {
         std::cout << "\n🔀 WORK STEALING EVENTS:" << std::endl;
@@ -249,6 +282,19 @@ void Profiler::printReport() {
             std::cout << "   No devices had any chunks to process." << std::endl;
         }
     }
+    if (!metrics.empty()) {
+        std::cout << "\n ALGORITHM METRICS:" << std::endl;
+        std::cout << "------------------" << std::endl;
+        for (const auto& metric : metrics) {
+            int precision = metric.value == static_cast<long long>(metric.value) ? 0 : 2;
+            std::cout << "   • " << metric.name << ": " << std::fixed << std::setprecision(precision)
+                      << metric.value;
+            if (!metric.unit.empty()) {
+                std::cout << " " << metric.unit;
+            }
+            std::cout << std::endl;
+        }
+    }
     std::cout << "\n--- DETAILED STATISTICS ---" << std::endl;
     std::cout << "\nDevice Statistics:" << std::endl;
     std::cout << "-----------------" << std::endl;
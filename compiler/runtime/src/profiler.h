@@ -2,6 +2,7 @@
 #include <chrono>
 #include <string>
 #include <unordered_map>
+#include <vector>
 
 class Profiler {
 public:
@@ -12,6 +13,10 @@ public:
     void recordChunkExecution(const std::string& device, int chunkSize);
     void recordStealEvent(const std::string& fromDevice, const std::string& toDevice);
     void recordInitialAllocation(const std::string& device, int chunkCount, int totalChunks);
+    void recordMetric(const std::string& name, double value, const std::string& unit);
+    // When the partition planner expected the device to finish its share of
+    // the last multiply, and when it did, in seconds from the start.
+    void recordDeviceFinish(const std::string& device, double predicted, double actual);
     void disableWorkStealing();
     void printReport();
     double getTotalTime(const std::string& name);
@@ -31,9 +36,20 @@ private:
     struct StealStats {
         int count;
     };
+    struct FinishTimes {
+        double predicted;
+        double actual;
+    };
+    struct Metric {
+        std::string name;
+        double value;
+        std::string unit;
+    };
     std::unordered_map<std::string, TimerData> timers;
     std::unordered_map<std::string, DeviceStats> deviceStats;
     std::unordered_map<std::string, StealStats> stealStats;
+    std::vector<Metric> metrics;
+    std::unordered_map<std::string, FinishTimes> finishTimes;
     bool workStealingDisabled = false;
     std::string formatTime(double seconds);
 };
\ No newline at end of file
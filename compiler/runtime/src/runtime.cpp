@@ -1,10 +1,34 @@
 #include "runtime.h"
 #include <iostream>
 #include <algorithm>
+#include <cstring>
 #include <stdexcept>
+#include <limits>
+#include <cstdlib>
+#include <cmath>
+#include <cstdint>
+#include <type_traits>
 
-Runtime::Runtime() {
+Runtime::Runtime() : layout(MatrixLayout::ROW_MAJOR), tileSize(64) {
     deviceManager.initialize();
+    const char* layoutEnv = std::getenv("MATRIX_LAYOUT");
+    if (layoutEnv != nullptr && !stringToLayout(layoutEnv, layout)) {
+        std::cout << "WARNING: Unknown MATRIX_LAYOUT value '" << layoutEnv << "', using row-major" << std::endl;
+    }
+    const char* tileEnv = std::getenv("MATRIX_TILE");
+    if (tileEnv != nullptr) {
+        int value = std::atoi(tileEnv);
+        if (value > 0) {
+            tileSize = value;
+        } else {
+            std::cout << "WARNING: Invalid MATRIX_TILE value '" << tileEnv << "', using " << tileSize << std::endl;
+        }
+    }
+    std::cout << "DEBUG: Matrix layout " << layoutToString(layout);
+    if (layout == MatrixLayout::TILED) {
+        std::cout << ", " << tileSize << " tiles";
+    }
+    std::cout << std::endl;
 }
 
 Runtime::~Runtime() {
@@ -16,6 +40,7 @@ Runtime::~Runtime() {
 void Runtime::execute(const Program& program) {
     std::cout << "DEBUG: Starting execution of program with " << program.instructions.size() << " instructions" << std::endl;
     profiler.startTimer("total_execution");
+    prebindFixedKernels(program);
     try {
         for (const auto& instr : program.instructions) {
             std::cout << "DEBUG: Executing instruction: " << instructionToString(instr.operation) << std::endl;
@@ -39,31 +64,62 @@ void Runtime::executeInstruction(const BytecodeInstruction& instr) {
             if (!(std::cin >> value)) {
                 throw std::runtime_error("Failed to read integer");
             }
-            variables["n"] = value;
+            variables[instr.label.empty() ? "n" : instr.label] = value;
             break;
         }
         case Instruction::READ_MATRIX: {
-            int size = variables["n"];
-            if (size <= 0) {
-                throw std::runtime_error("Invalid matrix size");
+            int batch, rows, cols;
+            resolveShape(instr, batch, rows, cols);
+            if (matrices.find(instr.label) == matrices.end()) {
+                matrices[instr.label] = createMatrix(instr, batch, rows, cols);
             }
-            readMatrix(size, instr.label);
+            readMatrix(instr.label);
+            bindSlot(instr);
             break;
         }
         case Instruction::ALLOC_MATRIX: {
-            int size = variables["n"];
-            if (size <= 0) {
-                throw std::runtime_error("Invalid matrix size");
-            }
+            int batch, rows, cols;
+            resolveShape(instr, batch, rows, cols);
             if (matrices.find(instr.label) == matrices.end()) {
-                matrices[instr.label] = new MatrixBuffer(size);
+                matrices[instr.label] = createMatrix(instr, batch, rows, cols);
             }
+            bindSlot(instr);
             break;
         }
         case Instruction::MATRIX_MULTIPLY: {
             executeMatrixMultiplication(instr);
             break;
         }
+        case Instruction::MATRIX_MULTIPLY_BATCHED: {
+            executeBatchedMultiplication(instr);
+            break;
+        }
+        case Instruction::GEMM: {
+            executeGemm(instr);
+            break;
+        }
+        case Instruction::MATRIX_POWER: {
+            executeMatrixPower(instr);
+            break;
+        }
+        case Instruction::MATRIX_MULTIPLY_MOD: {
+            executeModularMultiplication(instr);
+            break;
+        }
+        case Instruction::MATRIX_MULTIPLY_EXACT: {
+            executeExactMultiplication(instr);
+            break;
+        }
+        case Instruction::ADD:
+        case Instruction::SUB:
+        case Instruction::SCALE: {
+            executeElementwise(instr);
+            break;
+        }
+        case Instruction::TRANSPOSE: {
+            executeTranspose(instr);
+            break;
+        }
         case Instruction::WRITE_MATRIX: {
             std::string outputName = "result";  
             if (!instr.operands.empty()) {
@@ -84,6 +140,180 @@ void Runtime::executeInstruction(const BytecodeInstruction& instr) {
     }
 }
 
+static const char* WIDE_OPERAND_ERROR = "Wide integer matrices only hold MATRIX_MULTIPLY_EXACT results";
+
+// Shape entries are dimension variables, or decimal literals when the
+// compiler saw a constant size.
+static bool isConstantDimension(const std::string& entry) {
+    return !entry.empty() && std::all_of(entry.begin(), entry.end(), [](char c) { return c >= '0' && c <= '9'; });
+}
+
+int Runtime::dimensionValue(const std::string& entry) {
+    if (isConstantDimension(entry)) {
+        return std::stoi(entry);
+    }
+    return variables[entry];
+}
+
+// Looks up the matrix's dimensions; bytecode without a shape describes an
+// n x n matrix, and a three-entry shape a batch of matrices.
+void Runtime::resolveShape(const BytecodeInstruction& instr, int& batch, int& rows, int& cols) {
+    batch = 1;
+    if (instr.shape.empty()) {
+        rows = cols = variables["n"];
+    } else if (instr.shape.size() == 2) {
+        rows = dimensionValue(instr.shape[0]);
+        cols = dimensionValue(instr.shape[1]);
+    } else if (instr.shape.size() == 3) {
+        batch = dimensionValue(instr.shape[0]);
+        rows = dimensionValue(instr.shape[1]);
+        cols = dimensionValue(instr.shape[2]);
+    } else {
+        throw std::runtime_error("Invalid shape for matrix " + instr.label);
+    }
+    if (batch <= 0 || rows <= 0 || cols <= 0) {
+        throw std::runtime_error("Invalid matrix size");
+    }
+}
+
+// When every operand of a multiply has a constant shape, binds the matching
+// compile-time kernel before execution starts instead of at dispatch.
+void Runtime::prebindFixedKernels(const Program& program) {
+    struct ConstantShape { int rows; int cols; };
+    std::unordered_map<std::string, ConstantShape> shapes;
+    std::unordered_map<int, std::string> labels;
+    for (const auto& instr : program.instructions) {
+        if (instr.operation == Instruction::READ_MATRIX || instr.operation == Instruction::ALLOC_MATRIX) {
+            if (!instr.operands.empty()) {
+                labels[instr.operands[0]] = instr.label;
+            }
+            if (instr.shape.size() >= 2 &&
+                std::all_of(instr.shape.begin(), instr.shape.end(), isConstantDimension)) {
+                std::size_t first = instr.shape.size() - 2;
+                shapes[instr.label] = {std::stoi(instr.shape[first]), std::stoi(instr.shape[first + 1])};
+            }
+            continue;
+        }
+        std::string aName, bName;
+        if (instr.operation == Instruction::MATRIX_MULTIPLY && instr.semiring == Semiring::PLUS_TIMES) {
+            aName = "matrix1";
+            bName = "matrix2";
+        } else if ((instr.operation == Instruction::MATRIX_MULTIPLY_BATCHED || instr.operation == Instruction::GEMM) &&
+                   instr.operands.size() >= 2) {
+            aName = labels[instr.operands[0]];
+            bName = labels[instr.operands[1]];
+        } else {
+            continue;
+        }
+        auto a = shapes.find(aName);
+        auto b = shapes.find(bName);
+        if (a != shapes.end() && b != shapes.end() && a->second.cols == b->second.rows) {
+            deviceManager.getCPUExecutor()->bindFixedKernel(instr.dtype, a->second.rows, b->second.cols,
+                                                            a->second.cols);
+        }
+    }
+}
+
+// Batches stay row-major. A matrix's tiles depend on its role in the
+// multiply that reads it, so TILED matrices also start row-major and
+// tileOperand() cuts them when that multiply runs.
+MatrixBuffer* Runtime::createMatrix(const BytecodeInstruction& instr, int batch, int rows, int cols) const {
+    if (instr.shape.size() == 3 || layout != MatrixLayout::MORTON) {
+        return new MatrixBuffer(batch, rows, cols, instr.dtype);
+    }
+    return new MatrixBuffer(batch, rows, cols, instr.dtype, layout);
+}
+
+// A copy of matrix in another layout, with the same values and stats.
+static std::unique_ptr<MatrixBuffer> copyInLayout(MatrixBuffer* matrix, MatrixLayout target, int tileHeight,
+                                                  int tileWidth) {
+    auto copy = std::make_unique<MatrixBuffer>(matrix->batch, matrix->rows, matrix->cols, matrix->dtype, target,
+                                               tileHeight, tileWidth);
+    size_t size = dtypeSize(matrix->dtype);
+    const char* src = reinterpret_cast<const char*>(matrix->getCPUReadPtr());
+    char* dst = reinterpret_cast<char*>(copy->getCPUWritePtr());
+    for (int i = 0; i < matrix->batch * matrix->rows; i++) {
+        for (int j = 0; j < matrix->cols;) {
+            int span = std::min({matrix->cols - j, matrix->tileWidth - j % matrix->tileWidth,
+                                 copy->tileWidth - j % copy->tileWidth});
+            std::memcpy(dst + copy->index(i, j) * size, src + matrix->index(i, j) * size, span * size);
+            j += span;
+        }
+    }
+    copy->releaseCPUAccess();
+    matrix->releaseCPUAccess();
+    copy->valueRange = matrix->valueRange;
+    copy->nonZeros = matrix->nonZeros;
+    return copy;
+}
+
+// Replaces matrix, under every name bound to it, with a copy in the target
+// layout; returns it unchanged when it is already laid out that way.
+MatrixBuffer* Runtime::relayout(MatrixBuffer* matrix, MatrixLayout target, int tileHeight, int tileWidth) {
+    if (matrix->layout == target &&
+        (target != MatrixLayout::TILED ||
+         (matrix->tileHeight == std::min(tileHeight, matrix->rows) &&
+          matrix->tileWidth == std::min(tileWidth, matrix->cols)))) {
+        return matrix;
+    }
+    MatrixBuffer* copy = copyInLayout(matrix, target, tileHeight, tileWidth).release();
+    for (auto& pair : matrices) {
+        if (pair.second == matrix) {
+            pair.second = copy;
+            std::cout << "DEBUG: Matrix " << pair.first << " now " << layoutToString(target);
+            if (target == MatrixLayout::TILED) {
+                std::cout << " in " << copy->tileHeight << "x" << copy->tileWidth << " tiles";
+            }
+            std::cout << std::endl;
+        }
+    }
+    delete matrix;
+    return copy;
+}
+
+// Instructions other than the plain multiply and GEMM read row-major
+// matrices; a tiled one is converted back first.
+MatrixBuffer* Runtime::rowMajor(MatrixBuffer* matrix) {
+    if (matrix->layout != MatrixLayout::TILED) {
+        return matrix;
+    }
+    return relayout(matrix, MatrixLayout::ROW_MAJOR, 0, 0);
+}
+
+// Cuts a tiled multiply's operand to what one chunk reads: tileSize x k row
+// panels for A, k x tileSize column panels for B and square tiles for C and
+// the post-op matrices. A matrix already placed with other tiles in this
+// multiply, such as A in A * A, gets a copy for its second role. Operands
+// must all be looked up before the first one is placed.
+MatrixBuffer* Runtime::tileOperand(MatrixBuffer* matrix, int tileHeight, int tileWidth, TiledOperands& operands) {
+    auto placed = operands.placed.find(matrix);
+    if (placed == operands.placed.end()) {
+        MatrixBuffer* tiled = relayout(matrix, MatrixLayout::TILED, tileHeight, tileWidth);
+        operands.placed[matrix] = tiled;
+        return tiled;
+    }
+    MatrixBuffer* tiled = placed->second;
+    if (tiled->tileHeight == std::min(tileHeight, tiled->rows) && tiled->tileWidth == std::min(tileWidth, tiled->cols)) {
+        return tiled;
+    }
+    operands.copies.push_back(copyInLayout(tiled, MatrixLayout::TILED, tileHeight, tileWidth));
+    return operands.copies.back().get();
+}
+
+void Runtime::bindSlot(const BytecodeInstruction& instr) {
+    if (!instr.operands.empty()) {
+        slots[instr.operands[0]] = instr.label;
+    }
+}
+
+MatrixBuffer* Runtime::slotMatrix(int slot) {
+    auto name = slots.find(slot);
+    if (name == slots.end() || matrices.find(name->second) == matrices.end()) {
+        throw std::runtime_error("No matrix bound to slot " + std::to_string(slot));
+    }
+    return matrices[name->second];
+}
+
 void Runtime::executeMatrixMultiplication(const BytecodeInstruction& instr) {
     std::cout << "DEBUG: Starting matrix multiplication" << std::endl;
     if (instr.operands.size() < 3) {
@@ -101,28 +331,505 @@ void Runtime::executeMatrixMultiplication(const BytecodeInstruction& instr) {
     auto* matrix1 = matrices[matrix1Name];
     auto* matrix2 = matrices[matrix2Name];
     auto* result = matrices[resultName];
-    std::cout << "DEBUG: Matrix sizes - A: " << matrix1->size << "x" << matrix1->size 
-              << ", B: " << matrix2->size << "x" << matrix2->size 
-              << ", Result: " << result->size << "x" << result->size << std::endl;
+    if (matrix1->dtype != matrix2->dtype || matrix1->dtype != result->dtype) {
+        throw std::runtime_error(std::string("Matrix element types differ: ") + dtypeToString(matrix1->dtype) +
+                                 ", " + dtypeToString(matrix2->dtype) + ", " + dtypeToString(result->dtype));
+    }
+    if (isWideInteger(matrix1->dtype)) {
+        throw std::runtime_error(WIDE_OPERAND_ERROR);
+    }
+    std::cout << "DEBUG: Matrix sizes - A: " << matrix1->rows << "x" << matrix1->cols 
+              << ", B: " << matrix2->rows << "x" << matrix2->cols 
+              << ", Result: " << result->rows << "x" << result->cols
+              << " (" << dtypeToString(matrix1->dtype) << ")" << std::endl;
+    if (matrix1->cols != matrix2->rows || result->rows != matrix1->rows || result->cols != matrix2->cols) {
+        throw std::runtime_error("Matrix shapes do not match for multiplication");
+    }
+    if (matrix1->batch != 1 || matrix2->batch != 1 || result->batch != 1) {
+        throw std::runtime_error("MATRIX_MULTIPLY on a batch, use MATRIX_MULTIPLY_BATCHED");
+    }
+    if (instr.semiring != Semiring::PLUS_TIMES) {
+        matrix1 = rowMajor(matrix1);
+        matrix2 = rowMajor(matrix2);
+        result = rowMajor(result);
+        if (matrix1->layout != MatrixLayout::ROW_MAJOR || matrix2->layout != MatrixLayout::ROW_MAJOR ||
+            result->layout != MatrixLayout::ROW_MAJOR) {
+            throw std::runtime_error("Semiring multiplication needs row-major matrices");
+        }
+        if (instr.semiring == Semiring::OR_AND && matrix1->dtype != DType::I32) {
+            throw std::runtime_error("or_and multiplication needs i32 matrices");
+        }
+        std::cout << "DEBUG: Dispatching " << semiringToString(instr.semiring) << " multiplication to device manager"
+                  << std::endl;
+        profiler.startTimer("matrix_multiplication");
+        deviceManager.executeSemiringMultiplication(matrix1, matrix2, result, instr.semiring);
+        profiler.stopTimer("matrix_multiplication");
+        result->clearValueStats();
+        std::cout << "DEBUG: Matrix multiplication completed" << std::endl;
+        return;
+    }
+    TiledOperands tiled;
+    if (layout == MatrixLayout::TILED) {
+        matrix1 = tileOperand(matrix1, tileSize, matrix1->cols, tiled);
+        matrix2 = tileOperand(matrix2, matrix2->rows, tileSize, tiled);
+        result = tileOperand(result, tileSize, tileSize, tiled);
+    }
     std::cout << "DEBUG: Dispatching matrix multiplication to device manager" << std::endl;
     profiler.startTimer("matrix_multiplication");
     deviceManager.executeMatrixMultiplication(matrix1, matrix2, result);
     profiler.stopTimer("matrix_multiplication");
+    result->clearValueStats();
     std::cout << "DEBUG: Matrix multiplication completed" << std::endl;
 }
 
-void Runtime::readMatrix(int size, std::string name) {
-    if (matrices.find(name) == matrices.end()) {
-        matrices[name] = new MatrixBuffer(size);
+// Operands are the slots of A, B and C. B may hold a single matrix that
+// multiplies every matrix of A. C must be separate from both: the kernels
+// write rows of C while later row blocks still read the operands.
+void Runtime::executeBatchedMultiplication(const BytecodeInstruction& instr) {
+    if (instr.operands.size() < 3) {
+        throw std::runtime_error("Invalid batched multiply operands");
+    }
+    auto* matrix1 = rowMajor(slotMatrix(instr.operands[0]));
+    auto* matrix2 = rowMajor(slotMatrix(instr.operands[1]));
+    auto* result = rowMajor(slotMatrix(instr.operands[2]));
+    if (result == matrix1 || result == matrix2) {
+        throw std::runtime_error("Batched multiplication needs a result separate from its operands");
+    }
+    if (matrix1->dtype != matrix2->dtype || matrix1->dtype != result->dtype) {
+        throw std::runtime_error("Matrix element types differ in batched multiply");
+    }
+    if (isWideInteger(matrix1->dtype)) {
+        throw std::runtime_error(WIDE_OPERAND_ERROR);
+    }
+    if (matrix1->cols != matrix2->rows || result->rows != matrix1->rows || result->cols != matrix2->cols ||
+        result->batch != matrix1->batch || (matrix2->batch != 1 && matrix2->batch != matrix1->batch)) {
+        throw std::runtime_error("Matrix shapes do not match for batched multiplication");
+    }
+    if (matrix1->layout != MatrixLayout::ROW_MAJOR || matrix2->layout != MatrixLayout::ROW_MAJOR ||
+        result->layout != MatrixLayout::ROW_MAJOR) {
+        throw std::runtime_error("Batched multiplication needs row-major matrices");
+    }
+    std::cout << "DEBUG: Batched multiply of " << matrix1->batch << " x (" << matrix1->rows << "x"
+              << matrix1->cols << " * " << matrix2->rows << "x" << matrix2->cols << ")"
+              << (matrix2->batch == 1 ? ", shared B" : "") << " (" << dtypeToString(matrix1->dtype) << ")" << std::endl;
+    profiler.startTimer("matrix_multiplication_batched");
+    deviceManager.executeBatchedMultiplication(matrix1, matrix2, result);
+    profiler.stopTimer("matrix_multiplication_batched");
+    result->clearValueStats();
+}
+
+// Operands are the slots of A and the result, which must be distinct: the
+// chain reads A until its last multiply. The exponent is a dimension-style
+// entry, an integer variable or a decimal literal.
+void Runtime::executeMatrixPower(const BytecodeInstruction& instr) {
+    if (instr.operands.size() < 2 || instr.exponent.empty()) {
+        throw std::runtime_error("Invalid matrix power operands");
+    }
+    auto* matrix = rowMajor(slotMatrix(instr.operands[0]));
+    auto* result = rowMajor(slotMatrix(instr.operands[1]));
+    if (matrix == result) {
+        throw std::runtime_error("Matrix power needs a result separate from its operand");
+    }
+    if (matrix->dtype != result->dtype) {
+        throw std::runtime_error("Matrix element types differ in matrix power");
+    }
+    if (isWideInteger(matrix->dtype)) {
+        throw std::runtime_error(WIDE_OPERAND_ERROR);
+    }
+    if (!matrix->square() || result->rows != matrix->rows || result->cols != matrix->cols ||
+        matrix->batch != 1 || result->batch != 1) {
+        throw std::runtime_error("Matrix power needs a single square matrix and a result of its shape");
+    }
+    if (matrix->layout != MatrixLayout::ROW_MAJOR || result->layout != MatrixLayout::ROW_MAJOR) {
+        throw std::runtime_error("Matrix power needs row-major matrices");
     }
-    int* data = matrices[name]->getCPUWritePtr();
-    for (int i = 0; i < size * size; i++) {
-        if (!(std::cin >> data[i])) {
-            matrices[name]->releaseCPUAccess();
-            throw std::runtime_error("Failed to read matrix element");
+    int exponent = dimensionValue(instr.exponent);
+    if (exponent < 0) {
+        throw std::runtime_error("Matrix power exponent must not be negative");
+    }
+    std::cout << "DEBUG: Matrix power " << matrix->rows << "x" << matrix->cols << "^" << exponent
+              << " (" << dtypeToString(matrix->dtype) << ")" << std::endl;
+    profiler.startTimer("matrix_power");
+    deviceManager.executeMatrixPower(matrix, result, exponent);
+    profiler.stopTimer("matrix_power");
+    result->clearValueStats();
+}
+
+// Operands are the slots of A, B and C; the modulus is a dimension-style
+// entry. Inputs may be any int, negative ones included: they are reduced
+// first, and every result entry lands in [0, p). A signed remainder, C++ `%`,
+// leaves negative sums negative, so it is only taken for A and B read with no
+// negative values, whose sums are never negative.
+void Runtime::executeModularMultiplication(const BytecodeInstruction& instr) {
+    if (instr.operands.size() < 3 || instr.modulus.empty()) {
+        throw std::runtime_error("Invalid modular multiply operands");
+    }
+    auto* matrix1 = rowMajor(slotMatrix(instr.operands[0]));
+    auto* matrix2 = rowMajor(slotMatrix(instr.operands[1]));
+    auto* result = rowMajor(slotMatrix(instr.operands[2]));
+    if (matrix1->dtype != DType::I32 || matrix2->dtype != DType::I32 || result->dtype != DType::I32) {
+        throw std::runtime_error("Modular multiplication needs i32 matrices");
+    }
+    if (matrix1->cols != matrix2->rows || result->rows != matrix1->rows || result->cols != matrix2->cols ||
+        matrix1->batch != 1 || matrix2->batch != 1 || result->batch != 1) {
+        throw std::runtime_error("Matrix shapes do not match for modular multiplication");
+    }
+    if (matrix1->layout != MatrixLayout::ROW_MAJOR || matrix2->layout != MatrixLayout::ROW_MAJOR ||
+        result->layout != MatrixLayout::ROW_MAJOR) {
+        throw std::runtime_error("Modular multiplication needs row-major matrices");
+    }
+    int modulus = dimensionValue(instr.modulus);
+    if (modulus < 2) {
+        throw std::runtime_error("Modulus must be at least 2");
+    }
+    auto nonNegative = [](const MatrixBuffer* matrix) {
+        return matrix->valueRange.known() && matrix->valueRange.minValue >= 0;
+    };
+    if (instr.signedRemainder && (!nonNegative(matrix1) || !nonNegative(matrix2))) {
+        throw std::runtime_error("Signed remainder of possibly negative sums: the modular multiply returns "
+                                 "[0, p), which differs from % there, so A and B must not be negative");
+    }
+    std::cout << "DEBUG: Modular multiply " << matrix1->rows << "x" << matrix1->cols << " * " << matrix2->rows
+              << "x" << matrix2->cols << " mod " << modulus << std::endl;
+    profiler.startTimer("matrix_multiplication_mod");
+    deviceManager.executeModularMultiplication(matrix1, matrix2, result, static_cast<uint32_t>(modulus));
+    profiler.stopTimer("matrix_multiplication_mod");
+    result->clearValueStats();
+}
+
+// Operands are the slots of i32 A and B and of an i64 or i128 C. The bound
+// on |C| comes from the value ranges seen when A and B were read, or the
+// full int range for matrices that were not read, and fixes how many CRT
+// primes run.
+void Runtime::executeExactMultiplication(const BytecodeInstruction& instr) {
+    if (instr.operands.size() < 3) {
+        throw std::runtime_error("Invalid exact multiply operands");
+    }
+    auto* matrix1 = rowMajor(slotMatrix(instr.operands[0]));
+    auto* matrix2 = rowMajor(slotMatrix(instr.operands[1]));
+    auto* result = rowMajor(slotMatrix(instr.operands[2]));
+    if (matrix1->dtype != DType::I32 || matrix2->dtype != DType::I32 || !isWideInteger(result->dtype)) {
+        throw std::runtime_error("Exact multiplication needs i32 operands and an i64 or i128 result");
+    }
+    if (matrix1->cols != matrix2->rows || result->rows != matrix1->rows || result->cols != matrix2->cols ||
+        matrix1->batch != 1 || matrix2->batch != 1 || result->batch != 1) {
+        throw std::runtime_error("Matrix shapes do not match for exact multiplication");
+    }
+    if (matrix1->layout != MatrixLayout::ROW_MAJOR || matrix2->layout != MatrixLayout::ROW_MAJOR ||
+        result->layout != MatrixLayout::ROW_MAJOR) {
+        throw std::runtime_error("Exact multiplication needs row-major matrices");
+    }
+    auto maxAbs = [](const MatrixBuffer* matrix) -> unsigned __int128 {
+        return matrix->valueRange.known() ? matrix->valueRange.maxAbs() : 1LL << 31;
+    };
+    unsigned __int128 bound = maxAbs(matrix1) * maxAbs(matrix2) * static_cast<unsigned>(matrix1->cols);
+    if (result->dtype == DType::I64 && bound > static_cast<unsigned __int128>(INT64_MAX)) {
+        throw std::runtime_error("Exact products may not fit i64, use an i128 result");
+    }
+    std::cout << "DEBUG: Exact multiply " << matrix1->rows << "x" << matrix1->cols << " * " << matrix2->rows
+              << "x" << matrix2->cols << " into " << dtypeToString(result->dtype) << std::endl;
+    profiler.startTimer("matrix_multiplication_exact");
+    deviceManager.executeExactMultiplication(matrix1, matrix2, result, bound);
+    profiler.stopTimer("matrix_multiplication_exact");
+    result->clearValueStats();
+}
+
+static bool isInteger(double value) {
+    return std::trunc(value) == value;
+}
+
+// Operands are the slots of A, B and C, and post-ops name their matrices by
+// slot as well. C is only read when beta is non-zero. Post-op matrices may
+// not be C itself, since the fused kernels write C before later blocks read
+// it; beta covers that case. For the same reason C must be distinct from A
+// and B.
+void Runtime::executeGemm(const BytecodeInstruction& instr) {
+    if (instr.operands.size() < 3) {
+        throw std::runtime_error("Invalid GEMM operands");
+    }
+    auto* matrix1 = slotMatrix(instr.operands[0]);
+    auto* matrix2 = slotMatrix(instr.operands[1]);
+    auto* result = slotMatrix(instr.operands[2]);
+    if (result == matrix1 || result == matrix2) {
+        throw std::runtime_error("GEMM needs a result separate from its operands");
+    }
+    if (matrix1->dtype != matrix2->dtype || matrix1->dtype != result->dtype) {
+        throw std::runtime_error("Matrix element types differ in GEMM");
+    }
+    if (isWideInteger(matrix1->dtype)) {
+        throw std::runtime_error(WIDE_OPERAND_ERROR);
+    }
+    if (matrix1->cols != matrix2->rows || result->rows != matrix1->rows || result->cols != matrix2->cols) {
+        throw std::runtime_error("Matrix shapes do not match for GEMM");
+    }
+    if (matrix1->batch != 1 || matrix2->batch != 1 || result->batch != 1) {
+        throw std::runtime_error("GEMM on a batch, use MATRIX_MULTIPLY_BATCHED");
+    }
+    if (instr.postOps.size() > GEMM_MAX_POST_OPS) {
+        throw std::runtime_error("GEMM takes at most " + std::to_string(GEMM_MAX_POST_OPS) + " post-ops");
+    }
+    bool integer = result->dtype == DType::I32;
+    MatrixEpilogue epilogue;
+    epilogue.alpha = instr.alpha;
+    epilogue.beta = instr.beta;
+    if (integer && (!isInteger(instr.alpha) || !isInteger(instr.beta))) {
+        throw std::runtime_error("Integer GEMM needs integer alpha and beta");
+    }
+    for (const PostOp& op : instr.postOps) {
+        MatrixEpilogue::Step step{op.kind, nullptr, op.value, op.upper};
+        if (postOpHasOperand(op.kind)) {
+            step.matrix = slotMatrix(op.operand);
+            bool bias = op.kind == PostOpKind::BIAS;
+            if (step.matrix == result) {
+                throw std::runtime_error("GEMM post-op reads the result matrix, use beta");
+            }
+            if (step.matrix->dtype != result->dtype || step.matrix->batch != 1 ||
+                (layout != MatrixLayout::TILED && step.matrix->layout != result->layout) ||
+                step.matrix->cols != result->cols ||
+                step.matrix->rows != (bias ? 1 : result->rows)) {
+                throw std::runtime_error(std::string("GEMM ") + postOpToString(op.kind) +
+                                         " operand does not match the result");
+            }
+        } else if (integer && (!isInteger(op.value) || !isInteger(op.upper))) {
+            throw std::runtime_error(std::string("Integer GEMM needs integer ") + postOpToString(op.kind) +
+                                     " values");
+        }
+        if (op.kind == PostOpKind::CLAMP && op.value > op.upper) {
+            throw std::runtime_error("GEMM clamp bounds are reversed");
+        }
+        epilogue.steps.push_back(step);
+    }
+    TiledOperands tiled;
+    if (layout == MatrixLayout::TILED) {
+        matrix1 = tileOperand(matrix1, tileSize, matrix1->cols, tiled);
+        matrix2 = tileOperand(matrix2, matrix2->rows, tileSize, tiled);
+        result = tileOperand(result, tileSize, tileSize, tiled);
+        for (MatrixEpilogue::Step& step : epilogue.steps) {
+            if (step.matrix) {
+                step.matrix = tileOperand(step.matrix, tileSize, tileSize, tiled);
+            }
+        }
+    }
+    std::cout << "DEBUG: GEMM " << matrix1->rows << "x" << matrix1->cols << " * " << matrix2->rows << "x"
+              << matrix2->cols << ", alpha " << instr.alpha << ", beta " << instr.beta;
+    for (const PostOp& op : instr.postOps) {
+        std::cout << ", " << postOpToString(op.kind);
+    }
+    std::cout << " (" << dtypeToString(result->dtype) << ")" << std::endl;
+    profiler.startTimer("gemm");
+    deviceManager.executeMatrixMultiplication(matrix1, matrix2, result, &epilogue);
+    profiler.stopTimer("gemm");
+    result->clearValueStats();
+}
+
+static void requireElementwiseOperand(const MatrixBuffer* matrix, const MatrixBuffer* result, const char* name) {
+    if (matrix->dtype != result->dtype) {
+        throw std::runtime_error(std::string("Matrix element types differ in ") + name);
+    }
+    if (isWideInteger(matrix->dtype)) {
+        throw std::runtime_error(WIDE_OPERAND_ERROR);
+    }
+    if (matrix->batch != 1 || matrix->layout != MatrixLayout::ROW_MAJOR) {
+        throw std::runtime_error(std::string(name) + " needs single row-major matrices");
+    }
+}
+
+// ADD and SUB take the slots of A, B and C, SCALE the slots of A and C with
+// alpha as the factor. C may be one of the inputs.
+void Runtime::executeElementwise(const BytecodeInstruction& instr) {
+    ElementwiseOp op = instr.operation == Instruction::ADD   ? ElementwiseOp::ADD
+                       : instr.operation == Instruction::SUB ? ElementwiseOp::SUB
+                                                              : ElementwiseOp::SCALE;
+    bool binary = op != ElementwiseOp::SCALE;
+    const char* name = instructionToString(instr.operation);
+    if (instr.operands.size() < (binary ? 3u : 2u)) {
+        throw std::runtime_error(std::string("Invalid ") + name + " operands");
+    }
+    auto* matrix1 = rowMajor(slotMatrix(instr.operands[0]));
+    auto* matrix2 = binary ? rowMajor(slotMatrix(instr.operands[1])) : nullptr;
+    auto* result = rowMajor(slotMatrix(instr.operands[binary ? 2 : 1]));
+    for (const MatrixBuffer* matrix : {matrix1, matrix2, result}) {
+        if (matrix == nullptr) {
+            continue;
+        }
+        requireElementwiseOperand(matrix, result, name);
+        if (matrix->rows != result->rows || matrix->cols != result->cols) {
+            throw std::runtime_error(std::string("Matrix shapes do not match for ") + name);
         }
     }
-    matrices[name]->releaseCPUAccess();
+    if (!binary && result->dtype == DType::I32 && !isInteger(instr.alpha)) {
+        throw std::runtime_error("Integer SCALE needs an integer factor");
+    }
+    std::cout << "DEBUG: " << name << " " << result->rows << "x" << result->cols;
+    if (!binary) {
+        std::cout << " by " << instr.alpha;
+    }
+    std::cout << " (" << dtypeToString(result->dtype) << ")" << std::endl;
+    profiler.startTimer("elementwise");
+    deviceManager.executeElementwise(op, matrix1, matrix2, result, instr.alpha);
+    profiler.stopTimer("elementwise");
+    // In place, the result's old stats would describe an input.
+    result->clearValueStats();
+}
+
+// Operands are the slots of A and of a separate result of the transposed
+// shape.
+void Runtime::executeTranspose(const BytecodeInstruction& instr) {
+    if (instr.operands.size() < 2) {
+        throw std::runtime_error("Invalid TRANSPOSE operands");
+    }
+    auto* matrix = rowMajor(slotMatrix(instr.operands[0]));
+    auto* result = rowMajor(slotMatrix(instr.operands[1]));
+    if (matrix == result) {
+        throw std::runtime_error("Transpose needs a result separate from its operand");
+    }
+    requireElementwiseOperand(matrix, result, "TRANSPOSE");
+    requireElementwiseOperand(result, result, "TRANSPOSE");
+    if (result->rows != matrix->cols || result->cols != matrix->rows) {
+        throw std::runtime_error("Transpose result must have the operand's shape swapped");
+    }
+    std::cout << "DEBUG: TRANSPOSE " << matrix->rows << "x" << matrix->cols << " (" << dtypeToString(matrix->dtype)
+              << ")" << std::endl;
+    profiler.startTimer("transpose");
+    deviceManager.executeTranspose(matrix, result);
+    profiler.stopTimer("transpose");
+    // The same values, moved.
+    result->valueRange = matrix->valueRange;
+    result->nonZeros = matrix->nonZeros;
+}
+
+// __int128 has no stream operators: it is read and written in decimal here.
+template <typename T>
+static bool readElement(T& value) {
+    return static_cast<bool>(std::cin >> value);
+}
+
+static bool readElement(__int128& value) {
+    std::string text;
+    if (!(std::cin >> text)) {
+        return false;
+    }
+    bool negative = text[0] == '-';
+    size_t first = negative || text[0] == '+' ? 1 : 0;
+    if (first == text.size()) {
+        return false;
+    }
+    unsigned __int128 magnitude = 0;
+    for (size_t i = first; i < text.size(); i++) {
+        if (text[i] < '0' || text[i] > '9') {
+            return false;
+        }
+        magnitude = magnitude * 10 + static_cast<unsigned>(text[i] - '0');
+    }
+    value = negative ? -static_cast<__int128>(magnitude) : static_cast<__int128>(magnitude);
+    return true;
+}
+
+template <typename T>
+static void writeElement(const T& value) {
+    std::cout << value;
+}
+
+static void writeElement(const __int128& value) {
+    unsigned __int128 magnitude = value < 0 ? -static_cast<unsigned __int128>(value) : value;
+    char digits[40];
+    int length = 0;
+    do {
+        digits[length++] = static_cast<char>('0' + static_cast<int>(magnitude % 10));
+        magnitude /= 10;
+    } while (magnitude != 0);
+    if (value < 0) {
+        std::cout << '-';
+    }
+    while (length > 0) {
+        std::cout << digits[--length];
+    }
+}
+
+// Other layouts are read into a row-major copy and converted once. The
+// non-zero count, and for i32 the value range, are gathered on the way.
+template <typename T>
+static void readElements(MatrixBuffer* matrix) {
+    bool rowMajor = matrix->layout == MatrixLayout::ROW_MAJOR;
+    std::vector<T> staging;
+    if (!rowMajor) {
+        staging.resize(static_cast<size_t>(matrix->rows) * matrix->cols);
+    }
+    T* data = rowMajor ? matrix->getCPUWritePtrAs<T>() : staging.data();
+    int ld = rowMajor ? matrix->ld : matrix->cols;
+    long long nonZeros = 0;
+    ValueRange range;
+    for (int i = 0; i < matrix->batch * matrix->rows; i++) {
+        T* row = data + static_cast<size_t>(i) * ld;
+        for (int j = 0; j < matrix->cols; j++) {
+            if (!readElement(row[j])) {
+                matrix->releaseCPUAccess();
+                throw std::runtime_error("Failed to read matrix element");
+            }
+            nonZeros += row[j] != T(0);
+            if constexpr (std::is_same<T, int>::value) {
+                range.include(row[j]);
+            }
+        }
+    }
+    matrix->nonZeros = nonZeros;
+    matrix->valueRange = range;
+    if (rowMajor) {
+        matrix->releaseCPUAccess();
+    } else {
+        matrix->fromRowMajor(staging.data(), ld);
+    }
+}
+
+template <typename T>
+static void writeElements(MatrixBuffer* matrix) {
+    bool rowMajor = matrix->layout == MatrixLayout::ROW_MAJOR;
+    std::vector<T> staging;
+    if (!rowMajor) {
+        staging.resize(static_cast<size_t>(matrix->rows) * matrix->cols);
+        matrix->toRowMajor(staging.data(), matrix->cols);
+    }
+    const T* data = rowMajor ? matrix->getCPUReadPtrAs<T>() : staging.data();
+    int ld = rowMajor ? matrix->ld : matrix->cols;
+    // Print enough digits for floating-point results to round-trip, independent
+    // of whatever fixed formatting the profiler left on the stream.
+    std::ios_base::fmtflags flags = std::cout.flags();
+    std::streamsize precision = std::cout.precision(std::numeric_limits<T>::max_digits10);
+    std::cout << std::defaultfloat;
+    for (int i = 0; i < matrix->batch * matrix->rows; i++) {
+        const T* row = data + static_cast<size_t>(i) * ld;
+        for (int j = 0; j < matrix->cols; j++) {
+            writeElement(row[j]);
+            if (j < matrix->cols - 1) std::cout << " ";
+        }
+        std::cout << std::endl;
+    }
+    std::cout.flags(flags);
+    std::cout.precision(precision);
+    if (rowMajor) {
+        matrix->releaseCPUAccess();
+    }
+}
+
+void Runtime::readMatrix(const std::string& name) {
+    MatrixBuffer* matrix = matrices[name];
+    if (matrix->dtype == DType::F32) {
+        readElements<float>(matrix);
+    } else if (matrix->dtype == DType::F64) {
+        readElements<double>(matrix);
+    } else if (matrix->dtype == DType::I64) {
+        readElements<int64_t>(matrix);
+    } else if (matrix->dtype == DType::I128) {
+        readElements<__int128>(matrix);
+    } else {
+        readElements<int>(matrix);
+        const ValueRange& range = matrix->valueRange;
+        std::cout << "DEBUG: Matrix " << name << " value range [" << range.minValue << ", "
+                  << range.maxValue << "], " << range.bitWidth() << "-bit"
+                  << (range.binary() ? ", bit-packable" : "") << std::endl;
+    }
+    std::cout << "DEBUG: Matrix " << name << " has " << matrix->nonZeros << " non-zeros ("
+              << 100.0 * matrix->density() << "% dense)" << std::endl;
 }
 
 void Runtime::writeMatrix(const std::string& name) {
@@ -130,15 +837,13 @@ void Runtime::writeMatrix(const std::string& name) {
         throw std::runtime_error("Matrix not found for output");
     }
     auto* matrix = matrices[name];
-    int* data = matrix->getCPUReadPtr();
-    for (int i = 0; i < matrix->size; i++) {
-        for (int j = 0; j < matrix->size; j++) {
-            std::cout << data[i * matrix->size + j];
-            if (j < matrix->size - 1) std::cout << " ";
-        }
-        std::cout << std::endl;
+    switch (matrix->dtype) {
+        case DType::F32: writeElements<float>(matrix); break;
+        case DType::F64: writeElements<double>(matrix); break;
+        case DType::I64: writeElements<int64_t>(matrix); break;
+        case DType::I128: writeElements<__int128>(matrix); break;
+        default: writeElements<int>(matrix); break;
     }
-    matrix->releaseCPUAccess();
 }
 
 void Runtime::printProfiler() {
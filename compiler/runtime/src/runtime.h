@@ -1,4 +1,6 @@
 #pragma once
+#include <map>
+#include <memory>
 #include <unordered_map>
 #include <vector>
 #include <string>
@@ -19,8 +21,36 @@ private:
     Profiler profiler;
     std::unordered_map<std::string, MatrixBuffer*> matrices;
     std::unordered_map<std::string, int> variables;
+    std::unordered_map<int, std::string> slots;
+    // Storage layout for single matrices, from MATRIX_LAYOUT; batches stay
+    // row-major. TILED buffers start row-major and are cut into tiles of
+    // tileSize (MATRIX_TILE) by the multiplies that read them.
+    MatrixLayout layout;
+    int tileSize;
+    // Operands a tiled multiply has placed so far, by their buffer before
+    // the multiply, and the copies made for a matrix in two roles.
+    struct TiledOperands {
+        std::map<const MatrixBuffer*, MatrixBuffer*> placed;
+        std::vector<std::unique_ptr<MatrixBuffer>> copies;
+    };
     void executeInstruction(const BytecodeInstruction& instr);
     void executeMatrixMultiplication(const BytecodeInstruction& instr);
-    void readMatrix(int size, std::string name);
+    void executeBatchedMultiplication(const BytecodeInstruction& instr);
+    void executeGemm(const BytecodeInstruction& instr);
+    void executeMatrixPower(const BytecodeInstruction& instr);
+    void executeModularMultiplication(const BytecodeInstruction& instr);
+    void executeExactMultiplication(const BytecodeInstruction& instr);
+    void executeElementwise(const BytecodeInstruction& instr);
+    void executeTranspose(const BytecodeInstruction& instr);
+    void resolveShape(const BytecodeInstruction& instr, int& batch, int& rows, int& cols);
+    int dimensionValue(const std::string& entry);
+    void prebindFixedKernels(const Program& program);
+    void bindSlot(const BytecodeInstruction& instr);
+    MatrixBuffer* slotMatrix(int slot);
+    MatrixBuffer* createMatrix(const BytecodeInstruction& instr, int batch, int rows, int cols) const;
+    MatrixBuffer* relayout(MatrixBuffer* matrix, MatrixLayout target, int tileHeight, int tileWidth);
+    MatrixBuffer* rowMajor(MatrixBuffer* matrix);
+    MatrixBuffer* tileOperand(MatrixBuffer* matrix, int tileHeight, int tileWidth, TiledOperands& operands);
+    void readMatrix(const std::string& name);
     void writeMatrix(const std::string& name);
 };
\ No newline at end of file
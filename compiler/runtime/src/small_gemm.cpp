@@ -0,0 +1,229 @@
+#include "small_gemm.h"
+#include <array>
+#include <cstddef>
+
+// int accumulates in unsigned lanes so wraparound is well defined.
+template <typename T> struct SmallAccumulator { using type = T; };
+template <> struct SmallAccumulator<int> { using type = unsigned; };
+
+// MR rows of C at a time; each B row is loaded once per MR rows of A. A
+// non-zero M or K fixes that bound too, so the row remainder loop folds away
+// and short k loops unroll completely. Accumulate adds to C instead of
+// overwriting it.
+template <typename T, int N, int MR, int M = 0, int K = 0, bool Accumulate = false>
+static void smallGemmFixed(int m, int k, const T* a, int lda, const T* b, int ldb, T* c, int ldc) {
+    using Acc = typename SmallAccumulator<T>::type;
+    if (M > 0) m = M;
+    if (K > 0) k = K;
+    int i = 0;
+    for (; i + MR <= m; i += MR) {
+        Acc acc[MR][N] = {};
+        if (Accumulate) {
+            for (int r = 0; r < MR; r++) {
+                for (int j = 0; j < N; j++) {
+                    acc[r][j] = static_cast<Acc>(c[static_cast<std::size_t>(i + r) * ldc + j]);
+                }
+            }
+        }
+        for (int p = 0; p < k; p++) {
+            const T* bRow = b + static_cast<std::size_t>(p) * ldb;
+            for (int r = 0; r < MR; r++) {
+                Acc ap = static_cast<Acc>(a[static_cast<std::size_t>(i + r) * lda + p]);
+                for (int j = 0; j < N; j++) {
+                    acc[r][j] += ap * static_cast<Acc>(bRow[j]);
+                }
+            }
+        }
+        for (int r = 0; r < MR; r++) {
+            T* cRow = c + static_cast<std::size_t>(i + r) * ldc;
+            for (int j = 0; j < N; j++) {
+                cRow[j] = static_cast<T>(acc[r][j]);
+            }
+        }
+    }
+    for (; i < m; i++) {
+        Acc acc[N] = {};
+        if (Accumulate) {
+            for (int j = 0; j < N; j++) {
+                acc[j] = static_cast<Acc>(c[static_cast<std::size_t>(i) * ldc + j]);
+            }
+        }
+        const T* aRow = a + static_cast<std::size_t>(i) * lda;
+        for (int p = 0; p < k; p++) {
+            const T* bRow = b + static_cast<std::size_t>(p) * ldb;
+            Acc ap = static_cast<Acc>(aRow[p]);
+            for (int j = 0; j < N; j++) {
+                acc[j] += ap * static_cast<Acc>(bRow[j]);
+            }
+        }
+        T* cRow = c + static_cast<std::size_t>(i) * ldc;
+        for (int j = 0; j < N; j++) {
+            cRow[j] = static_cast<T>(acc[j]);
+        }
+    }
+}
+
+template <typename T>
+static void smallGemmGeneric(int m, int n, int k, const T* a, int lda, const T* b, int ldb, T* c, int ldc) {
+    using Acc = typename SmallAccumulator<T>::type;
+    Acc acc[SMALL_GEMM_MAX_N];
+    for (int i = 0; i < m; i++) {
+        for (int j = 0; j < n; j++) {
+            acc[j] = 0;
+        }
+        const T* aRow = a + static_cast<std::size_t>(i) * lda;
+        for (int p = 0; p < k; p++) {
+            const T* bRow = b + static_cast<std::size_t>(p) * ldb;
+            Acc ap = static_cast<Acc>(aRow[p]);
+            for (int j = 0; j < n; j++) {
+                acc[j] += ap * static_cast<Acc>(bRow[j]);
+            }
+        }
+        T* cRow = c + static_cast<std::size_t>(i) * ldc;
+        for (int j = 0; j < n; j++) {
+            cRow[j] = static_cast<T>(acc[j]);
+        }
+    }
+}
+
+template <typename T>
+static void smallGemm(int m, int n, int k, const T* a, int lda, const T* b, int ldb, T* c, int ldc) {
+    switch (n) {
+        case 8: smallGemmFixed<T, 8, 4>(m, k, a, lda, b, ldb, c, ldc); break;
+        case 16: smallGemmFixed<T, 16, 4>(m, k, a, lda, b, ldb, c, ldc); break;
+        case 32: smallGemmFixed<T, 32, 4>(m, k, a, lda, b, ldb, c, ldc); break;
+        case 48: smallGemmFixed<T, 48, 2>(m, k, a, lda, b, ldb, c, ldc); break;
+        case 64: smallGemmFixed<T, 64, 2>(m, k, a, lda, b, ldb, c, ldc); break;
+        default: smallGemmGeneric(m, n, k, a, lda, b, ldb, c, ldc); break;
+    }
+}
+
+#if defined(__x86_64__) || defined(__i386__)
+// The kernels are plain loops, so the x86 tiers are the same templates
+// inlined into functions compiled for wider vectors.
+template <typename T>
+__attribute__((target("avx2,fma"), flatten))
+static void smallGemmAvx2(int m, int n, int k, const T* a, int lda, const T* b, int ldb, T* c, int ldc) {
+    smallGemm(m, n, k, a, lda, b, ldb, c, ldc);
+}
+
+template <typename T>
+__attribute__((target("avx512f,avx512vl,avx512dq,avx512bw,fma"), flatten))
+static void smallGemmAvx512(int m, int n, int k, const T* a, int lda, const T* b, int ldb, T* c, int ldc) {
+    smallGemm(m, n, k, a, lda, b, ldb, c, ldc);
+}
+#endif
+
+template <typename T>
+static void smallGemmForIsa(CPUIsa isa, int m, int n, int k, const T* a, int lda, const T* b, int ldb, T* c, int ldc) {
+#if defined(__x86_64__) || defined(__i386__)
+    if (isa == CPUIsa::AVX512) {
+        smallGemmAvx512(m, n, k, a, lda, b, ldb, c, ldc);
+        return;
+    }
+    if (isa == CPUIsa::AVX2) {
+        smallGemmAvx2(m, n, k, a, lda, b, ldb, c, ldc);
+        return;
+    }
+#endif
+    smallGemm(m, n, k, a, lda, b, ldb, c, ldc);
+}
+
+// gemmFixed<T, M, N, K>: every bound a compile-time constant. Narrow C
+// blocks take up to four rows per pass, wide ones two, as in smallGemm.
+constexpr int fixedRowBlock(int m, int n) {
+    return m < (n > 32 ? 2 : 4) ? m : (n > 32 ? 2 : 4);
+}
+
+template <typename T, int M, int N, int K, bool Accumulate>
+static void gemmFixed(const T* a, int lda, const T* b, int ldb, T* c, int ldc) {
+    smallGemmFixed<T, N, fixedRowBlock(M, N), M, K, Accumulate>(M, K, a, lda, b, ldb, c, ldc);
+}
+
+// One struct per ISA tier so the table builder can take the tier as a type.
+struct FixedTierBase {
+    template <typename T, int M, int N, int K, bool Accumulate>
+    static void run(const T* a, int lda, const T* b, int ldb, T* c, int ldc) {
+        gemmFixed<T, M, N, K, Accumulate>(a, lda, b, ldb, c, ldc);
+    }
+};
+
+#if defined(__x86_64__) || defined(__i386__)
+struct FixedTierAvx2 {
+    template <typename T, int M, int N, int K, bool Accumulate>
+    __attribute__((target("avx2,fma"), flatten))
+    static void run(const T* a, int lda, const T* b, int ldb, T* c, int ldc) {
+        gemmFixed<T, M, N, K, Accumulate>(a, lda, b, ldb, c, ldc);
+    }
+};
+
+struct FixedTierAvx512 {
+    template <typename T, int M, int N, int K, bool Accumulate>
+    __attribute__((target("avx512f,avx512vl,avx512dq,avx512bw,fma"), flatten))
+    static void run(const T* a, int lda, const T* b, int ldb, T* c, int ldc) {
+        gemmFixed<T, M, N, K, Accumulate>(a, lda, b, ldb, c, ldc);
+    }
+};
+#endif
+
+// Every specialization costs a compiled copy per ISA tier, so the table
+// holds the square shapes the batch jobs and small programs actually use,
+// plus accumulating 32^3 for the Morton tile multiply.
+template <typename T>
+struct FixedEntry {
+    int m, n, k;
+    bool accumulate;
+    GemmFixedKernel<T> kernel;
+};
+
+template <typename T, typename Tier>
+static const std::array<FixedEntry<T>, 6>& fixedTable() {
+    static const std::array<FixedEntry<T>, 6> table = {{
+        {2, 2, 2, false, &Tier::template run<T, 2, 2, 2, false>},
+        {4, 4, 4, false, &Tier::template run<T, 4, 4, 4, false>},
+        {8, 8, 8, false, &Tier::template run<T, 8, 8, 8, false>},
+        {16, 16, 16, false, &Tier::template run<T, 16, 16, 16, false>},
+        {32, 32, 32, false, &Tier::template run<T, 32, 32, 32, false>},
+        {32, 32, 32, true, &Tier::template run<T, 32, 32, 32, true>},
+    }};
+    return table;
+}
+
+template <typename T, typename Tier>
+static GemmFixedKernel<T> findFixed(int m, int n, int k, bool accumulate) {
+    for (const FixedEntry<T>& entry : fixedTable<T, Tier>()) {
+        if (entry.m == m && entry.n == n && entry.k == k && entry.accumulate == accumulate) {
+            return entry.kernel;
+        }
+    }
+    return nullptr;
+}
+
+template <typename T>
+GemmFixedKernel<T> gemmFixedKernel(CPUIsa isa, int m, int n, int k, bool accumulate) {
+#if defined(__x86_64__) || defined(__i386__)
+    if (isa == CPUIsa::AVX512) {
+        return findFixed<T, FixedTierAvx512>(m, n, k, accumulate);
+    }
+    if (isa == CPUIsa::AVX2) {
+        return findFixed<T, FixedTierAvx2>(m, n, k, accumulate);
+    }
+#endif
+    return findFixed<T, FixedTierBase>(m, n, k, accumulate);
+}
+
+template GemmFixedKernel<int> gemmFixedKernel<int>(CPUIsa isa, int m, int n, int k, bool accumulate);
+template GemmFixedKernel<float> gemmFixedKernel<float>(CPUIsa isa, int m, int n, int k, bool accumulate);
+template GemmFixedKernel<double> gemmFixedKernel<double>(CPUIsa isa, int m, int n, int k, bool accumulate);
+
+void gemmSmall(CPUIsa isa, int m, int n, int k, const int* a, int lda, const int* b, int ldb, int* c, int ldc) {
+    smallGemmForIsa(isa, m, n, k, a, lda, b, ldb, c, ldc);
+}
+
+void gemmSmall(CPUIsa isa, int m, int n, int k, const float* a, int lda, const float* b, int ldb, float* c, int ldc) {
+    smallGemmForIsa(isa, m, n, k, a, lda, b, ldb, c, ldc);
+}
+
+void gemmSmall(CPUIsa isa, int m, int n, int k, const double* a, int lda, const double* b, int ldb, double* c, int ldc) {
+    smallGemmForIsa(isa, m, n, k, a, lda, b, ldb, c, ldc);
+}
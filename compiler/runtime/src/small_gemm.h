@@ -0,0 +1,32 @@
+#pragma once
+#include "cpu_features.h"
+
+// Largest shape handled without packing. Above it the Goto-style path in
+// cpu_gemm.h wins because its packed panels stay in cache across row blocks.
+constexpr int SMALL_GEMM_MAX_N = 64;
+constexpr int SMALL_GEMM_MAX_K = 256;
+
+inline bool smallGemmFits(int m, int n, int k) {
+    return m > 0 && n > 0 && k > 0 && n <= SMALL_GEMM_MAX_N && k <= SMALL_GEMM_MAX_K;
+}
+
+// C[m x n] = A[m x k] * B[k x n] straight from the row-major operands. Column
+// counts of 8, 16, 32, 48 and 64 use kernels with the width fixed at compile
+// time, so a C row block lives in registers for the whole k loop; any other n
+// uses a generic loop. On x86 the loops are compiled once per ISA tier and
+// isa picks the copy. int products wrap modulo 2^32 like the other kernels.
+void gemmSmall(CPUIsa isa, int m, int n, int k, const int* a, int lda, const int* b, int ldb, int* c, int ldc);
+void gemmSmall(CPUIsa isa, int m, int n, int k, const float* a, int lda, const float* b, int ldb, float* c, int ldc);
+void gemmSmall(CPUIsa isa, int m, int n, int k, const double* a, int lda, const double* b, int ldb, double* c, int ldc);
+
+// C = A * B with M, N and K all fixed at compile time: no loop bounds to
+// test, no clamps, and for the smaller sizes fully unrolled bodies that keep
+// C in registers. Instantiated for the square sizes 2, 4, 8, 16 and 32.
+template <typename T>
+using GemmFixedKernel = void (*)(const T* a, int lda, const T* b, int ldb, T* c, int ldc);
+
+// The specialization for this shape compiled for isa, or nullptr when
+// m x k * k x n is not one of the fixed sizes. With accumulate the kernel
+// computes C += A * B; only 32 x 32 x 32 has that form.
+template <typename T>
+GemmFixedKernel<T> gemmFixedKernel(CPUIsa isa, int m, int n, int k, bool accumulate = false);
@@ -0,0 +1,83 @@
+#include "sparse.h"
+#include <algorithm>
+
+template <typename T>
+static inline T multiplyAdd(T c, T a, T b) {
+    return c + a * b;
+}
+
+static inline int multiplyAdd(int c, int a, int b) {
+    return static_cast<int>(static_cast<unsigned>(c) + static_cast<unsigned>(a) * static_cast<unsigned>(b));
+}
+
+template <typename T>
+CSRMatrix<T> denseToCSR(const T* dense, int rows, int cols, int ld) {
+    CSRMatrix<T> csr;
+    csr.rows = rows;
+    csr.cols = cols;
+    csr.rowPtr.resize(static_cast<std::size_t>(rows) + 1);
+    std::size_t count = 0;
+    for (int i = 0; i < rows; i++) {
+        const T* row = dense + static_cast<std::size_t>(i) * ld;
+        csr.rowPtr[i] = static_cast<int>(count);
+        for (int j = 0; j < cols; j++) {
+            count += row[j] != T(0);
+        }
+    }
+    csr.rowPtr[rows] = static_cast<int>(count);
+    csr.colIdx.resize(count);
+    csr.values.resize(count);
+    for (int i = 0; i < rows; i++) {
+        const T* row = dense + static_cast<std::size_t>(i) * ld;
+        std::size_t out = csr.rowPtr[i];
+        for (int j = 0; j < cols; j++) {
+            if (row[j] != T(0)) {
+                csr.colIdx[out] = j;
+                csr.values[out] = row[j];
+                out++;
+            }
+        }
+    }
+    return csr;
+}
+
+template <typename T>
+std::vector<double> spgemmRowWork(const CSRMatrix<T>& a, const CSRMatrix<T>& b) {
+    std::vector<double> work(a.rows, 0.0);
+    for (int i = 0; i < a.rows; i++) {
+        double rowWork = 0.0;
+        for (int p = a.rowPtr[i]; p < a.rowPtr[i + 1]; p++) {
+            int k = a.colIdx[p];
+            rowWork += b.rowPtr[k + 1] - b.rowPtr[k];
+        }
+        work[i] = rowWork;
+    }
+    return work;
+}
+
+template <typename T>
+void spgemmRows(const CSRMatrix<T>& a, const CSRMatrix<T>& b, T* c, int ldc, int rowBegin, int rowEnd) {
+    const int* bCols = b.colIdx.data();
+    const T* bValues = b.values.data();
+    for (int i = rowBegin; i < rowEnd; i++) {
+        T* cRow = c + static_cast<std::size_t>(i) * ldc;
+        std::fill(cRow, cRow + b.cols, T(0));
+        for (int p = a.rowPtr[i]; p < a.rowPtr[i + 1]; p++) {
+            T aValue = a.values[p];
+            int k = a.colIdx[p];
+            for (int q = b.rowPtr[k]; q < b.rowPtr[k + 1]; q++) {
+                cRow[bCols[q]] = multiplyAdd(cRow[bCols[q]], aValue, bValues[q]);
+            }
+        }
+    }
+}
+
+template CSRMatrix<int> denseToCSR(const int*, int, int, int);
+template CSRMatrix<float> denseToCSR(const float*, int, int, int);
+template CSRMatrix<double> denseToCSR(const double*, int, int, int);
+template std::vector<double> spgemmRowWork(const CSRMatrix<int>&, const CSRMatrix<int>&);
+template std::vector<double> spgemmRowWork(const CSRMatrix<float>&, const CSRMatrix<float>&);
+template std::vector<double> spgemmRowWork(const CSRMatrix<double>&, const CSRMatrix<double>&);
+template void spgemmRows(const CSRMatrix<int>&, const CSRMatrix<int>&, int*, int, int, int);
+template void spgemmRows(const CSRMatrix<float>&, const CSRMatrix<float>&, float*, int, int, int);
+template void spgemmRows(const CSRMatrix<double>&, const CSRMatrix<double>&, double*, int, int, int);
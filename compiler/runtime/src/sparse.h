@@ -0,0 +1,30 @@
+#pragma once
+#include <cstddef>
+#include <vector>
+
+// Compressed sparse row storage: the column indices and values of row i are
+// colIdx/values[rowPtr[i], rowPtr[i + 1]), columns ascending.
+template <typename T>
+struct CSRMatrix {
+    int rows = 0;
+    int cols = 0;
+    std::vector<int> rowPtr;
+    std::vector<int> colIdx;
+    std::vector<T> values;
+    std::size_t nonZeros() const { return values.size(); }
+};
+
+template <typename T>
+CSRMatrix<T> denseToCSR(const T* dense, int rows, int cols, int ld);
+
+// Multiply-adds Gustavson's algorithm performs for each row of A * B: the
+// sum of nnz(B row k) over the non-zeros a(i, k).
+template <typename T>
+std::vector<double> spgemmRowWork(const CSRMatrix<T>& a, const CSRMatrix<T>& b);
+
+// Gustavson row-wise SpGEMM into dense C rows [rowBegin, rowEnd). Each C row
+// is cleared and used as the dense accumulator for a(i, k) * B(k, :), so bands
+// of rows are independent and need no per-thread scratch. int products wrap
+// modulo 2^32 like the dense kernels.
+template <typename T>
+void spgemmRows(const CSRMatrix<T>& a, const CSRMatrix<T>& b, T* c, int ldc, int rowBegin, int rowEnd);
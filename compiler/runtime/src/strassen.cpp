@@ -0,0 +1,186 @@
+#include "strassen.h"
+#include <algorithm>
+#include <chrono>
+#include <iostream>
+
+constexpr int STRASSEN_ADD_BAND_ROWS = 64;
+constexpr int STRASSEN_LEAF_BANDS = 8;
+
+StrassenWinograd::StrassenWinograd(
+    std::shared_ptr<CPUExecutor> cpuExecutor,
+    std::shared_ptr<WorkScheduler> scheduler,
+    std::shared_ptr<Profiler> profiler)
+    : cpuExecutor(cpuExecutor),
+      scheduler(scheduler),
+      profiler(profiler),
+      leafSeconds(0.0),
+      leafMultiplyAdds(0.0),
+      additionSeconds(0.0),
+      additionElements(0.0) {
+}
+
+int StrassenWinograd::recursionDepth(int n, int cutoff) {
+    int depth = 0;
+    while (cutoff > 0 && n % 2 == 0 && n / 2 >= cutoff) {
+        n /= 2;
+        depth++;
+    }
+    return depth;
+}
+
+std::size_t StrassenWinograd::workspaceElements(int n, int depth) {
+    std::size_t total = 0;
+    for (int level = 0; level < depth; level++) {
+        std::size_t h = static_cast<std::size_t>(n >> (level + 1));
+        total += 15 * h * h;
+    }
+    return total;
+}
+
+static inline int wrapAdd(int x, int y) {
+    return static_cast<int>(static_cast<unsigned>(x) + static_cast<unsigned>(y));
+}
+
+static inline int wrapSub(int x, int y) {
+    return static_cast<int>(static_cast<unsigned>(x) - static_cast<unsigned>(y));
+}
+
+void StrassenWinograd::runRowBands(int rows, int bandRows, const std::function<void(int, int)>& body) {
+    int tasks = (rows + bandRows - 1) / bandRows;
+    cpuExecutor->executeTasks(tasks, [&](int task) {
+        int r0 = task * bandRows;
+        body(r0, std::min(rows, r0 + bandRows));
+    }, scheduler, profiler);
+}
+
+void StrassenWinograd::recurse(const int* a, int lda, const int* b, int ldb, int* c, int ldc,
+                               int n, int level, int depth, int* workspace) {
+    int h = n / 2;
+    std::size_t hh = static_cast<std::size_t>(h) * h;
+    int* s1 = workspace;
+    int* s2 = s1 + hh;
+    int* s3 = s2 + hh;
+    int* s4 = s3 + hh;
+    int* t1 = s4 + hh;
+    int* t2 = t1 + hh;
+    int* t3 = t2 + hh;
+    int* t4 = t3 + hh;
+    int* m[7];
+    for (int i = 0; i < 7; i++) {
+        m[i] = t4 + hh * (i + 1);
+    }
+    int* next = m[6] + hh;
+    const int* a11 = a;
+    const int* a12 = a + h;
+    const int* a21 = a + static_cast<std::size_t>(h) * lda;
+    const int* a22 = a21 + h;
+    const int* b11 = b;
+    const int* b12 = b + h;
+    const int* b21 = b + static_cast<std::size_t>(h) * ldb;
+    const int* b22 = b21 + h;
+
+    auto addStart = std::chrono::steady_clock::now();
+    runRowBands(h, STRASSEN_ADD_BAND_ROWS, [&](int r0, int r1) {
+        for (int r = r0; r < r1; r++) {
+            std::size_t ao = static_cast<std::size_t>(r) * lda;
+            std::size_t bo = static_cast<std::size_t>(r) * ldb;
+            std::size_t wo = static_cast<std::size_t>(r) * h;
+            for (int j = 0; j < h; j++) {
+                int x1 = wrapAdd(a21[ao + j], a22[ao + j]);
+                int x2 = wrapSub(x1, a11[ao + j]);
+                s1[wo + j] = x1;
+                s2[wo + j] = x2;
+                s3[wo + j] = wrapSub(a11[ao + j], a21[ao + j]);
+                s4[wo + j] = wrapSub(a12[ao + j], x2);
+                int y1 = wrapSub(b12[bo + j], b11[bo + j]);
+                int y2 = wrapSub(b22[bo + j], y1);
+                t1[wo + j] = y1;
+                t2[wo + j] = y2;
+                t3[wo + j] = wrapSub(b22[bo + j], b12[bo + j]);
+                t4[wo + j] = wrapSub(y2, b21[bo + j]);
+            }
+        }
+    });
+    additionSeconds += std::chrono::duration<double>(std::chrono::steady_clock::now() - addStart).count();
+    additionElements += 8.0 * hh;
+
+    struct Product { const int* x; int ldx; const int* y; int ldy; int* out; };
+    Product products[7] = {
+        {a11, lda, b11, ldb, m[0]},
+        {a12, lda, b21, ldb, m[1]},
+        {s4, h, b22, ldb, m[2]},
+        {a22, lda, t4, h, m[3]},
+        {s1, h, t1, h, m[4]},
+        {s2, h, t2, h, m[5]},
+        {s3, h, t3, h, m[6]},
+    };
+
+    if (level + 1 == depth) {
+        int bandRows = std::max(1, (h + STRASSEN_LEAF_BANDS - 1) / STRASSEN_LEAF_BANDS);
+        int bandsPerLeaf = (h + bandRows - 1) / bandRows;
+        auto leafStart = std::chrono::steady_clock::now();
+        cpuExecutor->executeTasks(7 * bandsPerLeaf, [&](int task) {
+            const Product& p = products[task / bandsPerLeaf];
+            int r0 = (task % bandsPerLeaf) * bandRows;
+            int rows = std::min(h, r0 + bandRows) - r0;
+            cpuExecutor->multiplyBlock(rows, h, h,
+                                       p.x + static_cast<std::size_t>(r0) * p.ldx, p.ldx,
+                                       p.y, p.ldy,
+                                       p.out + static_cast<std::size_t>(r0) * h, h);
+        }, scheduler, profiler);
+        leafSeconds += std::chrono::duration<double>(std::chrono::steady_clock::now() - leafStart).count();
+        leafMultiplyAdds += 7.0 * hh * h;
+    } else {
+        for (const Product& p : products) {
+            recurse(p.x, p.ldx, p.y, p.ldy, p.out, h, h, level + 1, depth, next);
+        }
+    }
+
+    addStart = std::chrono::steady_clock::now();
+    int* c11 = c;
+    int* c12 = c + h;
+    int* c21 = c + static_cast<std::size_t>(h) * ldc;
+    int* c22 = c21 + h;
+    runRowBands(h, STRASSEN_ADD_BAND_ROWS, [&](int r0, int r1) {
+        for (int r = r0; r < r1; r++) {
+            std::size_t co = static_cast<std::size_t>(r) * ldc;
+            std::size_t wo = static_cast<std::size_t>(r) * h;
+            for (int j = 0; j < h; j++) {
+                int p1 = m[0][wo + j];
+                int u2 = wrapAdd(p1, m[5][wo + j]);
+                int u3 = wrapAdd(u2, m[6][wo + j]);
+                int u4 = wrapAdd(u2, m[4][wo + j]);
+                c11[co + j] = wrapAdd(p1, m[1][wo + j]);
+                c12[co + j] = wrapAdd(u4, m[2][wo + j]);
+                c21[co + j] = wrapSub(u3, m[3][wo + j]);
+                c22[co + j] = wrapAdd(u3, m[4][wo + j]);
+            }
+        }
+    });
+    additionSeconds += std::chrono::duration<double>(std::chrono::steady_clock::now() - addStart).count();
+    additionElements += 7.0 * hh;
+}
+
+void StrassenWinograd::multiply(const int* a, const int* b, int* c, int n, int depth, int* workspace) {
+    std::cout << "DEBUG: Strassen-Winograd multiply of size " << n << " with depth " << depth
+              << " (leaf size " << (n >> depth) << ")" << std::endl;
+    if (depth <= 0) {
+        cpuExecutor->multiplyBlock(n, n, n, a, n, b, n, c, n);
+        return;
+    }
+    recurse(a, n, b, n, c, n, n, 0, depth, workspace);
+}
+
+double StrassenWinograd::leafRate() const {
+    return leafSeconds > 0.0 ? leafMultiplyAdds / leafSeconds : 0.0;
+}
+
+// One recursion level at size n saves n^3/8 multiply-adds and costs 15 (n/2)^2
+// additions, so it pays off once n > 30 * (multiply-add rate / addition rate).
+int StrassenWinograd::estimatedCrossover() const {
+    if (leafSeconds <= 0.0 || additionSeconds <= 0.0 || additionElements <= 0.0) {
+        return 0;
+    }
+    double additionRate = additionElements / additionSeconds;
+    return static_cast<int>(30.0 * leafRate() / additionRate);
+}
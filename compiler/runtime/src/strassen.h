@@ -0,0 +1,36 @@
+#pragma once
+#include <cstddef>
+#include <functional>
+#include <memory>
+#include "cpu_executor.h"
+#include "work_stealing.h"
+#include "profiler.h"
+
+// Strassen-Winograd (7 multiplies, 15 additions per level) over int32 with
+// wraparound arithmetic, which keeps the result bit-identical to the classical
+// product. Recursion stops once the half size would drop below the cutoff; the
+// 7 leaf products of the last level are split into row bands and dispatched to
+// the CPU queue of the work-stealing scheduler as independent tasks.
+class StrassenWinograd {
+public:
+    StrassenWinograd(
+        std::shared_ptr<CPUExecutor> cpuExecutor,
+        std::shared_ptr<WorkScheduler> scheduler,
+        std::shared_ptr<Profiler> profiler);
+    static int recursionDepth(int n, int cutoff);
+    static std::size_t workspaceElements(int n, int depth);
+    void multiply(const int* a, const int* b, int* c, int n, int depth, int* workspace);
+    int estimatedCrossover() const;
+    double leafRate() const;
+private:
+    std::shared_ptr<CPUExecutor> cpuExecutor;
+    std::shared_ptr<WorkScheduler> scheduler;
+    std::shared_ptr<Profiler> profiler;
+    double leafSeconds;
+    double leafMultiplyAdds;
+    double additionSeconds;
+    double additionElements;
+    void recurse(const int* a, int lda, const int* b, int ldb, int* c, int ldc,
+                 int n, int level, int depth, int* workspace);
+    void runRowBands(int rows, int bandRows, const std::function<void(int, int)>& body);
+};
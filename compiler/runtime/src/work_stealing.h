@@ -1,11 +1,14 @@
 #pragma once
-#include <queue>
+#include <deque>
+#include <memory>
+#include <vector>
 #include <mutex>
 #include <condition_variable>
 #include <atomic>
 #include <chrono>
 #include "matrix_utils.h"
 #include "profiler.h"
+#include "chase_lev_deque.h"
 
 enum class DeviceType {
     CPU,
@@ -16,10 +19,21 @@ enum class DeviceType {
 class WorkStealingScheduler {
 public:
     struct DeviceQueue {
-        std::queue<WorkChunk> queue;
+        // Injection queue: chunks handed to the device by addWork and retire,
+        // and the split-off rest of chunks other devices steal. Workers move
+        // shares of it into their deques.
+        std::deque<WorkChunk> queue;
         std::mutex mutex;
-        std::condition_variable cv;
+        // One Chase-Lev deque per worker registered with setWorkerCount.
+        std::vector<std::unique_ptr<ChaseLevDeque<WorkChunk*>>> deques;
+        // Workers that found nothing to take; owners split chunks for them.
+        std::atomic<int> hungryWorkers{0};
+        // Workers holding a chunk they have not finished yet.
         std::atomic<int> activeWorkers;
+        // Result cells of the chunks finished since resetProgress(), and
+        // when the last of them finished, in steady_clock nanoseconds.
+        std::atomic<long long> finishedCells{0};
+        std::atomic<long long> lastFinish{0};
         std::chrono::steady_clock::time_point lastWorkTime;   
         double avgProcessingTime;   
         int chunksProcessed;
@@ -28,28 +42,48 @@ public:
     WorkStealingScheduler();
     ~WorkStealingScheduler();
     void setProfiler(std::shared_ptr<Profiler> profiler) { this->profiler = profiler; }
-    void initialize();
     void addWork(const std::vector<WorkChunk>& chunks, DeviceType device);
-    WorkChunk* getWork(DeviceType device);
+    // Gives the device count worker deques; call with none of its workers
+    // running. Chunks left in the old deques go back to the injection queue.
+    void setWorkerCount(DeviceType device, int count);
+    // A chunk for worker (an index below the setWorkerCount count, or -1 for
+    // a device without deques), or nullptr once every chunk added has been
+    // finished. Workers pop their own deque, then take a share of the
+    // injection queue, then steal from sibling deques and other devices, and
+    // sleep only when none of those has anything to take.
+    WorkChunk* getWork(DeviceType device, int worker = -1);
+    // Hands back a chunk from getWork once its result is written.
+    void finishWork(DeviceType device, WorkChunk* chunk);
+    // For a device whose executor has returned: chunks still queued for it
+    // move to the CPU.
+    void retire(DeviceType device);
     bool hasWork(DeviceType device);
+    // Chunks waiting in the device's injection queue and worker deques.
+    int queuedChunks(DeviceType device);
     DeviceQueue& getQueue(DeviceType device);
+    // Blocks until every chunk added has been finished.
     void waitForCompletion();
-    std::atomic<bool> cpuThreadExited{false};
-    std::atomic<bool> gpuThreadExited{false};
-    std::atomic<bool> aneThreadExited{false};
+    // Clears every device's finishedCells and lastFinish.
+    void resetProgress();
+    void setGPUEnabled(bool enabled) { gpuEnabled = enabled; }
     void recordChunkProcessingTime(DeviceType device, double seconds);
     WorkChunk* steal(DeviceType fromDevice, DeviceType toDevice);
     DeviceType selectDeviceToStealFrom(DeviceType idleDevice);
 private:
     DeviceQueue queues[3];  
-    std::atomic<int> totalWork;
-    std::atomic<bool> shutdownRequested;
-    std::atomic<bool> monitorActive;
-    void monitor();
+    // Chunks added, or split off, and not finished yet.
+    std::atomic<int> outstandingWork;
+    std::atomic<bool> gpuEnabled{true};
+    // Idle workers and waitForCompletion sleep on workEvent until
+    // workEvents moves: new chunks became takeable, or the last one finished.
+    std::mutex eventMutex;
+    std::condition_variable workEvent;
+    long long workEvents = 0;
+    void signalWork();
     std::shared_ptr<Profiler> profiler;
     std::string getDeviceName(DeviceType device);
-    std::atomic<int64_t> lastCpuWorkTime;
-    std::atomic<int64_t> lastGpuWorkTime;
-    std::atomic<int64_t> lastAneWorkTime;
+    WorkChunk* takeWork(DeviceQueue& queue, int worker);
+    // Removes every queued chunk of the device, from any thread.
+    void drainQueued(DeviceQueue& queue, std::vector<WorkChunk>& chunks);
 };
 using WorkScheduler = WorkStealingScheduler;
\ No newline at end of file
@@ -0,0 +1,142 @@
+#include "worker_pool.h"
+#include "cpu_topology.h"
+#include <algorithm>
+#include <atomic>
+#include <memory>
+#include <utility>
+
+WorkerPool::WorkerPool(int threads, std::vector<int> cpus) : cpus(std::move(cpus)) {
+    std::lock_guard<std::mutex> runLock(runMutex);
+    grow(threads);
+}
+
+WorkerPool::~WorkerPool() {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        stopping = true;
+    }
+    wake.notify_all();
+    for (auto& thread : threads) {
+        thread.join();
+    }
+}
+
+int WorkerPool::size() {
+    std::lock_guard<std::mutex> runLock(runMutex);
+    return static_cast<int>(threads.size());
+}
+
+// Called with runMutex held, so no job is running while threads are added.
+void WorkerPool::grow(int count) {
+    long long seen;
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        seen = generation;
+    }
+    while (static_cast<int>(threads.size()) < count) {
+        int member = static_cast<int>(threads.size()) + 1;
+        threads.emplace_back([this, member, seen]() {
+            if (!cpus.empty()) {
+                pinCurrentThread(cpus[member % cpus.size()]);
+            }
+            work(member, seen);
+        });
+    }
+}
+
+void WorkerPool::run(int members, const std::function<void(int)>& body) {
+    std::lock_guard<std::mutex> runLock(runMutex);
+    members = std::max(1, members);
+    grow(members - 1);
+    std::unique_ptr<ScopedCpuPin> callerPin;
+    if (!cpus.empty()) {
+        callerPin = std::make_unique<ScopedCpuPin>(cpus[0]);
+    }
+    if (members > 1) {
+        std::lock_guard<std::mutex> lock(mutex);
+        current = &body;
+        teamSize = members;
+        busy = members - 1;
+        generation++;
+    }
+    wake.notify_all();
+    body(0);
+    std::unique_lock<std::mutex> lock(mutex);
+    done.wait(lock, [this]() { return busy == 0; });
+}
+
+void WorkerPool::runTasks(int members, int count, const std::function<void(int)>& task) {
+    if (count <= 0) {
+        return;
+    }
+    std::atomic<int> next{0};
+    run(std::min(members, count), [&](int) {
+        for (int i; (i = next.fetch_add(1)) < count;) {
+            task(i);
+        }
+    });
+}
+
+// Members outside the current team go straight back to sleep.
+void WorkerPool::work(int member, long long seen) {
+    std::unique_lock<std::mutex> lock(mutex);
+    while (true) {
+        wake.wait(lock, [&]() { return stopping || generation != seen; });
+        if (stopping) {
+            return;
+        }
+        seen = generation;
+        if (member >= teamSize) {
+            continue;
+        }
+        const std::function<void(int)>* body = current;
+        lock.unlock();
+        (*body)(member);
+        lock.lock();
+        if (--busy == 0) {
+            done.notify_all();
+        }
+    }
+}
+
+DeviceThread::~DeviceThread() {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        stopping = true;
+    }
+    cv.notify_all();
+    if (thread.joinable()) {
+        thread.join();
+    }
+}
+
+void DeviceThread::start(std::function<void()> task) {
+    std::lock_guard<std::mutex> lock(mutex);
+    if (!thread.joinable()) {
+        thread = std::thread([this]() { loop(); });
+    }
+    job = std::move(task);
+    pending = true;
+    cv.notify_all();
+}
+
+void DeviceThread::join() {
+    std::unique_lock<std::mutex> lock(mutex);
+    cv.wait(lock, [this]() { return !pending; });
+}
+
+void DeviceThread::loop() {
+    std::unique_lock<std::mutex> lock(mutex);
+    while (true) {
+        cv.wait(lock, [this]() { return stopping || pending; });
+        if (!pending) {
+            return;
+        }
+        std::function<void()> task = std::move(job);
+        lock.unlock();
+        task();
+        lock.lock();
+        pending = false;
+        cv.notify_all();
+    }
+}
@@ -0,0 +1,61 @@
+#pragma once
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// CPU worker threads started once and parked between jobs. run() hands one
+// job to a team of members, the calling thread being member 0, and returns
+// when every member has finished. The threads, and the thread_local packing
+// buffers they grow, live as long as the pool, so every instruction and
+// program reuses them. Jobs run one at a time. With cpus, member i is pinned
+// to cpus[i % size]; the caller is pinned to cpus[0] only for the length of
+// each job and then gets its own affinity back.
+class WorkerPool {
+public:
+    explicit WorkerPool(int threads = 0, std::vector<int> cpus = {});
+    ~WorkerPool();
+    WorkerPool(const WorkerPool&) = delete;
+    WorkerPool& operator=(const WorkerPool&) = delete;
+    // Pool threads besides the caller; run() adds more when a team needs them.
+    int size();
+    void run(int members, const std::function<void(int)>& body);
+    // count tasks over a team of members, each member taking the next task
+    // index until none are left.
+    void runTasks(int members, int count, const std::function<void(int)>& task);
+private:
+    std::vector<std::thread> threads;
+    std::vector<int> cpus;
+    std::mutex runMutex;
+    std::mutex mutex;
+    std::condition_variable wake;
+    std::condition_variable done;
+    const std::function<void(int)>* current = nullptr;
+    int teamSize = 0;
+    int busy = 0;
+    long long generation = 0;
+    bool stopping = false;
+    void grow(int count);
+    void work(int member, long long seen);
+};
+
+// A long-lived thread for one device's executor: start() hands it a job and
+// returns at once, join() waits for that job to finish.
+class DeviceThread {
+public:
+    DeviceThread() = default;
+    ~DeviceThread();
+    DeviceThread(const DeviceThread&) = delete;
+    DeviceThread& operator=(const DeviceThread&) = delete;
+    void start(std::function<void()> job);
+    void join();
+private:
+    std::thread thread;
+    std::mutex mutex;
+    std::condition_variable cv;
+    std::function<void()> job;
+    bool pending = false;
+    bool stopping = false;
+    void loop();
+};
@@ -0,0 +1,193 @@
+// Runs every CPU kernel family once per dispatch tier this machine supports
+// and compares it with a plain reference. Tiers the CPU lacks are reported as
+// skipped, so the Apple build exercises NEON and x86 builds AVX2/AVX-512.
+#include "bit_gemm.h"
+#include "cpu_features.h"
+#include "cpu_gemm.h"
+#include "elementwise.h"
+#include "small_gemm.h"
+#include <cstdint>
+#include <cstring>
+#include <iostream>
+#include <string>
+#include <vector>
+
+static int failures = 0;
+
+static void check(bool ok, CPUIsa isa, const std::string& what) {
+    std::cout << (ok ? "PASS " : "FAIL ") << isaToString(isa) << " " << what << std::endl;
+    if (!ok) {
+        failures++;
+    }
+}
+
+// Small integers, so float sums are exact whatever order a kernel adds in.
+template <typename T>
+static std::vector<T> randomValues(std::size_t count, unsigned seed) {
+    std::vector<T> values(count);
+    for (auto& v : values) {
+        seed = seed * 1103515245u + 12345u;
+        v = static_cast<T>(static_cast<int>((seed >> 16) % 17) - 8);
+    }
+    return values;
+}
+
+template <typename T>
+static void referenceGemm(int m, int n, int k, const T* a, int lda, const T* b, int ldb, T* c, int ldc) {
+    for (int i = 0; i < m; i++) {
+        for (int j = 0; j < n; j++) {
+            T sum = T(0);
+            for (int p = 0; p < k; p++) {
+                sum += a[i * lda + p] * b[p * ldb + j];
+            }
+            c[i * ldc + j] = sum;
+        }
+    }
+}
+
+template <typename T>
+static bool sameValues(const std::vector<T>& x, const std::vector<T>& y) {
+    return x.size() == y.size() && std::memcmp(x.data(), y.data(), x.size() * sizeof(T)) == 0;
+}
+
+static void testGemmKernels(CPUIsa isa, const CPUFeatures& features) {
+    check(verifyGemmMicroKernel(gemmMicroKernel(isa)), isa, "int32 micro-kernel");
+    check(verifyGemmFloatMicroKernel(gemmF32MicroKernel(isa)), isa, "f32 micro-kernel");
+    check(verifyGemmFloatMicroKernel(gemmF64MicroKernel(isa)), isa, "f64 micro-kernel");
+    for (KernelWidth width : {KernelWidth::INT16, KernelWidth::INT8}) {
+        for (const GemmNarrowKernel* kernel : gemmNarrowKernels(width, isa, features)) {
+            check(verifyGemmNarrowKernel(*kernel), isa,
+                  std::string(kernelWidthToString(width)) + " kernel " + isaToString(kernel->isa) +
+                      (kernel->mixedSign ? (kernel->aUnsigned ? " u8s8" : " s8u8") : ""));
+        }
+    }
+    check(verifyGemmModKernel(gemmModKernel(isa)), isa, "mod kernel");
+    check(verifyGemmCrtKernel(gemmCrtKernel(isa)), isa, "CRT digits");
+    for (Semiring semiring : {Semiring::MIN_PLUS, Semiring::MAX_PLUS, Semiring::OR_AND}) {
+        std::string name = std::string(semiringToString(semiring)) + " kernel";
+        check(verifyGemmSemiringKernel(*gemmI32SemiringKernel(semiring, isa)), isa, "i32 " + name);
+        if (const auto* kernel = gemmF32SemiringKernel(semiring, isa)) {
+            check(verifyGemmSemiringKernel(*kernel), isa, "f32 " + name);
+        }
+        if (const auto* kernel = gemmF64SemiringKernel(semiring, isa)) {
+            check(verifyGemmSemiringKernel(*kernel), isa, "f64 " + name);
+        }
+    }
+    const BitGemmKernel& bitKernel = bitGemmKernel(isa, features);
+    check(verifyBitGemmKernel(bitKernel), isa, std::string("bit GEMM ") + bitKernel.name);
+}
+
+template <typename T>
+static void testSmallGemm(CPUIsa isa, const char* type) {
+    bool ok = true;
+    for (int n : {8, 16, 32, 48, 64, 13}) {
+        const int m = 11, k = 37, lda = k + 3, ldb = n + 5, ldc = n + 2;
+        std::vector<T> a = randomValues<T>(static_cast<std::size_t>(m) * lda, 7 + n);
+        std::vector<T> b = randomValues<T>(static_cast<std::size_t>(k) * ldb, 19 + n);
+        std::vector<T> expected(static_cast<std::size_t>(m) * ldc, T(0));
+        std::vector<T> actual = expected;
+        referenceGemm(m, n, k, a.data(), lda, b.data(), ldb, expected.data(), ldc);
+        gemmSmall(isa, m, n, k, a.data(), lda, b.data(), ldb, actual.data(), ldc);
+        ok = ok && sameValues(expected, actual);
+    }
+    for (int size : {2, 4, 8, 16, 32}) {
+        GemmFixedKernel<T> kernel = gemmFixedKernel<T>(isa, size, size, size);
+        std::vector<T> a = randomValues<T>(static_cast<std::size_t>(size) * size, 3 + size);
+        std::vector<T> b = randomValues<T>(static_cast<std::size_t>(size) * size, 5 + size);
+        std::vector<T> expected(static_cast<std::size_t>(size) * size), actual(expected.size());
+        referenceGemm(size, size, size, a.data(), size, b.data(), size, expected.data(), size);
+        ok = ok && kernel != nullptr;
+        if (kernel) {
+            kernel(a.data(), size, b.data(), size, actual.data(), size);
+            ok = ok && sameValues(expected, actual);
+        }
+        if (size == 32) {
+            GemmFixedKernel<T> accumulate = gemmFixedKernel<T>(isa, size, size, size, true);
+            ok = ok && accumulate != nullptr;
+            if (accumulate) {
+                std::vector<T> twice = actual;
+                accumulate(a.data(), size, b.data(), size, twice.data(), size);
+                for (std::size_t i = 0; i < expected.size(); i++) {
+                    ok = ok && twice[i] == expected[i] + expected[i];
+                }
+            }
+        }
+    }
+    check(ok, isa, std::string(type) + " small and fixed-size GEMM");
+}
+
+template <typename T>
+static T referenceElementwise(ElementwiseOp op, T a, T b, T alpha) {
+    switch (op) {
+        case ElementwiseOp::ADD: return a + b;
+        case ElementwiseOp::SUB: return a - b;
+        default: return alpha * a;
+    }
+}
+
+// Odd lengths and pointers one element past an allocation's start cover the
+// vector tails and the unaligned heads of the streaming stores.
+template <typename T>
+static void testElementwise(CPUIsa isa, const char* type) {
+    bool ok = true;
+    const std::size_t length = 4099;
+    const T alpha = T(3);
+    std::vector<T> a = randomValues<T>(length + 1, 41);
+    std::vector<T> b = randomValues<T>(length + 1, 43);
+    for (ElementwiseOp op : {ElementwiseOp::ADD, ElementwiseOp::SUB, ElementwiseOp::SCALE}) {
+        std::vector<T> expected(length);
+        for (std::size_t i = 0; i < length; i++) {
+            expected[i] = referenceElementwise(op, a[i + 1], b[i + 1], alpha);
+        }
+        for (bool stream : {false, true}) {
+            std::vector<T> c(length + 1);
+            elementwise(isa, op, length, a.data() + 1, b.data() + 1, alpha, c.data() + 1, stream);
+            ok = ok && sameValues(expected, std::vector<T>(c.begin() + 1, c.end()));
+            std::vector<T> inPlace = a;
+            elementwise(isa, op, length, inPlace.data() + 1, b.data() + 1, alpha, inPlace.data() + 1, stream);
+            ok = ok && sameValues(expected, std::vector<T>(inPlace.begin() + 1, inPlace.end()));
+        }
+    }
+    check(ok, isa, std::string(type) + " elementwise");
+}
+
+template <typename T>
+static void testTranspose(CPUIsa isa, const char* type) {
+    const int rows = 37, cols = 53, lda = cols + 3, ldc = rows + 1;
+    std::vector<T> a(static_cast<std::size_t>(rows) * lda);
+    for (std::size_t i = 0; i < a.size(); i++) {
+        a[i] = static_cast<T>(i * 2654435761u);
+    }
+    std::vector<T> c(static_cast<std::size_t>(cols) * ldc, T(0));
+    transpose(isa, rows, cols, a.data(), lda, c.data(), ldc);
+    bool ok = true;
+    for (int i = 0; i < rows; i++) {
+        for (int j = 0; j < cols; j++) {
+            ok = ok && c[static_cast<std::size_t>(j) * ldc + i] == a[static_cast<std::size_t>(i) * lda + j];
+        }
+    }
+    check(ok, isa, std::string(type) + " transpose");
+}
+
+int main() {
+    CPUFeatures features = detectCPUFeatures();
+    int tested = 0;
+    for (CPUIsa isa : {CPUIsa::SCALAR, CPUIsa::AVX2, CPUIsa::AVX512, CPUIsa::NEON}) {
+        if (!isaSupported(isa, features)) {
+            std::cout << "SKIP " << isaToString(isa) << " (not supported on this CPU)" << std::endl;
+            continue;
+        }
+        tested++;
+        testGemmKernels(isa, features);
+        testSmallGemm<int>(isa, "i32");
+        testSmallGemm<float>(isa, "f32");
+        testSmallGemm<double>(isa, "f64");
+        testElementwise<int>(isa, "i32");
+        testElementwise<float>(isa, "f32");
+        testElementwise<double>(isa, "f64");
+        testTranspose<uint32_t>(isa, "32-bit");
+        testTranspose<uint64_t>(isa, "64-bit");
+    }
+    std::cout << tested << " tiers tested, " << failures << " failures" << std::endl;
+    return failures == 0 ? 0 : 1;
+}
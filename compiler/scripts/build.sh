@@ -48,9 +48,14 @@ cmake .. -DCMAKE_BUILD_TYPE=Release -DCMAKE_MAKE_PROGRAM=make
 echo "Building project..."
 make -j$(sysctl -n hw.ncpu)
 
+echo "Running kernel tests..."
+ctest --output-on-failure
+
 echo "Build complete!"
 echo "Executables are in build/ directory:"
 echo "- build/programs/matrix_mult/matrix_mult"
+echo "- build/programs/matrix_mult_float/matrix_mult_float"
+echo "- build/programs/matrix_mult_rect/matrix_mult_rect"
 echo "- build/compiler/compiler"
 echo "- build/runtime/runtime"
 
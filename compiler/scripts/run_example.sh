@@ -8,6 +8,7 @@ echo "Building..."
 scripts/build.sh
 
 INPUT_NAME="${1:-example_matrix_input}"
+PROGRAM="${2:-matrix_mult}"
 INPUT_FILE="programs/test_inputs/${INPUT_NAME}.txt"
 
 EXPECTED_OUTPUT_FILE="programs/test_outputs/${INPUT_NAME%_input}_output.txt"
@@ -17,13 +18,13 @@ if [ ! -f "${INPUT_FILE}" ]; then
     exit 1
 fi
 
-echo "Running matrix multiplication with input: ${INPUT_NAME}"
+echo "Running ${PROGRAM} with input: ${INPUT_NAME}"
 echo "==============================================="
 
 echo -e "\n1. Compiling to bytecode (if needed):"
 echo "-----------------------------------------"
-if [ ! -f "$(pwd)/programs/matrix_mult/main.cpp.jsonl" ]; then
-    build/compiler/compiler $(pwd)/programs/matrix_mult/main.cpp
+if [ ! -f "$(pwd)/programs/${PROGRAM}/main.cpp.jsonl" ]; then
+    build/compiler/compiler $(pwd)/programs/${PROGRAM}/main.cpp
     echo "Bytecode generated successfully."
 else
     echo "Using existing bytecode."
@@ -37,12 +38,20 @@ echo "Processing large matrix (${INPUT_NAME})..."
 
 TEMP_OUTPUT=$(mktemp)
 
-cat "${INPUT_FILE}" | build/runtime/runtime $(pwd)/programs/matrix_mult/main.cpp.jsonl > "${TEMP_OUTPUT}" 2>&1
+cat "${INPUT_FILE}" | build/runtime/runtime $(pwd)/programs/${PROGRAM}/main.cpp.jsonl > "${TEMP_OUTPUT}" 2>&1
 
-MATRIX_SIZE=$(head -n 1 "${INPUT_FILE}")
-echo "Matrix size: ${MATRIX_SIZE}x${MATRIX_SIZE}"
+# The first line is n for square programs, or m k n for rectangular ones.
+read -r -a DIMS < <(head -n 1 "${INPUT_FILE}")
+RESULT_ROWS=${DIMS[0]}
+if [ ${#DIMS[@]} -eq 3 ]; then
+    echo "Matrix size: ${DIMS[0]}x${DIMS[1]} * ${DIMS[1]}x${DIMS[2]}"
+else
+    echo "Matrix size: ${RESULT_ROWS}x${RESULT_ROWS}"
+fi
 
-grep -E "^([0-9]+ )+[0-9]+$" "${TEMP_OUTPUT}" | head -n ${MATRIX_SIZE} > "${TEMP_OUTPUT}.matrix"
+# Result rows: signed integers or decimals such as -0.5625.
+NUMBER="-?[0-9]+(\\.[0-9]+)?([eE][-+]?[0-9]+)?"
+grep -E "^(${NUMBER} )+${NUMBER}$" "${TEMP_OUTPUT}" | head -n ${RESULT_ROWS} > "${TEMP_OUTPUT}.matrix"
 
 if [ -f "${EXPECTED_OUTPUT_FILE}" ]; then
     echo "Validating output against expected result..."